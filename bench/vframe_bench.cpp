@@ -0,0 +1,608 @@
+﻿// vframe_bench - renderer stress scenes with machine-readable results
+//
+// Usage: vframe_bench [--frames <n>] [--scene <name>]... [--out <results.json>]
+//                     [--compare <baseline.json>] [--threshold <percent>] [--list]
+//
+// Every scene creates its own VulkanContext on a hidden window and reports frames/sec,
+// CPU milliseconds per drawFrame, p99 frame time and peak process memory as JSON.
+// Peak memory is the process high-water mark, run one --scene per process to isolate it.
+// With --compare the results are checked against an earlier run: the exit code is 2
+// when any scene got worse than the threshold (default 10%), so it can gate an upgrade.
+//
+// No display or GPU on the machine: xvfb-run with lavapipe,
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json xvfb-run ./vframe_bench
+// Run from the build directory, the scene shaders are loaded from shaders/*.spv.
+
+#include <vFrame/vf_math.hpp>
+#include <vFrame/vf_vulkan.hpp>
+#include <vFrame/window.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using vf_vulkan::VulkanContext;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+    using ContextPtr = std::unique_ptr<VulkanContext, vf_vulkan::VulkanContextDeleter>;
+
+    constexpr int WINDOW_WIDTH = 1280;
+    constexpr int WINDOW_HEIGHT = 720;
+
+    struct SceneResult {
+        std::string name;
+        uint32_t frames = 0;
+        double fps = 0.0;
+        double cpuMsPerFrame = 0.0;   // Time spent inside drawFrame
+        double p99FrameMs = 0.0;      // Frame to frame
+        uint64_t peakMemoryBytes = 0;
+    };
+
+    uint64_t
+    peakMemoryBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        return counters.PeakWorkingSetSize;
+#else
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);        // Bytes
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // Kilobytes
+#endif
+#endif
+    }
+
+    // ### Scene content ###
+
+    // Perspective (Vulkan depth 0..1, y down) times a look-at from eye to the origin
+    vf_core::Mat4
+    viewProjection(const vf_core::Vec3& eye, float aspect)
+    {
+        return vf_core::perspective(1.0472f, aspect, 0.1f, 1000.0f) * // 60 degrees
+            vf_core::lookAt(eye, vf_core::Vec3{}, vf_core::Vec3{ 0.0f, 1.0f, 0.0f });
+    }
+
+    // Unit sphere as a latitude/longitude grid
+    void
+    makeSphere(uint32_t rings, uint32_t segments, std::vector<vf_vulkan::SceneVertex>& vertices,
+        std::vector<uint32_t>& indices)
+    {
+        const float pi = 3.14159265f;
+        for (uint32_t ring = 0; ring <= rings; ring++) {
+            const float theta = pi * ring / rings;
+            for (uint32_t segment = 0; segment <= segments; segment++) {
+                const float phi = 2.0f * pi * segment / segments;
+                vf_vulkan::SceneVertex vertex{};
+                vertex.normal[0] = std::sin(theta) * std::cos(phi);
+                vertex.normal[1] = std::cos(theta);
+                vertex.normal[2] = std::sin(theta) * std::sin(phi);
+                std::memcpy(vertex.position, vertex.normal, sizeof(vertex.position));
+                vertex.uv[0] = static_cast<float>(segment) / segments;
+                vertex.uv[1] = static_cast<float>(ring) / rings;
+                vertices.push_back(vertex);
+            }
+        }
+        for (uint32_t ring = 0; ring < rings; ring++) {
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                const uint32_t a = ring * (segments + 1) + segment;
+                const uint32_t b = a + segments + 1;
+                indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+    }
+
+    // Scene geometry taken by uploads, in vertices and indices
+    struct GeometryUsage {
+        uint32_t vertices = 0;
+        uint32_t indices = 0;
+    };
+
+    // Cube of count objects around the origin, two LODs of the same sphere
+    GeometryUsage
+    addObjectGrid(VulkanContext& context, uint32_t count)
+    {
+        GeometryUsage usage;
+        std::vector<vf_vulkan::SceneVertex> vertices;
+        std::vector<uint32_t> indices;
+        makeSphere(32, 64, vertices, indices);
+        vf_vulkan::MeshRange detailed = context.uploadSceneMesh(vertices.data(), static_cast<uint32_t>(vertices.size()),
+            indices.data(), static_cast<uint32_t>(indices.size()));
+        usage.vertices += static_cast<uint32_t>(vertices.size());
+        usage.indices += static_cast<uint32_t>(indices.size());
+        vertices.clear();
+        indices.clear();
+        makeSphere(8, 16, vertices, indices);
+        vf_vulkan::MeshRange coarse = context.uploadSceneMesh(vertices.data(), static_cast<uint32_t>(vertices.size()),
+            indices.data(), static_cast<uint32_t>(indices.size()));
+        usage.vertices += static_cast<uint32_t>(vertices.size());
+        usage.indices += static_cast<uint32_t>(indices.size());
+
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+        std::vector<vf_vulkan::SceneObjectDesc> objects(count);
+        for (uint32_t i = 0; i < count; i++) {
+            vf_vulkan::SceneObjectDesc& object = objects[i];
+            object.transform[12] = 3.0f * (static_cast<float>(i % side) - side * 0.5f);
+            object.transform[13] = 3.0f * (static_cast<float>((i / side) % side) - side * 0.5f);
+            object.transform[14] = 3.0f * (static_cast<float>(i / (side * side)) - side * 0.5f);
+            object.lods[0] = detailed;
+            object.lods[1] = coarse;
+            object.lodDistances[0] = 40.0f;
+            object.lodCount = 2;
+        }
+        context.addSceneObjects(objects.data(), count);
+        return usage;
+    }
+
+    void
+    setOrbitCamera(VulkanContext& context, uint32_t frame, float distance)
+    {
+        const float angle = frame * 0.01f;
+        const vf_core::Vec3 eye = { distance * std::cos(angle), distance * 0.3f, distance * std::sin(angle) };
+        const vf_core::Mat4 matrix = viewProjection(eye, static_cast<float>(WINDOW_WIDTH) / WINDOW_HEIGHT);
+        context.setCamera(&matrix.columns[0].x, &eye.x);
+    }
+
+    // ### Measurement ###
+
+    struct FrameSamples {
+        std::vector<double> cpuMs;
+        std::vector<double> frameMs;
+    };
+
+    struct FrameLoop {
+        vf_window::Window& window;
+        VulkanContext& context;
+        FrameSamples& samples;
+
+        // perFrame runs before drawFrame and is not counted as CPU time of the frame
+        void
+        run(uint32_t frames, const std::function<void(uint32_t)>& perFrame)
+        {
+            // Warm-up: pipelines compile on worker threads, the first frames are not representative
+            for (uint32_t i = 0; i < 10; i++) {
+                window.pollEvents();
+                context.drawFrame();
+            }
+
+            Clock::time_point last = Clock::now();
+            for (uint32_t i = 0; i < frames; i++) {
+                window.pollEvents();
+                if (perFrame) perFrame(i);
+
+                const Clock::time_point start = Clock::now();
+                context.drawFrame();
+                const Clock::time_point end = Clock::now();
+
+                samples.cpuMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+                samples.frameMs.push_back(std::chrono::duration<double, std::milli>(end - last).count());
+                last = end;
+            }
+        }
+    };
+
+    SceneResult
+    summarize(const std::string& name, const FrameSamples& samples)
+    {
+        SceneResult result;
+        result.name = name;
+        result.frames = static_cast<uint32_t>(samples.frameMs.size());
+        result.peakMemoryBytes = peakMemoryBytes();
+        if (samples.frameMs.empty()) return result;
+
+        double totalFrame = 0.0;
+        double totalCpu = 0.0;
+        for (size_t i = 0; i < samples.frameMs.size(); i++) {
+            totalFrame += samples.frameMs[i];
+            totalCpu += samples.cpuMs[i];
+        }
+        result.fps = 1000.0 * samples.frameMs.size() / totalFrame;
+        result.cpuMsPerFrame = totalCpu / samples.cpuMs.size();
+
+        std::vector<double> sorted = samples.frameMs;
+        std::sort(sorted.begin(), sorted.end());
+        const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(std::ceil(sorted.size() * 0.99)) - 1);
+        result.p99FrameMs = sorted[index];
+        return result;
+    }
+
+    ContextPtr
+    createContext(vf_window::Window& window, const std::function<void(VulkanContext&)>& configure = nullptr)
+    {
+        ContextPtr context = vf_vulkan::createVulkanContext();
+        context->setAppName("vframe_bench");
+        context->setPipelineCacheFile(""); // Every run compiles from scratch, results do not depend on a cache file
+        context->setPresentMode(vf_vulkan::PresentMode::IMMEDIATE); // Not capped by the refresh rate
+        if (configure) configure(*context);
+        context->vfGetWindow(window.getHandle());
+        context->init();
+        return context;
+    }
+
+    // ### Scenes ###
+
+    // 50k culled and LOD-selected objects: CPU cost must not depend on the count
+    SceneResult
+    sceneManyDraws(uint32_t frames)
+    {
+        vf_window::Window window(WINDOW_WIDTH, WINDOW_HEIGHT, "vframe_bench", false);
+        ContextPtr context = createContext(window, [](VulkanContext& ctx) {
+            ctx.setSceneCapacity(65536, 1u << 20, 1u << 22);
+        });
+        addObjectGrid(*context, 50000);
+
+        FrameSamples samples;
+        FrameLoop loop{ window, *context, samples };
+        loop.run(frames, [&](uint32_t frame) { setOrbitCamera(*context, frame, 120.0f); });
+        return summarize("many_draws", samples);
+    }
+
+    // Every render target combination: its own render pass and pipelines, compiled through the pipeline manager
+    SceneResult
+    scenePipelineVariants(uint32_t frames)
+    {
+        FrameSamples samples;
+        const uint32_t sampleCounts[] = { 1, 2, 4, 8 };
+        const uint32_t framesPerVariant = std::max(1u, frames / 8);
+
+        for (uint32_t sampleCount : sampleCounts) {
+            for (bool depth : { false, true }) {
+                vf_window::Window window(WINDOW_WIDTH, WINDOW_HEIGHT, "vframe_bench", false);
+                ContextPtr context = createContext(window, [&](VulkanContext& ctx) {
+                    ctx.setRenderTargets(depth, sampleCount);
+                });
+                addObjectGrid(*context, 1000);
+
+                FrameLoop loop{ window, *context, samples };
+                loop.run(framesPerVariant, [&](uint32_t frame) { setOrbitCamera(*context, frame, 40.0f); });
+            }
+        }
+        return summarize("pipeline_variants", samples);
+    }
+
+    // Meshes streamed into the scene buffers while drawing, one 4 MB upload per frame
+    SceneResult
+    sceneLargeUploads(uint32_t frames)
+    {
+        vf_window::Window window(WINDOW_WIDTH, WINDOW_HEIGHT, "vframe_bench", false);
+        const uint32_t maxVertices = 1u << 23;
+        const uint32_t maxIndices = 1u << 24;
+        ContextPtr context = createContext(window, [&](VulkanContext& ctx) {
+            ctx.setSceneCapacity(65536, maxVertices, maxIndices);
+        });
+        const GeometryUsage grid = addObjectGrid(*context, 1000);
+
+        std::vector<vf_vulkan::SceneVertex> vertices;
+        std::vector<uint32_t> indices;
+        makeSphere(256, 256, vertices, indices); // 66k vertices, 393k indices
+
+        // The index buffer fills first (42 uploads), running past either capacity throws
+        const uint32_t capacityUploads = std::min(
+            (maxVertices - grid.vertices) / static_cast<uint32_t>(vertices.size()),
+            (maxIndices - grid.indices) / static_cast<uint32_t>(indices.size()));
+        FrameSamples samples;
+        FrameLoop loop{ window, *context, samples };
+        loop.run(std::min(frames, capacityUploads), [&](uint32_t) {
+            context->uploadSceneMesh(vertices.data(), static_cast<uint32_t>(vertices.size()),
+                indices.data(), static_cast<uint32_t>(indices.size()));
+        });
+        return summarize("large_uploads", samples);
+    }
+
+    // Window size changes every few frames: swap chain, render targets and framebuffers are recreated
+    SceneResult
+    sceneResizeStorm(uint32_t frames)
+    {
+        vf_window::Window window(WINDOW_WIDTH, WINDOW_HEIGHT, "vframe_bench", false);
+        ContextPtr context = createContext(window);
+        addObjectGrid(*context, 1000);
+
+        FrameSamples samples;
+        FrameLoop loop{ window, *context, samples };
+        loop.run(frames, [&](uint32_t frame) {
+            if (frame % 4 == 0) {
+                const int step = static_cast<int>(frame / 4 % 8);
+                window.setSize(640 + step * 80, 360 + step * 45);
+            }
+            setOrbitCamera(*context, frame, 40.0f);
+        });
+        return summarize("resize_storm", samples);
+    }
+
+    const std::vector<std::pair<std::string, std::function<SceneResult(uint32_t)>>> SCENES = {
+        { "many_draws", sceneManyDraws },
+        { "pipeline_variants", scenePipelineVariants },
+        { "large_uploads", sceneLargeUploads },
+        { "resize_storm", sceneResizeStorm },
+    };
+
+    // ### JSON ###
+
+    std::string
+    toJson(const std::vector<SceneResult>& results)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(4);
+        out << "{\n  \"version\": 1,\n  \"scenes\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const SceneResult& r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"frames\": " << r.frames
+                << ", \"fps\": " << r.fps << ", \"cpuMsPerFrame\": " << r.cpuMsPerFrame
+                << ", \"p99FrameMs\": " << r.p99FrameMs << ", \"peakMemoryBytes\": " << r.peakMemoryBytes << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+        return out.str();
+    }
+
+    // Reads back what toJson writes: objects, arrays, strings without escapes, numbers
+    class JsonReader {
+    public:
+        explicit JsonReader(std::string text) : text_(std::move(text)) {}
+
+        std::vector<SceneResult>
+        readResults()
+        {
+            std::vector<SceneResult> results;
+            expect('{');
+            while (!consume('}')) {
+                const std::string key = readString();
+                expect(':');
+                if (key == "scenes") {
+                    expect('[');
+                    while (!consume(']')) {
+                        results.push_back(readScene());
+                        consume(',');
+                    }
+                }
+                else {
+                    skipValue();
+                }
+                consume(',');
+            }
+            return results;
+        }
+
+    private:
+        SceneResult
+        readScene()
+        {
+            SceneResult result;
+            expect('{');
+            while (!consume('}')) {
+                const std::string key = readString();
+                expect(':');
+                if (key == "name") result.name = readString();
+                else if (key == "frames") result.frames = static_cast<uint32_t>(readNumber());
+                else if (key == "fps") result.fps = readNumber();
+                else if (key == "cpuMsPerFrame") result.cpuMsPerFrame = readNumber();
+                else if (key == "p99FrameMs") result.p99FrameMs = readNumber();
+                else if (key == "peakMemoryBytes") result.peakMemoryBytes = static_cast<uint64_t>(readNumber());
+                else skipValue();
+                consume(',');
+            }
+            return result;
+        }
+
+        void
+        skipSpace()
+        {
+            while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) pos_++;
+        }
+
+        bool
+        consume(char c)
+        {
+            skipSpace();
+            if (pos_ < text_.size() && text_[pos_] == c) {
+                pos_++;
+                return true;
+            }
+            return false;
+        }
+
+        void
+        expect(char c)
+        {
+            if (!consume(c)) {
+                throw std::runtime_error(std::string("invalid results file: expected '") + c + "'");
+            }
+        }
+
+        std::string
+        readString()
+        {
+            expect('"');
+            const size_t end = text_.find('"', pos_);
+            if (end == std::string::npos) throw std::runtime_error("invalid results file: unterminated string");
+            std::string value = text_.substr(pos_, end - pos_);
+            pos_ = end + 1;
+            return value;
+        }
+
+        double
+        readNumber()
+        {
+            skipSpace();
+            const char* begin = text_.c_str() + pos_;
+            char* end = nullptr;
+            const double value = std::strtod(begin, &end);
+            if (end == begin) throw std::runtime_error("invalid results file: expected a number");
+            pos_ += static_cast<size_t>(end - begin);
+            return value;
+        }
+
+        void
+        skipValue()
+        {
+            skipSpace();
+            if (pos_ >= text_.size()) return;
+            if (text_[pos_] == '"') {
+                readString();
+            }
+            else if (text_[pos_] == '{' || text_[pos_] == '[') {
+                const char open = text_[pos_];
+                const char close = open == '{' ? '}' : ']';
+                pos_++;
+                while (!consume(close)) {
+                    if (open == '{') {
+                        readString();
+                        expect(':');
+                    }
+                    skipValue();
+                    consume(',');
+                }
+            }
+            else {
+                while (pos_ < text_.size() && text_[pos_] != ',' && text_[pos_] != '}' && text_[pos_] != ']') pos_++;
+            }
+        }
+
+        std::string text_;
+        size_t pos_ = 0;
+    };
+
+    // Percent change in the "worse" direction, positive is a regression
+    double
+    regression(double baseline, double current, bool higherIsBetter)
+    {
+        if (baseline <= 0.0) return 0.0;
+        const double change = (current - baseline) / baseline * 100.0;
+        return higherIsBetter ? -change : change;
+    }
+
+    bool
+    compare(const std::vector<SceneResult>& baseline, const std::vector<SceneResult>& current, double threshold)
+    {
+        std::map<std::string, SceneResult> byName;
+        for (const SceneResult& result : baseline) {
+            byName[result.name] = result;
+        }
+
+        bool passed = true;
+        std::cout << std::fixed << std::setprecision(1);
+        for (const SceneResult& now : current) {
+            auto it = byName.find(now.name);
+            if (it == byName.end()) {
+                std::cout << now.name << ": not in the baseline" << std::endl;
+                continue;
+            }
+            const SceneResult& base = it->second;
+
+            const std::pair<const char*, double> metrics[] = {
+                { "fps", regression(base.fps, now.fps, true) },
+                { "cpuMsPerFrame", regression(base.cpuMsPerFrame, now.cpuMsPerFrame, false) },
+                { "p99FrameMs", regression(base.p99FrameMs, now.p99FrameMs, false) },
+                { "peakMemoryBytes", regression(static_cast<double>(base.peakMemoryBytes),
+                    static_cast<double>(now.peakMemoryBytes), false) },
+            };
+            for (const auto& metric : metrics) {
+                const bool failed = metric.second > threshold;
+                passed = passed && !failed;
+                std::cout << now.name << "." << metric.first << ": " << (metric.second > 0.0 ? "+" : "")
+                    << metric.second << "% worse" << (failed ? "  REGRESSION" : "") << std::endl;
+            }
+        }
+        return passed;
+    }
+
+    std::string
+    readText(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filename);
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+    uint32_t frames = 600;
+    double threshold = 10.0;
+    std::vector<std::string> selected;
+    std::string outFile;
+    std::string compareFile;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--scene" && i + 1 < argc) selected.push_back(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) outFile = argv[++i];
+        else if (arg == "--compare" && i + 1 < argc) compareFile = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) threshold = std::strtod(argv[++i], nullptr);
+        else if (arg == "--list") {
+            for (const auto& scene : SCENES) std::cout << scene.first << std::endl;
+            return 0;
+        }
+        else {
+            std::cerr << "usage: vframe_bench [--frames <n>] [--scene <name>]... [--out <results.json>] "
+                "[--compare <baseline.json>] [--threshold <percent>] [--list]" << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        std::vector<SceneResult> results;
+        for (const auto& scene : SCENES) {
+            if (!selected.empty() && std::find(selected.begin(), selected.end(), scene.first) == selected.end()) {
+                continue;
+            }
+            std::cerr << "vframe_bench: " << scene.first << "..." << std::endl;
+            results.push_back(scene.second(frames));
+        }
+        if (results.empty()) {
+            throw std::runtime_error("no scene selected, see --list");
+        }
+
+        const std::string json = toJson(results);
+        if (outFile.empty()) {
+            std::cout << json;
+        }
+        else {
+            std::ofstream(outFile, std::ios::binary) << json;
+        }
+
+        if (!compareFile.empty()) {
+            const std::vector<SceneResult> baseline = JsonReader(readText(compareFile)).readResults();
+            if (!compare(baseline, results, threshold)) {
+                return 2;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "vframe_bench: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,952 @@
+﻿// vframe_microbench - CPU cost of the engine hot paths in isolation (Google Benchmark)
+//
+// Usage: vframe_microbench [--benchmark_filter=<regex>] [--benchmark_format=json] ...
+//
+// Built with -DVFRAME_BUILD_MICROBENCH=ON. A system Google Benchmark is used when there is one,
+// otherwise it is fetched. Linked against libpfm it also reports instructions and cycles per call:
+//   vframe_microbench --benchmark_perf_counters=INSTRUCTIONS,CYCLES
+//
+// Vulkan benchmarks run on a software device (lavapipe) so the numbers do not depend on the driver
+// of the machine. VFRAME_BENCH_GPU=1 picks the first GPU instead.
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vframe_microbench
+// Surface queries need a display (xvfb-run), they are skipped without one.
+// Run from the build directory, the draw benchmark loads shaders/scene_*.spv.
+
+#include <benchmark/benchmark.h>
+
+#include "vf_asset_archive.hpp"
+#include "vf_buffer.hpp"
+#include "vf_descriptors.hpp"
+#include "vf_mapped_file.hpp"
+#include "vf_pipeline_state.hpp"
+#include "vf_resource_tracker.hpp"
+
+#include <vFrame/vf_culling.hpp>
+#include <vFrame/vf_debug_draw.hpp>
+#include <vFrame/vf_ecs.hpp>
+#include <vFrame/vf_math.hpp>
+#include <vFrame/vf_spatial.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include <vFrame/vf_transform.hpp>
+
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace vf_vulkan;
+
+namespace {
+
+    // Instance, device and the objects every benchmark shares. Created on first use, lives until exit.
+    class BenchDevice {
+    public:
+        static BenchDevice*
+        get()
+        {
+            static std::unique_ptr<BenchDevice> device = create();
+            return device.get();
+        }
+
+        ~BenchDevice()
+        {
+            if (handles.device != VK_NULL_HANDLE) {
+                vkDeviceWaitIdle(handles.device);
+                if (fence != VK_NULL_HANDLE) vkDestroyFence(handles.device, fence, nullptr);
+                vkDestroyCommandPool(handles.device, handles.commandPool, nullptr);
+                vkDestroyDevice(handles.device, nullptr);
+            }
+            if (surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(instance, surface, nullptr);
+            if (window != nullptr) glfwDestroyWindow(window);
+            if (instance != VK_NULL_HANDLE) vkDestroyInstance(instance, nullptr);
+            if (glfwReady) glfwTerminate();
+        }
+
+        DeviceHandles handles;
+        VkInstance instance = VK_NULL_HANDLE;
+        VkSurfaceKHR surface = VK_NULL_HANDLE;  // VK_NULL_HANDLE without a display
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        bool bufferDeviceAddress = false;
+        std::string deviceName;
+
+    private:
+        static std::unique_ptr<BenchDevice>
+        create()
+        {
+            std::unique_ptr<BenchDevice> device(new BenchDevice());
+            try {
+                device->init();
+            }
+            catch (const std::exception& e) {
+                std::fprintf(stderr, "vframe_microbench: %s, Vulkan benchmarks are skipped\n", e.what());
+                return nullptr;
+            }
+            return device;
+        }
+
+        void
+        init()
+        {
+            // A hidden window only for the surface queries, everything else works without it
+            glfwReady = glfwInit() == GLFW_TRUE;
+            std::vector<const char*> extensions;
+            if (glfwReady && glfwVulkanSupported()) {
+                uint32_t count = 0;
+                const char** required = glfwGetRequiredInstanceExtensions(&count);
+                extensions.assign(required, required + count);
+            }
+
+            VkApplicationInfo appInfo{};
+            appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+            appInfo.pApplicationName = "vframe_microbench";
+            appInfo.apiVersion = VK_API_VERSION_1_2;
+
+            VkInstanceCreateInfo instanceInfo{};
+            instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+            instanceInfo.pApplicationInfo = &appInfo;
+            instanceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+            instanceInfo.ppEnabledExtensionNames = extensions.data();
+            if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create instance!");
+            }
+
+            pickPhysicalDevice();
+            createDevice();
+
+            if (!extensions.empty()) {
+                glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+                glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+                window = glfwCreateWindow(640, 360, "vframe_microbench", nullptr, nullptr);
+                if (window != nullptr && glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+                    surface = VK_NULL_HANDLE;
+                }
+            }
+        }
+
+        void
+        pickPhysicalDevice()
+        {
+            uint32_t count = 0;
+            vkEnumeratePhysicalDevices(instance, &count, nullptr);
+            std::vector<VkPhysicalDevice> devices(count);
+            vkEnumeratePhysicalDevices(instance, &count, devices.data());
+
+            const char* useGpu = std::getenv("VFRAME_BENCH_GPU");
+            const bool wantGpu = useGpu != nullptr && std::strcmp(useGpu, "0") != 0;
+            for (VkPhysicalDevice candidate : devices) {
+                VkPhysicalDeviceProperties properties;
+                vkGetPhysicalDeviceProperties(candidate, &properties);
+                const bool software = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+                if (software != wantGpu) {
+                    handles.physicalDevice = candidate;
+                    deviceName = properties.deviceName;
+                    break;
+                }
+            }
+            if (handles.physicalDevice == VK_NULL_HANDLE) {
+                throw std::runtime_error(wantGpu ? "failed to find a GPU!" : "failed to find a software Vulkan device!");
+            }
+
+            vkGetPhysicalDeviceQueueFamilyProperties(handles.physicalDevice, &count, nullptr);
+            std::vector<VkQueueFamilyProperties> families(count);
+            vkGetPhysicalDeviceQueueFamilyProperties(handles.physicalDevice, &count, families.data());
+            for (uint32_t i = 0; i < count; i++) {
+                if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                    handles.graphicsFamily = i;
+                    return;
+                }
+            }
+            throw std::runtime_error("failed to find a graphics queue!");
+        }
+
+        void
+        createDevice()
+        {
+            VkPhysicalDeviceVulkan12Features supported12{};
+            supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            VkPhysicalDeviceFeatures2 supported{};
+            supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            supported.pNext = &supported12;
+            vkGetPhysicalDeviceFeatures2(handles.physicalDevice, &supported);
+            bufferDeviceAddress = supported12.bufferDeviceAddress == VK_TRUE;
+
+            // The scene shaders read through buffer device addresses
+            VkPhysicalDeviceVulkan12Features features12{};
+            features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            features12.bufferDeviceAddress = supported12.bufferDeviceAddress;
+
+            const float priority = 1.0f;
+            VkDeviceQueueCreateInfo queueInfo{};
+            queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueInfo.queueFamilyIndex = handles.graphicsFamily;
+            queueInfo.queueCount = 1;
+            queueInfo.pQueuePriorities = &priority;
+
+            VkDeviceCreateInfo deviceInfo{};
+            deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+            deviceInfo.pNext = &features12;
+            deviceInfo.queueCreateInfoCount = 1;
+            deviceInfo.pQueueCreateInfos = &queueInfo;
+            if (vkCreateDevice(handles.physicalDevice, &deviceInfo, nullptr, &handles.device) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create logical device!");
+            }
+            vkGetDeviceQueue(handles.device, handles.graphicsFamily, 0, &handles.graphicsQueue);
+
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            poolInfo.queueFamilyIndex = handles.graphicsFamily;
+            if (vkCreateCommandPool(handles.device, &poolInfo, nullptr, &handles.commandPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create command pool!");
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = handles.commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(handles.device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate command buffers!");
+            }
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(handles.device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create fence!");
+            }
+        }
+
+        GLFWwindow* window = nullptr;
+        bool glfwReady = false;
+    };
+
+    BenchDevice*
+    requireDevice(benchmark::State& state)
+    {
+        BenchDevice* device = BenchDevice::get();
+        if (device == nullptr) {
+            state.SkipWithError("no Vulkan device");
+        }
+        else {
+            state.SetLabel(device->deviceName);
+        }
+        return device;
+    }
+
+    void
+    beginCommandBuffer(VkCommandBuffer commandBuffer)
+    {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    }
+
+    std::vector<char>
+    readSpirv(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filename);
+        }
+        std::vector<char> code(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(code.data(), static_cast<std::streamsize>(code.size()));
+        return code;
+    }
+
+    // ### Command recording ###
+
+    // What the per-object fallback of GpuScene::recordDraw costs on the CPU: one render pass,
+    // the scene pipeline and state.range(0) indexed draws. Recorded only, never submitted.
+    void
+    BM_RecordDraws(benchmark::State& state)
+    {
+        BenchDevice* bench = requireDevice(state);
+        if (bench == nullptr) return;
+        if (!bench->bufferDeviceAddress) {
+            state.SkipWithError("bufferDeviceAddress not supported");
+            return;
+        }
+        VkDevice device = bench->handles.device;
+
+        PipelineState pipelineState;
+        try {
+            pipelineState.vertexShader = ShaderCode::fromSpirv(readSpirv("shaders/scene_vert.spv"));
+            pipelineState.fragmentShader = ShaderCode::fromSpirv(readSpirv("shaders/scene_frag.spv"));
+        }
+        catch (const std::exception& e) {
+            state.SkipWithError(e.what());
+            return;
+        }
+
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference colorRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorRef;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        VkRenderPass renderPass;
+        vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = colorAttachment.format;
+        imageInfo.extent = { 64, 64, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        VkImage image;
+        vkCreateImage(device, &imageInfo, nullptr, &image);
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device, image, &requirements);
+        VkMemoryAllocateInfo memoryInfo{};
+        memoryInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memoryInfo.allocationSize = requirements.size;
+        memoryInfo.memoryTypeIndex = findMemoryType(bench->handles.physicalDevice, requirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkDeviceMemory memory;
+        vkAllocateMemory(device, &memoryInfo, nullptr, &memory);
+        vkBindImageMemory(device, image, memory, 0);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = colorAttachment.format;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        VkImageView view;
+        vkCreateImageView(device, &viewInfo, nullptr, &view);
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &view;
+        framebufferInfo.width = 64;
+        framebufferInfo.height = 64;
+        framebufferInfo.layers = 1;
+        VkFramebuffer framebuffer;
+        vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer);
+
+        // Same push constant block as GpuScene::DrawPush
+        struct DrawPush {
+            float viewProjection[16];
+            VkDeviceAddress vertices;
+            VkDeviceAddress objects;
+        } push{};
+        VkPushConstantRange pushRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPush) };
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushRange;
+        VkPipelineLayout layout;
+        vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout);
+
+        pipelineState.layout = layout;
+        pipelineState.renderPass = renderPass;
+        pipelineState.colorFormat = colorAttachment.format;
+        VkPipeline pipeline = createGraphicsPipeline(device, VK_NULL_HANDLE, pipelineState);
+
+        GpuBuffer indexBuffer = createBuffer(bench->handles, 1024, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        const uint32_t drawCount = static_cast<uint32_t>(state.range(0));
+        const VkClearValue clearColor{};
+        VkViewport viewport{ 0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f };
+        VkRect2D scissor{ { 0, 0 }, { 64, 64 } };
+
+        for (auto _ : state) {
+            vkResetCommandBuffer(bench->commandBuffer, 0);
+            beginCommandBuffer(bench->commandBuffer);
+
+            VkRenderPassBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            beginInfo.renderPass = renderPass;
+            beginInfo.framebuffer = framebuffer;
+            beginInfo.renderArea = scissor;
+            beginInfo.clearValueCount = 1;
+            beginInfo.pClearValues = &clearColor;
+            vkCmdBeginRenderPass(bench->commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            vkCmdBindPipeline(bench->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            vkCmdSetViewport(bench->commandBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(bench->commandBuffer, 0, 1, &scissor);
+            vkCmdPushConstants(bench->commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPush), &push);
+            vkCmdBindIndexBuffer(bench->commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+            for (uint32_t i = 0; i < drawCount; i++) {
+                vkCmdDrawIndexed(bench->commandBuffer, 36, 1, 0, 0, i); // firstInstance selects the object
+            }
+
+            vkCmdEndRenderPass(bench->commandBuffer);
+            vkEndCommandBuffer(bench->commandBuffer);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * drawCount);
+
+        destroyBuffer(device, indexBuffer);
+        vkDestroyPipeline(device, pipeline, nullptr);
+        vkDestroyPipelineLayout(device, layout, nullptr);
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+        vkDestroyImageView(device, view, nullptr);
+        vkDestroyImage(device, image, nullptr);
+        vkFreeMemory(device, memory, nullptr);
+        vkDestroyRenderPass(device, renderPass, nullptr);
+    }
+    BENCHMARK(BM_RecordDraws)->Arg(1)->Arg(64)->Arg(4096);
+
+    // Barriers of the cull pass: every buffer is written by compute, then read as indirect arguments
+    void
+    BM_ResourceTrackerFlush(benchmark::State& state)
+    {
+        BenchDevice* bench = requireDevice(state);
+        if (bench == nullptr) return;
+
+        const uint32_t bufferCount = static_cast<uint32_t>(state.range(0));
+        std::vector<GpuBuffer> buffers;
+        ResourceTracker tracker(false);
+        for (uint32_t i = 0; i < bufferCount; i++) {
+            buffers.push_back(createBuffer(bench->handles, 256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+            tracker.trackBuffer(buffers.back().buffer);
+        }
+
+        for (auto _ : state) {
+            vkResetCommandBuffer(bench->commandBuffer, 0);
+            beginCommandBuffer(bench->commandBuffer);
+            for (const GpuBuffer& buffer : buffers) {
+                tracker.useBuffer(buffer.buffer, ResourceUsage::COMPUTE_WRITE);
+            }
+            tracker.flush(bench->commandBuffer);
+            for (const GpuBuffer& buffer : buffers) {
+                tracker.useBuffer(buffer.buffer, ResourceUsage::INDIRECT_READ);
+            }
+            tracker.flush(bench->commandBuffer);
+            vkEndCommandBuffer(bench->commandBuffer);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * bufferCount * 2);
+
+        for (GpuBuffer& buffer : buffers) {
+            tracker.forget(buffer.buffer);
+            destroyBuffer(bench->handles.device, buffer);
+        }
+    }
+    BENCHMARK(BM_ResourceTrackerFlush)->Arg(4)->Arg(64)->Arg(1024);
+
+    // ### Frame synchronization ###
+
+    // Fixed cost of a frame boundary: empty submit, fence wait and reset
+    void
+    BM_FrameSync(benchmark::State& state)
+    {
+        BenchDevice* bench = requireDevice(state);
+        if (bench == nullptr) return;
+
+        vkResetCommandBuffer(bench->commandBuffer, 0);
+        beginCommandBuffer(bench->commandBuffer);
+        vkEndCommandBuffer(bench->commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &bench->commandBuffer;
+
+        for (auto _ : state) {
+            vkQueueSubmit(bench->handles.graphicsQueue, 1, &submitInfo, bench->fence);
+            vkWaitForFences(bench->handles.device, 1, &bench->fence, VK_TRUE, UINT64_MAX);
+            vkResetFences(bench->handles.device, 1, &bench->fence);
+        }
+    }
+    BENCHMARK(BM_FrameSync);
+
+    // What chooseSwapExtent/recreateSwapChain query on every resize
+    void
+    BM_SurfaceQueries(benchmark::State& state)
+    {
+        BenchDevice* bench = requireDevice(state);
+        if (bench == nullptr) return;
+        if (bench->surface == VK_NULL_HANDLE) {
+            state.SkipWithError("no display for a surface");
+            return;
+        }
+
+        VkPhysicalDevice physicalDevice = bench->handles.physicalDevice;
+        std::vector<VkSurfaceFormatKHR> formats;
+        std::vector<VkPresentModeKHR> presentModes;
+        for (auto _ : state) {
+            VkSurfaceCapabilitiesKHR capabilities;
+            vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, bench->surface, &capabilities);
+
+            uint32_t count = 0;
+            vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, bench->surface, &count, nullptr);
+            formats.resize(count);
+            vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, bench->surface, &count, formats.data());
+
+            vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, bench->surface, &count, nullptr);
+            presentModes.resize(count);
+            vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, bench->surface, &count, presentModes.data());
+
+            benchmark::DoNotOptimize(capabilities);
+            benchmark::DoNotOptimize(formats.data());
+        }
+    }
+    BENCHMARK(BM_SurfaceQueries);
+
+    // ### Allocation paths ###
+
+    // Buffer + dedicated memory, as every GpuBuffer is created today
+    void
+    BM_BufferCreateDestroy(benchmark::State& state)
+    {
+        BenchDevice* bench = requireDevice(state);
+        if (bench == nullptr) return;
+
+        for (auto _ : state) {
+            GpuBuffer buffer = createBuffer(bench->handles, static_cast<VkDeviceSize>(state.range(0)),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            destroyBuffer(bench->handles.device, buffer);
+        }
+    }
+    BENCHMARK(BM_BufferCreateDestroy)->Arg(256)->Arg(64 << 10)->Arg(16 << 20);
+
+    // Per-frame descriptor sets: allocate + template write, the pool is recycled every 256 sets
+    void
+    BM_DescriptorFrameSet(benchmark::State& state)
+    {
+        BenchDevice* bench = requireDevice(state);
+        if (bench == nullptr) return;
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+        for (uint32_t i = 0; i < 2; i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        DescriptorLayout layout(bench->handles.device, bindings);
+        DescriptorManager descriptors(bench->handles.device, 2);
+        GpuBuffer buffer = createBuffer(bench->handles, 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        DescriptorData data[2] = {};
+        data[0].buffer = { buffer.buffer, 0, 512 };
+        data[1].buffer = { buffer.buffer, 512, 512 };
+
+        uint32_t allocated = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(descriptors.allocateFrameSet(layout, data));
+            if (++allocated % 256 == 0) {
+                descriptors.beginFrame(0);
+            }
+        }
+
+        destroyBuffer(bench->handles.device, buffer);
+    }
+    BENCHMARK(BM_DescriptorFrameSet);
+
+    // Static set cache hit: hash and compare of the descriptor data
+    void
+    BM_DescriptorStaticSetLookup(benchmark::State& state)
+    {
+        BenchDevice* bench = requireDevice(state);
+        if (bench == nullptr) return;
+
+        VkDescriptorSetLayoutBinding binding{};
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        DescriptorLayout layout(bench->handles.device, { binding });
+        DescriptorManager descriptors(bench->handles.device, 2);
+        GpuBuffer buffer = createBuffer(bench->handles, 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        DescriptorData data{};
+        data.buffer = { buffer.buffer, 0, VK_WHOLE_SIZE };
+        descriptors.getStaticSet(layout, &data);
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(descriptors.getStaticSet(layout, &data));
+        }
+
+        descriptors.clearStaticSets();
+        destroyBuffer(bench->handles.device, buffer);
+    }
+    BENCHMARK(BM_DescriptorStaticSetLookup);
+
+    // Key of every pipeline request (PipelineManager cache lookup)
+    void
+    BM_PipelineStateHash(benchmark::State& state)
+    {
+        PipelineState pipelineState;
+        pipelineState.vertexShader = ShaderCode::fromSpirv(std::vector<char>(4096, 1));
+        pipelineState.fragmentShader = ShaderCode::fromSpirv(std::vector<char>(4096, 2));
+        PipelineState other = pipelineState;
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(pipelineState.hash());
+            benchmark::DoNotOptimize(pipelineState == other);
+        }
+    }
+    BENCHMARK(BM_PipelineStateHash);
+
+    // Round trip of one task through the engine thread pool
+    void
+    BM_ThreadPoolSubmit(benchmark::State& state)
+    {
+        vf_core::ThreadPool& pool = vf_core::ThreadPool::global();
+        for (auto _ : state) {
+            pool.submit([]() { return 1; }).get();
+        }
+    }
+    BENCHMARK(BM_ThreadPoolSubmit);
+
+    // ### Math (vf_math batch functions, label = backend picked at run time) ###
+
+    void
+    BM_TransformPoints(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        std::vector<float> x(count, 1.0f), y(count, 2.0f), z(count, 3.0f);
+        const vf_core::Mat4 matrix = vf_core::toMat4(vf_core::Transform{ { 1.0f, 2.0f, 3.0f },
+            vf_core::fromAxisAngle({ 0.0f, 1.0f, 0.0f }, 0.5f), { 2.0f, 2.0f, 2.0f } });
+
+        for (auto _ : state) {
+            vf_core::transformPoints(matrix, x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), count);
+            benchmark::DoNotOptimize(x.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(count));
+        state.SetLabel(vf_core::mathBackend());
+    }
+    BENCHMARK(BM_TransformPoints)->Arg(1 << 10)->Arg(1 << 16);
+
+    void
+    BM_MultiplyMatrices(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        std::vector<vf_core::Mat4> local(count, vf_core::translation({ 1.0f, 0.0f, 0.0f }));
+        std::vector<vf_core::Mat4> world(count);
+        const vf_core::Mat4 parent = vf_core::scaling({ 1.0f, 2.0f, 3.0f });
+
+        for (auto _ : state) {
+            vf_core::multiplyMatrices(parent, local.data(), world.data(), count);
+            benchmark::DoNotOptimize(world.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(count));
+        state.SetLabel(vf_core::mathBackend());
+    }
+    BENCHMARK(BM_MultiplyMatrices)->Arg(1 << 10)->Arg(1 << 16);
+
+    void
+    BM_TestSpheres(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        std::vector<float> x(count), y(count), z(count), radius(count, 1.0f);
+        for (size_t i = 0; i < count; i++) {
+            x[i] = static_cast<float>(i % 100) - 50.0f;
+            y[i] = static_cast<float>(i / 100 % 100) - 50.0f;
+            z[i] = static_cast<float>(i / 10000) * -2.0f;
+        }
+        std::vector<uint8_t> visible(count);
+        const vf_core::Frustum frustum = vf_core::extractFrustum(vf_core::perspective(1.0472f, 1.0f, 0.1f, 1000.0f));
+
+        for (auto _ : state) {
+            vf_core::testSpheres(frustum, x.data(), y.data(), z.data(), radius.data(), visible.data(), count);
+            benchmark::DoNotOptimize(visible.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(count));
+        state.SetLabel(vf_core::mathBackend());
+    }
+    BENCHMARK(BM_TestSpheres)->Arg(1 << 10)->Arg(1 << 17);
+
+    // Frustum culling of a mixed sphere/box set, single thread and on the engine pool
+    void
+    BM_CullingSet(benchmark::State& state)
+    {
+        const uint32_t count = static_cast<uint32_t>(state.range(0));
+        vf_core::CullingSet culling;
+        for (uint32_t i = 0; i < count; i++) {
+            const vf_core::Vec3 center = { static_cast<float>(i % 400) - 200.0f, 0.0f, static_cast<float>(i / 400) * -1.0f };
+            if (i % 3 == 0) {
+                culling.addBox(center - vf_core::Vec3{ 1.0f, 1.0f, 1.0f }, center + vf_core::Vec3{ 1.0f, 1.0f, 1.0f });
+            }
+            else {
+                culling.addSphere(center, 1.0f);
+            }
+        }
+        const vf_core::Frustum frustum = vf_core::extractFrustum(vf_core::perspective(1.0472f, 1.0f, 0.1f, 150.0f));
+        vf_core::ThreadPool* pool = state.range(1) != 0 ? &vf_core::ThreadPool::global() : nullptr;
+        std::vector<uint32_t> visible;
+
+        for (auto _ : state) {
+            culling.cull(frustum, visible, pool);
+            benchmark::DoNotOptimize(visible.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * count);
+        state.counters["visible"] = static_cast<double>(visible.size());
+    }
+    BENCHMARK(BM_CullingSet)->Args({ 100000, 0 })->Args({ 100000, 1 })->Args({ 1000000, 1 });
+
+    // ### ECS ###
+
+    struct BenchPosition { float x = 0.0f, y = 0.0f, z = 0.0f; };
+    struct BenchVelocity { float x = 0.0f, y = 0.0f, z = 0.0f; };
+    struct BenchTag { uint32_t value = 0; };
+
+    // Position += velocity over entities split between two archetypes, per chunk or per entity
+    void
+    BM_EcsQuery(benchmark::State& state)
+    {
+        const uint32_t count = static_cast<uint32_t>(state.range(0));
+        vf_core::World world;
+        for (uint32_t i = 0; i < count; i++) {
+            if (i % 2 == 0) {
+                world.create(BenchPosition{}, BenchVelocity{ 1.0f, 2.0f, 3.0f });
+            }
+            else {
+                world.create(BenchPosition{}, BenchVelocity{ 1.0f, 2.0f, 3.0f }, BenchTag{ i });
+            }
+        }
+
+        for (auto _ : state) {
+            if (state.range(1) != 0) {
+                world.parallelEachChunk<BenchPosition, BenchVelocity>(vf_core::ThreadPool::global(),
+                    [](uint32_t n, const vf_core::Entity*, BenchPosition* position, const BenchVelocity* velocity) {
+                        for (uint32_t i = 0; i < n; i++) {
+                            position[i].x += velocity[i].x;
+                            position[i].y += velocity[i].y;
+                            position[i].z += velocity[i].z;
+                        }
+                    });
+            }
+            else {
+                world.each<BenchPosition, BenchVelocity>([](vf_core::Entity, BenchPosition& position, const BenchVelocity& velocity) {
+                    position.x += velocity.x;
+                    position.y += velocity.y;
+                    position.z += velocity.z;
+                });
+            }
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * count);
+    }
+    BENCHMARK(BM_EcsQuery)->Args({ 100000, 0 })->Args({ 100000, 1 })->Args({ 1000000, 1 });
+
+    // Deferred add + remove of a component through a command buffer
+    void
+    BM_EcsCommandBuffer(benchmark::State& state)
+    {
+        const uint32_t count = static_cast<uint32_t>(state.range(0));
+        vf_core::World world;
+        std::vector<vf_core::Entity> entities;
+        for (uint32_t i = 0; i < count; i++) {
+            entities.push_back(world.create(BenchPosition{}, BenchVelocity{}));
+        }
+        vf_core::CommandBuffer commands(world);
+
+        for (auto _ : state) {
+            for (vf_core::Entity entity : entities) {
+                commands.add(entity, BenchTag{ entity.index });
+            }
+            commands.apply();
+            for (vf_core::Entity entity : entities) {
+                commands.remove<BenchTag>(entity);
+            }
+            commands.apply();
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * count * 2);
+    }
+    BENCHMARK(BM_EcsCommandBuffer)->Arg(10000);
+
+    // ### Transform hierarchy ###
+
+    // Random tree of range(0) nodes under 64 roots; every iteration moves range(1) nodes and updates
+    void
+    BM_TransformHierarchy(benchmark::State& state)
+    {
+        const uint32_t count = static_cast<uint32_t>(state.range(0));
+        const uint32_t moved = static_cast<uint32_t>(state.range(1));
+        vf_core::TransformHierarchy hierarchy;
+        uint32_t seed = 1;
+        auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+        for (uint32_t i = 0; i < count; i++) {
+            vf_core::Transform local;
+            local.position = { 1.0f, 0.0f, 0.5f };
+            hierarchy.create(local, i < 64 ? vf_core::VF_NO_PARENT : next() % i);
+        }
+        hierarchy.update(&vf_core::ThreadPool::global());
+
+        float angle = 0.0f;
+        size_t changed = 0;
+        for (auto _ : state) {
+            angle += 0.01f;
+            for (uint32_t i = 0; i < moved; i++) {
+                vf_core::Transform local;
+                local.rotation = vf_core::fromAxisAngle(vf_core::Vec3{ 0.0f, 1.0f, 0.0f }, angle);
+                hierarchy.setLocal(next() % count, local);
+            }
+            hierarchy.update(&vf_core::ThreadPool::global());
+            changed = hierarchy.changedNodes().size();
+            benchmark::DoNotOptimize(hierarchy.changedWorlds().data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * count);
+        state.counters["changed"] = static_cast<double>(changed);
+    }
+    BENCHMARK(BM_TransformHierarchy)->Args({ 100000, 100 })->Args({ 100000, 100000 })->Args({ 1000000, 1000 });
+
+    // ### Spatial index ###
+
+    // range(0) boxes scattered over a 400 x 400 level; range(1) 0 - AABB tree, 1 - loose grid.
+    // Every iteration moves 1% of them, commits, then runs 64 frustum and 64 ray queries in one batch
+    void
+    BM_SpatialIndex(benchmark::State& state)
+    {
+        const uint32_t count = static_cast<uint32_t>(state.range(0));
+        vf_core::SpatialConfig config;
+        config.structure = state.range(1) != 0 ? vf_core::SpatialStructure::LOOSE_GRID : vf_core::SpatialStructure::AABB_TREE;
+        config.cellSize = 4.0f;
+        vf_core::SpatialIndex index(config);
+
+        uint32_t seed = 1;
+        auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+        auto random = [&next](float range) { return (static_cast<float>(next()) / 16777216.0f - 0.5f) * range; };
+        std::vector<vf_core::Aabb> bounds(count);
+        std::vector<uint32_t> proxies(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const vf_core::Vec3 center = { random(400.0f), random(20.0f), random(400.0f) };
+            bounds[i] = { center - vf_core::Vec3{ 0.5f, 0.5f, 0.5f }, center + vf_core::Vec3{ 0.5f, 0.5f, 0.5f } };
+            proxies[i] = index.insert(bounds[i], i);
+        }
+        index.commit();
+
+        std::vector<vf_core::Frustum> frustums(64);
+        std::vector<vf_core::Ray> rays(64);
+        for (uint32_t i = 0; i < 64; i++) {
+            const vf_core::Vec3 eye = { random(300.0f), 2.0f, random(300.0f) };
+            const vf_core::Vec3 forward = vf_core::normalize(vf_core::Vec3{ random(2.0f), 0.0f, random(2.0f) + 0.01f });
+            frustums[i] = vf_core::extractFrustum(vf_core::perspective(1.0472f, 1.5f, 0.1f, 100.0f)
+                * vf_core::lookAt(eye, eye + forward, vf_core::Vec3{ 0.0f, 1.0f, 0.0f }));
+            rays[i].origin = eye;
+            rays[i].direction = forward;
+        }
+        std::vector<std::vector<uint32_t>> visible(64);
+        std::vector<vf_core::RayHit> hits(64);
+
+        for (auto _ : state) {
+            for (uint32_t i = 0; i < count / 100; i++) {
+                const uint32_t moved = next() % count;
+                const vf_core::Vec3 offset = { random(0.2f), 0.0f, random(0.2f) };
+                bounds[moved] = { bounds[moved].min + offset, bounds[moved].max + offset };
+                index.update(proxies[moved], bounds[moved]);
+            }
+            index.commit();
+            index.queryFrustums(frustums.data(), 64, visible.data(), &vf_core::ThreadPool::global());
+            index.raycasts(rays.data(), 64, hits.data(), &vf_core::ThreadPool::global());
+            benchmark::DoNotOptimize(hits.data());
+        }
+        state.counters["visible"] = static_cast<double>(visible[0].size());
+    }
+    BENCHMARK(BM_SpatialIndex)->Args({ 100000, 0 })->Args({ 100000, 1 });
+
+    // ### Debug draw ###
+
+    // A frame of range(0) boxes from this thread, merged into a ring like VulkanContext does.
+    // Called directly, the VF_DEBUG_* macros are empty in release builds. The library itself only has
+    // debug draw with VFRAME_DEBUG_DRAW on
+#if VFRAME_DEBUG_DRAW
+    void
+    BM_DebugDrawFrame(benchmark::State& state)
+    {
+        const uint32_t count = static_cast<uint32_t>(state.range(0));
+        std::vector<vf_core::DebugVertex> ring(1u << 18);
+        std::vector<vf_core::DebugText> texts;
+
+        for (auto _ : state) {
+            for (uint32_t i = 0; i < count; i++) {
+                const vf_core::Vec3 center = { static_cast<float>(i), 0.0f, 0.0f };
+                vf_core::debugBox({ center - vf_core::Vec3{ 0.5f, 0.5f, 0.5f }, center + vf_core::Vec3{ 0.5f, 0.5f, 0.5f } },
+                    vf_core::debugColor(0, 255, 0));
+            }
+            texts.clear();
+            benchmark::DoNotOptimize(vf_core::debugDrawCollect(ring.data(), static_cast<uint32_t>(ring.size()), texts));
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+    BENCHMARK(BM_DebugDrawFrame)->Arg(1000)->Arg(10000);
+#endif
+
+    // ### File loading ###
+
+    class TempFile {
+    public:
+        explicit TempFile(size_t size)
+            : name_("vframe_microbench_" + std::to_string(size) + ".bin")
+        {
+            std::ofstream(name_, std::ios::binary).write(std::vector<char>(size, 'v').data(),
+                static_cast<std::streamsize>(size));
+        }
+        ~TempFile() { std::remove(name_.c_str()); }
+
+        const std::string& name() const { return name_; }
+
+    private:
+        std::string name_;
+    };
+
+    // readFile path of the engine: loose file through the asset loader into std::vector<char>
+    void
+    BM_ReadFile(benchmark::State& state)
+    {
+        const size_t size = static_cast<size_t>(state.range(0));
+        TempFile file(size);
+        AssetLoader assets(vf_core::ThreadPool::global());
+
+        for (auto _ : state) {
+            std::vector<char> data = assets.read(file.name()).toChars();
+            benchmark::DoNotOptimize(data.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    }
+    BENCHMARK(BM_ReadFile)->Arg(4 << 10)->Arg(1 << 20)->Arg(16 << 20);
+
+    // Mapping alone, no page is touched: the fixed cost of the zero-copy mesh/texture path
+    void
+    BM_MappedFileOpen(benchmark::State& state)
+    {
+        TempFile file(1 << 20);
+        for (auto _ : state) {
+            MappedFile mapped(file.name());
+            benchmark::DoNotOptimize(mapped.data());
+        }
+    }
+    BENCHMARK(BM_MappedFileOpen);
+
+} // namespace
+
+BENCHMARK_MAIN();
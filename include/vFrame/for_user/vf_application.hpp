@@ -19,6 +19,8 @@
 
 namespace vf_core {
 
+    class World;
+
     class VFRAME_API Application {
     public:
         Application(int width, int height, const char* appName);
@@ -29,6 +31,9 @@ namespace vf_core {
         virtual void onStart() {}
         virtual void onUpdate(float deltaTime) {}
 
+        // Світ ECS застосунку, живе стільки ж, скільки Application
+        World& world();
+
     private:
         class Impl;                  // Forward declaration внутрішнього класу
         Impl* pImpl = nullptr;       // "Opaque pointer" — приховує імплементацію
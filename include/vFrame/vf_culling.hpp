@@ -0,0 +1,67 @@
+﻿#pragma once
+#ifndef VFRAME_CULLING_HPP
+#define VFRAME_CULLING_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <vFrame/vf_math.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vf_core {
+
+    class ThreadPool;
+
+    // CPU frustum culling. Bounds are kept as structure of arrays - center, half extents, radius -
+    // so a sphere is a box with zero extents and a box a sphere with zero radius, both go through
+    // the same loop: 16 objects per step with AVX-512, 8 with AVX2, 4 with SSE/NEON (picked at run time).
+    // Indices are stable: remove() frees one for a later add.
+    class VFRAME_API CullingSet {
+    public:
+        CullingSet();
+        ~CullingSet();
+
+        CullingSet(const CullingSet&) = delete;
+        CullingSet& operator=(const CullingSet&) = delete;
+
+        uint32_t addSphere(const Vec3& center, float radius);
+        uint32_t addBox(const Vec3& boxMin, const Vec3& boxMax);
+        void setSphere(uint32_t index, const Vec3& center, float radius);
+        void setBox(uint32_t index, const Vec3& boxMin, const Vec3& boxMax);
+        void remove(uint32_t index);
+        void clear();
+
+        uint32_t size() const; // Highest index + 1, removed slots included
+
+        // Replaces visible with the indices of the objects that intersect the frustum, in ascending order.
+        // Chunks of the set run on pool and the calling thread; nullptr culls on the calling thread only.
+        // Bounds must not change during the call.
+        void cull(const Frustum& frustum, std::vector<uint32_t>& visible, ThreadPool* pool);
+
+    private:
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+} // namespace vf_core
+
+#endif // VFRAME_CULLING_HPP
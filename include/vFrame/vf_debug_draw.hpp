@@ -0,0 +1,118 @@
+﻿#pragma once
+#ifndef VFRAME_DEBUG_DRAW_HPP
+#define VFRAME_DEBUG_DRAW_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <vFrame/vf_math.hpp>
+#include <vFrame/vf_spatial.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 1: VF_DEBUG_* macros draw, 0: they are not compiled at all, arguments included.
+// Default: on in debug builds, off with NDEBUG. Off in the library build compiles debug draw out of it
+// entirely (the functions below and the line renderer), so the application must not turn it on then.
+#ifndef VFRAME_DEBUG_DRAW
+#  ifdef NDEBUG
+#    define VFRAME_DEBUG_DRAW 0
+#  else
+#    define VFRAME_DEBUG_DRAW 1
+#  endif
+#endif
+
+namespace vf_core {
+
+    // Immediate-mode world space lines, cleared every frame. Any thread may draw during onUpdate:
+    // primitives go into a buffer of the calling thread, and the frame merges every buffer into one
+    // vertex ring drawn as a single line list, depth tested against the scene. Text anchors are
+    // labels at a world position, drawn with the first loaded font (a cross marks the point either way).
+    //
+    //   VF_DEBUG_BOX(bounds, vf_core::debugColor(0, 255, 0));
+    //   VF_DEBUG_TEXT(position, "spawn", vf_core::debugColor(255, 255, 0));
+    //
+    // Call through the macros so release builds do not pay for it; debugDrawSetEnabled(false)
+    // turns the calls into one atomic load at run time.
+
+    // RGBA8, R in the low byte
+    constexpr uint32_t
+    debugColor(uint32_t r, uint32_t g, uint32_t b, uint32_t a = 255)
+    {
+        return (r & 0xFFu) | (g & 0xFFu) << 8 | (b & 0xFFu) << 16 | (a & 0xFFu) << 24;
+    }
+
+    VFRAME_API void debugDrawSetEnabled(bool enabled);
+    VFRAME_API bool debugDrawEnabled();
+
+    VFRAME_API void debugLine(const Vec3& a, const Vec3& b, uint32_t color);
+    VFRAME_API void debugRay(const Ray& ray, float length, uint32_t color); // Clamped to ray.maxDistance
+    VFRAME_API void debugCross(const Vec3& center, float size, uint32_t color);
+    VFRAME_API void debugBox(const Aabb& box, uint32_t color);
+    VFRAME_API void debugBox(const Mat4& transform, const Aabb& box, uint32_t color); // Oriented: box in local space
+    VFRAME_API void debugSphere(const Vec3& center, float radius, uint32_t color);  // Three great circles
+    VFRAME_API void debugFrustum(const Mat4& viewProjection, uint32_t color);       // Vulkan clip space, 0 <= z <= 1
+    // cells x cells squares on the XZ plane around center
+    VFRAME_API void debugGrid(const Vec3& center, float cellSize, uint32_t cells, uint32_t color);
+    VFRAME_API void debugText(const Vec3& anchor, const std::string& text, uint32_t color);
+
+    // Lines and labels dropped past the per-thread limit or past the ring of the frame
+    VFRAME_API uint64_t debugDrawDroppedCount();
+
+    // ### Renderer side ###
+
+    // std430 mirror of Vertex in debug.vert
+    struct DebugVertex {
+        float x, y, z;
+        uint32_t color;
+    };
+    static_assert(sizeof(DebugVertex) == 16, "DebugVertex must match the std430 layout in debug.vert");
+
+    struct DebugText {
+        Vec3 anchor;
+        uint32_t color;
+        std::string text;
+    };
+
+    // Moves what every thread drew since the last call: line vertices (pairs) into vertices, at most
+    // capacity of them, labels appended to texts. Returns the vertex count. Called once a frame by VulkanContext
+    VFRAME_API uint32_t debugDrawCollect(DebugVertex* vertices, uint32_t capacity, std::vector<DebugText>& texts);
+
+} // namespace vf_core
+
+// Variadic so braced arguments (Vec3{ 0, 1, 0 }) pass through
+#if VFRAME_DEBUG_DRAW
+#  define VF_DEBUG_LINE(...) ::vf_core::debugLine(__VA_ARGS__)
+#  define VF_DEBUG_RAY(...) ::vf_core::debugRay(__VA_ARGS__)
+#  define VF_DEBUG_CROSS(...) ::vf_core::debugCross(__VA_ARGS__)
+#  define VF_DEBUG_BOX(...) ::vf_core::debugBox(__VA_ARGS__)
+#  define VF_DEBUG_SPHERE(...) ::vf_core::debugSphere(__VA_ARGS__)
+#  define VF_DEBUG_FRUSTUM(...) ::vf_core::debugFrustum(__VA_ARGS__)
+#  define VF_DEBUG_GRID(...) ::vf_core::debugGrid(__VA_ARGS__)
+#  define VF_DEBUG_TEXT(...) ::vf_core::debugText(__VA_ARGS__)
+#else
+#  define VF_DEBUG_LINE(...) ((void)0)
+#  define VF_DEBUG_RAY(...) ((void)0)
+#  define VF_DEBUG_CROSS(...) ((void)0)
+#  define VF_DEBUG_BOX(...) ((void)0)
+#  define VF_DEBUG_SPHERE(...) ((void)0)
+#  define VF_DEBUG_FRUSTUM(...) ((void)0)
+#  define VF_DEBUG_GRID(...) ((void)0)
+#  define VF_DEBUG_TEXT(...) ((void)0)
+#endif
+
+#endif // VFRAME_DEBUG_DRAW_HPP
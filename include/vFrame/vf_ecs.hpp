@@ -0,0 +1,276 @@
+﻿#pragma once
+#ifndef VFRAME_ECS_HPP
+#define VFRAME_ECS_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <vFrame/vf_thread_pool.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace vf_core {
+
+    // Entity component system. Entities with the same set of components form an archetype, whose
+    // entities live in 16 KB chunks: one array per component (structure of arrays) plus the entity ids.
+    // Queries walk the chunks of every matching archetype front to back and can split them across threads.
+    //
+    // Adding or removing components moves the entity to another archetype, so while a query runs
+    // the world must not change structurally: record the changes in a CommandBuffer and apply it after.
+    // The world belongs to one thread; only reserve() and the work inside parallel queries run elsewhere.
+    // Changes to a dead entity are ignored.
+
+    constexpr uint32_t VF_MAX_COMPONENTS = 128;      // Distinct component types in the process
+    constexpr uint32_t VF_MAX_QUERY_COMPONENTS = 8;
+
+    using ComponentId = uint32_t;
+
+    // index + generation: a destroyed entity's handle stays invalid when its index is reused
+    struct Entity {
+        uint32_t index = 0;
+        uint32_t generation = 0; // 0 - null entity
+
+        bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Entity& other) const { return !(*this == other); }
+    };
+
+    struct ComponentInfo {
+        const char* name;        // Identifies the type across modules (typeid name)
+        uint32_t size;
+        uint32_t alignment;
+        void (*construct)(void* target);
+        void (*moveConstruct)(void* target, void* source);
+        void (*destroy)(void* target);
+    };
+
+    // Same name, same id. Throws past VF_MAX_COMPONENTS
+    VFRAME_API ComponentId registerComponent(const ComponentInfo& info);
+
+    template <typename T>
+    ComponentId
+    componentId()
+    {
+        static_assert(std::is_default_constructible<T>::value && std::is_move_constructible<T>::value,
+            "components must be default and move constructible");
+        static const ComponentId id = registerComponent({
+            typeid(T).name(),
+            static_cast<uint32_t>(sizeof(T)),
+            static_cast<uint32_t>(alignof(T)),
+            [](void* target) { new (target) T(); },
+            [](void* target, void* source) { new (target) T(std::move(*static_cast<T*>(source))); },
+            [](void* target) { static_cast<T*>(target)->~T(); },
+        });
+        return id;
+    }
+
+    // Matching chunk of a query: count entities, columns in the order of the query's components
+    struct QueryChunk {
+        const Entity* entities;
+        uint32_t count;
+        void* columns[VF_MAX_QUERY_COMPONENTS];
+    };
+
+    class CommandBuffer;
+
+    class VFRAME_API World {
+    public:
+        World();
+        ~World();
+
+        World(const World&) = delete;
+        World& operator=(const World&) = delete;
+
+        // ### Immediate changes (not during a query) ###
+
+        template <typename... Components>
+        Entity
+        create(Components... values)
+        {
+            const ComponentId ids[] = { componentId<Components>()..., 0 };
+            void* sources[] = { static_cast<void*>(&values)..., nullptr };
+            return createRaw(ids, sources, static_cast<uint32_t>(sizeof...(Components)));
+        }
+
+        void destroy(Entity entity);
+        bool alive(Entity entity) const;
+
+        // Replaces the value when the entity already has T
+        template <typename T>
+        void
+        add(Entity entity, T value)
+        {
+            addRaw(entity, componentId<T>(), &value);
+        }
+
+        template <typename T>
+        void
+        remove(Entity entity)
+        {
+            removeRaw(entity, componentId<T>());
+        }
+
+        // nullptr when the entity is dead or has no T. Valid until the next structural change
+        template <typename T>
+        T*
+        get(Entity entity)
+        {
+            return static_cast<T*>(getRaw(entity, componentId<T>()));
+        }
+
+        template <typename T>
+        bool has(Entity entity) const { return hasRaw(entity, componentId<T>()); }
+
+        uint32_t entityCount() const;
+        uint32_t archetypeCount() const;
+
+        // ### Queries: every entity that has all of Components ###
+
+        // fn(Entity, Components&...)
+        template <typename... Components, typename F>
+        void
+        each(F&& fn)
+        {
+            eachChunk<Components...>([&fn](uint32_t count, const Entity* entities, Components*... columns) {
+                for (uint32_t i = 0; i < count; i++) {
+                    fn(entities[i], columns[i]...);
+                }
+            });
+        }
+
+        // fn(count, entities, Components*...): whole arrays, for loops the compiler can vectorize
+        template <typename... Components, typename F>
+        void
+        eachChunk(F&& fn)
+        {
+            std::vector<QueryChunk> chunks = collect<Components...>();
+            for (const QueryChunk& chunk : chunks) {
+                invokeChunk<Components...>(fn, chunk, std::index_sequence_for<Components...>{});
+            }
+        }
+
+        // Chunks are distributed over pool and the calling thread; fn must only touch its own chunk
+        template <typename... Components, typename F>
+        void
+        parallelEachChunk(ThreadPool& pool, F&& fn)
+        {
+            std::vector<QueryChunk> chunks = collect<Components...>();
+            pool.parallelFor(0, chunks.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    invokeChunk<Components...>(fn, chunks[i], std::index_sequence_for<Components...>{});
+                }
+            });
+        }
+
+        template <typename... Components, typename F>
+        void
+        parallelEach(ThreadPool& pool, F&& fn)
+        {
+            parallelEachChunk<Components...>(pool, [&fn](uint32_t count, const Entity* entities, Components*... columns) {
+                for (uint32_t i = 0; i < count; i++) {
+                    fn(entities[i], columns[i]...);
+                }
+            });
+        }
+
+        // ### Type-erased interface used by the templates and CommandBuffer ###
+
+        Entity createRaw(const ComponentId* ids, void* const* sources, uint32_t count); // sources are moved from, nullptr = default
+        void addRaw(Entity entity, ComponentId id, void* source);
+        void removeRaw(Entity entity, ComponentId id);
+        void* getRaw(Entity entity, ComponentId id);
+        bool hasRaw(Entity entity, ComponentId id) const;
+        void collectChunks(const ComponentId* ids, uint32_t count, std::vector<QueryChunk>& chunks);
+
+        Entity reserve();                      // Any thread: handle for CommandBuffer::create
+        void materialize(Entity reserved);     // Reserved handle becomes a live entity without components
+
+    private:
+        template <typename... Components>
+        std::vector<QueryChunk>
+        collect()
+        {
+            static_assert(sizeof...(Components) <= VF_MAX_QUERY_COMPONENTS, "too many components in one query");
+            const ComponentId ids[] = { componentId<Components>()..., 0 };
+            std::vector<QueryChunk> chunks;
+            collectChunks(ids, static_cast<uint32_t>(sizeof...(Components)), chunks);
+            return chunks;
+        }
+
+        template <typename... Components, typename F, size_t... I>
+        static void
+        invokeChunk(F& fn, const QueryChunk& chunk, std::index_sequence<I...>)
+        {
+            fn(chunk.count, chunk.entities, static_cast<Components*>(chunk.columns[I])...);
+        }
+
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+    // Structural changes recorded during a query (one buffer per thread or job) and applied
+    // in recording order on the thread that owns the world
+    class VFRAME_API CommandBuffer {
+    public:
+        explicit CommandBuffer(World& world);
+        ~CommandBuffer(); // Unapplied commands are dropped
+
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+        Entity create(); // The handle is usable in later commands, the entity exists after apply()
+        void destroy(Entity entity);
+
+        template <typename T>
+        void
+        add(Entity entity, T value)
+        {
+            addRaw(entity, componentId<T>(), &value);
+        }
+
+        template <typename T>
+        void
+        remove(Entity entity)
+        {
+            removeRaw(entity, componentId<T>());
+        }
+
+        void apply();
+        bool empty() const;
+
+    private:
+        void addRaw(Entity entity, ComponentId id, void* source);
+        void removeRaw(Entity entity, ComponentId id);
+
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+} // namespace vf_core
+
+#endif // VFRAME_ECS_HPP
@@ -0,0 +1,84 @@
+﻿#pragma once
+#ifndef VFRAME_LOG_HPP
+#define VFRAME_LOG_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <cstdint>
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define VF_LOG_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#  define VF_LOG_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+namespace vf_core {
+
+    // SEVERE rather than ERROR: windows.h defines ERROR as a macro
+    enum class LogLevel : uint32_t {
+        VERBOSE,
+        INFO,
+        WARNING,
+        SEVERE,
+    };
+
+    // Asynchronous log. The calling thread formats the message into its own ring buffer (no locks,
+    // no I/O) and a background thread merges the rings in call order and writes the sinks:
+    // the console and optionally a binary file (vf_log_format.hpp, tools/vflog).
+    // A full ring drops the message instead of blocking, logDroppedCount() tells how many.
+    //
+    // category is stored as a pointer: string literals only.
+    VFRAME_API void logWrite(LogLevel level, const char* category, const char* format, ...) VF_LOG_PRINTF_FORMAT(3, 4);
+
+    VFRAME_API void logSetLevel(LogLevel minimum);   // Runtime filter on top of VFRAME_LOG_LEVEL, INFO by default
+    VFRAME_API LogLevel logLevel();
+    VFRAME_API void logSetConsole(bool enabled);     // On by default
+    VFRAME_API void logOpenBinaryFile(const char* filename);
+    VFRAME_API void logCloseBinaryFile();
+    VFRAME_API void logFlush();                      // Returns when everything logged before the call is written
+    VFRAME_API uint64_t logDroppedCount();
+
+} // namespace vf_core
+
+// Compile time filter: calls below VFRAME_LOG_LEVEL (0 VERBOSE .. 3 SEVERE) are not compiled at all,
+// arguments included. Default: VERBOSE in debug builds, INFO with NDEBUG.
+#ifndef VFRAME_LOG_LEVEL
+#  ifdef NDEBUG
+#    define VFRAME_LOG_LEVEL 1
+#  else
+#    define VFRAME_LOG_LEVEL 0
+#  endif
+#endif
+
+#if VFRAME_LOG_LEVEL <= 0
+#  define VF_LOG_VERBOSE(category, ...) ::vf_core::logWrite(::vf_core::LogLevel::VERBOSE, category, __VA_ARGS__)
+#else
+#  define VF_LOG_VERBOSE(category, ...) ((void)0)
+#endif
+#if VFRAME_LOG_LEVEL <= 1
+#  define VF_LOG_INFO(category, ...) ::vf_core::logWrite(::vf_core::LogLevel::INFO, category, __VA_ARGS__)
+#else
+#  define VF_LOG_INFO(category, ...) ((void)0)
+#endif
+#if VFRAME_LOG_LEVEL <= 2
+#  define VF_LOG_WARNING(category, ...) ::vf_core::logWrite(::vf_core::LogLevel::WARNING, category, __VA_ARGS__)
+#else
+#  define VF_LOG_WARNING(category, ...) ((void)0)
+#endif
+#define VF_LOG_SEVERE(category, ...) ::vf_core::logWrite(::vf_core::LogLevel::SEVERE, category, __VA_ARGS__)
+
+#endif // VFRAME_LOG_HPP
@@ -0,0 +1,39 @@
+﻿#pragma once
+#ifndef VFRAME_LOG_FORMAT_HPP
+#define VFRAME_LOG_FORMAT_HPP
+
+#include <cstdint>
+
+// Binary log file (.vflog), written by the log sink opened with vf_core::logOpenBinaryFile
+// and turned back into text by tools/vflog.
+//
+// [VfLogFileHeader][VfLogRecord][category bytes][message bytes][VfLogRecord]...
+//
+// Records are appended in the order the writer thread merged them (by sequence number),
+// strings are not null-terminated. A crash can leave a truncated last record, readers stop there.
+
+namespace vf_core {
+
+    constexpr uint32_t VF_LOG_MAGIC = 0x474C4656; // "VFLG"
+    constexpr uint32_t VF_LOG_VERSION = 1;
+
+    struct VfLogFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        int64_t startNanoseconds;  // traceNow() clock when the file was opened
+    };
+    static_assert(sizeof(VfLogFileHeader) == 16, "VfLogFileHeader layout is part of the file format");
+
+    struct VfLogRecord {
+        int64_t nanoseconds;       // Same clock as startNanoseconds
+        uint64_t sequence;         // Global order of the log calls
+        uint32_t threadId;         // Numbered in the order threads first logged
+        uint32_t level;            // vf_core::LogLevel
+        uint32_t categoryLength;
+        uint32_t messageLength;
+    };
+    static_assert(sizeof(VfLogRecord) == 32, "VfLogRecord layout is part of the file format");
+
+} // namespace vf_core
+
+#endif // VFRAME_LOG_FORMAT_HPP
@@ -0,0 +1,688 @@
+﻿#pragma once
+#ifndef VFRAME_MATH_HPP
+#define VFRAME_MATH_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Vectors, matrices, quaternions and transforms. Memory layout is the GLSL one (std140/std430):
+// Vec4, Quat and Mat4 are 16 byte aligned, matrices are column-major, Mat3 columns are padded to Vec4,
+// so uniform and storage buffer contents are filled with memcpy. Vec3 is 12 bytes like a vec3 member
+// followed by a float; a lone vec3 member of a block needs alignas(16) on the C++ side.
+//
+// Single value operations are inline: SSE2 (SSE4.1/FMA when the compiler targets them) on x86,
+// NEON on ARM64, plain C++ otherwise or with VFRAME_MATH_SCALAR. The batch functions at the end
+// are compiled into vFrame and use AVX2 when the CPU has it.
+
+#if !defined(VFRAME_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define VF_MATH_SSE 1
+#  include <emmintrin.h>
+#  if defined(__SSE4_1__) || defined(__AVX__)
+#    define VF_MATH_SSE4 1
+#    include <smmintrin.h>
+#  endif
+#  if defined(__FMA__) || defined(__AVX2__)
+#    define VF_MATH_FMA 1
+#    include <immintrin.h>
+#  endif
+#elif !defined(VFRAME_MATH_SCALAR) && ((defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64))
+#  define VF_MATH_NEON 1
+#  include <arm_neon.h>
+#endif
+
+namespace vf_core {
+
+    constexpr float VF_PI = 3.14159265358979323846f;
+
+    struct Vec2 {
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    struct Vec3 {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+    };
+
+    struct alignas(16) Vec4 {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        float w = 0.0f;
+    };
+
+    // Unit quaternion, w is the real part
+    struct alignas(16) Quat {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        float w = 1.0f;
+    };
+
+    struct alignas(16) Mat3 {
+        Vec4 columns[3] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } }; // w unused (std140 padding)
+    };
+
+    struct alignas(16) Mat4 {
+        Vec4 columns[4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+    };
+
+    // Scale, then rotate, then translate. Not a GPU type
+    struct Transform {
+        Vec3 position;
+        Quat rotation;
+        Vec3 scale = { 1.0f, 1.0f, 1.0f };
+    };
+
+    // Planes point inwards: a point is inside when dot(plane.xyz, p) + plane.w >= 0 for all six
+    struct Frustum {
+        Vec4 planes[6]; // Left, right, bottom, top, near, far
+    };
+
+    static_assert(sizeof(Vec2) == 8 && sizeof(Vec3) == 12 && sizeof(Vec4) == 16, "GLSL vector sizes");
+    static_assert(sizeof(Mat3) == 48 && sizeof(Mat4) == 64 && sizeof(Quat) == 16, "GLSL matrix sizes");
+
+    namespace detail {
+
+#if defined(VF_MATH_SSE)
+        using Float4 = __m128;
+
+        inline Float4 load4(const float* p) { return _mm_load_ps(p); }
+        inline void store4(float* p, Float4 v) { _mm_store_ps(p, v); }
+        inline Float4 loadu4(const float* p) { return _mm_loadu_ps(p); }
+        inline void storeu4(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+        inline Float4 splat4(float s) { return _mm_set1_ps(s); }
+        inline Float4 add4(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+        inline Float4 sub4(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+        inline Float4 mul4(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+        inline Float4 div4(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+        inline Float4 min4(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+        inline Float4 max4(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+
+        // a * b + c
+        inline Float4
+        madd4(Float4 a, Float4 b, Float4 c)
+        {
+#  if defined(VF_MATH_FMA)
+            return _mm_fmadd_ps(a, b, c);
+#  else
+            return _mm_add_ps(_mm_mul_ps(a, b), c);
+#  endif
+        }
+
+        inline float
+        dot4(Float4 a, Float4 b)
+        {
+#  if defined(VF_MATH_SSE4)
+            return _mm_cvtss_f32(_mm_dp_ps(a, b, 0xFF));
+#  else
+            const __m128 products = _mm_mul_ps(a, b);
+            __m128 shuffled = _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1));
+            const __m128 sums = _mm_add_ps(products, shuffled);
+            shuffled = _mm_movehl_ps(shuffled, sums);
+            return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+#  endif
+        }
+#elif defined(VF_MATH_NEON)
+        using Float4 = float32x4_t;
+
+        inline Float4 load4(const float* p) { return vld1q_f32(p); }
+        inline void store4(float* p, Float4 v) { vst1q_f32(p, v); }
+        inline Float4 loadu4(const float* p) { return vld1q_f32(p); }
+        inline void storeu4(float* p, Float4 v) { vst1q_f32(p, v); }
+        inline Float4 splat4(float s) { return vdupq_n_f32(s); }
+        inline Float4 add4(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+        inline Float4 sub4(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+        inline Float4 mul4(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+        inline Float4 div4(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+        inline Float4 min4(Float4 a, Float4 b) { return vminq_f32(a, b); }
+        inline Float4 max4(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+        inline Float4 madd4(Float4 a, Float4 b, Float4 c) { return vfmaq_f32(c, a, b); }
+        inline float dot4(Float4 a, Float4 b) { return vaddvq_f32(vmulq_f32(a, b)); }
+#else
+        struct Float4 {
+            float v[4];
+        };
+
+        inline Float4 load4(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+        inline void store4(float* p, Float4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+        inline Float4 loadu4(const float* p) { return load4(p); }
+        inline void storeu4(float* p, Float4 a) { store4(p, a); }
+        inline Float4 splat4(float s) { return { { s, s, s, s } }; }
+        inline Float4 add4(Float4 a, Float4 b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+        inline Float4 sub4(Float4 a, Float4 b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+        inline Float4 mul4(Float4 a, Float4 b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+        inline Float4 div4(Float4 a, Float4 b) { return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+        inline Float4 min4(Float4 a, Float4 b)
+        {
+            return { { a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1],
+                a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3] } };
+        }
+        inline Float4 max4(Float4 a, Float4 b)
+        {
+            return { { a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+                a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3] } };
+        }
+        inline Float4 madd4(Float4 a, Float4 b, Float4 c) { return add4(mul4(a, b), c); }
+        inline float dot4(Float4 a, Float4 b) { return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]; }
+#endif
+
+        inline Float4 load4(const Vec4& v) { return load4(&v.x); }
+        inline Vec4 toVec4(Float4 v) { Vec4 r; store4(&r.x, v); return r; }
+
+    } // namespace detail
+
+    // ### Vec2 ###
+
+    inline Vec2 operator+(Vec2 a, Vec2 b) { return { a.x + b.x, a.y + b.y }; }
+    inline Vec2 operator-(Vec2 a, Vec2 b) { return { a.x - b.x, a.y - b.y }; }
+    inline Vec2 operator*(Vec2 a, Vec2 b) { return { a.x * b.x, a.y * b.y }; }
+    inline Vec2 operator*(Vec2 a, float s) { return { a.x * s, a.y * s }; }
+    inline Vec2 operator*(float s, Vec2 a) { return { a.x * s, a.y * s }; }
+    inline Vec2 operator/(Vec2 a, float s) { return { a.x / s, a.y / s }; }
+    inline Vec2 operator-(Vec2 a) { return { -a.x, -a.y }; }
+    inline Vec2& operator+=(Vec2& a, Vec2 b) { a = a + b; return a; }
+    inline Vec2& operator-=(Vec2& a, Vec2 b) { a = a - b; return a; }
+    inline Vec2& operator*=(Vec2& a, float s) { a = a * s; return a; }
+
+    inline float dot(Vec2 a, Vec2 b) { return a.x * b.x + a.y * b.y; }
+    inline float length(Vec2 a) { return std::sqrt(dot(a, a)); }
+    inline Vec2 lerp(Vec2 a, Vec2 b, float t) { return a + (b - a) * t; }
+
+    // ### Vec3 ###
+
+    inline Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    inline Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    inline Vec3 operator*(const Vec3& a, const Vec3& b) { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+    inline Vec3 operator*(const Vec3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+    inline Vec3 operator*(float s, const Vec3& a) { return { a.x * s, a.y * s, a.z * s }; }
+    inline Vec3 operator/(const Vec3& a, float s) { return a * (1.0f / s); }
+    inline Vec3 operator-(const Vec3& a) { return { -a.x, -a.y, -a.z }; }
+    inline Vec3& operator+=(Vec3& a, const Vec3& b) { a = a + b; return a; }
+    inline Vec3& operator-=(Vec3& a, const Vec3& b) { a = a - b; return a; }
+    inline Vec3& operator*=(Vec3& a, float s) { a = a * s; return a; }
+
+    inline float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    inline float lengthSquared(const Vec3& a) { return dot(a, a); }
+    inline float length(const Vec3& a) { return std::sqrt(dot(a, a)); }
+    inline Vec3 lerp(const Vec3& a, const Vec3& b, float t) { return a + (b - a) * t; }
+
+    inline Vec3
+    cross(const Vec3& a, const Vec3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    // Zero length stays zero
+    inline Vec3
+    normalize(const Vec3& a)
+    {
+        const float lengthValue = length(a);
+        return lengthValue > 0.0f ? a / lengthValue : a;
+    }
+
+    // componentMin/componentMax: windows.h defines min and max as macros
+    inline Vec3
+    componentMin(const Vec3& a, const Vec3& b)
+    {
+        return { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z };
+    }
+
+    inline Vec3
+    componentMax(const Vec3& a, const Vec3& b)
+    {
+        return { a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z };
+    }
+
+    // ### Vec4 ###
+
+    inline Vec4 operator+(const Vec4& a, const Vec4& b) { return detail::toVec4(detail::add4(detail::load4(a), detail::load4(b))); }
+    inline Vec4 operator-(const Vec4& a, const Vec4& b) { return detail::toVec4(detail::sub4(detail::load4(a), detail::load4(b))); }
+    inline Vec4 operator*(const Vec4& a, const Vec4& b) { return detail::toVec4(detail::mul4(detail::load4(a), detail::load4(b))); }
+    inline Vec4 operator*(const Vec4& a, float s) { return detail::toVec4(detail::mul4(detail::load4(a), detail::splat4(s))); }
+    inline Vec4 operator*(float s, const Vec4& a) { return a * s; }
+    inline Vec4 operator/(const Vec4& a, float s) { return detail::toVec4(detail::div4(detail::load4(a), detail::splat4(s))); }
+    inline Vec4 operator-(const Vec4& a) { return detail::toVec4(detail::sub4(detail::splat4(0.0f), detail::load4(a))); }
+    inline Vec4& operator+=(Vec4& a, const Vec4& b) { a = a + b; return a; }
+    inline Vec4& operator-=(Vec4& a, const Vec4& b) { a = a - b; return a; }
+    inline Vec4& operator*=(Vec4& a, float s) { a = a * s; return a; }
+
+    inline float dot(const Vec4& a, const Vec4& b) { return detail::dot4(detail::load4(a), detail::load4(b)); }
+    inline float length(const Vec4& a) { return std::sqrt(dot(a, a)); }
+    inline Vec4 componentMin(const Vec4& a, const Vec4& b) { return detail::toVec4(detail::min4(detail::load4(a), detail::load4(b))); }
+    inline Vec4 componentMax(const Vec4& a, const Vec4& b) { return detail::toVec4(detail::max4(detail::load4(a), detail::load4(b))); }
+
+    inline Vec4
+    lerp(const Vec4& a, const Vec4& b, float t)
+    {
+        const detail::Float4 from = detail::load4(a);
+        return detail::toVec4(detail::madd4(detail::sub4(detail::load4(b), from), detail::splat4(t), from));
+    }
+
+    inline Vec4 toVec4(const Vec3& v, float w) { return { v.x, v.y, v.z, w }; }
+    inline Vec3 toVec3(const Vec4& v) { return { v.x, v.y, v.z }; }
+
+    // ### Mat4 ###
+
+    inline Vec4
+    operator*(const Mat4& m, const Vec4& v)
+    {
+        detail::Float4 result = detail::mul4(detail::load4(m.columns[0]), detail::splat4(v.x));
+        result = detail::madd4(detail::load4(m.columns[1]), detail::splat4(v.y), result);
+        result = detail::madd4(detail::load4(m.columns[2]), detail::splat4(v.z), result);
+        result = detail::madd4(detail::load4(m.columns[3]), detail::splat4(v.w), result);
+        return detail::toVec4(result);
+    }
+
+    inline Mat4
+    operator*(const Mat4& a, const Mat4& b)
+    {
+        Mat4 result;
+        for (int column = 0; column < 4; column++) {
+            result.columns[column] = a * b.columns[column];
+        }
+        return result;
+    }
+
+    inline Mat4& operator*=(Mat4& a, const Mat4& b) { a = a * b; return a; }
+
+    // w = 1, no perspective divide
+    inline Vec3
+    transformPoint(const Mat4& m, const Vec3& p)
+    {
+        return toVec3(m * Vec4{ p.x, p.y, p.z, 1.0f });
+    }
+
+    inline Vec3
+    transformVector(const Mat4& m, const Vec3& v)
+    {
+        return toVec3(m * Vec4{ v.x, v.y, v.z, 0.0f });
+    }
+
+    inline Mat4
+    transpose(const Mat4& m)
+    {
+        Mat4 result;
+        const float* source = &m.columns[0].x;
+        float* target = &result.columns[0].x;
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                target[row * 4 + column] = source[column * 4 + row];
+            }
+        }
+        return result;
+    }
+
+    inline Mat4
+    translation(const Vec3& offset)
+    {
+        Mat4 result;
+        result.columns[3] = { offset.x, offset.y, offset.z, 1.0f };
+        return result;
+    }
+
+    inline Mat4
+    scaling(const Vec3& scale)
+    {
+        Mat4 result;
+        result.columns[0].x = scale.x;
+        result.columns[1].y = scale.y;
+        result.columns[2].z = scale.z;
+        return result;
+    }
+
+    // Right-handed view space looking down -z, Vulkan clip space: y down, depth 0..1.
+    // zNear/zFar: windows.h defines near and far
+    inline Mat4
+    perspective(float fovYRadians, float aspect, float zNear, float zFar)
+    {
+        const float f = 1.0f / std::tan(0.5f * fovYRadians);
+        Mat4 result;
+        result.columns[0] = { f / aspect, 0.0f, 0.0f, 0.0f };
+        result.columns[1] = { 0.0f, -f, 0.0f, 0.0f };
+        result.columns[2] = { 0.0f, 0.0f, zFar / (zNear - zFar), -1.0f };
+        result.columns[3] = { 0.0f, 0.0f, zNear * zFar / (zNear - zFar), 0.0f };
+        return result;
+    }
+
+    inline Mat4
+    lookAt(const Vec3& eye, const Vec3& target, const Vec3& up)
+    {
+        const Vec3 forward = normalize(target - eye);
+        const Vec3 right = normalize(cross(forward, up));
+        const Vec3 trueUp = cross(right, forward);
+
+        Mat4 result;
+        result.columns[0] = { right.x, trueUp.x, -forward.x, 0.0f };
+        result.columns[1] = { right.y, trueUp.y, -forward.y, 0.0f };
+        result.columns[2] = { right.z, trueUp.z, -forward.z, 0.0f };
+        result.columns[3] = { -dot(right, eye), -dot(trueUp, eye), dot(forward, eye), 1.0f };
+        return result;
+    }
+
+    // Rotation, scale and translation only (last row 0 0 0 1), much cheaper than inverse()
+    inline Mat4
+    affineInverse(const Mat4& m)
+    {
+        // Inverse of the upper 3x3 through the cross products of its columns
+        const Vec3 c0 = toVec3(m.columns[0]);
+        const Vec3 c1 = toVec3(m.columns[1]);
+        const Vec3 c2 = toVec3(m.columns[2]);
+        const Vec3 r0 = cross(c1, c2);
+        const Vec3 r1 = cross(c2, c0);
+        const Vec3 r2 = cross(c0, c1);
+        const float determinant = dot(c0, r0);
+        const float inverseDeterminant = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+        Mat4 result;
+        result.columns[0] = { r0.x * inverseDeterminant, r1.x * inverseDeterminant, r2.x * inverseDeterminant, 0.0f };
+        result.columns[1] = { r0.y * inverseDeterminant, r1.y * inverseDeterminant, r2.y * inverseDeterminant, 0.0f };
+        result.columns[2] = { r0.z * inverseDeterminant, r1.z * inverseDeterminant, r2.z * inverseDeterminant, 0.0f };
+        const Vec3 offset = -transformVector(result, toVec3(m.columns[3]));
+        result.columns[3] = { offset.x, offset.y, offset.z, 1.0f };
+        return result;
+    }
+
+    // General inverse (cofactors), a singular matrix gives zeros
+    inline Mat4
+    inverse(const Mat4& matrix)
+    {
+        const float* m = &matrix.columns[0].x;
+        float inv[16];
+        inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+        inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+        inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+        inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+        inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+        inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+        inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+        inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+        inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+        inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+        inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+        inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+        inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+        inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+        inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+        inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+        const float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+        const float inverseDeterminant = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+        Mat4 result;
+        float* target = &result.columns[0].x;
+        for (int i = 0; i < 16; i++) {
+            target[i] = inv[i] * inverseDeterminant;
+        }
+        return result;
+    }
+
+    // ### Mat3 ###
+
+    inline Vec3
+    operator*(const Mat3& m, const Vec3& v)
+    {
+        return toVec3(m.columns[0]) * v.x + toVec3(m.columns[1]) * v.y + toVec3(m.columns[2]) * v.z;
+    }
+
+    inline Mat3
+    operator*(const Mat3& a, const Mat3& b)
+    {
+        Mat3 result;
+        for (int column = 0; column < 3; column++) {
+            result.columns[column] = toVec4(a * toVec3(b.columns[column]), 0.0f);
+        }
+        return result;
+    }
+
+    inline Mat3
+    transpose(const Mat3& m)
+    {
+        Mat3 result;
+        result.columns[0] = { m.columns[0].x, m.columns[1].x, m.columns[2].x, 0.0f };
+        result.columns[1] = { m.columns[0].y, m.columns[1].y, m.columns[2].y, 0.0f };
+        result.columns[2] = { m.columns[0].z, m.columns[1].z, m.columns[2].z, 0.0f };
+        return result;
+    }
+
+    inline Mat3
+    toMat3(const Mat4& m)
+    {
+        Mat3 result;
+        for (int column = 0; column < 3; column++) {
+            result.columns[column] = toVec4(toVec3(m.columns[column]), 0.0f);
+        }
+        return result;
+    }
+
+    // Inverse transpose of the upper 3x3: transforms normals under non-uniform scale
+    inline Mat3
+    normalMatrix(const Mat4& m)
+    {
+        return transpose(toMat3(affineInverse(m)));
+    }
+
+    // ### Quat ###
+
+    inline Quat
+    operator*(const Quat& a, const Quat& b)
+    {
+        return {
+            a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        };
+    }
+
+    inline Vec3
+    operator*(const Quat& q, const Vec3& v)
+    {
+        // v + 2w(q x v) + 2 q x (q x v)
+        const Vec3 axis = { q.x, q.y, q.z };
+        const Vec3 t = cross(axis, v) * 2.0f;
+        return v + t * q.w + cross(axis, t);
+    }
+
+    inline float dot(const Quat& a, const Quat& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+    inline Quat conjugate(const Quat& q) { return { -q.x, -q.y, -q.z, q.w }; }
+
+    inline Quat
+    normalize(const Quat& q)
+    {
+        const float lengthValue = std::sqrt(dot(q, q));
+        if (lengthValue <= 0.0f) return Quat{};
+        const float s = 1.0f / lengthValue;
+        return { q.x * s, q.y * s, q.z * s, q.w * s };
+    }
+
+    // axis must be unit length
+    inline Quat
+    fromAxisAngle(const Vec3& axis, float radians)
+    {
+        const float s = std::sin(0.5f * radians);
+        return { axis.x * s, axis.y * s, axis.z * s, std::cos(0.5f * radians) };
+    }
+
+    // Shortest path, normalized linear interpolation: cheap and good enough for small steps
+    inline Quat
+    nlerp(const Quat& a, Quat b, float t)
+    {
+        if (dot(a, b) < 0.0f) b = { -b.x, -b.y, -b.z, -b.w };
+        return normalize(Quat{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t });
+    }
+
+    inline Quat
+    slerp(const Quat& a, Quat b, float t)
+    {
+        float cosine = dot(a, b);
+        if (cosine < 0.0f) {
+            b = { -b.x, -b.y, -b.z, -b.w };
+            cosine = -cosine;
+        }
+        if (cosine > 0.9995f) return nlerp(a, b, t); // sin(angle) ~ 0
+
+        const float angle = std::acos(cosine);
+        const float inverseSine = 1.0f / std::sin(angle);
+        const float wa = std::sin((1.0f - t) * angle) * inverseSine;
+        const float wb = std::sin(t * angle) * inverseSine;
+        return { a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb };
+    }
+
+    inline Mat3
+    toMat3(const Quat& q)
+    {
+        const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        Mat3 result;
+        result.columns[0] = { 1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f };
+        result.columns[1] = { 2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f };
+        result.columns[2] = { 2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f };
+        return result;
+    }
+
+    inline Mat4
+    toMat4(const Quat& q)
+    {
+        const Mat3 rotation = toMat3(q);
+        Mat4 result;
+        result.columns[0] = rotation.columns[0];
+        result.columns[1] = rotation.columns[1];
+        result.columns[2] = rotation.columns[2];
+        return result;
+    }
+
+    // ### Transform ###
+
+    inline Mat4
+    toMat4(const Transform& t)
+    {
+        const Mat3 rotation = toMat3(t.rotation);
+        Mat4 result;
+        result.columns[0] = rotation.columns[0] * t.scale.x;
+        result.columns[1] = rotation.columns[1] * t.scale.y;
+        result.columns[2] = rotation.columns[2] * t.scale.z;
+        result.columns[3] = { t.position.x, t.position.y, t.position.z, 1.0f };
+        return result;
+    }
+
+    inline Vec3
+    transformPoint(const Transform& t, const Vec3& p)
+    {
+        return t.position + t.rotation * (t.scale * p);
+    }
+
+    // parent * child. Exact for uniform parent scale; non-uniform scale under rotation
+    // is a shear that a TRS cannot hold, use the matrices (toMat4) for that
+    inline Transform
+    combine(const Transform& parent, const Transform& child)
+    {
+        Transform result;
+        result.position = transformPoint(parent, child.position);
+        result.rotation = parent.rotation * child.rotation;
+        result.scale = parent.scale * child.scale;
+        return result;
+    }
+
+    // Exact for uniform scale (or no rotation): the inverse of a rotated non-uniform scale is
+    // S^-1 * R^-1, which a TRS cannot hold. Use affineInverse(toMat4(t)) for that
+    inline Transform
+    inverse(const Transform& t)
+    {
+        Transform result;
+        result.rotation = conjugate(t.rotation);
+        result.scale = { 1.0f / t.scale.x, 1.0f / t.scale.y, 1.0f / t.scale.z };
+        result.position = result.scale * (result.rotation * -t.position);
+        return result;
+    }
+
+    // ### Frustum ###
+
+    // Gribb/Hartmann plane extraction for Vulkan clip space (0 <= z <= w), planes normalized
+    inline Frustum
+    extractFrustum(const Mat4& viewProjection)
+    {
+        const Mat4 rows = transpose(viewProjection);
+        const Vec4& x = rows.columns[0];
+        const Vec4& y = rows.columns[1];
+        const Vec4& z = rows.columns[2];
+        const Vec4& w = rows.columns[3];
+
+        Frustum frustum;
+        frustum.planes[0] = w + x;
+        frustum.planes[1] = w - x;
+        frustum.planes[2] = w + y;
+        frustum.planes[3] = w - y;
+        frustum.planes[4] = z;
+        frustum.planes[5] = w - z;
+        for (Vec4& plane : frustum.planes) {
+            const float lengthValue = length(toVec3(plane));
+            if (lengthValue > 0.0f) plane = plane / lengthValue;
+        }
+        return frustum;
+    }
+
+    inline bool
+    intersectsSphere(const Frustum& frustum, const Vec3& center, float radius)
+    {
+        for (const Vec4& plane : frustum.planes) {
+            if (dot(toVec3(plane), center) + plane.w < -radius) return false;
+        }
+        return true;
+    }
+
+    // Conservative: a box near a frustum corner may pass while outside
+    inline bool
+    intersectsBox(const Frustum& frustum, const Vec3& boxMin, const Vec3& boxMax)
+    {
+        for (const Vec4& plane : frustum.planes) {
+            // Corner furthest along the plane normal
+            const Vec3 positive = { plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                plane.z >= 0.0f ? boxMax.z : boxMin.z };
+            if (dot(toVec3(plane), positive) + plane.w < 0.0f) return false;
+        }
+        return true;
+    }
+
+    // ### Batch (structure of arrays) ###
+    // Output may alias input. Compiled into vFrame: AVX2/FMA when the CPU supports it, else as above.
+
+    // out = m * (x, y, z, 1) for count points
+    VFRAME_API void transformPoints(const Mat4& m, const float* x, const float* y, const float* z,
+        float* outX, float* outY, float* outZ, size_t count);
+
+    // out[i] = a[i] * b[i]
+    VFRAME_API void multiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count);
+    // out[i] = a * b[i], e.g. one parent and its children
+    VFRAME_API void multiplyMatrices(const Mat4& a, const Mat4* b, Mat4* out, size_t count);
+
+    // visible[i] = 1 when sphere i intersects the frustum, else 0
+    VFRAME_API void testSpheres(const Frustum& frustum, const float* x, const float* y, const float* z,
+        const float* radius, uint8_t* visible, size_t count);
+
+    // "avx2", "sse4.1", "sse2", "neon" or "scalar": what the batch functions run on this CPU
+    VFRAME_API const char* mathBackend();
+
+} // namespace vf_core
+
+#endif // VFRAME_MATH_HPP
@@ -0,0 +1,51 @@
+﻿#pragma once
+#ifndef VFRAME_MESH_FORMAT_HPP
+#define VFRAME_MESH_FORMAT_HPP
+
+#include <vFrame/vf_scene_types.hpp>
+
+#include <cstdint>
+
+// Cooked mesh format (.vfmesh), produced offline by tools/vfmesh_cook.
+//
+// [VfMeshHeader][padding][vertex stream][padding][index stream]
+//
+// Streams are already in the GPU layout (SceneVertex, uint32 indices, little-endian)
+// and start at VF_MESH_STREAM_ALIGNMENT, so the loader maps the file and copies
+// the streams into staging memory as is - there is nothing to parse.
+
+namespace vf_vulkan {
+
+    constexpr uint32_t VF_MESH_MAGIC = 0x534D4656; // "VFMS"
+    constexpr uint32_t VF_MESH_VERSION = 1;
+    constexpr uint32_t VF_MESH_STREAM_ALIGNMENT = 64;
+
+    struct VfMeshLod {
+        uint32_t firstIndex;  // Relative to the index stream of this file
+        uint32_t indexCount;
+    };
+
+    struct VfMeshHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexStride;       // Must be sizeof(SceneVertex)
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        uint64_t vertexDataOffset;   // From the beginning of the file, VF_MESH_STREAM_ALIGNMENT aligned
+        uint64_t indexDataOffset;
+        float boundsCenter[3];
+        float boundsRadius;
+        VfMeshLod lods[VF_MAX_MESH_LODS];
+    };
+    static_assert(sizeof(VfMeshHeader) == 88, "VfMeshHeader layout is part of the file format");
+
+    constexpr uint64_t
+    vfMeshAlignOffset(uint64_t offset)
+    {
+        return (offset + VF_MESH_STREAM_ALIGNMENT - 1) & ~static_cast<uint64_t>(VF_MESH_STREAM_ALIGNMENT - 1);
+    }
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_MESH_FORMAT_HPP
@@ -0,0 +1,73 @@
+﻿#pragma once
+#ifndef VFRAME_PAK_FORMAT_HPP
+#define VFRAME_PAK_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Asset archive format (.vfpak), produced offline by tools/vfpak.
+//
+// [VfPakHeader][VfPakEntry x entryCount][path strings][entry data...]
+//
+// Entries are sorted by pathHash, so a lookup is a binary search over the mapped table
+// without building anything at load time. Paths are kept to resolve hash collisions.
+// Every entry is stored either as is (VF_PAK_COMPRESSION_NONE, read straight from the mapping)
+// or compressed with LZ4 / zstd - the packer keeps the raw bytes when compression does not pay off.
+
+namespace vf_vulkan {
+
+    constexpr uint32_t VF_PAK_MAGIC = 0x4B504656; // "VFPK"
+    constexpr uint32_t VF_PAK_VERSION = 1;
+    constexpr uint32_t VF_PAK_DATA_ALIGNMENT = 16;
+
+    enum VfPakCompression : uint32_t {
+        VF_PAK_COMPRESSION_NONE = 0,
+        VF_PAK_COMPRESSION_LZ4 = 1,
+        VF_PAK_COMPRESSION_ZSTD = 2,
+    };
+
+    struct VfPakHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t entriesOffset;  // From the beginning of the file
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+    static_assert(sizeof(VfPakHeader) == 40, "VfPakHeader layout is part of the file format");
+
+    struct VfPakEntry {
+        uint64_t pathHash;       // vfPakHashPath of the path
+        uint64_t dataOffset;     // From the beginning of the file, VF_PAK_DATA_ALIGNMENT aligned
+        uint64_t storedSize;     // Bytes in the archive
+        uint64_t size;           // Bytes after decompression
+        uint32_t pathOffset;     // Into the string table, not null-terminated
+        uint32_t pathLength;
+        uint32_t compression;    // VfPakCompression
+        uint32_t reserved;
+    };
+    static_assert(sizeof(VfPakEntry) == 48, "VfPakEntry layout is part of the file format");
+
+    // FNV-1a 64 over the path with '\' treated as '/', so Windows style paths find the same entry
+    constexpr uint64_t
+    vfPakHashPath(const char* path, size_t length)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (size_t i = 0; i < length; i++) {
+            char c = path[i] == '\\' ? '/' : path[i];
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    constexpr uint64_t
+    vfPakAlignOffset(uint64_t offset)
+    {
+        return (offset + VF_PAK_DATA_ALIGNMENT - 1) & ~static_cast<uint64_t>(VF_PAK_DATA_ALIGNMENT - 1);
+    }
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_PAK_FORMAT_HPP
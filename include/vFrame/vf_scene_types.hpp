@@ -0,0 +1,181 @@
+﻿#pragma once
+#ifndef VFRAME_SCENE_TYPES_HPP
+#define VFRAME_SCENE_TYPES_HPP
+
+#include <cstdint>
+
+namespace vf_vulkan {
+
+    constexpr uint32_t VF_MAX_MESH_LODS = 4;
+
+    // Streamed KTX2 texture (see VulkanContext::loadTexture)
+    using TextureHandle = uint32_t;
+    constexpr TextureHandle VF_INVALID_TEXTURE = 0xFFFFFFFFu;
+    constexpr uint32_t VF_MAX_SCENE_TEXTURES = 64; // Textures the scene pass can sample (handles below this)
+
+    // Vertex layout of the GPU-driven scene. The vertex shader pulls it from a
+    // storage buffer (no vertex input state), so it must stay 32 bytes of floats.
+    struct SceneVertex {
+        float position[3];
+        float normal[3];
+        float uv[2];
+    };
+
+    // Location of a mesh (or one LOD of it) inside the shared scene index/vertex buffers.
+    struct MeshRange {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        int32_t vertexOffset = 0;
+    };
+
+    // Mesh uploaded into the scene buffers (see VulkanContext::loadSceneMesh)
+    struct SceneMesh {
+        MeshRange lods[VF_MAX_MESH_LODS];
+        uint32_t lodCount = 0;
+        float boundsCenter[3] = { 0.0f, 0.0f, 0.0f };
+        float boundsRadius = 0.0f;
+    };
+
+    struct SceneObjectDesc {
+        float transform[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 }; // Column-major model matrix
+        float boundsCenter[3] = { 0.0f, 0.0f, 0.0f };  // Bounding sphere in model space
+        float boundsRadius = 1.0f;
+        MeshRange lods[VF_MAX_MESH_LODS];              // lods[0] is the most detailed
+        float lodDistances[VF_MAX_MESH_LODS] = { 0.0f, 0.0f, 0.0f, 0.0f }; // Max camera distance for lod i (last lod has no limit)
+        uint32_t lodCount = 1;
+        TextureHandle texture = VF_INVALID_TEXTURE;    // Base color, multiplied with the lighting in the scene pass
+    };
+
+    struct TextureStreamingStats {
+        uint32_t textureCount = 0;
+        uint32_t pendingUploads = 0;     // Mip uploads prepared on worker threads
+        uint64_t residentBytes = 0;      // Device memory held by texture images
+        uint64_t budgetBytes = 0;
+        uint64_t streamedBytes = 0;      // Total mip data uploaded since start
+        uint64_t evictions = 0;          // Number of times mips were dropped under memory pressure
+    };
+
+    struct PipelineStats {
+        uint32_t pipelineCount = 0;          // Distinct pipelines
+        uint32_t pendingCompiles = 0;
+        uint64_t requests = 0;               // Graphics pipeline requests by state
+        uint64_t deduplicated = 0;           // Requests answered with an existing pipeline
+        uint64_t compiled = 0;
+        uint64_t failed = 0;
+        double compileMilliseconds = 0.0;    // Total time spent compiling on worker threads
+        double maxCompileMilliseconds = 0.0;
+    };
+
+    // FIFO: vsync, never tears. FIFO_RELAXED: vsync, tears when a frame is late.
+    // MAILBOX: vsync, the newest frame replaces a queued one. IMMEDIATE: no vsync, lowest latency, tears
+    enum class PresentMode : uint32_t {
+        FIFO,
+        FIFO_RELAXED,
+        MAILBOX,
+        IMMEDIATE,
+    };
+
+    struct PresentStats {
+        PresentMode requestedMode = PresentMode::MAILBOX;
+        PresentMode activeMode = PresentMode::FIFO;  // FIFO when the requested mode is not supported
+        bool presentWait = false;                    // VK_KHR_present_wait available
+        uint32_t frameLatency = 0;                   // Effective latency limit, 0 without present wait
+        uint64_t presents = 0;
+        double lastIntervalMilliseconds = 0.0;       // Present to present
+        double averageIntervalMilliseconds = 0.0;
+        double maxIntervalMilliseconds = 0.0;
+    };
+
+    struct DynamicResolutionStats {
+        bool enabled = false;                // Requested and supported by the swap chain
+        float scale = 1.0f;                  // Render size / output size, per axis
+        float gpuMilliseconds = 0.0f;        // Last measured GPU frame time
+        float smoothedGpuMilliseconds = 0.0f; // What the controller reacts to
+        uint32_t renderWidth = 0;
+        uint32_t renderHeight = 0;
+    };
+
+    // Font loaded into the text renderer (see VulkanContext::loadFont)
+    using FontHandle = uint32_t;
+    constexpr FontHandle VF_INVALID_FONT = 0xFFFFFFFFu;
+    constexpr uint32_t VF_MAX_FONTS = 4;
+
+    struct TextStats {
+        uint32_t fontCount = 0;
+        uint32_t strings = 0;            // drawText calls of the last frame
+        uint32_t glyphs = 0;             // Glyph quads of the last frame, all in one draw
+        uint32_t drawCalls = 0;
+        uint64_t droppedGlyphs = 0;      // Over the per frame glyph capacity, since start
+        uint64_t layoutHits = 0;         // Strings drawn from the layout cache
+        uint64_t layoutMisses = 0;       // Strings laid out again
+        uint32_t cachedLayouts = 0;
+    };
+
+    // GPU particle emitter (see VulkanContext::addParticleEmitter)
+    using EmitterHandle = uint32_t;
+    constexpr EmitterHandle VF_INVALID_EMITTER = 0xFFFFFFFFu;
+    constexpr uint32_t VF_MAX_EMITTERS = 256;
+
+    struct ParticleSettings {
+        uint32_t maxParticles = 1u << 20;  // Live at once, emission past it is dropped
+        bool sortAlpha = false;            // Alpha blended and sorted back to front on the GPU; additive, unsorted otherwise
+        bool depthCollisions = false;      // Keeps the depth buffer for the simulation. Needs depth and no MSAA
+    };
+
+    struct ParticleEmitterDesc {
+        float position[3] = { 0.0f, 0.0f, 0.0f };
+        float positionSpread = 0.0f;                    // Spawn radius around position
+        float velocity[3] = { 0.0f, 1.0f, 0.0f };
+        float velocitySpread = 0.5f;                    // Length of the random vector added to velocity
+        float gravity[3] = { 0.0f, -9.81f, 0.0f };      // Acceleration
+        float drag = 0.0f;                              // Fraction of the velocity lost per second
+        float bounce = 0.5f;                            // Restitution on depth buffer hits, < 0 passes through
+        float lifetimeMin = 1.0f;                       // Seconds
+        float lifetimeMax = 2.0f;
+        float startColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f }; // Linear RGBA, blended to endColor over the lifetime
+        float endColor[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+        float startSize = 0.1f;                         // World units
+        float endSize = 0.1f;
+        float rate = 100.0f;                            // Particles per second
+    };
+
+    struct ParticleStats {
+        uint32_t emitters = 0;
+        uint32_t maxParticles = 0;
+        uint32_t aliveParticles = 0;   // Read back from the GPU, frames in flight late
+        uint32_t emitted = 0;          // Requested by the last frame
+        uint32_t sortedElements = 0;   // Bitonic sort size of the last frame, 0 without sortAlpha
+        bool depthCollisions = false;  // Requested and supported by the render targets
+    };
+
+    constexpr uint32_t VF_MAX_MEMORY_HEAPS = 16;
+
+    // What vFrame allocates device memory for
+    enum class MemoryCategory : uint32_t {
+        TEXTURES,
+        BUFFERS,        // Scene geometry, objects, indirect draws
+        RENDER_TARGETS, // Depth, MSAA color, dynamic resolution target
+        STAGING,        // Upload buffers, freed once the copy is done
+        COUNT,
+    };
+
+    struct MemoryHeapStats {
+        uint64_t size = 0;
+        uint64_t budget = 0;     // VK_EXT_memory_budget; 80% of size without it
+        uint64_t usage = 0;      // Whole process with VK_EXT_memory_budget (other allocators too), vFrame's own otherwise
+        uint64_t allocated = 0;  // Allocated by vFrame
+        bool deviceLocal = false;
+    };
+
+    struct MemoryStats {
+        bool budgetExtension = false;        // Budget and usage come from the driver
+        uint32_t heapCount = 0;
+        MemoryHeapStats heaps[VF_MAX_MEMORY_HEAPS];
+        uint64_t categoryBytes[static_cast<uint32_t>(MemoryCategory::COUNT)] = {};
+        uint32_t allocationCount = 0;
+        float deviceLocalPressure = 0.0f;    // Highest usage / budget of the device local heaps
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_SCENE_TYPES_HPP
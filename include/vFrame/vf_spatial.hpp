@@ -0,0 +1,104 @@
+﻿#pragma once
+#ifndef VFRAME_SPATIAL_HPP
+#define VFRAME_SPATIAL_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <vFrame/vf_math.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vf_core {
+
+    class ThreadPool;
+
+    constexpr uint32_t VF_NO_HIT = 0xFFFFFFFFu;
+
+    struct Aabb {
+        Vec3 min;
+        Vec3 max;
+    };
+
+    struct Ray {
+        Vec3 origin;
+        Vec3 direction;         // Need not be normalized, distances are in units of its length
+        float maxDistance = 1.0e30f;
+    };
+
+    struct RayHit {
+        uint32_t userData = VF_NO_HIT;
+        float distance = 0.0f;  // Where the ray enters the bounds, 0 when it starts inside
+    };
+
+    enum class SpatialStructure : uint32_t {
+        AABB_TREE,   // Any scene: sizes and density may vary
+        LOOSE_GRID,  // Dense scenes of similarly sized objects, a few per cell
+    };
+
+    struct SpatialConfig {
+        SpatialStructure structure = SpatialStructure::AABB_TREE;
+        float fatMargin = 0.1f;  // AABB_TREE: leaves are this much larger, moves inside them do not touch the tree
+        float cellSize = 8.0f;   // LOOSE_GRID: an object lives in the cell of its center, the cell bounds grow to fit it
+    };
+
+    // Spatial index of bounding boxes for culling, picking and gameplay queries.
+    //
+    // insert / update / remove may be called from any thread at any time; they are queued and
+    // take effect in call order at commit(), which runs once per frame on one thread.
+    // Queries are const and safe from any number of threads, as long as commit() is not running.
+    // Results are the userData passed to insert(), tested against the exact bounds.
+    class VFRAME_API SpatialIndex {
+    public:
+        explicit SpatialIndex(const SpatialConfig& config = SpatialConfig{});
+        ~SpatialIndex();
+
+        SpatialIndex(const SpatialIndex&) = delete;
+        SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+        uint32_t insert(const Aabb& bounds, uint32_t userData); // Returns the proxy for update and remove
+        void update(uint32_t proxy, const Aabb& bounds);
+        void remove(uint32_t proxy);                           // The proxy may be returned by a later insert
+        void commit();
+
+        uint32_t size() const; // Committed proxies
+
+        // Results are appended
+        void queryBox(const Aabb& box, std::vector<uint32_t>& results) const;
+        void querySphere(const Vec3& center, float radius, std::vector<uint32_t>& results) const;
+        void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const;
+        RayHit raycast(const Ray& ray) const; // Nearest bounds along the ray
+
+        // Batches: query i replaces results[i] / hits[i]. Queries run on pool and the calling thread,
+        // nullptr runs them on the calling thread only
+        void queryBoxes(const Aabb* boxes, uint32_t count, std::vector<uint32_t>* results, ThreadPool* pool) const;
+        void querySpheres(const Vec3* centers, const float* radii, uint32_t count, std::vector<uint32_t>* results, ThreadPool* pool) const;
+        void queryFrustums(const Frustum* frustums, uint32_t count, std::vector<uint32_t>* results, ThreadPool* pool) const;
+        void raycasts(const Ray* rays, uint32_t count, RayHit* hits, ThreadPool* pool) const;
+
+    private:
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+} // namespace vf_core
+
+#endif // VFRAME_SPATIAL_HPP
@@ -0,0 +1,143 @@
+﻿#pragma once
+#ifndef VFRAME_TEXT_HPP
+#define VFRAME_TEXT_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vf_core {
+
+    class ThreadPool;
+
+    struct CodepointRange {
+        uint32_t first;
+        uint32_t last; // Inclusive
+    };
+
+    struct FontConfig {
+        float pixelHeight = 48.0f;   // Em size the glyphs are rasterized at, any size is drawn from it
+        uint32_t spread = 6;         // Atlas pixels the distance field reaches out of (and into) a glyph
+        uint32_t atlasWidth = 1024;  // The height grows to fit, in powers of two
+        std::vector<CodepointRange> ranges = { { 0x20, 0x7E }, { 0xA0, 0xFF }, { 0x400, 0x45F } };
+        std::string cacheFile;       // Atlas and metrics are kept here between runs, "" disables the disk cache
+    };
+
+    // Glyph metrics in em units (multiply by the font size), y down from the baseline.
+    // The quad covers the distance field, spread included
+    struct GlyphInfo {
+        uint32_t codepoint = 0;
+        uint32_t glyphIndex = 0;
+        float advance = 0.0f;
+        float x0 = 0.0f, y0 = 0.0f, x1 = 0.0f, y1 = 0.0f;
+        float u0 = 0.0f, v0 = 0.0f, u1 = 0.0f, v1 = 0.0f; // Atlas, normalized
+    };
+
+    // TrueType font (glyf outlines) turned into a signed distance field atlas, one byte per pixel:
+    // 128 is the outline, higher is inside. Glyphs are rasterized on pool and the calling thread
+    // (nullptr: calling thread only). With a cacheFile the result is written there and read back by the
+    // next run instead of rasterizing, as long as the font data and the config are the same.
+    // Kerning comes from the 'kern' table; GPOS and complex shaping are not supported.
+    class VFRAME_API Font {
+    public:
+        Font(const uint8_t* data, size_t size, const FontConfig& config, ThreadPool* pool);
+        ~Font();
+
+        Font(const Font&) = delete;
+        Font& operator=(const Font&) = delete;
+
+        const GlyphInfo* glyph(uint32_t codepoint) const; // nullptr when the codepoint is not in the atlas
+        const GlyphInfo* fallbackGlyph() const;           // '?' or the first glyph, for missing codepoints
+        float kerning(const GlyphInfo& left, const GlyphInfo& right) const;
+
+        float ascender() const;   // Em units, positive
+        float descender() const;  // Em units, negative
+        float lineHeight() const; // Ascender - descender + line gap
+
+        float pixelHeight() const;
+        uint32_t spread() const;
+        uint32_t glyphCount() const;
+        uint32_t atlasWidth() const;
+        uint32_t atlasHeight() const;
+        const uint8_t* atlasPixels() const;
+
+        bool loadedFromCache() const;
+
+    private:
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+    // One glyph quad in pixels relative to the top left of the text box
+    struct TextGlyph {
+        float x0, y0, x1, y1;
+        float u0, v0, u1, v1;
+    };
+
+    struct TextLayout {
+        std::vector<TextGlyph> glyphs; // Whitespace has none
+        float width = 0.0f;            // Widest line
+        float height = 0.0f;           // Lines * line height
+        uint32_t lineCount = 0;
+    };
+
+    // UTF-8 to positioned quads: advances, kerning, '\n' and, with maxWidth > 0, wrapping at spaces.
+    // The first baseline is one ascender below the top
+    VFRAME_API void layoutText(const Font& font, std::string_view text, float size, float maxWidth, TextLayout& layout);
+
+    struct TextLayoutStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint32_t entries = 0;
+    };
+
+    // Laid out strings by font, text, size and wrap width. A string drawn every frame is laid out once;
+    // entries unused for idleFrames are dropped by nextFrame(). Fonts must outlive the cache. One thread only
+    class VFRAME_API TextLayoutCache {
+    public:
+        explicit TextLayoutCache(uint32_t idleFrames = 120);
+        ~TextLayoutCache();
+
+        TextLayoutCache(const TextLayoutCache&) = delete;
+        TextLayoutCache& operator=(const TextLayoutCache&) = delete;
+
+        // Valid until the next get() or nextFrame()
+        const TextLayout& get(const Font& font, std::string_view text, float size, float maxWidth = 0.0f);
+        void nextFrame();
+        void clear();
+
+        TextLayoutStats stats() const;
+
+    private:
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+} // namespace vf_core
+
+#endif // VFRAME_TEXT_HPP
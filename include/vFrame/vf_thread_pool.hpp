@@ -0,0 +1,72 @@
+﻿#pragma once
+#ifndef VFRAME_THREAD_POOL_HPP
+#define VFRAME_THREAD_POOL_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace vf_core {
+
+    // Fixed set of worker threads with a shared FIFO queue.
+    // Used by the engine for background work (texture streaming, decompression, pipeline compiles)
+    // and by user code through parallelFor.
+    class VFRAME_API ThreadPool {
+    public:
+        explicit ThreadPool(size_t threadCount = 0); // 0 - hardware_concurrency() - 1 (at least 1)
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template <typename F>
+        auto submit(F&& task) -> std::future<std::invoke_result_t<F>>
+        {
+            using Result = std::invoke_result_t<F>;
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> future = packaged->get_future();
+            enqueue([packaged]() { (*packaged)(); });
+            return future;
+        }
+
+        // Splits [begin, end) into chunks of at least grainSize and runs fn(chunkBegin, chunkEnd)
+        // on the workers and the calling thread. Returns when every chunk is done.
+        void parallelFor(size_t begin, size_t end, size_t grainSize,
+            const std::function<void(size_t, size_t)>& fn);
+
+        size_t size() const;
+
+        // Engine wide pool, created on first use
+        static ThreadPool& global();
+
+    private:
+        void enqueue(std::function<void()> task);
+
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+} // namespace vf_core
+
+#endif // VFRAME_THREAD_POOL_HPP
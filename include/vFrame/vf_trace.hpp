@@ -0,0 +1,86 @@
+﻿#pragma once
+#ifndef VFRAME_TRACE_HPP
+#define VFRAME_TRACE_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <cstdint>
+
+namespace vf_core {
+
+    // CPU zones, GPU zones and frame markers on one timeline, saved as Chrome trace JSON
+    // (opens in ui.perfetto.dev and chrome://tracing). Every thread writes into its own buffer
+    // without locks; outside of a capture a zone costs one atomic load.
+    //
+    //   vf_core::traceStart();
+    //   ... a few frames ...
+    //   vf_core::traceStop();
+    //   vf_core::traceWriteChromeJson("frame.json");
+    //
+    // GPU zones of the frame (culling, scene pass, upscale) are recorded by VulkanContext while
+    // a capture runs; with VK_KHR/EXT_calibrated_timestamps they line up with the CPU exactly.
+    VFRAME_API void traceStart(uint32_t maxEventsPerThread = 1u << 16); // Events past that are dropped
+    VFRAME_API void traceStop();
+    VFRAME_API void traceWriteChromeJson(const char* filename); // After traceStop()
+    VFRAME_API bool traceEnabled();
+
+    // Nanoseconds on std::chrono::steady_clock, the clock of every event
+    VFRAME_API int64_t traceNow();
+    // Track name of the calling thread in the viewer
+    VFRAME_API void traceSetThreadName(const char* name);
+
+    // name is stored as a pointer: string literals (or anything else that outlives the capture)
+    VFRAME_API void traceZone(const char* name, int64_t beginNanoseconds, int64_t endNanoseconds);
+    VFRAME_API void traceGpuZone(const char* name, int64_t beginNanoseconds, int64_t endNanoseconds);
+    VFRAME_API void traceFrame(uint64_t frameNumber);
+
+    class TraceScope {
+    public:
+        explicit TraceScope(const char* name)
+            : name_(name)
+            , begin_(traceEnabled() ? traceNow() : -1)
+        {
+        }
+
+        ~TraceScope()
+        {
+            if (begin_ >= 0) traceZone(name_, begin_, traceNow());
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        const char* name_;
+        int64_t begin_;
+    };
+
+} // namespace vf_core
+
+// VF_TRACE_ZONE("name") times the rest of the enclosing scope, VF_TRACE_FRAME(n) marks a frame start.
+// -DVFRAME_DISABLE_TRACE compiles both out.
+#ifndef VFRAME_DISABLE_TRACE
+#  define VF_TRACE_CONCAT_INNER(a, b) a##b
+#  define VF_TRACE_CONCAT(a, b) VF_TRACE_CONCAT_INNER(a, b)
+#  define VF_TRACE_ZONE(name) ::vf_core::TraceScope VF_TRACE_CONCAT(vfTraceScope, __LINE__)(name)
+#  define VF_TRACE_FRAME(frameNumber) ::vf_core::traceFrame(frameNumber)
+#else
+#  define VF_TRACE_ZONE(name) ((void)0)
+#  define VF_TRACE_FRAME(frameNumber) ((void)0)
+#endif
+
+#endif // VFRAME_TRACE_HPP
@@ -0,0 +1,79 @@
+﻿#pragma once
+#ifndef VFRAME_TRANSFORM_HPP
+#define VFRAME_TRANSFORM_HPP
+
+#if defined _WIN32 || defined __CYGWIN__
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __declspec(dllexport)
+#  else
+#    define VFRAME_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) || defined(__clang__)
+#  ifdef VFRAME_BUILD_DLL
+#    define VFRAME_API __attribute__((visibility("default")))
+#  else
+#    define VFRAME_API
+#  endif
+#else
+#  define VFRAME_API
+#endif
+
+#include <vFrame/vf_math.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vf_core {
+
+    class ThreadPool;
+
+    constexpr uint32_t VF_NO_PARENT = 0xFFFFFFFFu;
+
+    // Scene graph transforms. Local transforms and world matrices live in flat arrays sorted by depth,
+    // so every parent comes before its children and one depth level is one contiguous range.
+    // update() walks the levels in order and recomputes only nodes that were changed or whose parent
+    // was recomputed; the nodes of a level are independent and run in parallel.
+    // Node ids are stable: destroy() frees one for a later create.
+    class VFRAME_API TransformHierarchy {
+    public:
+        TransformHierarchy();
+        ~TransformHierarchy();
+
+        TransformHierarchy(const TransformHierarchy&) = delete;
+        TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+        uint32_t create(const Transform& local, uint32_t parent = VF_NO_PARENT);
+        void destroy(uint32_t node); // Together with all of its descendants, which go at the next update()
+
+        void setLocal(uint32_t node, const Transform& local);
+        const Transform& local(uint32_t node) const;
+
+        // Throws when parent is node itself or one of its descendants
+        void setParent(uint32_t node, uint32_t parent);
+        uint32_t parent(uint32_t node) const;
+
+        const Mat4& world(uint32_t node) const; // As of the last update()
+        bool alive(uint32_t node) const;
+        uint32_t size() const;                  // Nodes, destroyed ones included until the next update()
+
+        // Levels run on pool and the calling thread; nullptr updates on the calling thread only.
+        // Creates, destroys and reparents since the last call re-sort the arrays first.
+        void update(ThreadPool* pool);
+
+        // Nodes whose world matrix the last update() recomputed, parents before children,
+        // and their matrices in the same order: one contiguous block for the GPU upload
+        const std::vector<uint32_t>& changedNodes() const;
+        const std::vector<Mat4>& changedWorlds() const;
+
+    private:
+        class Impl;
+        #pragma warning(push)
+        #pragma warning(disable: 4251) // "class needs to have dll-interface"
+        std::unique_ptr<Impl> pImpl;
+        #pragma warning(pop)
+    };
+
+} // namespace vf_core
+
+#endif // VFRAME_TRANSFORM_HPP
@@ -32,6 +32,10 @@
 #include <limits> // Necessary for std::numeric_limits
 #include <algorithm> // Necessary for std::clamp
 #include <fstream> // For file operations (if needed later)
+#include <memory>
+#include <functional>
+#include <vFrame/vf_scene_types.hpp>
+#include <vFrame/vf_text.hpp>
 
 namespace vf_vulkan {
 
@@ -55,6 +59,80 @@ namespace vf_vulkan {
 
         VkInstance getInstance() const;
 
+        // GPU-driven scene: geometry, objects and bounds live in GPU buffers,
+        // frustum culling and LOD selection run in a compute pass (see shaders/cull.comp).
+        // Needs bufferDeviceAddress and drawIndirectFirstInstance, the first upload throws without them
+        void setSceneCapacity(uint32_t maxObjects, uint32_t maxVertices, uint32_t maxIndices); // Before the first upload
+        MeshRange uploadSceneMesh(const SceneVertex* vertices, uint32_t vertexCount,
+            const uint32_t* indices, uint32_t indexCount);
+        SceneMesh loadSceneMesh(const char* filename); // Cooked .vfmesh (tools/vfmesh_cook), memory mapped
+        uint32_t addSceneObjects(const SceneObjectDesc* objects, uint32_t count); // Returns index of the first object
+        void clearSceneObjects();
+        void setCamera(const float viewProjection[16], const float cameraPosition[3]); // Debug lines (vf_debug_draw.hpp) use it too
+
+        // .vfpak archive (tools/vfpak). Every later load - shaders, meshes, textures - looks into
+        // the mounted archives first (the last mounted wins) and falls back to loose files
+        void mountAssetArchive(const char* filename); // Call before init() to load the built-in shaders from it
+
+        // Streamed KTX2 textures (BCn/ASTC/ETC2/RGBA8). Only the small mips are loaded up front,
+        // bigger ones follow the on-screen size reported by setTextureDemand and the memory budget.
+        // Scene objects sample them through SceneObjectDesc::texture (handles below VF_MAX_SCENE_TEXTURES)
+        TextureHandle loadTexture(const char* filename);
+        void setTextureDemand(TextureHandle texture, float screenPixels); // Every frame the texture is visible
+        void setTextureBudget(uint64_t bytes);
+        TextureStreamingStats getTextureStats() const;
+
+        // Signed distance field text (TrueType). The glyph atlas is rasterized on the thread pool and cached in
+        // the working directory (vframe_font_*.sdf); a string drawn every frame is laid out once. Every drawText of a
+        // frame ends up in one instanced draw on top of the scene, positions are window pixels from the top left
+        FontHandle loadFont(const char* filename, const vf_core::FontConfig& config = vf_core::FontConfig()); // After init()
+        void drawText(FontHandle font, const char* text, float x, float y, float size,
+            const float color[4], float maxWidth = 0.0f); // Until the next drawFrame, maxWidth > 0 wraps at spaces
+        void measureText(FontHandle font, const char* text, float size, float maxWidth, float& width, float& height);
+        TextStats getTextStats() const;
+
+        // GPU particles: emission, forces, depth buffer collisions and compaction run in compute shaders, the live
+        // count never comes back to the CPU - the draw is indirect. Billboards and the alpha sort use the setCamera camera
+        void setParticleSettings(const ParticleSettings& settings); // Before init()
+        EmitterHandle addParticleEmitter(const ParticleEmitterDesc& desc); // At most VF_MAX_EMITTERS at once
+        void updateParticleEmitter(EmitterHandle emitter, const ParticleEmitterDesc& desc);
+        void removeParticleEmitter(EmitterHandle emitter); // Its particles live out their lifetime
+        void burstParticles(EmitterHandle emitter, uint32_t count); // Emitted at the next frame on top of the rate
+        ParticleStats getParticleStats() const;
+
+        // Tearing/latency/power trade-off. A change after init() recreates the swap chain at the next frame
+        void setPresentMode(PresentMode mode); // MAILBOX by default, FIFO where the requested mode is missing
+        // With VK_KHR_present_wait the frame loop waits until the present `frames` back is on screen,
+        // so at most that many frames are queued for display. 0 (default): only the fences limit the CPU
+        void setFrameLatency(uint32_t frames);
+        // Intervals come from present wait when a frame latency is set, from the present calls otherwise
+        PresentStats getPresentStats() const;
+
+        // Depth buffer (on by default) and MSAA sample count (1 by default, clamped to what the device supports).
+        // Both are transient attachments, lazily allocated on tile-based GPUs, MSAA is resolved inside the render pass
+        void setRenderTargets(bool depth, uint32_t msaaSamples); // Before init()
+
+        // The scene is drawn at a fraction of the window size chosen every frame from the measured GPU time,
+        // then upscaled to the window. Keeps targetMilliseconds on slow GPUs without touching quality settings
+        void enableDynamicResolution(float targetMilliseconds, float minScale = 0.5f); // Before init()
+        DynamicResolutionStats getDynamicResolutionStats() const;
+
+        // Device memory per heap (VK_EXT_memory_budget when available) and per category, refreshed every frame
+        MemoryStats getMemoryStats() const;
+        // callback runs on the frame thread once device local usage reaches fraction of the budget (0.9 prints
+        // a warning by default), and again only after usage dropped below it
+        void addMemoryWarning(float fraction, std::function<void(const MemoryStats&)> callback); // After init()
+
+        // Pipelines compile on worker threads through a VkPipelineCache kept on disk between runs
+        void setPipelineCacheFile(const char* filename); // Before init(), "" keeps the cache in memory only
+        PipelineStats getPipelineStats() const; // Distinct pipelines, deduplicated requests, compile time
+
+        // Development mode: sources in sourceDir are watched, recompiled to shaders/*.spv in the background
+        // (glslc; HLSL as name.vert.hlsl) and the pipelines using them are swapped at a frame boundary.
+        // The built-in cull.comp/scene.vert/scene.frag are watched by name, the main pipeline via watchShader.
+        void enableShaderHotReload(const char* sourceDir, const char* compiler = "glslc"); // After init()
+        void watchShader(const char* source, const char* spvName); // e.g. ("shader.vert", "vert.spv")
+
     private:
         VulkanContext();  
         ~VulkanContext(); 
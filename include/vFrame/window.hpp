@@ -27,12 +27,13 @@ namespace vf_window {
 
     class VFRAME_API Window {
     public:
-        Window(int w, int h, const char* title); 
+        Window(int w, int h, const char* title, bool visible = true); // Hidden windows for benchmarks/CI
         ~Window();
 
         GLFWwindow* getHandle() const;           
         bool shouldClose() const;                
         void pollEvents() const;                 
+        void setSize(int w, int h);
 
     private:
         GLFWwindow* window = nullptr;
@@ -0,0 +1,27 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Debug lines pulled from the per-frame ring, two vertices per line, world space.
+
+struct Vertex {
+    float x, y, z;
+    uint color;     // RGBA8, R in the low byte
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+    VertexBuffer vertices;
+} pc;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    Vertex vertex = pc.vertices.vertices[gl_VertexIndex];
+    gl_Position = pc.viewProjection * vec4(vertex.x, vertex.y, vertex.z, 1.0);
+    fragColor = unpackUnorm4x8(vertex.color);
+}
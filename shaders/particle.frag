@@ -0,0 +1,13 @@
+#version 460
+
+layout(location = 0) in vec2 fragCorner;
+layout(location = 1) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // Round, soft edged sprite
+    float falloff = 1.0 - smoothstep(0.5, 1.0, length(fragCorner));
+    outColor = vec4(fragColor.rgb, fragColor.a * falloff);
+}
@@ -0,0 +1,56 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Camera facing particle quads, one instance per live particle, 6 vertices each.
+// Instance count comes from the indirect arguments written by particles.comp.
+
+struct Particle {
+    vec3 position;
+    float age;
+    vec3 velocity;
+    float lifetime;
+    uint colors[2];     // Start, end: RGBA8, R in the low byte
+    uint sizes;         // Start, end: half floats
+    uint emitter;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer ParticleBuffer {
+    Particle particles[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer KeyBuffer {
+    uvec2 keys[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+    vec4 right;         // World space camera axes, xyz
+    vec4 up;
+    ParticleBuffer particles;
+    KeyBuffer keys;
+    uint sorted;        // 1: instance i draws the particle of sorted key i
+} pc;
+
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out vec4 fragColor;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, -1.0),
+    vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, 1.0)
+);
+
+void main()
+{
+    uint index = pc.sorted != 0 ? pc.keys.keys[gl_InstanceIndex].y : gl_InstanceIndex;
+    Particle particle = pc.particles.particles[index];
+
+    float t = clamp(particle.age / particle.lifetime, 0.0, 1.0);
+    vec2 sizes = unpackHalf2x16(particle.sizes);
+    float halfSize = 0.5 * mix(sizes.x, sizes.y, t);
+
+    vec2 corner = CORNERS[gl_VertexIndex];
+    vec3 position = particle.position + (pc.right.xyz * corner.x + pc.up.xyz * corner.y) * halfSize;
+    gl_Position = pc.viewProjection * vec4(position, 1.0);
+    fragCorner = corner;
+    fragColor = mix(unpackUnorm4x8(particle.colors[0]), unpackUnorm4x8(particle.colors[1]), t);
+}
@@ -0,0 +1,21 @@
+#version 460
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragUV;
+layout(location = 2) flat in uint fragTexture;
+
+// VF_MAX_SCENE_TEXTURES in vf_scene_types.hpp, indexed by texture handle
+layout(set = 0, binding = 0) uniform sampler2D textures[64];
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec3 lightDirection = normalize(vec3(0.4, 1.0, 0.3));
+    float diffuse = max(dot(normalize(fragNormal), lightDirection), 0.0);
+    vec4 baseColor = vec4(1.0);
+    if (fragTexture != 0xFFFFFFFFu) {
+        baseColor = texture(textures[fragTexture], fragUV);
+    }
+    outColor = vec4(baseColor.rgb * (0.15 + 0.85 * diffuse), baseColor.a);
+}
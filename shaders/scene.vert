@@ -0,0 +1,48 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Vertex pulling for the GPU-driven scene: no vertex input state,
+// vertices and per-object data are read through buffer device addresses.
+
+struct Vertex {
+    float px, py, pz;
+    float nx, ny, nz;
+    float u, v;
+};
+
+struct ObjectData {
+    mat4 model;
+    vec4 sphere;
+    uvec4 lods[4];
+    vec4 lodDistances;
+    uvec4 info;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+    VertexBuffer vertices;
+    ObjectBuffer objects;
+} pc;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragUV;
+layout(location = 2) flat out uint fragTexture;
+
+void main()
+{
+    Vertex vertex = pc.vertices.vertices[gl_VertexIndex];
+    mat4 model = pc.objects.objects[gl_InstanceIndex].model;
+
+    gl_Position = pc.viewProjection * model * vec4(vertex.px, vertex.py, vertex.pz, 1.0);
+    fragNormal = mat3(model) * vec3(vertex.nx, vertex.ny, vertex.nz);
+    fragUV = vec2(vertex.u, vertex.v);
+    fragTexture = pc.objects.objects[gl_InstanceIndex].info.y;
+}
@@ -0,0 +1,17 @@
+#version 460
+
+layout(set = 0, binding = 0) uniform sampler2DArray atlas;
+
+layout(location = 0) in vec3 fragUV;
+layout(location = 1) in vec4 fragColor;
+layout(location = 2) in float fragDistanceScale;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // 0.5 is the outline; the field is scaled to screen pixels for a one pixel wide antialiased edge
+    float distance = texture(atlas, fragUV).r - 0.5;
+    float coverage = clamp(distance * fragDistanceScale + 0.5, 0.0, 1.0);
+    outColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
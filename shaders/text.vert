@@ -0,0 +1,44 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Glyph quads pulled from the per-frame ring: one instance per glyph, 6 vertices (two triangles) each.
+// Positions are window pixels with the origin in the top left corner.
+
+struct Glyph {
+    vec4 rect;      // x0, y0, x1, y1
+    vec4 uv;        // u0, v0, u1, v1
+    uint color;     // RGBA8, R in the low byte
+    uint layer;     // Font
+    float distanceScale;
+    uint padding;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer GlyphBuffer {
+    Glyph glyphs[];
+};
+
+layout(push_constant) uniform Push {
+    GlyphBuffer glyphs;
+    vec2 invScreenSize;
+} pc;
+
+layout(location = 0) out vec3 fragUV;
+layout(location = 1) out vec4 fragColor;
+layout(location = 2) out float fragDistanceScale;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 0.0),
+    vec2(1.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0)
+);
+
+void main()
+{
+    Glyph glyph = pc.glyphs.glyphs[gl_InstanceIndex];
+    vec2 corner = CORNERS[gl_VertexIndex];
+
+    vec2 position = mix(glyph.rect.xy, glyph.rect.zw, corner);
+    gl_Position = vec4(position * pc.invScreenSize * 2.0 - 1.0, 0.0, 1.0);
+    fragUV = vec3(mix(glyph.uv.xy, glyph.uv.zw, corner), float(glyph.layer));
+    fragColor = unpackUnorm4x8(glyph.color);
+    fragDistanceScale = glyph.distanceScale;
+}
@@ -1,6 +1,7 @@
 ﻿#include "vFrame/for_user/vf_application.hpp"
 #include "vFrame/window.hpp"
 #include "vFrame/vf_vulkan.hpp"
+#include "vFrame/vf_ecs.hpp"
 
 #include <chrono>
 #include <memory>
@@ -41,6 +42,8 @@ namespace vf_core {
             }
         }
 
+        World world;
+
     private:
         vf_window::Window window;
         std::unique_ptr<vf_vulkan::VulkanContext, vf_vulkan::VulkanContextDeleter> context;
@@ -63,4 +66,8 @@ namespace vf_core {
         pImpl->run(this);
     }
 
+    World& Application::world() {
+        return pImpl->world;
+    }
+
 }
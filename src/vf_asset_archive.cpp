@@ -0,0 +1,205 @@
+﻿#include "vf_asset_archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef VFRAME_HAS_LZ4
+#include <lz4.h>
+#endif
+#ifdef VFRAME_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace vf_vulkan {
+
+    namespace {
+
+        std::vector<uint8_t>
+        decompress(const VfPakEntry& entry, const uint8_t* src, const std::string& path)
+        {
+            std::vector<uint8_t> result(static_cast<size_t>(entry.size));
+
+            switch (entry.compression) {
+            case VF_PAK_COMPRESSION_LZ4:
+#ifdef VFRAME_HAS_LZ4
+            {
+                int decoded = LZ4_decompress_safe(reinterpret_cast<const char*>(src), reinterpret_cast<char*>(result.data()),
+                    static_cast<int>(entry.storedSize), static_cast<int>(entry.size));
+                if (decoded < 0 || static_cast<uint64_t>(decoded) != entry.size) {
+                    throw std::runtime_error("failed to decompress asset: " + path);
+                }
+                return result;
+            }
+#else
+                throw std::runtime_error("asset is LZ4 compressed, but vFrame was built without LZ4: " + path);
+#endif
+            case VF_PAK_COMPRESSION_ZSTD:
+#ifdef VFRAME_HAS_ZSTD
+            {
+                size_t decoded = ZSTD_decompress(result.data(), result.size(), src, static_cast<size_t>(entry.storedSize));
+                if (ZSTD_isError(decoded) || decoded != entry.size) {
+                    throw std::runtime_error("failed to decompress asset: " + path);
+                }
+                return result;
+            }
+#else
+                throw std::runtime_error("asset is zstd compressed, but vFrame was built without zstd: " + path);
+#endif
+            default:
+                throw std::runtime_error("unknown asset compression: " + path);
+            }
+        }
+
+    } // namespace
+
+    // ### AssetBlob ###
+    AssetBlob::AssetBlob(std::shared_ptr<const MappedFile> file, const uint8_t* data, size_t size)
+        : file_(std::move(file))
+        , data_(data)
+        , size_(size)
+    {
+    }
+
+    AssetBlob::AssetBlob(std::vector<uint8_t> bytes)
+        : storage_(std::move(bytes))
+    {
+        data_ = storage_.data();
+        size_ = storage_.size();
+    }
+
+    std::vector<char>
+    AssetBlob::toChars() const
+    {
+        return std::vector<char>(reinterpret_cast<const char*>(data_), reinterpret_cast<const char*>(data_) + size_);
+    }
+
+    // ### AssetArchive ###
+    AssetArchive::AssetArchive(const std::string& filename)
+        : filename_(filename)
+        , file_(std::make_shared<MappedFile>(filename))
+    {
+        const uint8_t* data = file_->data();
+        const uint64_t size = file_->size();
+        if (size < sizeof(VfPakHeader)) {
+            throw std::runtime_error("invalid asset archive: " + filename);
+        }
+
+        VfPakHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != VF_PAK_MAGIC || header.version != VF_PAK_VERSION) {
+            throw std::runtime_error("unsupported asset archive: " + filename);
+        }
+
+        // The table is used in place, so it must be aligned for VfPakEntry. Ranges are checked in the
+        // subtract form, a crafted offset must not wrap the sum around
+        if (header.entriesOffset % alignof(VfPakEntry) != 0 ||
+            header.entriesOffset > size || static_cast<uint64_t>(header.entryCount) * sizeof(VfPakEntry) > size - header.entriesOffset ||
+            header.stringsOffset > size || header.stringsSize > size - header.stringsOffset) {
+            throw std::runtime_error("corrupted asset archive: " + filename);
+        }
+
+        entries_ = reinterpret_cast<const VfPakEntry*>(data + header.entriesOffset);
+        entryCount_ = header.entryCount;
+        strings_ = reinterpret_cast<const char*>(data + header.stringsOffset);
+
+        // Validate once, lookups then trust the table
+        for (uint32_t i = 0; i < entryCount_; i++) {
+            const VfPakEntry& entry = entries_[i];
+            if (entry.dataOffset > size || entry.storedSize > size - entry.dataOffset ||
+                static_cast<uint64_t>(entry.pathOffset) + entry.pathLength > header.stringsSize ||
+                (entry.compression == VF_PAK_COMPRESSION_NONE && entry.storedSize != entry.size) ||
+                (i > 0 && entries_[i - 1].pathHash > entry.pathHash)) {
+                throw std::runtime_error("corrupted asset archive: " + filename);
+            }
+        }
+    }
+
+    const VfPakEntry*
+    AssetArchive::find(const std::string& path) const
+    {
+        const uint64_t hash = vfPakHashPath(path.data(), path.size());
+        const VfPakEntry* end = entries_ + entryCount_;
+        const VfPakEntry* it = std::lower_bound(entries_, end, hash,
+            [](const VfPakEntry& entry, uint64_t value) { return entry.pathHash < value; });
+
+        // Equal hashes are neighbours, the stored path settles collisions
+        for (; it != end && it->pathHash == hash; ++it) {
+            if (it->pathLength != path.size()) continue;
+
+            bool same = true;
+            for (size_t i = 0; i < path.size() && same; i++) {
+                char c = path[i] == '\\' ? '/' : path[i];
+                same = strings_[it->pathOffset + i] == c;
+            }
+            if (same) return it;
+        }
+        return nullptr;
+    }
+
+    AssetBlob
+    AssetArchive::read(const std::string& path) const
+    {
+        const VfPakEntry* entry = find(path);
+        if (!entry) {
+            throw std::runtime_error("asset not found in " + filename_ + ": " + path);
+        }
+
+        const uint8_t* src = file_->data() + entry->dataOffset;
+        if (entry->compression == VF_PAK_COMPRESSION_NONE) {
+            return AssetBlob(file_, src, static_cast<size_t>(entry->size)); // Zero copy
+        }
+        return AssetBlob(decompress(*entry, src, path));
+    }
+
+    // ### AssetLoader ###
+    AssetLoader::AssetLoader(vf_core::ThreadPool& threadPool)
+        : threadPool_(threadPool)
+    {
+    }
+
+    void
+    AssetLoader::mount(const std::string& archiveFilename)
+    {
+        archives_.push_back(std::make_unique<AssetArchive>(archiveFilename));
+    }
+
+    AssetBlob
+    AssetLoader::read(const std::string& path) const
+    {
+        for (auto it = archives_.rbegin(); it != archives_.rend(); ++it) {
+            if ((*it)->contains(path)) {
+                return (*it)->read(path);
+            }
+        }
+
+        auto file = std::make_shared<MappedFile>(path);
+        const uint8_t* data = file->data();
+        size_t size = file->size();
+        return AssetBlob(std::move(file), data, size);
+    }
+
+    std::future<AssetBlob>
+    AssetLoader::readAsync(const std::string& path) const
+    {
+        return threadPool_.submit([this, path]() { return read(path); });
+    }
+
+    std::vector<AssetBlob>
+    AssetLoader::readAll(const std::vector<std::string>& paths) const
+    {
+        std::vector<std::future<AssetBlob>> futures;
+        futures.reserve(paths.size());
+        for (const std::string& path : paths) {
+            futures.push_back(readAsync(path));
+        }
+
+        std::vector<AssetBlob> result;
+        result.reserve(paths.size());
+        for (auto& future : futures) {
+            result.push_back(future.get());
+        }
+        return result;
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,84 @@
+﻿#pragma once
+#ifndef VFRAME_ASSET_ARCHIVE_HPP
+#define VFRAME_ASSET_ARCHIVE_HPP
+
+#include <vFrame/vf_pak_format.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include "vf_mapped_file.hpp"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Bytes of one asset: either a view into a mapping (loose file, uncompressed archive entry)
+    // that keeps the mapping alive, or a decompressed copy.
+    class AssetBlob {
+    public:
+        AssetBlob() = default;
+        AssetBlob(std::shared_ptr<const MappedFile> file, const uint8_t* data, size_t size);
+        explicit AssetBlob(std::vector<uint8_t> bytes);
+
+        // data() points into storage_, a copy would dangle
+        AssetBlob(AssetBlob&&) noexcept = default;
+        AssetBlob& operator=(AssetBlob&&) noexcept = default;
+        AssetBlob(const AssetBlob&) = delete;
+        AssetBlob& operator=(const AssetBlob&) = delete;
+
+        const uint8_t* data() const { return data_; }
+        size_t size() const { return size_; }
+
+        std::vector<char> toChars() const; // Shader code is passed around as std::vector<char>
+
+    private:
+        std::shared_ptr<const MappedFile> file_;
+        std::vector<uint8_t> storage_;
+        const uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Read-only .vfpak archive (see vf_pak_format.hpp), memory mapped for its whole lifetime
+    class AssetArchive {
+    public:
+        explicit AssetArchive(const std::string& filename);
+
+        bool contains(const std::string& path) const { return find(path) != nullptr; }
+        AssetBlob read(const std::string& path) const;
+
+        const std::string& filename() const { return filename_; }
+        uint32_t entryCount() const { return entryCount_; }
+
+    private:
+        const VfPakEntry* find(const std::string& path) const;
+
+        std::string filename_;
+        std::shared_ptr<MappedFile> file_;
+        const VfPakEntry* entries_ = nullptr;
+        uint32_t entryCount_ = 0;
+        const char* strings_ = nullptr;
+    };
+
+    // Resolves asset paths for every resource load (shaders, meshes, textures):
+    // mounted archives first, the last mounted one wins, then loose files relative to the working directory.
+    // Archives must be mounted before loads start, mount() is not synchronized with readAsync().
+    class AssetLoader {
+    public:
+        explicit AssetLoader(vf_core::ThreadPool& threadPool);
+
+        void mount(const std::string& archiveFilename);
+
+        AssetBlob read(const std::string& path) const;
+        // Lookup, page faults and decompression run on the thread pool
+        std::future<AssetBlob> readAsync(const std::string& path) const;
+        std::vector<AssetBlob> readAll(const std::vector<std::string>& paths) const;
+
+    private:
+        vf_core::ThreadPool& threadPool_;
+        std::vector<std::unique_ptr<AssetArchive>> archives_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_ASSET_ARCHIVE_HPP
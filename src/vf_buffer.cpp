@@ -0,0 +1,165 @@
+﻿#include "vf_buffer.hpp"
+#include "vf_memory_budget.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    uint32_t
+    findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1u << i)) &&
+                (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    GpuBuffer
+    createBuffer(const DeviceHandles& handles, VkDeviceSize size,
+        VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+    {
+        GpuBuffer result{};
+        result.size = size;
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(handles.device, &bufferInfo, nullptr, &result.buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(handles.device, result.buffer, &memRequirements);
+
+        const bool deviceAddress = (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+
+        // Буфери з device address потребують окремого прапорця при виділенні пам'яті
+        VkMemoryAllocateFlagsInfo flagsInfo{};
+        flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+        flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = deviceAddress ? &flagsInfo : nullptr;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(handles.physicalDevice, memRequirements.memoryTypeBits, properties);
+
+        if (vkAllocateMemory(handles.device, &allocInfo, nullptr, &result.memory) != VK_SUCCESS) {
+            vkDestroyBuffer(handles.device, result.buffer, nullptr);
+            throw std::runtime_error("failed to allocate buffer memory!");
+        }
+
+        vkBindBufferMemory(handles.device, result.buffer, result.memory, 0);
+
+        if (handles.memory != nullptr) {
+            const MemoryCategory category = usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ?
+                MemoryCategory::STAGING : MemoryCategory::BUFFERS;
+            handles.memory->allocated(result.memory, category, allocInfo.memoryTypeIndex, memRequirements.size);
+            result.tracker = handles.memory;
+        }
+
+        if (deviceAddress) {
+            VkBufferDeviceAddressInfo addressInfo{};
+            addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+            addressInfo.buffer = result.buffer;
+            result.address = vkGetBufferDeviceAddress(handles.device, &addressInfo);
+        }
+
+        if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            vkMapMemory(handles.device, result.memory, 0, size, 0, &result.mapped);
+        }
+
+        return result;
+    }
+
+    void
+    destroyBuffer(VkDevice device, GpuBuffer& buffer)
+    {
+        if (buffer.mapped != nullptr) {
+            vkUnmapMemory(device, buffer.memory);
+        }
+        if (buffer.buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, buffer.buffer, nullptr);
+        }
+        if (buffer.memory != VK_NULL_HANDLE) {
+            if (buffer.tracker != nullptr) {
+                buffer.tracker->freed(buffer.memory);
+            }
+            vkFreeMemory(device, buffer.memory, nullptr);
+        }
+        buffer = GpuBuffer{};
+    }
+
+    VkCommandBuffer
+    beginSingleTimeCommands(const DeviceHandles& handles)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = handles.commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(handles.device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate single time command buffer!");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    void
+    endSingleTimeCommands(const DeviceHandles& handles, VkCommandBuffer commandBuffer)
+    {
+        vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        if (vkQueueSubmit(handles.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit single time command buffer!");
+        }
+        vkQueueWaitIdle(handles.graphicsQueue);
+
+        vkFreeCommandBuffers(handles.device, handles.commandPool, 1, &commandBuffer);
+    }
+
+    void
+    uploadToBuffer(const DeviceHandles& handles, const GpuBuffer& dst, VkDeviceSize dstOffset,
+        const void* data, VkDeviceSize size)
+    {
+        if (size == 0) return;
+
+        GpuBuffer staging = createBuffer(handles, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        std::memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(handles);
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = 0;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, dst.buffer, 1, &copyRegion);
+        endSingleTimeCommands(handles, commandBuffer);
+
+        destroyBuffer(handles.device, staging);
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,53 @@
+﻿#pragma once
+#ifndef VFRAME_BUFFER_HPP
+#define VFRAME_BUFFER_HPP
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+namespace vf_vulkan {
+
+    class MemoryTracker;
+
+    // Handles shared by every subsystem that creates GPU resources.
+    // Filled by VulkanContext::Impl after createLogicalDevice/createCommandPull.
+    struct DeviceHandles {
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        VkQueue graphicsQueue = VK_NULL_HANDLE;
+        uint32_t graphicsFamily = 0;
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE; // Shared by every pipeline compile
+        MemoryTracker* memory = nullptr;                 // Allocation accounting, null outside of a VulkanContext
+    };
+
+    // Buffer + memory pair. address is filled only for SHADER_DEVICE_ADDRESS buffers,
+    // mapped only for HOST_VISIBLE buffers (persistently mapped).
+    struct GpuBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceAddress address = 0;
+        void* mapped = nullptr;
+        MemoryTracker* tracker = nullptr; // Told when the memory is freed
+    };
+
+    uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    // Accounted as STAGING when the buffer is only a transfer source, as BUFFERS otherwise
+    GpuBuffer createBuffer(const DeviceHandles& handles, VkDeviceSize size,
+        VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+
+    void destroyBuffer(VkDevice device, GpuBuffer& buffer);
+
+    // One-shot command buffer on the graphics queue (uploads, copies). Blocks until the GPU is done.
+    VkCommandBuffer beginSingleTimeCommands(const DeviceHandles& handles);
+    void endSingleTimeCommands(const DeviceHandles& handles, VkCommandBuffer commandBuffer);
+
+    // Copies size bytes from host memory into a DEVICE_LOCAL buffer through a temporary staging buffer.
+    void uploadToBuffer(const DeviceHandles& handles, const GpuBuffer& dst, VkDeviceSize dstOffset,
+        const void* data, VkDeviceSize size);
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_BUFFER_HPP
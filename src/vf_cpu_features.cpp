@@ -0,0 +1,45 @@
+﻿#include "vf_cpu_features.hpp"
+
+#if defined(VF_CPU_DISPATCH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace vf_core {
+
+    namespace {
+
+        CpuFeatures
+        detect()
+        {
+            CpuFeatures features;
+#if defined(VF_CPU_DISPATCH_X86) && (defined(__GNUC__) || defined(__clang__))
+            __builtin_cpu_init();
+            features.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            features.avx512 = features.avx2 && __builtin_cpu_supports("avx512f");
+#elif defined(VF_CPU_DISPATCH_X86) && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return features;
+
+            __cpuid(info, 1);
+            const bool fma = (info[2] & (1 << 12)) != 0;
+            if (!fma || (info[2] & (1 << 27)) == 0) return features; // No OSXSAVE: no xgetbv
+            const unsigned long long xcr0 = _xgetbv(0);
+
+            __cpuidex(info, 7, 0);
+            features.avx2 = (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+            features.avx512 = features.avx2 && (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+#endif
+            return features;
+        }
+
+    } // namespace
+
+    const CpuFeatures&
+    cpuFeatures()
+    {
+        static const CpuFeatures features = detect();
+        return features;
+    }
+
+} // namespace vf_core
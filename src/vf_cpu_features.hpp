@@ -0,0 +1,32 @@
+﻿#pragma once
+#ifndef VFRAME_CPU_FEATURES_HPP
+#define VFRAME_CPU_FEATURES_HPP
+
+// x86 builds compile AVX2/AVX-512 loops with per-function target attributes
+// and pick them at run time, the library itself stays at the baseline instruction set
+#if !defined(VFRAME_MATH_SCALAR) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#  define VF_CPU_DISPATCH_X86 1
+#  include <immintrin.h>
+#endif
+
+#if defined(VF_CPU_DISPATCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#  define VF_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#  define VF_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#  define VF_TARGET_AVX2
+#  define VF_TARGET_AVX512
+#endif
+
+namespace vf_core {
+
+    struct CpuFeatures {
+        bool avx2 = false;   // AVX2 + FMA, with OS support for the YMM state
+        bool avx512 = false; // AVX-512F, with OS support for the ZMM state
+    };
+
+    // Detected once
+    const CpuFeatures& cpuFeatures();
+
+} // namespace vf_core
+
+#endif // VFRAME_CPU_FEATURES_HPP
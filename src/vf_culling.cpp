@@ -0,0 +1,361 @@
+﻿#include <vFrame/vf_culling.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include <vFrame/vf_trace.hpp>
+#include "vf_cpu_features.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+
+namespace vf_core {
+
+    namespace {
+
+        using namespace detail;
+
+        constexpr uint32_t LANES = 16;                // Arrays are padded to this, no loop has a tail
+        constexpr uint32_t CHUNK_OBJECTS = 8192;      // Unit of parallel work, multiple of LANES
+        const float REMOVED_RADIUS = -std::numeric_limits<float>::max(); // Never inside any plane
+
+        // Plane in the form the loops use: distance = n.c + w + |n|.extents + radius
+        struct CullPlanes {
+            float nx[6], ny[6], nz[6], w[6];
+            float ax[6], ay[6], az[6];
+        };
+
+        struct BoundsArrays {
+            const float* centerX;
+            const float* centerY;
+            const float* centerZ;
+            const float* extentX;
+            const float* extentY;
+            const float* extentZ;
+            const float* radius;
+        };
+
+        CullPlanes
+        toCullPlanes(const Frustum& frustum)
+        {
+            CullPlanes planes;
+            for (int p = 0; p < 6; p++) {
+                planes.nx[p] = frustum.planes[p].x;
+                planes.ny[p] = frustum.planes[p].y;
+                planes.nz[p] = frustum.planes[p].z;
+                planes.w[p] = frustum.planes[p].w;
+                planes.ax[p] = std::fabs(frustum.planes[p].x);
+                planes.ay[p] = std::fabs(frustum.planes[p].y);
+                planes.az[p] = std::fabs(frustum.planes[p].z);
+            }
+            return planes;
+        }
+
+        // Each kernel tests [begin, end) and writes the visible indices to out, returns how many.
+        // Indices are written unconditionally and the count advanced by the mask: out never
+        // needs more room than end - begin.
+        uint32_t
+        cullRange4(const BoundsArrays& bounds, const CullPlanes& planes, uint32_t begin, uint32_t end, uint32_t* out)
+        {
+            uint32_t count = 0;
+            for (uint32_t i = begin; i < end; i += 4) {
+                const Float4 cx = load4(bounds.centerX + i), cy = load4(bounds.centerY + i), cz = load4(bounds.centerZ + i);
+                const Float4 ex = load4(bounds.extentX + i), ey = load4(bounds.extentY + i), ez = load4(bounds.extentZ + i);
+                const Float4 r = load4(bounds.radius + i);
+
+                Float4 nearest = splat4(std::numeric_limits<float>::max());
+                for (int p = 0; p < 6; p++) {
+                    Float4 distance = madd4(splat4(planes.nx[p]), cx, add4(splat4(planes.w[p]), r));
+                    distance = madd4(splat4(planes.ny[p]), cy, distance);
+                    distance = madd4(splat4(planes.nz[p]), cz, distance);
+                    distance = madd4(splat4(planes.ax[p]), ex, distance);
+                    distance = madd4(splat4(planes.ay[p]), ey, distance);
+                    distance = madd4(splat4(planes.az[p]), ez, distance);
+                    nearest = min4(nearest, distance);
+                }
+
+                alignas(16) float result[4];
+                store4(result, nearest);
+                for (uint32_t lane = 0; lane < 4; lane++) {
+                    out[count] = i + lane;
+                    count += result[lane] >= 0.0f ? 1 : 0;
+                }
+            }
+            return count;
+        }
+
+#ifdef VF_CPU_DISPATCH_X86
+        VF_TARGET_AVX2 uint32_t
+        cullRangeAvx2(const BoundsArrays& bounds, const CullPlanes& planes, uint32_t begin, uint32_t end, uint32_t* out)
+        {
+            __m256 nx[6], ny[6], nz[6], w[6], ax[6], ay[6], az[6];
+            for (int p = 0; p < 6; p++) {
+                nx[p] = _mm256_set1_ps(planes.nx[p]);
+                ny[p] = _mm256_set1_ps(planes.ny[p]);
+                nz[p] = _mm256_set1_ps(planes.nz[p]);
+                w[p] = _mm256_set1_ps(planes.w[p]);
+                ax[p] = _mm256_set1_ps(planes.ax[p]);
+                ay[p] = _mm256_set1_ps(planes.ay[p]);
+                az[p] = _mm256_set1_ps(planes.az[p]);
+            }
+
+            uint32_t count = 0;
+            for (uint32_t i = begin; i < end; i += 8) {
+                const __m256 cx = _mm256_load_ps(bounds.centerX + i);
+                const __m256 cy = _mm256_load_ps(bounds.centerY + i);
+                const __m256 cz = _mm256_load_ps(bounds.centerZ + i);
+                const __m256 ex = _mm256_load_ps(bounds.extentX + i);
+                const __m256 ey = _mm256_load_ps(bounds.extentY + i);
+                const __m256 ez = _mm256_load_ps(bounds.extentZ + i);
+                const __m256 r = _mm256_load_ps(bounds.radius + i);
+
+                __m256 nearest = _mm256_set1_ps(std::numeric_limits<float>::max());
+                for (int p = 0; p < 6; p++) {
+                    __m256 distance = _mm256_fmadd_ps(nx[p], cx, _mm256_add_ps(w[p], r));
+                    distance = _mm256_fmadd_ps(ny[p], cy, distance);
+                    distance = _mm256_fmadd_ps(nz[p], cz, distance);
+                    distance = _mm256_fmadd_ps(ax[p], ex, distance);
+                    distance = _mm256_fmadd_ps(ay[p], ey, distance);
+                    distance = _mm256_fmadd_ps(az[p], ez, distance);
+                    nearest = _mm256_min_ps(nearest, distance);
+                }
+
+                const uint32_t mask = static_cast<uint32_t>(
+                    _mm256_movemask_ps(_mm256_cmp_ps(nearest, _mm256_setzero_ps(), _CMP_GE_OQ)));
+                for (uint32_t lane = 0; lane < 8; lane++) {
+                    out[count] = i + lane;
+                    count += (mask >> lane) & 1;
+                }
+            }
+            return count;
+        }
+
+        VF_TARGET_AVX512 uint32_t
+        cullRangeAvx512(const BoundsArrays& bounds, const CullPlanes& planes, uint32_t begin, uint32_t end, uint32_t* out)
+        {
+            const __m512i laneOffsets = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+            uint32_t count = 0;
+            for (uint32_t i = begin; i < end; i += 16) {
+                const __m512 cx = _mm512_load_ps(bounds.centerX + i);
+                const __m512 cy = _mm512_load_ps(bounds.centerY + i);
+                const __m512 cz = _mm512_load_ps(bounds.centerZ + i);
+                const __m512 ex = _mm512_load_ps(bounds.extentX + i);
+                const __m512 ey = _mm512_load_ps(bounds.extentY + i);
+                const __m512 ez = _mm512_load_ps(bounds.extentZ + i);
+                const __m512 r = _mm512_load_ps(bounds.radius + i);
+
+                __mmask16 inside = 0xFFFF;
+                for (int p = 0; p < 6; p++) {
+                    __m512 distance = _mm512_fmadd_ps(_mm512_set1_ps(planes.nx[p]), cx, _mm512_add_ps(_mm512_set1_ps(planes.w[p]), r));
+                    distance = _mm512_fmadd_ps(_mm512_set1_ps(planes.ny[p]), cy, distance);
+                    distance = _mm512_fmadd_ps(_mm512_set1_ps(planes.nz[p]), cz, distance);
+                    distance = _mm512_fmadd_ps(_mm512_set1_ps(planes.ax[p]), ex, distance);
+                    distance = _mm512_fmadd_ps(_mm512_set1_ps(planes.ay[p]), ey, distance);
+                    distance = _mm512_fmadd_ps(_mm512_set1_ps(planes.az[p]), ez, distance);
+                    inside = _mm512_mask_cmp_ps_mask(inside, distance, _mm512_setzero_ps(), _CMP_GE_OQ);
+                }
+
+                // Visible lanes packed to the front of the store
+                const __m512i indices = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i)), laneOffsets);
+                _mm512_mask_compressstoreu_epi32(out + count, inside, indices);
+                for (uint32_t bits = inside; bits != 0; bits &= bits - 1) {
+                    count++;
+                }
+            }
+            return count;
+        }
+#endif
+
+        using CullKernel = uint32_t (*)(const BoundsArrays&, const CullPlanes&, uint32_t, uint32_t, uint32_t*);
+
+        CullKernel
+        selectKernel()
+        {
+#ifdef VF_CPU_DISPATCH_X86
+            if (cpuFeatures().avx512) return cullRangeAvx512;
+            if (cpuFeatures().avx2) return cullRangeAvx2;
+#endif
+            return cullRange4;
+        }
+
+        // std::allocator only guarantees alignof(float), the loads above are aligned to 64
+        template <typename T>
+        struct AlignedAllocator {
+            using value_type = T;
+
+            AlignedAllocator() = default;
+            template <typename U>
+            AlignedAllocator(const AlignedAllocator<U>&) {}
+
+            T*
+            allocate(size_t n)
+            {
+                return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(64)));
+            }
+
+            void
+            deallocate(T* p, size_t)
+            {
+                ::operator delete(p, std::align_val_t(64));
+            }
+
+            template <typename U>
+            bool operator==(const AlignedAllocator<U>&) const { return true; }
+            template <typename U>
+            bool operator!=(const AlignedAllocator<U>&) const { return false; }
+        };
+
+        using FloatArray = std::vector<float, AlignedAllocator<float>>;
+
+    } // namespace
+
+    class CullingSet::Impl {
+    public:
+        FloatArray centerX, centerY, centerZ;
+        FloatArray extentX, extentY, extentZ;
+        FloatArray radius;
+        uint32_t count = 0;                 // Used slots, removed ones included
+        std::vector<uint32_t> freeSlots;
+        std::vector<uint32_t> chunkCounts;
+        std::vector<uint32_t> scratch;      // Visible indices of each chunk at chunk * CHUNK_OBJECTS
+        CullKernel kernel = selectKernel();
+
+        uint32_t
+        allocate()
+        {
+            if (!freeSlots.empty()) {
+                const uint32_t index = freeSlots.back();
+                freeSlots.pop_back();
+                return index;
+            }
+
+            const uint32_t index = count++;
+            if (index >= centerX.size()) {
+                // New slots start removed, so the padding up to a multiple of LANES is never visible
+                const size_t padded = (static_cast<size_t>(index) + LANES) / LANES * LANES;
+                for (FloatArray* array : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+                    array->resize(padded, 0.0f);
+                }
+                radius.resize(padded, REMOVED_RADIUS);
+            }
+            return index;
+        }
+
+        void
+        set(uint32_t index, const Vec3& center, const Vec3& extent, float sphereRadius)
+        {
+            centerX[index] = center.x;
+            centerY[index] = center.y;
+            centerZ[index] = center.z;
+            extentX[index] = extent.x;
+            extentY[index] = extent.y;
+            extentZ[index] = extent.z;
+            radius[index] = sphereRadius;
+        }
+
+        BoundsArrays
+        arrays() const
+        {
+            return { centerX.data(), centerY.data(), centerZ.data(), extentX.data(), extentY.data(), extentZ.data(), radius.data() };
+        }
+    };
+
+    CullingSet::CullingSet()
+        : pImpl(std::make_unique<Impl>())
+    {
+    }
+
+    CullingSet::~CullingSet() = default;
+
+    uint32_t
+    CullingSet::addSphere(const Vec3& center, float radius)
+    {
+        const uint32_t index = pImpl->allocate();
+        setSphere(index, center, radius);
+        return index;
+    }
+
+    uint32_t
+    CullingSet::addBox(const Vec3& boxMin, const Vec3& boxMax)
+    {
+        const uint32_t index = pImpl->allocate();
+        setBox(index, boxMin, boxMax);
+        return index;
+    }
+
+    void
+    CullingSet::setSphere(uint32_t index, const Vec3& center, float radius)
+    {
+        pImpl->set(index, center, Vec3{}, radius);
+    }
+
+    void
+    CullingSet::setBox(uint32_t index, const Vec3& boxMin, const Vec3& boxMax)
+    {
+        pImpl->set(index, (boxMin + boxMax) * 0.5f, (boxMax - boxMin) * 0.5f, 0.0f);
+    }
+
+    void
+    CullingSet::remove(uint32_t index)
+    {
+        pImpl->set(index, Vec3{}, Vec3{}, REMOVED_RADIUS);
+        pImpl->freeSlots.push_back(index);
+    }
+
+    void
+    CullingSet::clear()
+    {
+        std::fill(pImpl->radius.begin(), pImpl->radius.end(), REMOVED_RADIUS);
+        pImpl->count = 0;
+        pImpl->freeSlots.clear();
+    }
+
+    uint32_t
+    CullingSet::size() const
+    {
+        return pImpl->count;
+    }
+
+    void
+    CullingSet::cull(const Frustum& frustum, std::vector<uint32_t>& visible, ThreadPool* pool)
+    {
+        VF_TRACE_ZONE("Frustum culling");
+        Impl& impl = *pImpl;
+        const uint32_t padded = (impl.count + LANES - 1) / LANES * LANES;
+        const uint32_t chunkCount = (padded + CHUNK_OBJECTS - 1) / CHUNK_OBJECTS;
+        const CullPlanes planes = toCullPlanes(frustum);
+        const BoundsArrays bounds = impl.arrays();
+
+        impl.scratch.resize(padded);
+        impl.chunkCounts.resize(chunkCount);
+        auto cullChunks = [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; chunk++) {
+                const uint32_t begin = static_cast<uint32_t>(chunk) * CHUNK_OBJECTS;
+                const uint32_t end = std::min(begin + CHUNK_OBJECTS, padded);
+                impl.chunkCounts[chunk] = impl.kernel(bounds, planes, begin, end, impl.scratch.data() + begin);
+            }
+        };
+        if (pool != nullptr && chunkCount > 1) {
+            pool->parallelFor(0, chunkCount, 1, cullChunks);
+        }
+        else {
+            cullChunks(0, chunkCount);
+        }
+
+        // Chunks are in index order, packing them keeps the list sorted
+        uint32_t total = 0;
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            total += impl.chunkCounts[chunk];
+        }
+        visible.resize(total);
+        uint32_t offset = 0;
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            const uint32_t chunkVisible = impl.chunkCounts[chunk];
+            if (chunkVisible == 0) continue;
+            std::memcpy(visible.data() + offset, impl.scratch.data() + chunk * CHUNK_OBJECTS, chunkVisible * sizeof(uint32_t));
+            offset += chunkVisible;
+        }
+    }
+
+} // namespace vf_core
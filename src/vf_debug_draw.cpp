@@ -0,0 +1,295 @@
+﻿#include <vFrame/vf_debug_draw.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
+// Release builds have no debug draw at all: the VF_DEBUG_* macros are empty and nothing here is compiled
+#if VFRAME_DEBUG_DRAW
+
+namespace vf_core {
+
+    namespace {
+
+        constexpr uint32_t MAX_THREAD_VERTICES = 1u << 18; // Drawing with no renderer collecting stops here
+        constexpr uint32_t MAX_THREAD_TEXTS = 4096;
+        constexpr uint32_t CIRCLE_SEGMENTS = 24;
+
+        // Its mutex is only contended by the collect once a frame
+        struct ThreadBuffer {
+            std::mutex mutex;
+            std::vector<DebugVertex> vertices;
+            std::vector<DebugText> texts;
+        };
+
+        struct DebugDrawState {
+            std::atomic<bool> enabled{ true };
+            std::atomic<uint64_t> dropped{ 0 };
+
+            // Taken when a thread draws for the first time and by the collect
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        };
+
+        DebugDrawState&
+        state()
+        {
+            static DebugDrawState debugDraw;
+            return debugDraw;
+        }
+
+        thread_local std::shared_ptr<ThreadBuffer> localBuffer;
+
+        ThreadBuffer&
+        threadBuffer()
+        {
+            if (!localBuffer) {
+                DebugDrawState& debugDraw = state();
+                auto buffer = std::make_shared<ThreadBuffer>();
+                std::lock_guard<std::mutex> lock(debugDraw.mutex);
+                debugDraw.buffers.push_back(buffer);
+                localBuffer = std::move(buffer);
+            }
+            return *localBuffer;
+        }
+
+        DebugVertex
+        vertex(const Vec3& p, uint32_t color)
+        {
+            return { p.x, p.y, p.z, color };
+        }
+
+        // segments is the number of lines, the points of a primitive go in under one lock
+        class LineWriter {
+        public:
+            explicit LineWriter(uint32_t segments)
+                : buffer_(threadBuffer())
+                , lock_(buffer_.mutex)
+            {
+                const size_t room = MAX_THREAD_VERTICES - std::min<size_t>(buffer_.vertices.size(), MAX_THREAD_VERTICES);
+                ok_ = static_cast<size_t>(segments) * 2 <= room;
+                if (!ok_) {
+                    state().dropped.fetch_add(segments, std::memory_order_relaxed);
+                }
+            }
+
+            bool ok() const { return ok_; }
+
+            void
+            line(const Vec3& a, const Vec3& b, uint32_t color)
+            {
+                buffer_.vertices.push_back(vertex(a, color));
+                buffer_.vertices.push_back(vertex(b, color));
+            }
+
+        private:
+            ThreadBuffer& buffer_;
+            std::lock_guard<std::mutex> lock_;
+            bool ok_ = false;
+        };
+
+        bool
+        enabled()
+        {
+            return state().enabled.load(std::memory_order_relaxed);
+        }
+
+        // Corner i has the max x with bit 0, y with bit 1, z with bit 2; edges join corners one bit apart
+        void
+        boxEdges(const Vec3 corners[8], uint32_t color)
+        {
+            LineWriter writer(12);
+            if (!writer.ok()) return;
+            for (uint32_t i = 0; i < 8; i++) {
+                for (uint32_t bit = 1; bit < 8; bit <<= 1) {
+                    if ((i & bit) == 0) {
+                        writer.line(corners[i], corners[i | bit], color);
+                    }
+                }
+            }
+        }
+
+        struct UnitCircle {
+            float cosines[CIRCLE_SEGMENTS + 1];
+            float sines[CIRCLE_SEGMENTS + 1];
+
+            UnitCircle()
+            {
+                for (uint32_t i = 0; i <= CIRCLE_SEGMENTS; i++) {
+                    const float angle = 6.28318530718f * static_cast<float>(i) / static_cast<float>(CIRCLE_SEGMENTS);
+                    cosines[i] = std::cos(angle);
+                    sines[i] = std::sin(angle);
+                }
+            }
+        };
+
+    } // namespace
+
+    void
+    debugDrawSetEnabled(bool enabled)
+    {
+        state().enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool
+    debugDrawEnabled()
+    {
+        return enabled();
+    }
+
+    void
+    debugLine(const Vec3& a, const Vec3& b, uint32_t color)
+    {
+        if (!enabled()) return;
+        LineWriter writer(1);
+        if (writer.ok()) writer.line(a, b, color);
+    }
+
+    void
+    debugRay(const Ray& ray, float length, uint32_t color)
+    {
+        debugLine(ray.origin, ray.origin + ray.direction * std::min(length, ray.maxDistance), color);
+    }
+
+    void
+    debugCross(const Vec3& center, float size, uint32_t color)
+    {
+        if (!enabled()) return;
+        const float half = size * 0.5f;
+        LineWriter writer(3);
+        if (!writer.ok()) return;
+        writer.line(center - Vec3{ half, 0.0f, 0.0f }, center + Vec3{ half, 0.0f, 0.0f }, color);
+        writer.line(center - Vec3{ 0.0f, half, 0.0f }, center + Vec3{ 0.0f, half, 0.0f }, color);
+        writer.line(center - Vec3{ 0.0f, 0.0f, half }, center + Vec3{ 0.0f, 0.0f, half }, color);
+    }
+
+    void
+    debugBox(const Aabb& box, uint32_t color)
+    {
+        if (!enabled()) return;
+        Vec3 corners[8];
+        for (uint32_t i = 0; i < 8; i++) {
+            corners[i] = { (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z };
+        }
+        boxEdges(corners, color);
+    }
+
+    void
+    debugBox(const Mat4& transform, const Aabb& box, uint32_t color)
+    {
+        if (!enabled()) return;
+        Vec3 corners[8];
+        for (uint32_t i = 0; i < 8; i++) {
+            const Vec3 local = { (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z };
+            corners[i] = transformPoint(transform, local);
+        }
+        boxEdges(corners, color);
+    }
+
+    void
+    debugSphere(const Vec3& center, float radius, uint32_t color)
+    {
+        if (!enabled()) return;
+        static const UnitCircle circle;
+
+        LineWriter writer(3 * CIRCLE_SEGMENTS);
+        if (!writer.ok()) return;
+        for (uint32_t i = 0; i < CIRCLE_SEGMENTS; i++) {
+            const float c0 = circle.cosines[i] * radius, s0 = circle.sines[i] * radius;
+            const float c1 = circle.cosines[i + 1] * radius, s1 = circle.sines[i + 1] * radius;
+            writer.line(center + Vec3{ c0, s0, 0.0f }, center + Vec3{ c1, s1, 0.0f }, color);
+            writer.line(center + Vec3{ c0, 0.0f, s0 }, center + Vec3{ c1, 0.0f, s1 }, color);
+            writer.line(center + Vec3{ 0.0f, c0, s0 }, center + Vec3{ 0.0f, c1, s1 }, color);
+        }
+    }
+
+    void
+    debugFrustum(const Mat4& viewProjection, uint32_t color)
+    {
+        if (!enabled()) return;
+        const Mat4 clipToWorld = inverse(viewProjection);
+        Vec3 corners[8];
+        for (uint32_t i = 0; i < 8; i++) {
+            const Vec4 clip = { (i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f, 1.0f };
+            const Vec4 world = clipToWorld * clip;
+            corners[i] = world.w != 0.0f ? toVec3(world) / world.w : toVec3(world);
+        }
+        boxEdges(corners, color);
+    }
+
+    void
+    debugGrid(const Vec3& center, float cellSize, uint32_t cells, uint32_t color)
+    {
+        if (!enabled() || cells == 0) return;
+        const float half = 0.5f * cellSize * static_cast<float>(cells);
+
+        LineWriter writer(2 * (cells + 1));
+        if (!writer.ok()) return;
+        for (uint32_t i = 0; i <= cells; i++) {
+            const float offset = -half + cellSize * static_cast<float>(i);
+            writer.line(center + Vec3{ -half, 0.0f, offset }, center + Vec3{ half, 0.0f, offset }, color);
+            writer.line(center + Vec3{ offset, 0.0f, -half }, center + Vec3{ offset, 0.0f, half }, color);
+        }
+    }
+
+    void
+    debugText(const Vec3& anchor, const std::string& text, uint32_t color)
+    {
+        if (!enabled()) return;
+        debugCross(anchor, 0.1f, color);
+
+        ThreadBuffer& buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        if (buffer.texts.size() >= MAX_THREAD_TEXTS) {
+            state().dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.texts.push_back({ anchor, color, text });
+    }
+
+    uint64_t
+    debugDrawDroppedCount()
+    {
+        return state().dropped.load(std::memory_order_relaxed);
+    }
+
+    uint32_t
+    debugDrawCollect(DebugVertex* vertices, uint32_t capacity, std::vector<DebugText>& texts)
+    {
+        DebugDrawState& debugDraw = state();
+        std::lock_guard<std::mutex> registryLock(debugDraw.mutex);
+
+        uint32_t count = 0;
+        for (const std::shared_ptr<ThreadBuffer>& buffer : debugDraw.buffers) {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+
+            // Whole lines only, straight into the ring
+            const uint32_t available = static_cast<uint32_t>(buffer->vertices.size());
+            const uint32_t taken = std::min(available, (capacity - count) & ~1u);
+            if (taken > 0) {
+                std::memcpy(vertices + count, buffer->vertices.data(), sizeof(DebugVertex) * taken);
+                count += taken;
+            }
+            if (taken < available) {
+                debugDraw.dropped.fetch_add((available - taken) / 2, std::memory_order_relaxed);
+            }
+            buffer->vertices.clear();
+
+            std::move(buffer->texts.begin(), buffer->texts.end(), std::back_inserter(texts));
+            buffer->texts.clear();
+        }
+
+        // Buffers of threads that exited are only held here
+        debugDraw.buffers.erase(std::remove_if(debugDraw.buffers.begin(), debugDraw.buffers.end(),
+            [](const std::shared_ptr<ThreadBuffer>& buffer) { return buffer.use_count() == 1; }),
+            debugDraw.buffers.end());
+        return count;
+    }
+
+} // namespace vf_core
+
+#endif // VFRAME_DEBUG_DRAW
@@ -0,0 +1,110 @@
+﻿#include "vf_debug_renderer.hpp"
+
+#include <vFrame/vf_trace.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+#if VFRAME_DEBUG_DRAW // See vf_debug_draw.cpp
+
+namespace vf_vulkan {
+
+    DebugRenderer::DebugRenderer(const DeviceHandles& handles, PipelineManager& pipelines, uint32_t framesInFlight,
+        uint32_t maxVerticesPerFrame)
+        : handles_(handles)
+        , pipelines_(pipelines)
+        , framesInFlight_(framesInFlight)
+        , maxVertices_(maxVerticesPerFrame & ~1u)
+    {
+        ring_ = createBuffer(handles_, sizeof(vf_core::DebugVertex) * maxVertices_ * framesInFlight_,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushRange.offset = 0;
+        pushRange.size = sizeof(DrawPush);
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushRange;
+
+        if (vkCreatePipelineLayout(handles_.device, &layoutInfo, nullptr, &pipelineLayout_) != VK_SUCCESS) {
+            destroyBuffer(handles_.device, ring_);
+            throw std::runtime_error("failed to create debug draw pipeline layout!");
+        }
+    }
+
+    DebugRenderer::~DebugRenderer()
+    {
+        // Compiles in flight read the layout
+        pipelines_.waitIdle();
+
+        vkDestroyPipelineLayout(handles_.device, pipelineLayout_, nullptr);
+        destroyBuffer(handles_.device, ring_);
+    }
+
+    void
+    DebugRenderer::createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+        VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode)
+    {
+        // Hidden by the scene in front of them, but never hide anything themselves
+        state_.vertexShader = ShaderCode::fromSpirv(std::move(vertShaderCode));
+        state_.fragmentShader = ShaderCode::fromSpirv(std::move(fragShaderCode));
+        state_.layout = pipelineLayout_;
+        state_.renderPass = renderPass;
+        state_.colorFormat = colorFormat;
+        state_.depthFormat = depthFormat;
+        state_.samples = samples;
+        state_.depthTest = depthFormat != VK_FORMAT_UNDEFINED;
+        state_.depthWrite = false;
+        state_.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        state_.cullMode = VK_CULL_MODE_NONE;
+        state_.blend = BlendMode::ALPHA;
+
+        pipeline_ = pipelines_.requestGraphics(state_);
+    }
+
+    VkPipeline
+    DebugRenderer::buildPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const
+    {
+        PipelineState state = state_;
+        state.vertexShader = ShaderCode::fromSpirv(vertShaderCode);
+        state.fragmentShader = ShaderCode::fromSpirv(fragShaderCode);
+        return createGraphicsPipeline(handles_.device, handles_.pipelineCache, state);
+    }
+
+    VkPipeline
+    DebugRenderer::swapPipeline(VkPipeline pipeline)
+    {
+        return pipelines_.replace(pipeline_, pipeline);
+    }
+
+    void
+    DebugRenderer::collect(uint32_t frame, std::vector<vf_core::DebugText>& texts)
+    {
+        VF_TRACE_ZONE("Debug draw collect");
+
+        vf_core::DebugVertex* slot = static_cast<vf_core::DebugVertex*>(ring_.mapped) + static_cast<size_t>(frame) * maxVertices_;
+        vertexCount_ = vf_core::debugDrawCollect(slot, maxVertices_, texts);
+    }
+
+    void
+    DebugRenderer::recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, const float viewProjection[16])
+    {
+        VkPipeline pipeline = pipelines_.get(pipeline_);
+        if (vertexCount_ == 0 || pipeline == VK_NULL_HANDLE) return;
+
+        DrawPush push{};
+        std::memcpy(push.viewProjection, viewProjection, sizeof(push.viewProjection));
+        push.vertices = ring_.address + sizeof(vf_core::DebugVertex) * maxVertices_ * frame;
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdPushConstants(commandBuffer, pipelineLayout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPush), &push);
+        vkCmdDraw(commandBuffer, vertexCount_, 1, 0, 0);
+    }
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_DEBUG_DRAW
@@ -0,0 +1,60 @@
+﻿#pragma once
+#ifndef VFRAME_DEBUG_RENDERER_HPP
+#define VFRAME_DEBUG_RENDERER_HPP
+
+#include <vFrame/vf_debug_draw.hpp>
+#include "vf_buffer.hpp"
+#include "vf_pipeline_manager.hpp"
+
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Draws the vf_core::debug* lines of every thread. collect() merges the thread buffers straight into
+    // the persistently mapped ring slot of the frame; recordDraw emits them as one line list draw,
+    // vertices pulled in debug.vert. The slot of a frame in flight is reused once its fence was waited.
+    class DebugRenderer {
+    public:
+        DebugRenderer(const DeviceHandles& handles, PipelineManager& pipelines, uint32_t framesInFlight,
+            uint32_t maxVerticesPerFrame = 1u << 18);
+        ~DebugRenderer();
+
+        DebugRenderer(const DebugRenderer&) = delete;
+        DebugRenderer& operator=(const DebugRenderer&) = delete;
+
+        // Same contract as GpuScene::createPipeline: requested again when the render pass format changes
+        void createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+            VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode);
+        void setRenderPass(VkRenderPass renderPass) { state_.renderPass = renderPass; } // See GpuScene::setRenderPass
+        VkPipeline buildPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const;
+        VkPipeline swapPipeline(VkPipeline pipeline);
+
+        // After the fence of frame was waited: lines go to its slot, labels are left in texts
+        void collect(uint32_t frame, std::vector<vf_core::DebugText>& texts);
+        // Inside the render pass
+        void recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, const float viewProjection[16]);
+
+        uint32_t lineCount() const { return vertexCount_ / 2; }
+
+    private:
+        struct DrawPush {
+            float viewProjection[16];
+            VkDeviceAddress vertices;
+        };
+
+        DeviceHandles handles_;
+        PipelineManager& pipelines_;
+        uint32_t framesInFlight_;
+        uint32_t maxVertices_;
+
+        GpuBuffer ring_;              // Host visible, framesInFlight * maxVertices vertices
+        uint32_t vertexCount_ = 0;    // Collected for the frame being recorded
+
+        VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+        PipelineHandle pipeline_ = VF_INVALID_PIPELINE;
+        PipelineState state_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_DEBUG_RENDERER_HPP
@@ -0,0 +1,65 @@
+﻿#pragma once
+#ifndef VFRAME_DELETION_QUEUE_HPP
+#define VFRAME_DELETION_QUEUE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Destroys GPU objects once no frame in flight can use them any more.
+    // push() is tagged with the current frame number, flush() runs every entry
+    // that is at least framesInFlight frames old (the fences of those frames were waited on).
+    class DeletionQueue {
+    public:
+        explicit DeletionQueue(uint32_t framesInFlight)
+            : framesInFlight_(framesInFlight)
+        {
+        }
+
+        ~DeletionQueue() { flushAll(); }
+
+        DeletionQueue(const DeletionQueue&) = delete;
+        DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+        void
+        push(uint64_t frame, std::function<void()> destroy)
+        {
+            entries_.push_back({ frame, std::move(destroy) });
+        }
+
+        void
+        flush(uint64_t currentFrame)
+        {
+            size_t kept = 0;
+            for (size_t i = 0; i < entries_.size(); i++) {
+                if (entries_[i].first + framesInFlight_ <= currentFrame) {
+                    entries_[i].second();
+                }
+                else {
+                    entries_[kept++] = std::move(entries_[i]);
+                }
+            }
+            entries_.resize(kept);
+        }
+
+        // After vkDeviceWaitIdle
+        void
+        flushAll()
+        {
+            for (auto& entry : entries_) {
+                entry.second();
+            }
+            entries_.clear();
+        }
+
+    private:
+        uint32_t framesInFlight_;
+        std::vector<std::pair<uint64_t, std::function<void()>>> entries_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_DELETION_QUEUE_HPP
@@ -0,0 +1,236 @@
+﻿#include "vf_descriptors.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        // Descriptors per set a pool is sized for, a pool that runs out of one type is simply retired.
+        // Every type DescriptorData can describe needs an entry: a type missing here fails on every pool
+        constexpr VkDescriptorPoolSize POOL_RATIOS[] = {
+            { VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+            { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1 },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 },
+            { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1 },
+        };
+
+        uint64_t
+        hashBytes(const void* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull)
+        {
+            const uint8_t* ptr = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash ^= ptr[i];
+                hash *= 0x100000001B3ull;
+            }
+            return hash;
+        }
+
+    } // namespace
+
+    // ### DescriptorLayout ###
+    DescriptorLayout::DescriptorLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+        : device_(device)
+        , bindings_(bindings)
+    {
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings_.size());
+        layoutInfo.pBindings = bindings_.data();
+
+        if (vkCreateDescriptorSetLayout(device_, &layoutInfo, nullptr, &layout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor set layout!");
+        }
+
+        // DescriptorData slots follow each other in binding order
+        std::vector<VkDescriptorUpdateTemplateEntry> entries;
+        for (const auto& binding : bindings_) {
+            VkDescriptorUpdateTemplateEntry entry{};
+            entry.dstBinding = binding.binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = binding.descriptorCount;
+            entry.descriptorType = binding.descriptorType;
+            entry.offset = sizeof(DescriptorData) * descriptorCount_;
+            entry.stride = sizeof(DescriptorData);
+            entries.push_back(entry);
+            descriptorCount_ += binding.descriptorCount;
+        }
+
+        VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+        templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+        templateInfo.pDescriptorUpdateEntries = entries.data();
+        templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        templateInfo.descriptorSetLayout = layout_;
+
+        if (vkCreateDescriptorUpdateTemplate(device_, &templateInfo, nullptr, &template_) != VK_SUCCESS) {
+            vkDestroyDescriptorSetLayout(device_, layout_, nullptr);
+            throw std::runtime_error("failed to create descriptor update template!");
+        }
+    }
+
+    DescriptorLayout::~DescriptorLayout()
+    {
+        vkDestroyDescriptorUpdateTemplate(device_, template_, nullptr);
+        vkDestroyDescriptorSetLayout(device_, layout_, nullptr);
+    }
+
+    void
+    DescriptorLayout::write(VkDescriptorSet set, const DescriptorData* data) const
+    {
+        vkUpdateDescriptorSetWithTemplate(device_, set, template_, data);
+    }
+
+    // ### DescriptorAllocator ###
+    DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t setsPerPool)
+        : device_(device)
+        , setsPerPool_(setsPerPool)
+    {
+    }
+
+    DescriptorAllocator::~DescriptorAllocator()
+    {
+        for (VkDescriptorPool pool : usedPools_) {
+            vkDestroyDescriptorPool(device_, pool, nullptr);
+        }
+        for (VkDescriptorPool pool : freePools_) {
+            vkDestroyDescriptorPool(device_, pool, nullptr);
+        }
+    }
+
+    VkDescriptorPool
+    DescriptorAllocator::takePool()
+    {
+        if (!freePools_.empty()) {
+            VkDescriptorPool pool = freePools_.back();
+            freePools_.pop_back();
+            usedPools_.push_back(pool);
+            return pool;
+        }
+
+        std::vector<VkDescriptorPoolSize> sizes;
+        for (const auto& ratio : POOL_RATIOS) {
+            sizes.push_back({ ratio.type, ratio.descriptorCount * setsPerPool_ });
+        }
+
+        // No FREE_DESCRIPTOR_SET_BIT: sets only go away with the whole pool
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = setsPerPool_;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+        poolInfo.pPoolSizes = sizes.data();
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(device_, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        usedPools_.push_back(pool);
+
+        // A frame that needed another pool will need it again, the next one is bigger
+        setsPerPool_ = std::min(setsPerPool_ * 2, MAX_SETS_PER_POOL);
+        return pool;
+    }
+
+    VkDescriptorSet
+    DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+    {
+        if (current_ == VK_NULL_HANDLE) {
+            current_ = takePool();
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = current_;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet set;
+        VkResult result = vkAllocateDescriptorSets(device_, &allocInfo, &set);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            current_ = takePool();
+            allocInfo.descriptorPool = current_;
+            result = vkAllocateDescriptorSets(device_, &allocInfo, &set);
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+        return set;
+    }
+
+    void
+    DescriptorAllocator::reset()
+    {
+        for (VkDescriptorPool pool : usedPools_) {
+            vkResetDescriptorPool(device_, pool, 0);
+            freePools_.push_back(pool);
+        }
+        usedPools_.clear();
+        current_ = VK_NULL_HANDLE;
+    }
+
+    // ### DescriptorManager ###
+    DescriptorManager::DescriptorManager(VkDevice device, uint32_t framesInFlight)
+        : staticAllocator_(device)
+    {
+        for (uint32_t i = 0; i < framesInFlight; i++) {
+            frameAllocators_.push_back(std::make_unique<DescriptorAllocator>(device));
+        }
+    }
+
+    void
+    DescriptorManager::beginFrame(uint32_t frame)
+    {
+        frame_ = frame;
+        frameAllocators_[frame_]->reset();
+    }
+
+    VkDescriptorSet
+    DescriptorManager::allocateFrameSet(const DescriptorLayout& layout, const DescriptorData* data)
+    {
+        VkDescriptorSet set = frameAllocators_[frame_]->allocate(layout.layout());
+        layout.write(set, data);
+        return set;
+    }
+
+    VkDescriptorSet
+    DescriptorManager::getStaticSet(const DescriptorLayout& layout, const DescriptorData* data)
+    {
+        const size_t bytes = sizeof(DescriptorData) * layout.descriptorCount();
+        const DescriptorLayout* key = &layout;
+        const uint64_t hash = hashBytes(data, bytes, hashBytes(&key, sizeof(key)));
+
+        std::vector<CachedSet>& bucket = staticSets_[hash];
+        for (const CachedSet& cached : bucket) {
+            if (cached.layout == key && std::memcmp(cached.data.data(), data, bytes) == 0) {
+                return cached.set;
+            }
+        }
+
+        CachedSet cached;
+        cached.layout = key;
+        cached.data.assign(data, data + layout.descriptorCount());
+        cached.set = staticAllocator_.allocate(layout.layout());
+        layout.write(cached.set, data);
+        bucket.push_back(std::move(cached));
+        return bucket.back().set;
+    }
+
+    void
+    DescriptorManager::clearStaticSets()
+    {
+        staticSets_.clear();
+        staticAllocator_.reset();
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,102 @@
+﻿#pragma once
+#ifndef VFRAME_DESCRIPTORS_HPP
+#define VFRAME_DESCRIPTORS_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // One slot of the data passed to DescriptorLayout::write, one per descriptor in binding order.
+    // Value-initialize ({}) before filling: cached sets are looked up by the raw bytes.
+    union DescriptorData {
+        VkDescriptorImageInfo image;
+        VkDescriptorBufferInfo buffer;
+        VkBufferView texelBuffer;
+    };
+
+    // Set layout and the update template built from the same bindings,
+    // so a whole set is written with a single vkUpdateDescriptorSetWithTemplate
+    class DescriptorLayout {
+    public:
+        DescriptorLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+        ~DescriptorLayout();
+
+        DescriptorLayout(const DescriptorLayout&) = delete;
+        DescriptorLayout& operator=(const DescriptorLayout&) = delete;
+
+        VkDescriptorSetLayout layout() const { return layout_; }
+        const std::vector<VkDescriptorSetLayoutBinding>& bindings() const { return bindings_; }
+        uint32_t descriptorCount() const { return descriptorCount_; } // DescriptorData slots write() reads
+
+        void write(VkDescriptorSet set, const DescriptorData* data) const;
+
+    private:
+        VkDevice device_;
+        std::vector<VkDescriptorSetLayoutBinding> bindings_;
+        uint32_t descriptorCount_ = 0;
+        VkDescriptorSetLayout layout_ = VK_NULL_HANDLE;
+        VkDescriptorUpdateTemplate template_ = VK_NULL_HANDLE;
+    };
+
+    // Growable set of descriptor pools. Sets are never freed one by one:
+    // reset() recycles every pool at once with vkResetDescriptorPool.
+    class DescriptorAllocator {
+    public:
+        explicit DescriptorAllocator(VkDevice device, uint32_t setsPerPool = 64);
+        ~DescriptorAllocator();
+
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+        VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+        void reset();
+
+        uint32_t poolCount() const { return static_cast<uint32_t>(usedPools_.size() + freePools_.size()); }
+
+    private:
+        VkDescriptorPool takePool();
+
+        VkDevice device_;
+        uint32_t setsPerPool_;                  // Grows for every new pool, up to MAX_SETS_PER_POOL
+        VkDescriptorPool current_ = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPool> usedPools_; // Includes current_
+        std::vector<VkDescriptorPool> freePools_;
+    };
+
+    // Per frame in flight allocators for transient sets and a cache for static ones.
+    class DescriptorManager {
+    public:
+        DescriptorManager(VkDevice device, uint32_t framesInFlight);
+
+        // After the fence of this frame slot was waited: its sets from the last round are recycled in bulk
+        void beginFrame(uint32_t frame);
+
+        // Valid until this frame slot comes around again
+        VkDescriptorSet allocateFrameSet(const DescriptorLayout& layout, const DescriptorData* data);
+
+        // Same layout and data return the same set, written once
+        VkDescriptorSet getStaticSet(const DescriptorLayout& layout, const DescriptorData* data);
+        // When resources referenced by static sets are destroyed; the GPU must not use the sets any more
+        void clearStaticSets();
+
+    private:
+        struct CachedSet {
+            const DescriptorLayout* layout;
+            std::vector<DescriptorData> data;
+            VkDescriptorSet set;
+        };
+
+        std::vector<std::unique_ptr<DescriptorAllocator>> frameAllocators_;
+        uint32_t frame_ = 0;
+        DescriptorAllocator staticAllocator_;
+        std::unordered_map<uint64_t, std::vector<CachedSet>> staticSets_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_DESCRIPTORS_HPP
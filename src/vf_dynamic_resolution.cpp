@@ -0,0 +1,52 @@
+﻿#include "vf_dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        constexpr float SMOOTHING = 0.2f;   // Weight of the newest measurement
+        constexpr float DEADBAND = 0.05f;   // Relative error that is left alone, stops oscillation around the target
+        constexpr float GAIN = 0.5f;        // Fraction of the correction applied at once
+        constexpr float STEP = 1.0f / 64.0f; // Scale is quantized, tiny changes are not worth a different render size
+
+    } // namespace
+
+    ResolutionController::ResolutionController(const Settings& settings, uint32_t latencyFrames)
+        : settings_(settings)
+        , latencyFrames_(latencyFrames)
+        , scale_(settings.maxScale)
+    {
+    }
+
+    float
+    ResolutionController::update(float gpuMilliseconds)
+    {
+        smoothed_ = smoothed_ == 0.0f ? gpuMilliseconds : smoothed_ + (gpuMilliseconds - smoothed_) * SMOOTHING;
+
+        // Frames still in flight were recorded with the previous scale
+        if (cooldown_ > 0) {
+            cooldown_--;
+            return scale_;
+        }
+
+        const float target = settings_.targetMilliseconds * settings_.headroom;
+        if (smoothed_ <= 0.0f || std::fabs(smoothed_ - target) < target * DEADBAND) {
+            return scale_;
+        }
+
+        const float ideal = scale_ * std::sqrt(target / smoothed_);
+        float next = scale_ + (ideal - scale_) * GAIN;
+        next = std::round(next / STEP) * STEP;
+        next = std::clamp(next, settings_.minScale, settings_.maxScale);
+
+        if (next != scale_) {
+            scale_ = next;
+            cooldown_ = latencyFrames_;
+        }
+        return scale_;
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,39 @@
+﻿#pragma once
+#ifndef VFRAME_DYNAMIC_RESOLUTION_HPP
+#define VFRAME_DYNAMIC_RESOLUTION_HPP
+
+#include <cstdint>
+
+namespace vf_vulkan {
+
+    // Picks the render scale (fraction of the output width and height) that keeps the measured
+    // GPU frame time at the target. GPU time is taken as proportional to the pixel count, i.e. scale^2.
+    class ResolutionController {
+    public:
+        struct Settings {
+            float targetMilliseconds = 16.6f;
+            float minScale = 0.5f;
+            float maxScale = 1.0f;
+            float headroom = 0.9f;  // Aims below the target so a spike does not miss it right away
+        };
+
+        // latencyFrames: how many frames pass before a new scale shows up in the measurements (frames in flight)
+        ResolutionController(const Settings& settings, uint32_t latencyFrames);
+
+        // One GPU frame time measurement, returns the scale for the next frame
+        float update(float gpuMilliseconds);
+
+        float scale() const { return scale_; }
+        float smoothedMilliseconds() const { return smoothed_; }
+
+    private:
+        Settings settings_;
+        uint32_t latencyFrames_;
+        uint32_t cooldown_ = 0;
+        float scale_;
+        float smoothed_ = 0.0f;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_DYNAMIC_RESOLUTION_HPP
@@ -0,0 +1,665 @@
+﻿#include <vFrame/vf_ecs.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace vf_core {
+
+    namespace {
+
+        using ComponentMask = std::bitset<VF_MAX_COMPONENTS>;
+
+        constexpr uint32_t CHUNK_BYTES = 16 * 1024;
+        constexpr uint32_t COLUMN_ALIGNMENT = 64;  // Every column starts on a cache line
+        constexpr size_t ARENA_PAGE_BYTES = 4096;  // Command buffer value storage
+
+        // ### Component registry ###
+
+        // Fixed array: an id is only looked up after registerComponent returned it, no lock on reads
+        struct ComponentRegistry {
+            std::mutex mutex;
+            std::unordered_map<std::string, ComponentId> ids;
+            ComponentInfo infos[VF_MAX_COMPONENTS];
+            uint32_t count = 0;
+        };
+
+        ComponentRegistry&
+        registry()
+        {
+            static ComponentRegistry instance;
+            return instance;
+        }
+
+        const ComponentInfo&
+        componentInfo(ComponentId id)
+        {
+            return registry().infos[id];
+        }
+
+        size_t
+        alignUp(size_t value, size_t alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        // ### Archetype storage ###
+
+        struct Chunk {
+            unsigned char* data = nullptr;
+            uint32_t count = 0;
+        };
+
+        struct Archetype {
+            ComponentMask mask;
+            std::vector<ComponentId> components;    // Ascending
+            std::vector<uint32_t> offsets;          // Column byte offset inside a chunk, per component
+            std::vector<uint32_t> sizes;
+            int16_t columnOf[VF_MAX_COMPONENTS];    // Component id -> column, -1 when absent
+            uint32_t capacity = 0;                  // Entities per chunk
+            uint32_t chunkBytes = 0;
+            std::vector<Chunk> chunks;              // All full except the last one
+            std::unordered_map<ComponentId, Archetype*> addEdges, removeEdges;
+
+            Entity* entities(const Chunk& chunk) const { return reinterpret_cast<Entity*>(chunk.data); }
+            unsigned char* at(const Chunk& chunk, uint32_t column, uint32_t row) const { return chunk.data + offsets[column] + size_t(sizes[column]) * row; }
+        };
+
+        // Entity ids first, then one column per component
+        void
+        computeLayout(Archetype& archetype)
+        {
+            size_t rowBytes = sizeof(Entity);
+            for (ComponentId id : archetype.components) {
+                rowBytes += componentInfo(id).size;
+            }
+            const size_t padding = size_t(COLUMN_ALIGNMENT) * (archetype.components.size() + 1);
+            const size_t capacity = CHUNK_BYTES > padding ? (CHUNK_BYTES - padding) / rowBytes : 0;
+            archetype.capacity = static_cast<uint32_t>(std::max<size_t>(capacity, 1));
+
+            size_t offset = sizeof(Entity) * size_t(archetype.capacity);
+            archetype.offsets.clear();
+            archetype.sizes.clear();
+            for (ComponentId id : archetype.components) {
+                const ComponentInfo& info = componentInfo(id);
+                offset = alignUp(offset, std::max<size_t>(COLUMN_ALIGNMENT, info.alignment));
+                archetype.offsets.push_back(static_cast<uint32_t>(offset));
+                archetype.sizes.push_back(info.size);
+                offset += size_t(info.size) * archetype.capacity;
+            }
+            archetype.chunkBytes = static_cast<uint32_t>(std::max<size_t>(alignUp(offset, COLUMN_ALIGNMENT), CHUNK_BYTES));
+        }
+
+        size_t
+        chunkAlignment(const Archetype& archetype)
+        {
+            size_t alignment = COLUMN_ALIGNMENT;
+            for (ComponentId id : archetype.components) {
+                alignment = std::max<size_t>(alignment, componentInfo(id).alignment);
+            }
+            return alignment;
+        }
+
+        struct EntityRecord {
+            Archetype* archetype = nullptr; // nullptr - free or reserved
+            uint32_t chunk = 0;
+            uint32_t row = 0;
+            uint32_t generation = 1;
+        };
+
+        struct QueryCache {
+            std::vector<Archetype*> archetypes;
+            size_t archetypesSeen = 0; // Archetypes are never removed, only the new ones are matched
+        };
+
+    } // namespace
+
+    ComponentId
+    registerComponent(const ComponentInfo& info)
+    {
+        ComponentRegistry& components = registry();
+        std::lock_guard<std::mutex> lock(components.mutex);
+
+        auto found = components.ids.find(info.name);
+        if (found != components.ids.end()) {
+            return found->second;
+        }
+        if (components.count == VF_MAX_COMPONENTS) {
+            throw std::runtime_error("failed to register component: VF_MAX_COMPONENTS reached!");
+        }
+        const ComponentId id = components.count++;
+        components.infos[id] = info;
+        components.ids.emplace(info.name, id);
+        return id;
+    }
+
+    // #############################################
+    // World
+    // #############################################
+
+    class World::Impl {
+    public:
+        std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> archetypeByMask;
+        std::vector<Archetype*> archetypes;  // Creation order
+        Archetype* root = nullptr;           // No components
+
+        std::vector<EntityRecord> records;
+        std::vector<uint32_t> freeIndices;
+        std::atomic<uint32_t> nextIndex{ 0 }; // reserve() takes fresh indices from any thread
+        uint32_t liveEntities = 0;
+
+        std::unordered_map<ComponentMask, QueryCache> queries;
+
+        Impl()
+        {
+            root = findArchetype(ComponentMask());
+        }
+
+        ~Impl()
+        {
+            for (Archetype* archetype : archetypes) {
+                for (Chunk& chunk : archetype->chunks) {
+                    destroyRows(*archetype, chunk, 0, chunk.count);
+                    ::operator delete(chunk.data, std::align_val_t(chunkAlignment(*archetype)));
+                }
+            }
+        }
+
+        Archetype*
+        findArchetype(const ComponentMask& mask)
+        {
+            auto found = archetypeByMask.find(mask);
+            if (found != archetypeByMask.end()) {
+                return found->second.get();
+            }
+
+            auto archetype = std::make_unique<Archetype>();
+            archetype->mask = mask;
+            std::fill(std::begin(archetype->columnOf), std::end(archetype->columnOf), int16_t(-1));
+            for (ComponentId id = 0; id < VF_MAX_COMPONENTS; id++) {
+                if (mask.test(id)) {
+                    archetype->columnOf[id] = static_cast<int16_t>(archetype->components.size());
+                    archetype->components.push_back(id);
+                }
+            }
+            computeLayout(*archetype);
+
+            Archetype* result = archetype.get();
+            archetypeByMask.emplace(mask, std::move(archetype));
+            archetypes.push_back(result);
+            return result;
+        }
+
+        // Archetype graph: the neighbour with one component more or less, cached on the edge
+        Archetype*
+        neighbour(Archetype& archetype, ComponentId id, bool add)
+        {
+            auto& edges = add ? archetype.addEdges : archetype.removeEdges;
+            auto found = edges.find(id);
+            if (found != edges.end()) {
+                return found->second;
+            }
+            ComponentMask mask = archetype.mask;
+            mask.set(id, add);
+            Archetype* result = findArchetype(mask);
+            edges.emplace(id, result);
+            return result;
+        }
+
+        bool
+        isAlive(Entity entity) const
+        {
+            return entity.index < records.size() && records[entity.index].archetype != nullptr
+                && records[entity.index].generation == entity.generation;
+        }
+
+        // Row with unconstructed components, entity id written
+        void
+        allocateRow(Archetype& archetype, Entity entity, uint32_t& chunkIndex, uint32_t& row)
+        {
+            if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) {
+                Chunk chunk;
+                chunk.data = static_cast<unsigned char*>(::operator new(archetype.chunkBytes, std::align_val_t(chunkAlignment(archetype))));
+                archetype.chunks.push_back(chunk);
+            }
+            chunkIndex = static_cast<uint32_t>(archetype.chunks.size() - 1);
+            Chunk& chunk = archetype.chunks.back();
+            row = chunk.count++;
+            archetype.entities(chunk)[row] = entity;
+        }
+
+        void
+        destroyRows(Archetype& archetype, Chunk& chunk, uint32_t begin, uint32_t end)
+        {
+            for (uint32_t column = 0; column < archetype.components.size(); column++) {
+                const ComponentInfo& info = componentInfo(archetype.components[column]);
+                for (uint32_t row = begin; row < end; row++) {
+                    info.destroy(archetype.at(chunk, column, row));
+                }
+            }
+        }
+
+        // Components of the row are already destroyed or moved out. The archetype's last row fills
+        // the hole, so chunks stay dense
+        void
+        releaseRow(Archetype& archetype, uint32_t chunkIndex, uint32_t row)
+        {
+            Chunk& last = archetype.chunks.back();
+            const uint32_t lastRow = last.count - 1;
+            Chunk& chunk = archetype.chunks[chunkIndex];
+
+            if (&chunk != &last || row != lastRow) {
+                for (uint32_t column = 0; column < archetype.components.size(); column++) {
+                    const ComponentInfo& info = componentInfo(archetype.components[column]);
+                    void* source = archetype.at(last, column, lastRow);
+                    info.moveConstruct(archetype.at(chunk, column, row), source);
+                    info.destroy(source);
+                }
+                const Entity moved = archetype.entities(last)[lastRow];
+                archetype.entities(chunk)[row] = moved;
+                records[moved.index].chunk = chunkIndex;
+                records[moved.index].row = row;
+            }
+
+            if (--last.count == 0) {
+                ::operator delete(last.data, std::align_val_t(chunkAlignment(archetype)));
+                archetype.chunks.pop_back();
+            }
+        }
+
+        // Components present in both archetypes are moved, missing ones default constructed
+        // (or moved from added when it is the new one), dropped ones destroyed
+        void
+        moveEntity(Entity entity, Archetype& target, ComponentId addedId, void* added)
+        {
+            EntityRecord& record = records[entity.index];
+            Archetype& source = *record.archetype;
+            Chunk& sourceChunk = source.chunks[record.chunk];
+
+            uint32_t chunkIndex, row;
+            allocateRow(target, entity, chunkIndex, row);
+            Chunk& targetChunk = target.chunks[chunkIndex];
+
+            for (uint32_t column = 0; column < target.components.size(); column++) {
+                const ComponentId id = target.components[column];
+                const ComponentInfo& info = componentInfo(id);
+                void* destination = target.at(targetChunk, column, row);
+                const int16_t sourceColumn = source.columnOf[id];
+                if (sourceColumn >= 0) {
+                    void* value = source.at(sourceChunk, sourceColumn, record.row);
+                    info.moveConstruct(destination, value);
+                    info.destroy(value);
+                } else if (id == addedId && added) {
+                    info.moveConstruct(destination, added);
+                } else {
+                    info.construct(destination);
+                }
+            }
+            for (uint32_t column = 0; column < source.components.size(); column++) {
+                if (target.columnOf[source.components[column]] < 0) {
+                    componentInfo(source.components[column]).destroy(source.at(sourceChunk, column, record.row));
+                }
+            }
+
+            releaseRow(source, record.chunk, record.row);
+            record.archetype = &target;
+            record.chunk = chunkIndex;
+            record.row = row;
+        }
+
+        uint32_t
+        takeIndex()
+        {
+            uint32_t index;
+            if (!freeIndices.empty()) {
+                index = freeIndices.back();
+                freeIndices.pop_back();
+            } else {
+                index = nextIndex.fetch_add(1);
+            }
+            if (index >= records.size()) {
+                records.resize(size_t(index) + 1);
+            }
+            return index;
+        }
+
+        void
+        place(uint32_t index, Archetype& archetype, const ComponentId* ids, void* const* sources, uint32_t count)
+        {
+            EntityRecord& record = records[index];
+            const Entity entity{ index, record.generation };
+            allocateRow(archetype, entity, record.chunk, record.row);
+            record.archetype = &archetype;
+            liveEntities++;
+
+            Chunk& chunk = archetype.chunks[record.chunk];
+            for (uint32_t column = 0; column < archetype.components.size(); column++) {
+                const ComponentId id = archetype.components[column];
+                void* source = nullptr;
+                for (uint32_t i = 0; i < count; i++) {
+                    if (ids[i] == id) {
+                        source = sources ? sources[i] : nullptr;
+                        break;
+                    }
+                }
+                const ComponentInfo& info = componentInfo(id);
+                if (source) {
+                    info.moveConstruct(archetype.at(chunk, column, record.row), source);
+                } else {
+                    info.construct(archetype.at(chunk, column, record.row));
+                }
+            }
+        }
+
+        const std::vector<Archetype*>&
+        matching(const ComponentMask& mask)
+        {
+            QueryCache& cache = queries[mask];
+            for (; cache.archetypesSeen < archetypes.size(); cache.archetypesSeen++) {
+                Archetype* archetype = archetypes[cache.archetypesSeen];
+                if ((archetype->mask & mask) == mask) {
+                    cache.archetypes.push_back(archetype);
+                }
+            }
+            return cache.archetypes;
+        }
+    };
+
+    World::World() : pImpl(std::make_unique<Impl>()) {}
+    World::~World() = default;
+
+    Entity
+    World::createRaw(const ComponentId* ids, void* const* sources, uint32_t count)
+    {
+        ComponentMask mask;
+        for (uint32_t i = 0; i < count; i++) {
+            mask.set(ids[i]);
+        }
+        Archetype* archetype = pImpl->findArchetype(mask);
+        const uint32_t index = pImpl->takeIndex();
+        pImpl->place(index, *archetype, ids, sources, count);
+        return Entity{ index, pImpl->records[index].generation };
+    }
+
+    void
+    World::destroy(Entity entity)
+    {
+        if (!pImpl->isAlive(entity)) {
+            return;
+        }
+        EntityRecord& record = pImpl->records[entity.index];
+        Archetype& archetype = *record.archetype;
+        pImpl->destroyRows(archetype, archetype.chunks[record.chunk], record.row, record.row + 1);
+        pImpl->releaseRow(archetype, record.chunk, record.row);
+
+        record.archetype = nullptr;
+        if (++record.generation == 0) {
+            record.generation = 1;
+        }
+        pImpl->freeIndices.push_back(entity.index);
+        pImpl->liveEntities--;
+    }
+
+    bool
+    World::alive(Entity entity) const
+    {
+        return pImpl->isAlive(entity);
+    }
+
+    void
+    World::addRaw(Entity entity, ComponentId id, void* source)
+    {
+        if (!pImpl->isAlive(entity)) {
+            return;
+        }
+        EntityRecord& record = pImpl->records[entity.index];
+        Archetype& archetype = *record.archetype;
+        const int16_t column = archetype.columnOf[id];
+        if (column >= 0) {
+            const ComponentInfo& info = componentInfo(id);
+            void* value = archetype.at(archetype.chunks[record.chunk], column, record.row);
+            info.destroy(value);
+            info.moveConstruct(value, source);
+            return;
+        }
+        pImpl->moveEntity(entity, *pImpl->neighbour(archetype, id, true), id, source);
+    }
+
+    void
+    World::removeRaw(Entity entity, ComponentId id)
+    {
+        if (!pImpl->isAlive(entity)) {
+            return;
+        }
+        Archetype& archetype = *pImpl->records[entity.index].archetype;
+        if (archetype.columnOf[id] < 0) {
+            return;
+        }
+        pImpl->moveEntity(entity, *pImpl->neighbour(archetype, id, false), id, nullptr);
+    }
+
+    void*
+    World::getRaw(Entity entity, ComponentId id)
+    {
+        if (!pImpl->isAlive(entity)) {
+            return nullptr;
+        }
+        const EntityRecord& record = pImpl->records[entity.index];
+        const int16_t column = record.archetype->columnOf[id];
+        return column >= 0 ? record.archetype->at(record.archetype->chunks[record.chunk], column, record.row) : nullptr;
+    }
+
+    bool
+    World::hasRaw(Entity entity, ComponentId id) const
+    {
+        return pImpl->isAlive(entity) && pImpl->records[entity.index].archetype->columnOf[id] >= 0;
+    }
+
+    uint32_t
+    World::entityCount() const
+    {
+        return pImpl->liveEntities;
+    }
+
+    uint32_t
+    World::archetypeCount() const
+    {
+        return static_cast<uint32_t>(pImpl->archetypes.size());
+    }
+
+    void
+    World::collectChunks(const ComponentId* ids, uint32_t count, std::vector<QueryChunk>& chunks)
+    {
+        ComponentMask mask;
+        for (uint32_t i = 0; i < count; i++) {
+            mask.set(ids[i]);
+        }
+
+        chunks.clear();
+        for (Archetype* archetype : pImpl->matching(mask)) {
+            for (const Chunk& chunk : archetype->chunks) {
+                QueryChunk view{};
+                view.entities = archetype->entities(chunk);
+                view.count = chunk.count;
+                for (uint32_t i = 0; i < count; i++) {
+                    view.columns[i] = chunk.data + archetype->offsets[archetype->columnOf[ids[i]]];
+                }
+                chunks.push_back(view);
+            }
+        }
+    }
+
+    Entity
+    World::reserve()
+    {
+        return Entity{ pImpl->nextIndex.fetch_add(1), 1 };
+    }
+
+    void
+    World::materialize(Entity reserved)
+    {
+        if (reserved.index >= pImpl->records.size()) {
+            pImpl->records.resize(size_t(reserved.index) + 1);
+        }
+        const EntityRecord& record = pImpl->records[reserved.index];
+        if (record.archetype || record.generation != reserved.generation) {
+            return;
+        }
+        pImpl->place(reserved.index, *pImpl->root, nullptr, nullptr, 0);
+    }
+
+    // #############################################
+    // CommandBuffer
+    // #############################################
+
+    class CommandBuffer::Impl {
+    public:
+        enum class CommandType : uint8_t { CREATE, DESTROY, ADD, REMOVE };
+
+        struct Command {
+            CommandType type;
+            ComponentId component;
+            Entity entity;
+            void* value;    // ADD: moved-in component, owned until applied
+        };
+
+        struct LargeBlock {
+            void* data;
+            size_t alignment;
+        };
+
+        World& world;
+        std::vector<Command> commands;
+        size_t applied = 0;
+
+        // Values never move once stored (components need not be trivially relocatable):
+        // fixed pages with a bump offset, reused after apply(); oversized values get their own block
+        std::vector<unsigned char*> pages;
+        size_t page = 0;
+        size_t pageOffset = 0;
+        std::vector<LargeBlock> largeBlocks;
+
+        explicit Impl(World& owner) : world(owner) {}
+
+        ~Impl()
+        {
+            clear();
+            for (unsigned char* data : pages) {
+                ::operator delete(data, std::align_val_t(COLUMN_ALIGNMENT));
+            }
+        }
+
+        void*
+        allocate(size_t size, size_t alignment)
+        {
+            if (size > ARENA_PAGE_BYTES || alignment > COLUMN_ALIGNMENT) {
+                alignment = std::max<size_t>(alignment, alignof(std::max_align_t));
+                void* data = ::operator new(size, std::align_val_t(alignment));
+                largeBlocks.push_back({ data, alignment });
+                return data;
+            }
+            size_t offset = alignUp(pageOffset, alignment);
+            if (page == pages.size() || offset + size > ARENA_PAGE_BYTES) {
+                if (page < pages.size()) {
+                    page++;
+                }
+                if (page == pages.size()) {
+                    pages.push_back(static_cast<unsigned char*>(::operator new(ARENA_PAGE_BYTES, std::align_val_t(COLUMN_ALIGNMENT))));
+                }
+                offset = 0;
+            }
+            pageOffset = offset + size;
+            return pages[page] + offset;
+        }
+
+        // Values of commands that were not applied are destroyed
+        void
+        clear()
+        {
+            for (size_t i = applied; i < commands.size(); i++) {
+                if (commands[i].type == CommandType::ADD) {
+                    componentInfo(commands[i].component).destroy(commands[i].value);
+                }
+            }
+            commands.clear();
+            applied = 0;
+            page = 0;
+            pageOffset = 0;
+            for (const LargeBlock& block : largeBlocks) {
+                ::operator delete(block.data, std::align_val_t(block.alignment));
+            }
+            largeBlocks.clear();
+        }
+    };
+
+    CommandBuffer::CommandBuffer(World& world) : pImpl(std::make_unique<Impl>(world)) {}
+    CommandBuffer::~CommandBuffer() = default;
+
+    Entity
+    CommandBuffer::create()
+    {
+        const Entity entity = pImpl->world.reserve();
+        pImpl->commands.push_back({ Impl::CommandType::CREATE, 0, entity, nullptr });
+        return entity;
+    }
+
+    void
+    CommandBuffer::destroy(Entity entity)
+    {
+        pImpl->commands.push_back({ Impl::CommandType::DESTROY, 0, entity, nullptr });
+    }
+
+    void
+    CommandBuffer::addRaw(Entity entity, ComponentId id, void* source)
+    {
+        const ComponentInfo& info = componentInfo(id);
+        void* value = pImpl->allocate(info.size, info.alignment);
+        info.moveConstruct(value, source);
+        pImpl->commands.push_back({ Impl::CommandType::ADD, id, entity, value });
+    }
+
+    void
+    CommandBuffer::removeRaw(Entity entity, ComponentId id)
+    {
+        pImpl->commands.push_back({ Impl::CommandType::REMOVE, id, entity, nullptr });
+    }
+
+    void
+    CommandBuffer::apply()
+    {
+        VF_TRACE_ZONE("ECS command buffer");
+
+        World& world = pImpl->world;
+        for (; pImpl->applied < pImpl->commands.size(); pImpl->applied++) {
+            const Impl::Command& command = pImpl->commands[pImpl->applied];
+            switch (command.type) {
+            case Impl::CommandType::CREATE:
+                world.materialize(command.entity);
+                break;
+            case Impl::CommandType::DESTROY:
+                world.destroy(command.entity);
+                break;
+            case Impl::CommandType::ADD:
+                world.addRaw(command.entity, command.component, command.value);
+                componentInfo(command.component).destroy(command.value);
+                break;
+            case Impl::CommandType::REMOVE:
+                world.removeRaw(command.entity, command.component);
+                break;
+            }
+        }
+        pImpl->clear();
+    }
+
+    bool
+    CommandBuffer::empty() const
+    {
+        return pImpl->commands.size() == pImpl->applied;
+    }
+
+} // namespace vf_core
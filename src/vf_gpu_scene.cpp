@@ -0,0 +1,419 @@
+﻿#include "vf_gpu_scene.hpp"
+
+#include <vFrame/vf_math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+        constexpr uint32_t CULL_WORKGROUP_SIZE = 64; // local_size_x in cull.comp
+
+        void
+        extractFrustumPlanes(const float viewProjection[16], float planes[6][4])
+        {
+            vf_core::Mat4 matrix;
+            std::memcpy(&matrix.columns[0].x, viewProjection, sizeof(matrix));
+            const vf_core::Frustum frustum = vf_core::extractFrustum(matrix);
+            std::memcpy(planes, frustum.planes, sizeof(frustum.planes));
+        }
+    }
+
+    GpuScene::GpuScene(const DeviceHandles& handles, PipelineManager& pipelines, DescriptorManager& descriptors,
+        ResourceTracker& tracker, const Capacity& capacity, uint32_t framesInFlight, bool drawIndirectCount,
+        bool multiDrawIndirect, std::vector<char> cullShaderCode)
+        : handles_(handles)
+        , pipelines_(pipelines)
+        , descriptors_(descriptors)
+        , tracker_(tracker)
+        , capacity_(capacity)
+        , framesInFlight_(framesInFlight)
+        , drawIndirectCount_(drawIndirectCount)
+        , multiDrawIndirect_(multiDrawIndirect)
+    {
+        const VkBufferUsageFlags addressUsage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+        vertexBuffer_ = createBuffer(handles_, sizeof(SceneVertex) * capacity_.maxVertices,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | addressUsage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        indexBuffer_ = createBuffer(handles_, sizeof(uint32_t) * capacity_.maxIndices,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        objectBuffer_ = createBuffer(handles_, sizeof(GpuObjectData) * capacity_.maxObjects,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | addressUsage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        paramsBuffer_ = createBuffer(handles_, sizeof(CullParams) * framesInFlight_,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | addressUsage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        // Indirect buffers are written by the compute pass, so each frame in flight owns its own pair
+        for (uint32_t i = 0; i < framesInFlight_; i++) {
+            drawBuffers_.push_back(createBuffer(handles_,
+                sizeof(VkDrawIndexedIndirectCommand) * capacity_.maxObjects,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | addressUsage,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+
+            countBuffers_.push_back(createBuffer(handles_, sizeof(uint32_t),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | addressUsage,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+
+            tracker_.trackBuffer(drawBuffers_.back().buffer);
+            tracker_.trackBuffer(countBuffers_.back().buffer);
+        }
+
+        createPipelineLayouts();
+        cullPipeline_ = pipelines_.request([this, code = std::move(cullShaderCode)]() { return buildCullPipeline(code); });
+
+        extractFrustumPlanes(viewProjection_, cullParams_.planes);
+        cullParams_.compact = drawIndirectCount_ ? 1u : 0u;
+    }
+
+    GpuScene::~GpuScene()
+    {
+        // Compiles in flight read the layouts, the pipelines themselves belong to the manager
+        pipelines_.waitIdle();
+
+        if (cullPipelineLayout_ != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(handles_.device, cullPipelineLayout_, nullptr);
+        }
+        if (drawPipelineLayout_ != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(handles_.device, drawPipelineLayout_, nullptr);
+        }
+        textureLayout_.reset();
+
+        for (auto& buffer : drawBuffers_) {
+            tracker_.forget(buffer.buffer);
+            destroyBuffer(handles_.device, buffer);
+        }
+        for (auto& buffer : countBuffers_) {
+            tracker_.forget(buffer.buffer);
+            destroyBuffer(handles_.device, buffer);
+        }
+        destroyBuffer(handles_.device, paramsBuffer_);
+        destroyBuffer(handles_.device, objectBuffer_);
+        destroyBuffer(handles_.device, indexBuffer_);
+        destroyBuffer(handles_.device, vertexBuffer_);
+    }
+
+    VkShaderModule
+    GpuScene::createShaderModule(const std::vector<char>& code) const
+    {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+        VkShaderModule shaderModule;
+        if (vkCreateShaderModule(handles_.device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module!");
+        }
+        return shaderModule;
+    }
+
+    // Layouts outlive every pipeline rebuild (swap chain, hot reload)
+    void
+    GpuScene::createPipelineLayouts()
+    {
+        VkPushConstantRange cullPushRange{};
+        cullPushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        cullPushRange.offset = 0;
+        cullPushRange.size = sizeof(CullPush);
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &cullPushRange;
+
+        if (vkCreatePipelineLayout(handles_.device, &layoutInfo, nullptr, &cullPipelineLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull pipeline layout!");
+        }
+
+        VkDescriptorSetLayoutBinding texturesBinding{};
+        texturesBinding.binding = 0;
+        texturesBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        texturesBinding.descriptorCount = VF_MAX_SCENE_TEXTURES;
+        texturesBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        textureLayout_ = std::make_unique<DescriptorLayout>(handles_.device,
+            std::vector<VkDescriptorSetLayoutBinding>{ texturesBinding });
+
+        VkDescriptorSetLayout setLayout = textureLayout_->layout();
+
+        VkPushConstantRange drawPushRange{};
+        drawPushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        drawPushRange.offset = 0;
+        drawPushRange.size = sizeof(DrawPush);
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        layoutInfo.pPushConstantRanges = &drawPushRange;
+
+        if (vkCreatePipelineLayout(handles_.device, &layoutInfo, nullptr, &drawPipelineLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create scene pipeline layout!");
+        }
+    }
+
+    VkPipeline
+    GpuScene::buildCullPipeline(const std::vector<char>& cullShaderCode) const
+    {
+        VkShaderModule cullModule = createShaderModule(cullShaderCode);
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = cullModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = cullPipelineLayout_;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkResult result = vkCreateComputePipelines(handles_.device, handles_.pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+        vkDestroyShaderModule(handles_.device, cullModule, nullptr);
+
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull compute pipeline!");
+        }
+        return pipeline;
+    }
+
+    void
+    GpuScene::createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+        VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode)
+    {
+        // Vertices are pulled from the storage buffer in scene.vert, so there is no vertex input
+        drawState_.vertexShader = ShaderCode::fromSpirv(std::move(vertShaderCode));
+        drawState_.fragmentShader = ShaderCode::fromSpirv(std::move(fragShaderCode));
+        drawState_.layout = drawPipelineLayout_;
+        drawState_.renderPass = renderPass;
+        drawState_.colorFormat = colorFormat;
+        drawState_.depthFormat = depthFormat;
+        drawState_.samples = samples;
+        drawState_.depthTest = depthFormat != VK_FORMAT_UNDEFINED;
+        drawState_.depthWrite = drawState_.depthTest;
+        drawState_.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        drawState_.cullMode = VK_CULL_MODE_BACK_BIT;
+        drawState_.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+        // The same state after a swap chain recreation returns the pipeline that is already there
+        drawPipeline_ = pipelines_.requestGraphics(drawState_);
+    }
+
+    VkPipeline
+    GpuScene::buildDrawPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const
+    {
+        PipelineState state = drawState_;
+        state.vertexShader = ShaderCode::fromSpirv(vertShaderCode);
+        state.fragmentShader = ShaderCode::fromSpirv(fragShaderCode);
+        return createGraphicsPipeline(handles_.device, handles_.pipelineCache, state);
+    }
+
+    VkPipeline
+    GpuScene::swapDrawPipeline(VkPipeline pipeline)
+    {
+        return pipelines_.replace(drawPipeline_, pipeline);
+    }
+
+    VkPipeline
+    GpuScene::swapCullPipeline(VkPipeline pipeline)
+    {
+        return pipelines_.replace(cullPipeline_, pipeline);
+    }
+
+    MeshRange
+    GpuScene::uploadMesh(const SceneVertex* vertices, uint32_t vertexCount,
+        const uint32_t* indices, uint32_t indexCount)
+    {
+        if (vertexCount_ + vertexCount > capacity_.maxVertices ||
+            indexCount_ + indexCount > capacity_.maxIndices) {
+            throw std::runtime_error("scene geometry capacity exceeded!");
+        }
+
+        // Both streams share one staging buffer and one submit. The source may be a mapped
+        // file (loadSceneMesh), then this memcpy is the only copy on the way to the GPU.
+        const VkDeviceSize vertexBytes = sizeof(SceneVertex) * vertexCount;
+        const VkDeviceSize indexBytes = sizeof(uint32_t) * indexCount;
+        if (vertexBytes + indexBytes == 0) {
+            return MeshRange{ indexCount_, 0, static_cast<int32_t>(vertexCount_) };
+        }
+
+        GpuBuffer staging = createBuffer(handles_, vertexBytes + indexBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        std::memcpy(staging.mapped, vertices, static_cast<size_t>(vertexBytes));
+        std::memcpy(static_cast<char*>(staging.mapped) + vertexBytes, indices, static_cast<size_t>(indexBytes));
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(handles_);
+        if (vertexBytes > 0) {
+            VkBufferCopy vertexCopy{ 0, sizeof(SceneVertex) * vertexCount_, vertexBytes };
+            vkCmdCopyBuffer(commandBuffer, staging.buffer, vertexBuffer_.buffer, 1, &vertexCopy);
+        }
+        if (indexBytes > 0) {
+            VkBufferCopy indexCopy{ vertexBytes, sizeof(uint32_t) * indexCount_, indexBytes };
+            vkCmdCopyBuffer(commandBuffer, staging.buffer, indexBuffer_.buffer, 1, &indexCopy);
+        }
+        endSingleTimeCommands(handles_, commandBuffer);
+        destroyBuffer(handles_.device, staging);
+
+        MeshRange range;
+        range.firstIndex = indexCount_;
+        range.indexCount = indexCount;
+        range.vertexOffset = static_cast<int32_t>(vertexCount_);
+
+        vertexCount_ += vertexCount;
+        indexCount_ += indexCount;
+        return range;
+    }
+
+    uint32_t
+    GpuScene::addObjects(const SceneObjectDesc* objects, uint32_t count)
+    {
+        if (objectCount_ + count > capacity_.maxObjects) {
+            throw std::runtime_error("scene object capacity exceeded!");
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (objects[i].texture != VF_INVALID_TEXTURE && objects[i].texture >= VF_MAX_SCENE_TEXTURES) {
+                throw std::runtime_error("scene object texture exceeds VF_MAX_SCENE_TEXTURES!");
+            }
+        }
+
+        std::vector<GpuObjectData> data(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const SceneObjectDesc& src = objects[i];
+            GpuObjectData& dst = data[i];
+            std::memcpy(dst.model, src.transform, sizeof(dst.model));
+
+            // Bounding sphere goes to world space once here, so the cull shader does no matrix math
+            const float* m = src.transform;
+            const float* c = src.boundsCenter;
+            for (int r = 0; r < 3; r++) {
+                dst.sphere[r] = m[r] * c[0] + m[4 + r] * c[1] + m[8 + r] * c[2] + m[12 + r];
+            }
+            float maxScale = 0.0f;
+            for (int col = 0; col < 3; col++) {
+                float s = std::sqrt(m[col * 4] * m[col * 4] + m[col * 4 + 1] * m[col * 4 + 1] + m[col * 4 + 2] * m[col * 4 + 2]);
+                maxScale = std::max(maxScale, s);
+            }
+            dst.sphere[3] = src.boundsRadius * maxScale;
+
+            uint32_t lodCount = std::clamp(src.lodCount, 1u, VF_MAX_MESH_LODS);
+            for (uint32_t lod = 0; lod < VF_MAX_MESH_LODS; lod++) {
+                const MeshRange& range = src.lods[std::min(lod, lodCount - 1)];
+                dst.lods[lod][0] = range.firstIndex;
+                dst.lods[lod][1] = range.indexCount;
+                dst.lods[lod][2] = static_cast<uint32_t>(range.vertexOffset);
+                dst.lods[lod][3] = 0;
+                dst.lodDistances[lod] = src.lodDistances[lod];
+            }
+            dst.info[0] = lodCount;
+            dst.info[1] = src.texture; // VF_INVALID_TEXTURE: scene.frag skips sampling
+            dst.info[2] = dst.info[3] = 0;
+        }
+
+        uploadToBuffer(handles_, objectBuffer_, sizeof(GpuObjectData) * objectCount_,
+            data.data(), sizeof(GpuObjectData) * count);
+
+        uint32_t first = objectCount_;
+        objectCount_ += count;
+        return first;
+    }
+
+    void
+    GpuScene::clearObjects()
+    {
+        objectCount_ = 0;
+    }
+
+    void
+    GpuScene::setCamera(const float viewProjection[16], const float cameraPosition[3])
+    {
+        std::memcpy(viewProjection_, viewProjection, sizeof(viewProjection_));
+        extractFrustumPlanes(viewProjection_, cullParams_.planes);
+        cullParams_.cameraPosition[0] = cameraPosition[0];
+        cullParams_.cameraPosition[1] = cameraPosition[1];
+        cullParams_.cameraPosition[2] = cameraPosition[2];
+        cullParams_.cameraPosition[3] = 1.0f;
+    }
+
+    void
+    GpuScene::recordCulling(VkCommandBuffer commandBuffer, uint32_t frame)
+    {
+        VkPipeline cullPipeline = pipelines_.get(cullPipeline_);
+        if (objectCount_ == 0 || cullPipeline == VK_NULL_HANDLE) return;
+
+        // Slot of this frame is free: its fence was waited in drawFrame
+        cullParams_.objectCount = objectCount_;
+        CullParams* params = static_cast<CullParams*>(paramsBuffer_.mapped) + frame;
+        std::memcpy(params, &cullParams_, sizeof(CullParams));
+
+        VkBuffer drawBuffer = drawBuffers_[frame].buffer;
+        VkBuffer countBuffer = countBuffers_[frame].buffer;
+
+        if (drawIndirectCount_) {
+            tracker_.useBuffer(countBuffer, ResourceUsage::TRANSFER_DST);
+            tracker_.flush(commandBuffer);
+            vkCmdFillBuffer(commandBuffer, countBuffer, 0, sizeof(uint32_t), 0);
+            tracker_.useBuffer(countBuffer, ResourceUsage::COMPUTE_READ_WRITE); // atomicAdd
+        }
+        tracker_.useBuffer(drawBuffer, ResourceUsage::COMPUTE_WRITE);
+        tracker_.flush(commandBuffer);
+
+        CullPush push{};
+        push.params = paramsBuffer_.address + sizeof(CullParams) * frame;
+        push.objects = objectBuffer_.address;
+        push.draws = drawBuffers_[frame].address;
+        push.count = countBuffers_[frame].address;
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdPushConstants(commandBuffer, cullPipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPush), &push);
+        vkCmdDispatch(commandBuffer, (objectCount_ + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+        tracker_.useBuffer(drawBuffer, ResourceUsage::INDIRECT_READ);
+        if (drawIndirectCount_) {
+            tracker_.useBuffer(countBuffer, ResourceUsage::INDIRECT_READ);
+        }
+        tracker_.flush(commandBuffer);
+    }
+
+    void
+    GpuScene::recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, const DescriptorData* textures)
+    {
+        // Without the cull pass of this frame the indirect buffers are stale
+        VkPipeline drawPipeline = pipelines_.get(drawPipeline_);
+        if (objectCount_ == 0 || drawPipeline == VK_NULL_HANDLE || !pipelines_.isReady(cullPipeline_)) return;
+
+        DrawPush push{};
+        std::memcpy(push.viewProjection, viewProjection_, sizeof(push.viewProjection));
+        push.vertices = vertexBuffer_.address;
+        push.objects = objectBuffer_.address;
+
+        // Views change with texture residency, so the set is written again every frame
+        VkDescriptorSet textureSet = descriptors_.allocateFrameSet(*textureLayout_, textures);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipelineLayout_, 0, 1,
+            &textureSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, drawPipelineLayout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPush), &push);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer_.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+        const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (drawIndirectCount_) {
+            vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffers_[frame].buffer, 0,
+                countBuffers_[frame].buffer, 0, objectCount_, stride);
+        }
+        else if (multiDrawIndirect_) {
+            // Culled objects have instanceCount = 0
+            vkCmdDrawIndexedIndirect(commandBuffer, drawBuffers_[frame].buffer, 0, objectCount_, stride);
+        }
+        else {
+            for (uint32_t i = 0; i < objectCount_; i++) {
+                vkCmdDrawIndexedIndirect(commandBuffer, drawBuffers_[frame].buffer, stride * i, 1, stride);
+            }
+        }
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,134 @@
+﻿#pragma once
+#ifndef VFRAME_GPU_SCENE_HPP
+#define VFRAME_GPU_SCENE_HPP
+
+#include <vFrame/vf_scene_types.hpp>
+#include "vf_buffer.hpp"
+#include "vf_descriptors.hpp"
+#include "vf_pipeline_manager.hpp"
+#include "vf_resource_tracker.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // GPU-driven scene: per-object data, bounds and geometry live in GPU buffers.
+    // A compute pass culls against the frustum, picks a LOD and writes
+    // VkDrawIndexedIndirectCommand's, so the CPU cost per frame does not depend on the object count.
+    // Each object may sample one texture (SceneObjectDesc::texture) from an array of VF_MAX_SCENE_TEXTURES
+    // combined image samplers, written once per frame.
+    class GpuScene {
+    public:
+        struct Capacity {
+            uint32_t maxObjects = 65536;
+            uint32_t maxVertices = 1u << 20;
+            uint32_t maxIndices = 1u << 22;
+        };
+
+        // Both pipelines compile on the pipeline manager, the scene is not drawn until they are ready.
+        // Indirect buffers are registered in the tracker, recordCulling declares their uses there
+        GpuScene(const DeviceHandles& handles, PipelineManager& pipelines, DescriptorManager& descriptors,
+            ResourceTracker& tracker, const Capacity& capacity, uint32_t framesInFlight, bool drawIndirectCount, bool multiDrawIndirect, std::vector<char> cullShaderCode);
+        ~GpuScene();
+
+        GpuScene(const GpuScene&) = delete;
+        GpuScene& operator=(const GpuScene&) = delete;
+
+        // Graphics pipeline depends on the render pass, so it is requested again when the render pass format changes.
+        // depthFormat VK_FORMAT_UNDEFINED: the render pass has no depth attachment, the scene is drawn without depth test
+        void createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+            VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode);
+        // Compatible render pass recreated (same formats): the pipeline stays, later builds use the new one
+        void setRenderPass(VkRenderPass renderPass) { drawState_.renderPass = renderPass; }
+
+        // build* may run on any thread, swap* installs the result at a frame boundary (shader hot reload)
+        // and returns the previous pipeline, which the caller destroys once no frame in flight uses it
+        VkPipeline buildDrawPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const;
+        VkPipeline buildCullPipeline(const std::vector<char>& cullShaderCode) const;
+        VkPipeline swapDrawPipeline(VkPipeline pipeline);
+        VkPipeline swapCullPipeline(VkPipeline pipeline);
+
+        MeshRange uploadMesh(const SceneVertex* vertices, uint32_t vertexCount,
+            const uint32_t* indices, uint32_t indexCount);
+        uint32_t addObjects(const SceneObjectDesc* objects, uint32_t count);
+        void clearObjects();
+        void setCamera(const float viewProjection[16], const float cameraPosition[3]);
+
+        // Outside of the render pass: reset count, dispatch culling, indirect buffers end up ready for indirect read
+        void recordCulling(VkCommandBuffer commandBuffer, uint32_t frame);
+        // Inside the render pass. textures: VF_MAX_SCENE_TEXTURES slots, indexed by texture handle
+        void recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, const DescriptorData* textures);
+
+        uint32_t objectCount() const { return objectCount_; }
+
+    private:
+        // std430 mirror of ObjectData in cull.comp / scene.vert
+        struct GpuObjectData {
+            float model[16];
+            float sphere[4];
+            uint32_t lods[VF_MAX_MESH_LODS][4];
+            float lodDistances[VF_MAX_MESH_LODS];
+            uint32_t info[4];
+        };
+        static_assert(sizeof(GpuObjectData) == 176, "GpuObjectData must match the std430 layout in cull.comp");
+
+        // std430 mirror of CullParams in cull.comp
+        struct CullParams {
+            float planes[6][4];
+            float cameraPosition[4];
+            uint32_t objectCount;
+            uint32_t compact;
+            uint32_t padding[2];
+        };
+
+        struct CullPush {
+            VkDeviceAddress params;
+            VkDeviceAddress objects;
+            VkDeviceAddress draws;
+            VkDeviceAddress count;
+        };
+
+        struct DrawPush {
+            float viewProjection[16];
+            VkDeviceAddress vertices;
+            VkDeviceAddress objects;
+        };
+
+        VkShaderModule createShaderModule(const std::vector<char>& code) const;
+        void createPipelineLayouts();
+
+        DeviceHandles handles_;
+        PipelineManager& pipelines_;
+        DescriptorManager& descriptors_;
+        ResourceTracker& tracker_;
+        Capacity capacity_;
+        uint32_t framesInFlight_;
+        bool drawIndirectCount_;
+        bool multiDrawIndirect_;
+
+        GpuBuffer vertexBuffer_;
+        GpuBuffer indexBuffer_;
+        GpuBuffer objectBuffer_;
+        GpuBuffer paramsBuffer_;            // Host visible, one CullParams per frame in flight
+        std::vector<GpuBuffer> drawBuffers_; // One per frame in flight
+        std::vector<GpuBuffer> countBuffers_;
+
+        VkPipelineLayout cullPipelineLayout_ = VK_NULL_HANDLE;
+        PipelineHandle cullPipeline_ = VF_INVALID_PIPELINE;
+        std::unique_ptr<DescriptorLayout> textureLayout_;
+        VkPipelineLayout drawPipelineLayout_ = VK_NULL_HANDLE;
+        PipelineHandle drawPipeline_ = VF_INVALID_PIPELINE;
+        PipelineState drawState_;
+
+        uint32_t vertexCount_ = 0;
+        uint32_t indexCount_ = 0;
+        uint32_t objectCount_ = 0;
+
+        float viewProjection_[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+        CullParams cullParams_{};
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_GPU_SCENE_HPP
@@ -0,0 +1,77 @@
+﻿#include "vf_gpu_timer.hpp"
+
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    GpuTimer::GpuTimer(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight)
+        : device_(device)
+        , written_(framesInFlight, false)
+    {
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+        // No timestamps on this queue: the timer stays disabled and read() never reports anything
+        const uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+        if (validBits == 0) return;
+        validMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        period_ = properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2 * framesInFlight;
+
+        if (vkCreateQueryPool(device_, &poolInfo, nullptr, &pool_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    GpuTimer::~GpuTimer()
+    {
+        if (pool_ != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device_, pool_, nullptr);
+        }
+    }
+
+    void
+    GpuTimer::begin(VkCommandBuffer commandBuffer, uint32_t frame)
+    {
+        if (!supported()) return;
+
+        vkCmdResetQueryPool(commandBuffer, pool_, 2 * frame, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool_, 2 * frame);
+    }
+
+    void
+    GpuTimer::end(VkCommandBuffer commandBuffer, uint32_t frame)
+    {
+        if (!supported()) return;
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool_, 2 * frame + 1);
+        written_[frame] = true;
+    }
+
+    bool
+    GpuTimer::read(uint32_t frame, float& milliseconds)
+    {
+        if (!supported() || !written_[frame]) return false;
+
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(device_, pool_, 2 * frame, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+            return false;
+        }
+        written_[frame] = false;
+
+        const uint64_t ticks = ((timestamps[1] & validMask_) - (timestamps[0] & validMask_)) & validMask_;
+        milliseconds = static_cast<float>(static_cast<double>(ticks) * period_ / 1000000.0);
+        return true;
+    }
+
+} // namespace vf_vulkan
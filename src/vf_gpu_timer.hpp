@@ -0,0 +1,41 @@
+﻿#pragma once
+#ifndef VFRAME_GPU_TIMER_HPP
+#define VFRAME_GPU_TIMER_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // GPU time of a whole frame from two timestamps per frame in flight.
+    // Results are read after the fence of the frame slot was waited, so reading never stalls.
+    class GpuTimer {
+    public:
+        GpuTimer(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight);
+        ~GpuTimer();
+
+        GpuTimer(const GpuTimer&) = delete;
+        GpuTimer& operator=(const GpuTimer&) = delete;
+
+        bool supported() const { return pool_ != VK_NULL_HANDLE; }
+
+        // First and last commands of the frame's command buffer, outside of any render pass
+        void begin(VkCommandBuffer commandBuffer, uint32_t frame);
+        void end(VkCommandBuffer commandBuffer, uint32_t frame);
+
+        // False until the frame slot was recorded and executed once
+        bool read(uint32_t frame, float& milliseconds);
+
+    private:
+        VkDevice device_;
+        VkQueryPool pool_ = VK_NULL_HANDLE;
+        float period_ = 1.0f;      // Nanoseconds per tick
+        uint64_t validMask_ = ~0ull;
+        std::vector<bool> written_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_GPU_TIMER_HPP
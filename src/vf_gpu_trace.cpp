@@ -0,0 +1,207 @@
+﻿#include "vf_gpu_trace.hpp"
+
+#include <vFrame/vf_trace.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#endif
+
+namespace vf_vulkan {
+
+    namespace {
+
+        constexpr int64_t RECALIBRATE_NANOSECONDS = 1000000000; // GPU and CPU clocks drift apart slowly
+
+        // Host clock value in traceNow() units. steady_clock is CLOCK_MONOTONIC in libstdc++/libc++
+        // and QueryPerformanceCounter in the MSVC library, the two domains calibrated timestamps offer
+        int64_t
+        hostToTraceTime(uint64_t hostTimestamp)
+        {
+#ifdef _WIN32
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            const uint64_t perSecond = static_cast<uint64_t>(frequency.QuadPart);
+            return static_cast<int64_t>(hostTimestamp / perSecond * 1000000000ull +
+                hostTimestamp % perSecond * 1000000000ull / perSecond);
+#else
+            return static_cast<int64_t>(hostTimestamp);
+#endif
+        }
+
+    } // namespace
+
+    GpuTraceRecorder::GpuTraceRecorder(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device,
+        uint32_t queueFamily, uint32_t framesInFlight, const char* calibratedExtension)
+        : device_(device)
+        , frames_(framesInFlight)
+    {
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+        // No timestamps on this queue: zones are silently not recorded
+        const uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+        if (validBits == 0) return;
+        validMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        period_ = properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2 * MAX_ZONES_PER_FRAME * framesInFlight;
+
+        if (vkCreateQueryPool(device_, &poolInfo, nullptr, &pool_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create trace query pool!");
+        }
+
+        if (calibratedExtension == nullptr) return;
+
+        // KHR and EXT entry points are the same function, only the suffix differs
+        const std::string suffix = std::strcmp(calibratedExtension, VK_KHR_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0 ?
+            "KHR" : "EXT";
+        auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsKHR>(
+            vkGetInstanceProcAddr(instance, ("vkGetPhysicalDeviceCalibrateableTimeDomains" + suffix).c_str()));
+        auto getTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsKHR>(
+            vkGetDeviceProcAddr(device_, ("vkGetCalibratedTimestamps" + suffix).c_str()));
+        if (getTimeDomains == nullptr || getTimestamps == nullptr) return;
+
+#ifdef _WIN32
+        hostDomain_ = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_KHR;
+#else
+        hostDomain_ = VK_TIME_DOMAIN_CLOCK_MONOTONIC_KHR;
+#endif
+        uint32_t domainCount = 0;
+        getTimeDomains(physicalDevice, &domainCount, nullptr);
+        std::vector<VkTimeDomainKHR> domains(domainCount);
+        getTimeDomains(physicalDevice, &domainCount, domains.data());
+
+        bool hasDevice = false;
+        bool hasHost = false;
+        for (VkTimeDomainKHR domain : domains) {
+            hasDevice = hasDevice || domain == VK_TIME_DOMAIN_DEVICE_KHR;
+            hasHost = hasHost || domain == hostDomain_;
+        }
+        if (hasDevice && hasHost) {
+            getCalibratedTimestamps_ = getTimestamps;
+        }
+    }
+
+    GpuTraceRecorder::~GpuTraceRecorder()
+    {
+        if (pool_ != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device_, pool_, nullptr);
+        }
+    }
+
+    void
+    GpuTraceRecorder::beginFrame(VkCommandBuffer commandBuffer, uint32_t frame)
+    {
+        FrameZones& zones = frames_[frame];
+        zones.names.clear();
+        zones.recording = supported() && vf_core::traceEnabled();
+        if (!zones.recording) return;
+
+        vkCmdResetQueryPool(commandBuffer, pool_, 2 * MAX_ZONES_PER_FRAME * frame, 2 * MAX_ZONES_PER_FRAME);
+    }
+
+    uint32_t
+    GpuTraceRecorder::beginZone(VkCommandBuffer commandBuffer, uint32_t frame, const char* name)
+    {
+        FrameZones& zones = frames_[frame];
+        if (!zones.recording || zones.names.size() == MAX_ZONES_PER_FRAME) return NO_ZONE;
+
+        const uint32_t zone = static_cast<uint32_t>(zones.names.size());
+        zones.names.push_back(name);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool_,
+            2 * (MAX_ZONES_PER_FRAME * frame + zone));
+        return zone;
+    }
+
+    void
+    GpuTraceRecorder::endZone(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t zone)
+    {
+        if (zone == NO_ZONE) return;
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool_,
+            2 * (MAX_ZONES_PER_FRAME * frame + zone) + 1);
+    }
+
+    void
+    GpuTraceRecorder::submitted(uint32_t frame)
+    {
+        frames_[frame].submitTime = vf_core::traceNow();
+    }
+
+    void
+    GpuTraceRecorder::collect(uint32_t frame)
+    {
+        FrameZones& zones = frames_[frame];
+        if (!zones.recording || zones.names.empty()) return;
+        zones.recording = false;
+
+        // Every zone of a frame must have been closed, an open one would make the read fail
+        const uint32_t queryCount = 2 * static_cast<uint32_t>(zones.names.size());
+        uint64_t timestamps[2 * MAX_ZONES_PER_FRAME];
+        if (vkGetQueryPoolResults(device_, pool_, 2 * MAX_ZONES_PER_FRAME * frame, queryCount,
+            sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+            return;
+        }
+
+        if (calibrated()) {
+            const int64_t now = vf_core::traceNow();
+            if (lastCalibration_ == 0 || now - lastCalibration_ > RECALIBRATE_NANOSECONDS) {
+                calibrate();
+                lastCalibration_ = now;
+            }
+        }
+
+        // Uncalibrated: the frame starts on the GPU when it was submitted
+        const int64_t offset = calibrated() ? 0 : zones.submitTime - toHostTime(timestamps[0]);
+        for (uint32_t zone = 0; zone < zones.names.size(); zone++) {
+            vf_core::traceGpuZone(zones.names[zone], toHostTime(timestamps[2 * zone]) + offset,
+                toHostTime(timestamps[2 * zone + 1]) + offset);
+        }
+    }
+
+    void
+    GpuTraceRecorder::calibrate()
+    {
+        VkCalibratedTimestampInfoKHR infos[2]{};
+        infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_KHR;
+        infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_KHR;
+        infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_KHR;
+        infos[1].timeDomain = hostDomain_;
+
+        uint64_t values[2];
+        uint64_t maxDeviation;
+        if (getCalibratedTimestamps_(device_, 2, infos, values, &maxDeviation) != VK_SUCCESS) return;
+
+        calibrationTicks_ = values[0];
+        calibrationHostTime_ = hostToTraceTime(values[1]);
+    }
+
+    // Without calibration the result is only meaningful relative to other timestamps
+    int64_t
+    GpuTraceRecorder::toHostTime(uint64_t ticks) const
+    {
+        // Timestamps wrap at validMask_, a zone may also start before the calibration sample
+        uint64_t delta = (ticks - calibrationTicks_) & validMask_;
+        int64_t signedDelta = static_cast<int64_t>(delta);
+        if (delta > validMask_ / 2) {
+            signedDelta = -static_cast<int64_t>((validMask_ - delta) + 1);
+        }
+        return calibrationHostTime_ + static_cast<int64_t>(static_cast<double>(signedDelta) * period_);
+    }
+
+} // namespace vf_vulkan
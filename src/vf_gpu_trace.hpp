@@ -0,0 +1,72 @@
+﻿#pragma once
+#ifndef VFRAME_GPU_TRACE_HPP
+#define VFRAME_GPU_TRACE_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Named GPU zones of the frame command buffer, handed to the trace (vf_trace.hpp) in CPU time.
+    // Timestamps are only written while a trace capture runs, and read back after the fence of the
+    // frame slot was waited, like GpuTimer.
+    //
+    // With calibrated timestamps (VK_KHR_calibrated_timestamps or the EXT) GPU ticks are mapped through
+    // a (GPU, host clock) pair sampled at most once a second. Without them the first zone of a frame
+    // is placed at the time of its submit, so only durations and order within a frame are exact.
+    class GpuTraceRecorder {
+    public:
+        static constexpr uint32_t NO_ZONE = ~0u;
+
+        // calibratedExtension: name of the enabled calibrated timestamps extension, nullptr when neither is
+        GpuTraceRecorder(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily,
+            uint32_t framesInFlight, const char* calibratedExtension);
+        ~GpuTraceRecorder();
+
+        GpuTraceRecorder(const GpuTraceRecorder&) = delete;
+        GpuTraceRecorder& operator=(const GpuTraceRecorder&) = delete;
+
+        bool supported() const { return pool_ != VK_NULL_HANDLE; }
+        bool calibrated() const { return getCalibratedTimestamps_ != nullptr; }
+
+        // First command of the frame's command buffer, outside of a render pass
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+        // name must be a string literal. Zones may be inside render passes and may nest
+        uint32_t beginZone(VkCommandBuffer commandBuffer, uint32_t frame, const char* name);
+        void endZone(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t zone);
+        // Right after vkQueueSubmit of the frame
+        void submitted(uint32_t frame);
+
+        // After the fence of the frame slot was waited: zones go to the trace
+        void collect(uint32_t frame);
+
+    private:
+        static constexpr uint32_t MAX_ZONES_PER_FRAME = 32;
+
+        struct FrameZones {
+            std::vector<const char*> names;
+            bool recording = false;
+            int64_t submitTime = 0;
+        };
+
+        void calibrate();
+        int64_t toHostTime(uint64_t ticks) const;
+
+        VkDevice device_;
+        VkQueryPool pool_ = VK_NULL_HANDLE;
+        double period_ = 1.0;           // Nanoseconds per tick
+        uint64_t validMask_ = ~0ull;
+        std::vector<FrameZones> frames_;
+
+        PFN_vkGetCalibratedTimestampsKHR getCalibratedTimestamps_ = nullptr;
+        VkTimeDomainKHR hostDomain_ = VK_TIME_DOMAIN_CLOCK_MONOTONIC_KHR;
+        uint64_t calibrationTicks_ = 0;
+        int64_t calibrationHostTime_ = 0;
+        int64_t lastCalibration_ = 0;   // traceNow() of the last calibration, 0 before the first
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_GPU_TRACE_HPP
@@ -0,0 +1,284 @@
+﻿#include "vf_ktx2.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        // Fixed part of the file: identifier, header and index (section 3.1 - 3.3 of the spec)
+        struct Ktx2Header {
+            uint8_t identifier[12];
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t layerCount;
+            uint32_t faceCount;
+            uint32_t levelCount;
+            uint32_t supercompressionScheme;
+            uint32_t dfdByteOffset;
+            uint32_t dfdByteLength;
+            uint32_t kvdByteOffset;
+            uint32_t kvdByteLength;
+            uint64_t sgdByteOffset;
+            uint64_t sgdByteLength;
+        };
+        static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the KTX2 file layout");
+
+        struct Ktx2LevelIndex {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+
+        bool
+        inRange(VkFormat format, VkFormat first, VkFormat last)
+        {
+            return format >= first && format <= last;
+        }
+
+        // RGB565 -> 8 bit per channel
+        void
+        unpack565(uint16_t color, uint8_t out[4])
+        {
+            uint8_t r = static_cast<uint8_t>((color >> 11) & 0x1F);
+            uint8_t g = static_cast<uint8_t>((color >> 5) & 0x3F);
+            uint8_t b = static_cast<uint8_t>(color & 0x1F);
+            out[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+            out[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+            out[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+            out[3] = 255;
+        }
+
+        // Colour part shared by BC1/BC2/BC3. BC2/BC3 always use the four colour mode.
+        void
+        decodeColorBlock(const uint8_t* block, bool allowPunchThrough, bool keepAlpha, uint8_t texels[16][4])
+        {
+            uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+            uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+            uint32_t indices = static_cast<uint32_t>(block[4]) | (static_cast<uint32_t>(block[5]) << 8) |
+                (static_cast<uint32_t>(block[6]) << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+            uint8_t palette[4][4];
+            unpack565(c0, palette[0]);
+            unpack565(c1, palette[1]);
+
+            if (c0 > c1 || !allowPunchThrough) {
+                for (int k = 0; k < 3; k++) {
+                    palette[2][k] = static_cast<uint8_t>((2 * palette[0][k] + palette[1][k]) / 3);
+                    palette[3][k] = static_cast<uint8_t>((palette[0][k] + 2 * palette[1][k]) / 3);
+                }
+                palette[2][3] = 255;
+                palette[3][3] = 255;
+            }
+            else {
+                for (int k = 0; k < 3; k++) {
+                    palette[2][k] = static_cast<uint8_t>((palette[0][k] + palette[1][k]) / 2);
+                    palette[3][k] = 0;
+                }
+                palette[2][3] = 255;
+                palette[3][3] = keepAlpha ? 0 : 255; // BC1 RGB formats ignore the punch-through alpha
+            }
+
+            for (int i = 0; i < 16; i++) {
+                std::memcpy(texels[i], palette[(indices >> (2 * i)) & 3], 4);
+            }
+        }
+
+        // BC3 alpha: two endpoints and 3 bit indices
+        void
+        decodeAlphaBlock(const uint8_t* block, uint8_t texels[16][4])
+        {
+            uint8_t a[8];
+            a[0] = block[0];
+            a[1] = block[1];
+            if (a[0] > a[1]) {
+                for (int i = 1; i < 7; i++) {
+                    a[i + 1] = static_cast<uint8_t>(((7 - i) * a[0] + i * a[1]) / 7);
+                }
+            }
+            else {
+                for (int i = 1; i < 5; i++) {
+                    a[i + 1] = static_cast<uint8_t>(((5 - i) * a[0] + i * a[1]) / 5);
+                }
+                a[6] = 0;
+                a[7] = 255;
+            }
+
+            uint64_t bits = 0;
+            for (int i = 0; i < 6; i++) {
+                bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+            }
+            for (int i = 0; i < 16; i++) {
+                texels[i][3] = a[(bits >> (3 * i)) & 7];
+            }
+        }
+
+    } // namespace
+
+    Ktx2Texture
+    parseKtx2(const uint8_t* data, size_t size, const std::string& filename)
+    {
+        if (size < sizeof(Ktx2Header)) {
+            throw std::runtime_error("invalid KTX2 file: " + filename);
+        }
+
+        Ktx2Header header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+            throw std::runtime_error("invalid KTX2 file: " + filename);
+        }
+
+        if (header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0) {
+            throw std::runtime_error("supercompressed KTX2 textures are not supported: " + filename);
+        }
+        if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 ||
+            header.pixelWidth == 0 || header.pixelHeight == 0) {
+            throw std::runtime_error("only 2D KTX2 textures are supported: " + filename);
+        }
+
+        Ktx2Texture texture;
+        texture.format = static_cast<VkFormat>(header.vkFormat);
+        texture.width = header.pixelWidth;
+        texture.height = header.pixelHeight;
+
+        if (formatBlock(texture.format).bytes == 0) {
+            throw std::runtime_error("unsupported KTX2 texture format: " + filename);
+        }
+
+        // levelCount 0 asks the loader to generate mips, we just use the single level
+        const uint32_t levelCount = std::max(header.levelCount, 1u);
+        uint32_t maxLevels = 0;
+        for (uint32_t extent = std::max(texture.width, texture.height); extent > 0; extent >>= 1) {
+            maxLevels++;
+        }
+        if (levelCount > maxLevels || sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex) > size) {
+            throw std::runtime_error("corrupted KTX2 file: " + filename);
+        }
+
+        texture.levels.resize(levelCount);
+        for (uint32_t i = 0; i < levelCount; i++) {
+            Ktx2LevelIndex index;
+            std::memcpy(&index, data + sizeof(Ktx2Header) + i * sizeof(Ktx2LevelIndex), sizeof(index));
+
+            uint32_t w = std::max(texture.width >> i, 1u);
+            uint32_t h = std::max(texture.height >> i, 1u);
+            // Subtract form: a crafted offset must not wrap the sum around
+            if (index.byteOffset > size || index.byteLength > size - index.byteOffset ||
+                index.byteLength < levelByteSize(texture.format, w, h)) {
+                throw std::runtime_error("corrupted KTX2 file: " + filename);
+            }
+            texture.levels[i].byteOffset = index.byteOffset;
+            texture.levels[i].byteLength = index.byteLength;
+        }
+
+        return texture;
+    }
+
+    FormatBlock
+    formatBlock(VkFormat format)
+    {
+        if (format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB) {
+            return { 1, 1, 4 };
+        }
+        if (inRange(format, VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK) ||
+            inRange(format, VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC4_SNORM_BLOCK) ||
+            inRange(format, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK) ||
+            inRange(format, VK_FORMAT_EAC_R11_UNORM_BLOCK, VK_FORMAT_EAC_R11_SNORM_BLOCK)) {
+            return { 4, 4, 8 };
+        }
+        if (inRange(format, VK_FORMAT_BC2_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK) ||
+            inRange(format, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK) ||
+            inRange(format, VK_FORMAT_EAC_R11G11_UNORM_BLOCK, VK_FORMAT_EAC_R11G11_SNORM_BLOCK)) {
+            return { 4, 4, 16 };
+        }
+        if (inRange(format, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK)) {
+            // UNORM/SRGB pairs in the order of VkFormat
+            static const uint8_t astcBlocks[14][2] = {
+                { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+                { 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+            };
+            const uint8_t* block = astcBlocks[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+            return { block[0], block[1], 16 };
+        }
+        return { 0, 0, 0 };
+    }
+
+    uint64_t
+    levelByteSize(VkFormat format, uint32_t width, uint32_t height)
+    {
+        FormatBlock block = formatBlock(format);
+        uint64_t blocksX = (width + block.width - 1) / block.width;
+        uint64_t blocksY = (height + block.height - 1) / block.height;
+        return blocksX * blocksY * block.bytes;
+    }
+
+    VkFormat
+    decodedFormat(VkFormat format)
+    {
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        default:
+            return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    void
+    decodeBlocksToRgba8(VkFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst)
+    {
+        const bool bc1 = inRange(format, VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK);
+        const bool bc1Alpha = format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+        const bool bc2 = format == VK_FORMAT_BC2_UNORM_BLOCK || format == VK_FORMAT_BC2_SRGB_BLOCK;
+        const uint32_t blockBytes = bc1 ? 8 : 16;
+
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+
+        uint8_t texels[16][4];
+        for (uint32_t by = 0; by < blocksY; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                const uint8_t* block = src + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+
+                if (bc1) {
+                    decodeColorBlock(block, true, bc1Alpha, texels);
+                }
+                else {
+                    decodeColorBlock(block + 8, false, false, texels);
+                    if (bc2) {
+                        for (int i = 0; i < 16; i++) {
+                            uint8_t alpha = static_cast<uint8_t>((block[i / 2] >> (4 * (i % 2))) & 0xF);
+                            texels[i][3] = static_cast<uint8_t>(alpha * 17);
+                        }
+                    }
+                    else {
+                        decodeAlphaBlock(block, texels);
+                    }
+                }
+
+                // Blocks on the right/bottom edge may hang over the image
+                for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+                    for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+                        size_t offset = (static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4;
+                        std::memcpy(dst + offset, texels[y * 4 + x], 4);
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,49 @@
+﻿#pragma once
+#ifndef VFRAME_KTX2_HPP
+#define VFRAME_KTX2_HPP
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Parsed KTX2 container (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html).
+    // Level data is not copied: offsets point into the mapped file.
+    struct Ktx2Level {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+    };
+
+    struct Ktx2Texture {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<Ktx2Level> levels; // levels[0] is the full resolution mip
+    };
+
+    // Only 2D textures without supercompression are accepted (BCn, ASTC, ETC2 or RGBA8 payloads).
+    // Basis Universal (vkFormat 0 / BasisLZ) needs a transcoder that V-Frame does not ship.
+    Ktx2Texture parseKtx2(const uint8_t* data, size_t size, const std::string& filename);
+
+    struct FormatBlock {
+        uint32_t width;  // Texels per block
+        uint32_t height;
+        uint32_t bytes;  // Bytes per block
+    };
+
+    // Block layout of the formats accepted by parseKtx2
+    FormatBlock formatBlock(VkFormat format);
+
+    uint64_t levelByteSize(VkFormat format, uint32_t width, uint32_t height);
+
+    // CPU fallback for devices without textureCompressionBC: BC1/BC2/BC3 are decoded to RGBA8.
+    // Returns VK_FORMAT_UNDEFINED when the format cannot be decoded.
+    VkFormat decodedFormat(VkFormat format);
+    void decodeBlocksToRgba8(VkFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst);
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_KTX2_HPP
@@ -0,0 +1,430 @@
+﻿#include <vFrame/vf_log.hpp>
+#include <vFrame/vf_log_format.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vf_core {
+
+    namespace {
+
+        constexpr uint32_t RING_BYTES = 1 << 16;          // Per thread, power of two
+        constexpr uint32_t MAX_MESSAGE_BYTES = 4096;      // Longer messages are truncated
+        constexpr uint32_t PADDING_LEVEL = 0xFFFFFFFFu;   // Fills the end of the ring when a record would wrap
+        constexpr auto WRITER_INTERVAL = std::chrono::milliseconds(10);
+        constexpr uint64_t NOT_WRITING = ~0ull;
+
+        // Ring entry, followed by messageLength bytes and aligned to 8. A padding entry is only size + level.
+        struct RingRecord {
+            uint32_t size;
+            uint32_t level;
+            uint64_t sequence;
+            int64_t nanoseconds;
+            const char* category;
+            uint32_t messageLength;
+            uint32_t reserved;
+        };
+
+        // Single producer (its thread), single consumer (whoever holds LogState::drainMutex).
+        // head and tail only grow, the position in data is the value masked.
+        struct ThreadRing {
+            uint32_t threadId = 0;
+            std::atomic<uint64_t> head{ 0 };
+            std::atomic<uint64_t> tail{ 0 };
+            std::atomic<bool> closed{ false }; // Thread exited, removed once drained
+            std::atomic<uint64_t> writing{ NOT_WRITING }; // Lower bound of the sequence being pushed
+            alignas(8) unsigned char data[RING_BYTES];
+        };
+
+        struct PendingRecord {
+            uint64_t sequence;
+            int64_t nanoseconds;
+            const char* category;
+            uint32_t threadId;
+            uint32_t level;
+            std::string message;
+        };
+
+        const char*
+        levelName(uint32_t level)
+        {
+            switch (static_cast<LogLevel>(level)) {
+            case LogLevel::VERBOSE: return "VERBOSE";
+            case LogLevel::INFO:    return "INFO";
+            case LogLevel::WARNING: return "WARNING";
+            case LogLevel::SEVERE:  return "SEVERE";
+            }
+            return "?";
+        }
+
+        class LogState {
+        public:
+            std::atomic<uint32_t> minimumLevel{ static_cast<uint32_t>(LogLevel::INFO) };
+            std::atomic<bool> console{ true };
+            std::atomic<uint64_t> sequence{ 0 };
+            std::atomic<uint64_t> dropped{ 0 };
+            const int64_t startTime = traceNow();
+
+            LogState()
+            {
+                writer_ = std::thread([this] { writerLoop(); });
+            }
+
+            ~LogState()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(wakeMutex_);
+                    stop_ = true;
+                }
+                wake_.notify_one();
+                if (writer_.joinable()) writer_.join();
+
+                std::lock_guard<std::mutex> lock(drainMutex_);
+                drainLocked(true);
+                closeFileLocked();
+            }
+
+            std::shared_ptr<ThreadRing>
+            registerRing()
+            {
+                auto ring = std::make_shared<ThreadRing>();
+                std::lock_guard<std::mutex> lock(ringsMutex_);
+                ring->threadId = nextThreadId_++;
+                rings_.push_back(ring);
+                return ring;
+            }
+
+            void
+            wakeWriter()
+            {
+                wake_.notify_one();
+            }
+
+            void
+            flush()
+            {
+                std::unique_lock<std::mutex> lock(drainMutex_);
+                drainLoggedBefore(lock);
+            }
+
+            void
+            openFile(const char* filename)
+            {
+                std::FILE* file = std::fopen(filename, "wb");
+                if (file == nullptr) {
+                    throw std::runtime_error("failed to open log file!");
+                }
+                const VfLogFileHeader header{ VF_LOG_MAGIC, VF_LOG_VERSION, traceNow() };
+                std::fwrite(&header, sizeof(header), 1, file);
+
+                // Everything already logged goes to the previous sinks
+                std::unique_lock<std::mutex> lock(drainMutex_);
+                drainLoggedBefore(lock);
+                closeFileLocked();
+                file_ = file;
+            }
+
+            void
+            closeFile()
+            {
+                std::unique_lock<std::mutex> lock(drainMutex_);
+                drainLoggedBefore(lock);
+                closeFileLocked();
+            }
+
+        private:
+            void
+            writerLoop()
+            {
+                traceSetThreadName("vFrame log");
+                std::unique_lock<std::mutex> wakeLock(wakeMutex_);
+                while (!stop_) {
+                    wake_.wait_for(wakeLock, WRITER_INTERVAL);
+                    wakeLock.unlock();
+                    {
+                        std::lock_guard<std::mutex> lock(drainMutex_);
+                        drainLocked();
+                    }
+                    wakeLock.lock();
+                }
+            }
+
+            // Another thread may sit between taking a sequence and pushing its record, drainLocked
+            // holds the newer records back until it lands. That is a few instructions, so just retry
+            void
+            drainLoggedBefore(std::unique_lock<std::mutex>& lock)
+            {
+                const uint64_t target = sequence.load(std::memory_order_seq_cst);
+                while (drainLocked() < target) {
+                    lock.unlock();
+                    std::this_thread::yield();
+                    lock.lock();
+                }
+            }
+
+            // Writes the records below the returned sequence, every lower sequence is in a ring already.
+            // Newer ones wait in pending_ for the next drain, otherwise a record pushed late by one thread
+            // would be written after newer records of another thread
+            uint64_t
+            drainLocked(bool everything = false)
+            {
+                // Before the ring list: a thread that took a lower sequence has registered its ring
+                uint64_t limit = sequence.load(std::memory_order_seq_cst);
+
+                std::vector<std::shared_ptr<ThreadRing>> rings;
+                {
+                    std::lock_guard<std::mutex> lock(ringsMutex_);
+                    // Exited threads wrote their last record before closing
+                    rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<ThreadRing>& ring) {
+                        return ring->closed.load(std::memory_order_acquire) &&
+                            ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+                    }), rings_.end());
+                    rings = rings_;
+                }
+
+                // Before the rings are read: a thread seen writing here may push right after its ring was read
+                for (const std::shared_ptr<ThreadRing>& ring : rings) {
+                    limit = std::min(limit, ring->writing.load(std::memory_order_seq_cst));
+                }
+                if (everything) limit = NOT_WRITING;
+
+                for (const std::shared_ptr<ThreadRing>& ring : rings) {
+                    readRing(*ring);
+                }
+                if (pending_.empty()) return limit;
+
+                // Each ring is ordered already, merging them restores the order of the calls
+                std::sort(pending_.begin(), pending_.end(), [](const PendingRecord& a, const PendingRecord& b) {
+                    return a.sequence < b.sequence;
+                });
+                const auto ready = std::find_if(pending_.begin(), pending_.end(), [limit](const PendingRecord& record) {
+                    return record.sequence >= limit;
+                });
+                if (ready == pending_.begin()) return limit;
+
+                const bool toConsole = console.load(std::memory_order_relaxed);
+                for (auto record = pending_.begin(); record != ready; ++record) {
+                    if (toConsole) writeConsole(*record);
+                    if (file_ != nullptr) writeFile(*record);
+                }
+                pending_.erase(pending_.begin(), ready);
+                if (toConsole) {
+                    std::fflush(stdout);
+                    std::fflush(stderr);
+                }
+                if (file_ != nullptr) std::fflush(file_);
+                return limit;
+            }
+
+            void
+            readRing(ThreadRing& ring)
+            {
+                uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+                const uint64_t head = ring.head.load(std::memory_order_acquire);
+                while (tail < head) {
+                    const unsigned char* entry = ring.data + (tail & (RING_BYTES - 1));
+                    uint32_t prefix[2];
+                    std::memcpy(prefix, entry, sizeof(prefix));
+                    if (prefix[1] != PADDING_LEVEL) {
+                        RingRecord record;
+                        std::memcpy(&record, entry, sizeof(record));
+                        pending_.push_back({ record.sequence, record.nanoseconds, record.category, ring.threadId, record.level,
+                            std::string(reinterpret_cast<const char*>(entry + sizeof(RingRecord)), record.messageLength) });
+                    }
+                    tail += prefix[0];
+                }
+                ring.tail.store(tail, std::memory_order_release);
+            }
+
+            void
+            writeConsole(const PendingRecord& record)
+            {
+                std::FILE* stream = record.level >= static_cast<uint32_t>(LogLevel::WARNING) ? stderr : stdout;
+                std::fprintf(stream, "[%10.6f] [%u] %s %s: %s\n", (record.nanoseconds - startTime) / 1e9, record.threadId,
+                    levelName(record.level), record.category, record.message.c_str());
+            }
+
+            void
+            writeFile(const PendingRecord& record)
+            {
+                VfLogRecord header{};
+                header.nanoseconds = record.nanoseconds;
+                header.sequence = record.sequence;
+                header.threadId = record.threadId;
+                header.level = record.level;
+                header.categoryLength = static_cast<uint32_t>(std::strlen(record.category));
+                header.messageLength = static_cast<uint32_t>(record.message.size());
+                std::fwrite(&header, sizeof(header), 1, file_);
+                std::fwrite(record.category, 1, header.categoryLength, file_);
+                std::fwrite(record.message.data(), 1, header.messageLength, file_);
+            }
+
+            void
+            closeFileLocked()
+            {
+                if (file_ == nullptr) return;
+                std::fclose(file_);
+                file_ = nullptr;
+            }
+
+            std::mutex ringsMutex_;
+            std::vector<std::shared_ptr<ThreadRing>> rings_;
+            uint32_t nextThreadId_ = 1;
+
+            std::mutex drainMutex_;                // Ring consumers and sinks
+            std::vector<PendingRecord> pending_;   // Read from the rings, not written yet
+            std::FILE* file_ = nullptr;
+
+            std::mutex wakeMutex_;
+            std::condition_variable wake_;
+            bool stop_ = false;
+            std::thread writer_;
+        };
+
+        LogState&
+        state()
+        {
+            static LogState logState;
+            return logState;
+        }
+
+        // Marks the ring closed when its thread exits, the writer drops it after the last drain
+        struct LocalRing {
+            std::shared_ptr<ThreadRing> ring;
+
+            ~LocalRing()
+            {
+                if (ring) ring->closed.store(true, std::memory_order_release);
+            }
+        };
+
+        thread_local LocalRing localRing;
+
+        ThreadRing&
+        threadRing()
+        {
+            if (!localRing.ring) {
+                localRing.ring = state().registerRing();
+            }
+            return *localRing.ring;
+        }
+
+        bool
+        push(LogState& log, ThreadRing& ring, const RingRecord& record, const char* message)
+        {
+            const uint64_t head = ring.head.load(std::memory_order_relaxed);
+            const uint32_t position = static_cast<uint32_t>(head & (RING_BYTES - 1));
+            const uint32_t contiguous = RING_BYTES - position;
+            const uint32_t padding = contiguous < record.size ? contiguous : 0;
+
+            if (head + padding + record.size - ring.tail.load(std::memory_order_acquire) > RING_BYTES) {
+                log.dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            unsigned char* entry = ring.data + position;
+            if (padding != 0) {
+                const uint32_t prefix[2] = { padding, PADDING_LEVEL };
+                std::memcpy(entry, prefix, sizeof(prefix));
+                entry = ring.data;
+            }
+            std::memcpy(entry, &record, sizeof(record));
+            std::memcpy(entry + sizeof(record), message, record.messageLength);
+            ring.head.store(head + padding + record.size, std::memory_order_release);
+            return true;
+        }
+
+    } // namespace
+
+    void
+    logWrite(LogLevel level, const char* category, const char* format, ...)
+    {
+        LogState& log = state();
+        if (static_cast<uint32_t>(level) < log.minimumLevel.load(std::memory_order_relaxed)) return;
+
+        char message[MAX_MESSAGE_BYTES];
+        va_list args;
+        va_start(args, format);
+        const int written = std::vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+        if (written < 0) return;
+
+        RingRecord record{};
+        record.messageLength = std::min(static_cast<uint32_t>(written), MAX_MESSAGE_BYTES - 1);
+        record.size = (static_cast<uint32_t>(sizeof(RingRecord)) + record.messageLength + 7u) & ~7u;
+        record.level = static_cast<uint32_t>(level);
+        record.nanoseconds = traceNow();
+        record.category = category;
+
+        // Published before the sequence is taken, cleared once the record is in the ring:
+        // the writer holds newer records back meanwhile (see LogState::drainLocked)
+        ThreadRing& ring = threadRing();
+        ring.writing.store(log.sequence.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+        record.sequence = log.sequence.fetch_add(1, std::memory_order_seq_cst);
+        const bool pushed = push(log, ring, record, message);
+        ring.writing.store(NOT_WRITING, std::memory_order_release);
+        if (!pushed) return;
+
+        // Warnings and errors should not wait for the next writer tick (e.g. right before a crash),
+        // neither should a burst that already filled half of the ring
+        const uint64_t used = ring.head.load(std::memory_order_relaxed) - ring.tail.load(std::memory_order_relaxed);
+        if (level >= LogLevel::WARNING || used > RING_BYTES / 2) {
+            log.wakeWriter();
+        }
+    }
+
+    void
+    logSetLevel(LogLevel minimum)
+    {
+        state().minimumLevel.store(static_cast<uint32_t>(minimum), std::memory_order_relaxed);
+    }
+
+    LogLevel
+    logLevel()
+    {
+        return static_cast<LogLevel>(state().minimumLevel.load(std::memory_order_relaxed));
+    }
+
+    void
+    logSetConsole(bool enabled)
+    {
+        state().console.store(enabled, std::memory_order_relaxed);
+    }
+
+    void
+    logOpenBinaryFile(const char* filename)
+    {
+        state().openFile(filename);
+    }
+
+    void
+    logCloseBinaryFile()
+    {
+        state().closeFile();
+    }
+
+    void
+    logFlush()
+    {
+        state().flush();
+    }
+
+    uint64_t
+    logDroppedCount()
+    {
+        return state().dropped.load(std::memory_order_relaxed);
+    }
+
+} // namespace vf_core
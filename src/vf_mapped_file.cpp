@@ -0,0 +1,141 @@
+﻿#include "vf_mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace vf_vulkan {
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::string& filename)
+    {
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("failed to open file: " + filename);
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("failed to get file size: " + filename);
+        }
+
+        fileHandle_ = file;
+        size_ = static_cast<size_t>(fileSize.QuadPart);
+        if (size_ == 0) {
+            return; // Empty file can't be mapped, data() stays nullptr
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            close();
+            throw std::runtime_error("failed to map file: " + filename);
+        }
+        mappingHandle_ = mapping;
+
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data_ == nullptr) {
+            close();
+            throw std::runtime_error("failed to map view of file: " + filename);
+        }
+    }
+
+    void
+    MappedFile::close()
+    {
+        if (data_ != nullptr) {
+            UnmapViewOfFile(data_);
+        }
+        if (mappingHandle_ != nullptr) {
+            CloseHandle(static_cast<HANDLE>(mappingHandle_));
+        }
+        if (fileHandle_ != nullptr) {
+            CloseHandle(static_cast<HANDLE>(fileHandle_));
+        }
+        data_ = nullptr;
+        size_ = 0;
+        mappingHandle_ = nullptr;
+        fileHandle_ = nullptr;
+    }
+#else
+    MappedFile::MappedFile(const std::string& filename)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open file: " + filename);
+        }
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0) {
+            ::close(fd);
+            throw std::runtime_error("failed to get file size: " + filename);
+        }
+
+        size_ = static_cast<size_t>(fileStat.st_size);
+        if (size_ == 0) {
+            ::close(fd);
+            return; // Empty file can't be mapped, data() stays nullptr
+        }
+
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // Mapping keeps its own reference to the file
+        if (mapped == MAP_FAILED) {
+            size_ = 0;
+            throw std::runtime_error("failed to map file: " + filename);
+        }
+
+        // Whole file is going to be copied front to back into staging memory
+        madvise(mapped, size_, MADV_SEQUENTIAL);
+        madvise(mapped, size_, MADV_WILLNEED);
+        data_ = static_cast<const uint8_t*>(mapped);
+    }
+
+    void
+    MappedFile::close()
+    {
+        if (data_ != nullptr) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+#endif
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile&
+    MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+#ifdef _WIN32
+            std::swap(fileHandle_, other.fileHandle_);
+            std::swap(mappingHandle_, other.mappingHandle_);
+#endif
+        }
+        return *this;
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,42 @@
+﻿#pragma once
+#ifndef VFRAME_MAPPED_FILE_HPP
+#define VFRAME_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vf_vulkan {
+
+    // Read-only memory mapped file (mmap / MapViewOfFile).
+    // Pages are faulted in by the OS on first touch, so copying straight from data()
+    // into a staging buffer is the only copy between disk and GPU upload.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& filename);
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const uint8_t* data() const { return data_; }
+        size_t size() const { return size_; }
+        bool isOpen() const { return data_ != nullptr; }
+
+        void close();
+
+    private:
+        const uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        void* fileHandle_ = nullptr;
+        void* mappingHandle_ = nullptr;
+#endif
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_MAPPED_FILE_HPP
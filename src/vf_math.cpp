@@ -0,0 +1,221 @@
+﻿#include <vFrame/vf_math.hpp>
+#include "vf_cpu_features.hpp"
+
+namespace vf_core {
+
+    namespace {
+
+        using namespace detail;
+
+#ifdef VF_CPU_DISPATCH_X86
+        const bool hasAvx2 = cpuFeatures().avx2;
+
+        VF_TARGET_AVX2 void
+        transformPointsAvx2(const Mat4& m, const float* x, const float* y, const float* z,
+            float* outX, float* outY, float* outZ, size_t& i, size_t count)
+        {
+            const __m256 m00 = _mm256_set1_ps(m.columns[0].x), m01 = _mm256_set1_ps(m.columns[1].x);
+            const __m256 m02 = _mm256_set1_ps(m.columns[2].x), m03 = _mm256_set1_ps(m.columns[3].x);
+            const __m256 m10 = _mm256_set1_ps(m.columns[0].y), m11 = _mm256_set1_ps(m.columns[1].y);
+            const __m256 m12 = _mm256_set1_ps(m.columns[2].y), m13 = _mm256_set1_ps(m.columns[3].y);
+            const __m256 m20 = _mm256_set1_ps(m.columns[0].z), m21 = _mm256_set1_ps(m.columns[1].z);
+            const __m256 m22 = _mm256_set1_ps(m.columns[2].z), m23 = _mm256_set1_ps(m.columns[3].z);
+
+            for (; i + 8 <= count; i += 8) {
+                const __m256 px = _mm256_loadu_ps(x + i);
+                const __m256 py = _mm256_loadu_ps(y + i);
+                const __m256 pz = _mm256_loadu_ps(z + i);
+                _mm256_storeu_ps(outX + i, _mm256_fmadd_ps(m00, px, _mm256_fmadd_ps(m01, py, _mm256_fmadd_ps(m02, pz, m03))));
+                _mm256_storeu_ps(outY + i, _mm256_fmadd_ps(m10, px, _mm256_fmadd_ps(m11, py, _mm256_fmadd_ps(m12, pz, m13))));
+                _mm256_storeu_ps(outZ + i, _mm256_fmadd_ps(m20, px, _mm256_fmadd_ps(m21, py, _mm256_fmadd_ps(m22, pz, m23))));
+            }
+        }
+
+        // Two result columns per 256 bit register; shuffles broadcast within each 128 bit half
+        VF_TARGET_AVX2 void
+        multiplyAvx2(const Mat4& a, const Mat4& b, Mat4& out)
+        {
+            const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.columns[0].x));
+            const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.columns[1].x));
+            const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.columns[2].x));
+            const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.columns[3].x));
+
+            for (int column = 0; column < 4; column += 2) {
+                const __m256 bc = _mm256_loadu_ps(&b.columns[column].x);
+                __m256 result = _mm256_mul_ps(a0, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(0, 0, 0, 0)));
+                result = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(1, 1, 1, 1)), result);
+                result = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(2, 2, 2, 2)), result);
+                result = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(3, 3, 3, 3)), result);
+                _mm256_storeu_ps(&out.columns[column].x, result);
+            }
+        }
+
+        VF_TARGET_AVX2 void
+        multiplyMatricesAvx2(const Mat4* a, const Mat4* b, Mat4* out, size_t count)
+        {
+            for (size_t i = 0; i < count; i++) {
+                multiplyAvx2(a[i], b[i], out[i]);
+            }
+        }
+
+        VF_TARGET_AVX2 void
+        multiplyMatricesAvx2(const Mat4& a, const Mat4* b, Mat4* out, size_t count)
+        {
+            const Mat4 parent = a; // out may alias a
+            for (size_t i = 0; i < count; i++) {
+                multiplyAvx2(parent, b[i], out[i]);
+            }
+        }
+
+        VF_TARGET_AVX2 void
+        testSpheresAvx2(const Frustum& frustum, const float* x, const float* y, const float* z,
+            const float* radius, uint8_t* visible, size_t& i, size_t count)
+        {
+            __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (int p = 0; p < 6; p++) {
+                planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+                planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+                planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+                planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+            }
+
+            for (; i + 8 <= count; i += 8) {
+                const __m256 cx = _mm256_loadu_ps(x + i);
+                const __m256 cy = _mm256_loadu_ps(y + i);
+                const __m256 cz = _mm256_loadu_ps(z + i);
+                const __m256 r = _mm256_loadu_ps(radius + i);
+
+                // Smallest signed distance + radius over the planes, inside when >= 0
+                __m256 nearest = _mm256_set1_ps(1.0e30f);
+                for (int p = 0; p < 6; p++) {
+                    __m256 distance = _mm256_fmadd_ps(planeX[p], cx, _mm256_fmadd_ps(planeY[p], cy,
+                        _mm256_fmadd_ps(planeZ[p], cz, _mm256_add_ps(planeW[p], r))));
+                    nearest = _mm256_min_ps(nearest, distance);
+                }
+                const int mask = _mm256_movemask_ps(_mm256_cmp_ps(nearest, _mm256_setzero_ps(), _CMP_GE_OQ));
+                for (int k = 0; k < 8; k++) {
+                    visible[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+                }
+            }
+        }
+#endif
+
+    } // namespace
+
+    void
+    transformPoints(const Mat4& m, const float* x, const float* y, const float* z,
+        float* outX, float* outY, float* outZ, size_t count)
+    {
+        size_t i = 0;
+#ifdef VF_CPU_DISPATCH_X86
+        if (hasAvx2) {
+            transformPointsAvx2(m, x, y, z, outX, outY, outZ, i, count);
+        }
+#endif
+        // Four at a time, same instruction set as the single value operations
+        const Float4 m00 = splat4(m.columns[0].x), m01 = splat4(m.columns[1].x), m02 = splat4(m.columns[2].x), m03 = splat4(m.columns[3].x);
+        const Float4 m10 = splat4(m.columns[0].y), m11 = splat4(m.columns[1].y), m12 = splat4(m.columns[2].y), m13 = splat4(m.columns[3].y);
+        const Float4 m20 = splat4(m.columns[0].z), m21 = splat4(m.columns[1].z), m22 = splat4(m.columns[2].z), m23 = splat4(m.columns[3].z);
+        for (; i + 4 <= count; i += 4) {
+            const Float4 px = loadu4(x + i);
+            const Float4 py = loadu4(y + i);
+            const Float4 pz = loadu4(z + i);
+            storeu4(outX + i, madd4(m00, px, madd4(m01, py, madd4(m02, pz, m03))));
+            storeu4(outY + i, madd4(m10, px, madd4(m11, py, madd4(m12, pz, m13))));
+            storeu4(outZ + i, madd4(m20, px, madd4(m21, py, madd4(m22, pz, m23))));
+        }
+        for (; i < count; i++) {
+            const Vec3 p = transformPoint(m, Vec3{ x[i], y[i], z[i] });
+            outX[i] = p.x;
+            outY[i] = p.y;
+            outZ[i] = p.z;
+        }
+    }
+
+    void
+    multiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count)
+    {
+#ifdef VF_CPU_DISPATCH_X86
+        if (hasAvx2) {
+            multiplyMatricesAvx2(a, b, out, count);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; i++) {
+            out[i] = a[i] * b[i];
+        }
+    }
+
+    void
+    multiplyMatrices(const Mat4& a, const Mat4* b, Mat4* out, size_t count)
+    {
+#ifdef VF_CPU_DISPATCH_X86
+        if (hasAvx2) {
+            multiplyMatricesAvx2(a, b, out, count);
+            return;
+        }
+#endif
+        const Mat4 parent = a;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = parent * b[i];
+        }
+    }
+
+    void
+    testSpheres(const Frustum& frustum, const float* x, const float* y, const float* z,
+        const float* radius, uint8_t* visible, size_t count)
+    {
+        size_t i = 0;
+#ifdef VF_CPU_DISPATCH_X86
+        if (hasAvx2) {
+            testSpheresAvx2(frustum, x, y, z, radius, visible, i, count);
+        }
+#endif
+        Float4 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++) {
+            planeX[p] = splat4(frustum.planes[p].x);
+            planeY[p] = splat4(frustum.planes[p].y);
+            planeZ[p] = splat4(frustum.planes[p].z);
+            planeW[p] = splat4(frustum.planes[p].w);
+        }
+
+        for (; i + 4 <= count; i += 4) {
+            const Float4 cx = loadu4(x + i);
+            const Float4 cy = loadu4(y + i);
+            const Float4 cz = loadu4(z + i);
+            const Float4 r = loadu4(radius + i);
+
+            Float4 nearest = splat4(1.0e30f);
+            for (int p = 0; p < 6; p++) {
+                nearest = min4(nearest, madd4(planeX[p], cx, madd4(planeY[p], cy, madd4(planeZ[p], cz, add4(planeW[p], r)))));
+            }
+
+            alignas(16) float result[4];
+            store4(result, nearest);
+            for (size_t lane = 0; lane < 4; lane++) {
+                visible[i + lane] = result[lane] >= 0.0f ? 1 : 0;
+            }
+        }
+        for (; i < count; i++) {
+            visible[i] = intersectsSphere(frustum, Vec3{ x[i], y[i], z[i] }, radius[i]) ? 1 : 0;
+        }
+    }
+
+    const char*
+    mathBackend()
+    {
+#ifdef VF_CPU_DISPATCH_X86
+        if (hasAvx2) return "avx2";
+#endif
+#if defined(VF_MATH_SSE4)
+        return "sse4.1";
+#elif defined(VF_MATH_SSE)
+        return "sse2";
+#elif defined(VF_MATH_NEON)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+
+} // namespace vf_core
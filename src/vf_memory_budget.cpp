@@ -0,0 +1,122 @@
+﻿#include "vf_memory_budget.hpp"
+
+#include <algorithm>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        constexpr float DEFAULT_BUDGET_FRACTION = 0.8f; // Without the extension: what is safe to assume is ours
+        constexpr float WARNING_HYSTERESIS = 0.05f;     // A warning re-arms this far below its fraction
+
+    } // namespace
+
+    MemoryTracker::MemoryTracker(VkPhysicalDevice physicalDevice, bool memoryBudget)
+        : physicalDevice_(physicalDevice)
+        , memoryBudget_(memoryBudget)
+    {
+        VkPhysicalDeviceMemoryProperties properties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &properties);
+
+        for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+            typeToHeap_[i] = properties.memoryTypes[i].heapIndex;
+        }
+
+        stats_.budgetExtension = memoryBudget_;
+        stats_.heapCount = std::min(properties.memoryHeapCount, VF_MAX_MEMORY_HEAPS);
+        for (uint32_t i = 0; i < stats_.heapCount; i++) {
+            stats_.heaps[i].size = properties.memoryHeaps[i].size;
+            stats_.heaps[i].budget = static_cast<uint64_t>(properties.memoryHeaps[i].size * DEFAULT_BUDGET_FRACTION);
+            stats_.heaps[i].deviceLocal = (properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        }
+    }
+
+    void
+    MemoryTracker::allocated(VkDeviceMemory memory, MemoryCategory category, uint32_t memoryType, VkDeviceSize bytes)
+    {
+        const uint32_t heap = memoryType < VK_MAX_MEMORY_TYPES ? typeToHeap_[memoryType] : 0;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        allocations_[memory] = { category, heap, bytes };
+        stats_.categoryBytes[static_cast<uint32_t>(category)] += bytes;
+        if (heap < stats_.heapCount) {
+            stats_.heaps[heap].allocated += bytes;
+        }
+        stats_.allocationCount++;
+    }
+
+    void
+    MemoryTracker::freed(VkDeviceMemory memory)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = allocations_.find(memory);
+        if (it == allocations_.end()) return;
+
+        const Allocation& allocation = it->second;
+        stats_.categoryBytes[static_cast<uint32_t>(allocation.category)] -= allocation.bytes;
+        if (allocation.heap < stats_.heapCount) {
+            stats_.heaps[allocation.heap].allocated -= allocation.bytes;
+        }
+        stats_.allocationCount--;
+        allocations_.erase(it);
+    }
+
+    void
+    MemoryTracker::addWarning(float fraction, WarningCallback callback)
+    {
+        warnings_.push_back({ fraction, std::move(callback) });
+    }
+
+    void
+    MemoryTracker::update()
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+        budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        if (memoryBudget_) {
+            VkPhysicalDeviceMemoryProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            properties.pNext = &budget;
+            vkGetPhysicalDeviceMemoryProperties2(physicalDevice_, &properties);
+        }
+
+        MemoryStats snapshot;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            float pressure = 0.0f;
+            for (uint32_t i = 0; i < stats_.heapCount; i++) {
+                MemoryHeapStats& heap = stats_.heaps[i];
+                if (memoryBudget_) {
+                    heap.budget = budget.heapBudget[i];
+                    heap.usage = budget.heapUsage[i];
+                }
+                else {
+                    heap.usage = heap.allocated;
+                }
+                if (heap.deviceLocal && heap.budget > 0) {
+                    pressure = std::max(pressure, static_cast<float>(static_cast<double>(heap.usage) / heap.budget));
+                }
+            }
+            stats_.deviceLocalPressure = pressure;
+            snapshot = stats_;
+        }
+
+        // Callbacks run without the lock, they may allocate or free (e.g. lower the texture budget)
+        for (Warning& warning : warnings_) {
+            if (!warning.fired && snapshot.deviceLocalPressure >= warning.fraction) {
+                warning.fired = true;
+                warning.callback(snapshot);
+            }
+            else if (warning.fired && snapshot.deviceLocalPressure < warning.fraction - WARNING_HYSTERESIS) {
+                warning.fired = false;
+            }
+        }
+    }
+
+    MemoryStats
+    MemoryTracker::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+} // namespace vf_vulkan
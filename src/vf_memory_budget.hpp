@@ -0,0 +1,64 @@
+﻿#pragma once
+#ifndef VFRAME_MEMORY_BUDGET_HPP
+#define VFRAME_MEMORY_BUDGET_HPP
+
+#include <vulkan/vulkan.h>
+#include <vFrame/vf_scene_types.hpp>
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Device memory telemetry: every vkAllocateMemory of the engine is reported here with its category,
+    // heap budget and usage are refreshed once a frame (VK_EXT_memory_budget when the device has it).
+    // Warnings fire on the frame thread when the device local heaps get close to their budget.
+    class MemoryTracker {
+    public:
+        using WarningCallback = std::function<void(const MemoryStats&)>;
+
+        MemoryTracker(VkPhysicalDevice physicalDevice, bool memoryBudget);
+
+        MemoryTracker(const MemoryTracker&) = delete;
+        MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+        // Any thread
+        void allocated(VkDeviceMemory memory, MemoryCategory category, uint32_t memoryType, VkDeviceSize bytes);
+        void freed(VkDeviceMemory memory);
+
+        // Fires once when pressure rises to fraction (0..1 of the budget), again only after it dropped below
+        void addWarning(float fraction, WarningCallback callback);
+
+        // Frame boundary: new budget/usage from the driver, then the warnings
+        void update();
+
+        MemoryStats stats() const;
+
+    private:
+        struct Allocation {
+            MemoryCategory category;
+            uint32_t heap;
+            VkDeviceSize bytes;
+        };
+
+        struct Warning {
+            float fraction;
+            WarningCallback callback;
+            bool fired = false;
+        };
+
+        VkPhysicalDevice physicalDevice_;
+        bool memoryBudget_;
+        uint32_t typeToHeap_[VK_MAX_MEMORY_TYPES] = {};
+
+        mutable std::mutex mutex_;
+        std::unordered_map<VkDeviceMemory, Allocation> allocations_;
+        MemoryStats stats_;
+        std::vector<Warning> warnings_; // Frame thread only
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_MEMORY_BUDGET_HPP
@@ -0,0 +1,682 @@
+﻿#include "vf_particle_system.hpp"
+
+#include <vFrame/vf_math.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+        constexpr uint32_t SIMULATE_WORKGROUP_SIZE = 64; // local_size_x in particles.comp
+        constexpr uint32_t SORT_BLOCK = 512;             // Elements per workgroup in particle_sort.comp
+        constexpr float MAX_STEP = 0.1f;                 // Seconds, a hitch must not fling particles through walls
+        constexpr float COLLISION_THICKNESS = 0.5f;      // World units behind the depth buffer that count as solid
+
+        // Simulation passes (mode in particles.comp)
+        constexpr uint32_t MODE_SIMULATE = 0;
+        constexpr uint32_t MODE_EMIT = 1;
+        constexpr uint32_t MODE_FINALIZE = 2;
+        constexpr uint32_t MODE_SORT_KEYS = 3;
+
+        // Sort passes (mode in particle_sort.comp)
+        constexpr uint32_t SORT_LOCAL = 0;
+        constexpr uint32_t SORT_GLOBAL_STEP = 1;
+        constexpr uint32_t SORT_LOCAL_MERGE = 2;
+
+        uint32_t
+        nextPowerOfTwo(uint32_t value)
+        {
+            uint32_t result = 1;
+            while (result < value && result < 0x80000000u) {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        // Normal halves only: sizes below 2^-14 world units become 0
+        uint32_t
+        floatToHalf(float value)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            const uint32_t sign = (bits >> 16) & 0x8000u;
+            const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFFu) - 127 + 15;
+            const uint32_t mantissa = bits & 0x7FFFFFu;
+            if (exponent <= 0) return sign;
+            if (exponent >= 31) return sign | 0x7C00u;
+
+            uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+            if (mantissa & 0x1000u) half++; // Round to nearest, a carry into the exponent is still correct
+            return half;
+        }
+
+        uint32_t
+        packColor(const float color[4])
+        {
+            uint32_t packed = 0;
+            for (uint32_t i = 0; i < 4; i++) {
+                const float channel = std::min(std::max(color[i], 0.0f), 1.0f);
+                packed |= static_cast<uint32_t>(channel * 255.0f + 0.5f) << (8 * i);
+            }
+            return packed;
+        }
+
+        VkShaderModule
+        createShaderModule(VkDevice device, const std::vector<char>& code)
+        {
+            VkShaderModuleCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            createInfo.codeSize = code.size();
+            createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+            VkShaderModule shaderModule;
+            if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shader module!");
+            }
+            return shaderModule;
+        }
+
+        VkPipeline
+        createComputePipeline(const DeviceHandles& handles, VkPipelineLayout layout, const std::vector<char>& code,
+            const char* failure)
+        {
+            VkShaderModule module = createShaderModule(handles.device, code);
+
+            VkComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfo.stage.module = module;
+            pipelineInfo.stage.pName = "main";
+            pipelineInfo.layout = layout;
+
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            VkResult result = vkCreateComputePipelines(handles.device, handles.pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+            vkDestroyShaderModule(handles.device, module, nullptr);
+
+            if (result != VK_SUCCESS) {
+                throw std::runtime_error(failure);
+            }
+            return pipeline;
+        }
+
+        void
+        normalizedRow(const float matrix[16], uint32_t row, float result[4])
+        {
+            // Column major: row r of column c is matrix[c * 4 + r]
+            const float x = matrix[row], y = matrix[4 + row], z = matrix[8 + row];
+            const float length = std::sqrt(x * x + y * y + z * z);
+            const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+            result[0] = x * scale;
+            result[1] = y * scale;
+            result[2] = z * scale;
+            result[3] = 0.0f;
+        }
+    }
+
+    ParticleSystem::ParticleSystem(const DeviceHandles& handles, PipelineManager& pipelines, ResourceTracker& tracker,
+        const ParticleSettings& settings, uint32_t framesInFlight,
+        std::vector<char> simulateShaderCode, std::vector<char> sortShaderCode)
+        : handles_(handles)
+        , pipelines_(pipelines)
+        , tracker_(tracker)
+        , settings_(settings)
+        , framesInFlight_(framesInFlight)
+    {
+        settings_.maxParticles = std::max(settings_.maxParticles, 1u);
+        keyCapacity_ = std::max(nextPowerOfTwo(settings_.maxParticles), SORT_BLOCK);
+
+        const VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+        for (GpuBuffer& particles : particles_) {
+            particles = createBuffer(handles_, sizeof(GpuParticle) * settings_.maxParticles, storageUsage,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        counters_ = createBuffer(handles_, sizeof(uint32_t) * 2,
+            storageUsage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        arguments_ = createBuffer(handles_, sizeof(uint32_t) * 8,
+            storageUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (settings_.sortAlpha) {
+            keys_ = createBuffer(handles_, sizeof(uint32_t) * 2 * keyCapacity_, storageUsage,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        frameData_ = createBuffer(handles_, sizeof(FrameData) * framesInFlight_, storageUsage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        readback_ = createBuffer(handles_, sizeof(uint32_t) * framesInFlight_, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        std::memset(readback_.mapped, 0, sizeof(uint32_t) * framesInFlight_);
+
+        // No particles: both counts and the indirect arguments start at 0
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(handles_);
+        vkCmdFillBuffer(commandBuffer, counters_.buffer, 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(commandBuffer, arguments_.buffer, 0, VK_WHOLE_SIZE, 0);
+        endSingleTimeCommands(handles_, commandBuffer);
+
+        for (GpuBuffer& particles : particles_) {
+            tracker_.trackBuffer(particles.buffer);
+        }
+        tracker_.trackBuffer(counters_.buffer);
+        tracker_.trackBuffer(arguments_.buffer);
+        tracker_.trackBuffer(readback_.buffer);
+        if (keys_.buffer != VK_NULL_HANDLE) {
+            tracker_.trackBuffer(keys_.buffer);
+        }
+
+        slotSteps_.assign(framesInFlight_, 0);
+        stats_.maxParticles = settings_.maxParticles;
+        lastStep_ = std::chrono::steady_clock::now();
+
+        createPipelineLayouts();
+        simulatePipeline_ = pipelines_.request([this, code = std::move(simulateShaderCode)]() { return buildSimulatePipeline(code); });
+        if (settings_.sortAlpha) {
+            sortPipeline_ = pipelines_.request([this, code = std::move(sortShaderCode)]() { return buildSortPipeline(code); });
+        }
+    }
+
+    ParticleSystem::~ParticleSystem()
+    {
+        // Compiles in flight read the layouts, the pipelines themselves belong to the manager
+        pipelines_.waitIdle();
+
+        vkDestroyPipelineLayout(handles_.device, simulateLayout_, nullptr);
+        vkDestroyPipelineLayout(handles_.device, sortLayout_, nullptr);
+        vkDestroyPipelineLayout(handles_.device, drawLayout_, nullptr);
+
+        for (GpuBuffer* buffer : { &particles_[0], &particles_[1], &counters_, &arguments_, &readback_, &keys_, &depth_ }) {
+            if (buffer->buffer != VK_NULL_HANDLE) {
+                tracker_.forget(buffer->buffer);
+            }
+            destroyBuffer(handles_.device, *buffer);
+        }
+        destroyBuffer(handles_.device, frameData_);
+    }
+
+    // Layouts only describe push constants, they outlive every pipeline rebuild (swap chain, hot reload)
+    void
+    ParticleSystem::createPipelineLayouts()
+    {
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushRange.offset = 0;
+        pushRange.size = sizeof(SimulatePush);
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushRange;
+
+        if (vkCreatePipelineLayout(handles_.device, &layoutInfo, nullptr, &simulateLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create particle simulation pipeline layout!");
+        }
+
+        pushRange.size = sizeof(SortPush);
+        if (vkCreatePipelineLayout(handles_.device, &layoutInfo, nullptr, &sortLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create particle sort pipeline layout!");
+        }
+
+        pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushRange.size = sizeof(DrawPush);
+        if (vkCreatePipelineLayout(handles_.device, &layoutInfo, nullptr, &drawLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create particle pipeline layout!");
+        }
+    }
+
+    VkPipeline
+    ParticleSystem::buildSimulatePipeline(const std::vector<char>& shaderCode) const
+    {
+        return createComputePipeline(handles_, simulateLayout_, shaderCode, "failed to create particle simulation pipeline!");
+    }
+
+    VkPipeline
+    ParticleSystem::buildSortPipeline(const std::vector<char>& shaderCode) const
+    {
+        return createComputePipeline(handles_, sortLayout_, shaderCode, "failed to create particle sort pipeline!");
+    }
+
+    void
+    ParticleSystem::createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+        VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode)
+    {
+        // Hidden by the scene, never hide each other: sorted particles blend back to front, additive ones
+        // need no order at all
+        drawState_.vertexShader = ShaderCode::fromSpirv(std::move(vertShaderCode));
+        drawState_.fragmentShader = ShaderCode::fromSpirv(std::move(fragShaderCode));
+        drawState_.layout = drawLayout_;
+        drawState_.renderPass = renderPass;
+        drawState_.colorFormat = colorFormat;
+        drawState_.depthFormat = depthFormat;
+        drawState_.samples = samples;
+        drawState_.depthTest = depthFormat != VK_FORMAT_UNDEFINED;
+        drawState_.depthWrite = false;
+        drawState_.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        drawState_.cullMode = VK_CULL_MODE_NONE;
+        drawState_.blend = settings_.sortAlpha ? BlendMode::ALPHA : BlendMode::ADDITIVE;
+
+        drawPipeline_ = pipelines_.requestGraphics(drawState_);
+    }
+
+    VkPipeline
+    ParticleSystem::buildDrawPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const
+    {
+        PipelineState state = drawState_;
+        state.vertexShader = ShaderCode::fromSpirv(vertShaderCode);
+        state.fragmentShader = ShaderCode::fromSpirv(fragShaderCode);
+        return createGraphicsPipeline(handles_.device, handles_.pipelineCache, state);
+    }
+
+    VkPipeline
+    ParticleSystem::swapDrawPipeline(VkPipeline pipeline)
+    {
+        return pipelines_.replace(drawPipeline_, pipeline);
+    }
+
+    VkPipeline
+    ParticleSystem::swapSimulatePipeline(VkPipeline pipeline)
+    {
+        return pipelines_.replace(simulatePipeline_, pipeline);
+    }
+
+    VkPipeline
+    ParticleSystem::swapSortPipeline(VkPipeline pipeline)
+    {
+        if (sortPipeline_ == VF_INVALID_PIPELINE) return pipeline; // Not sorting, nothing to replace
+        return pipelines_.replace(sortPipeline_, pipeline);
+    }
+
+    void
+    ParticleSystem::setDepthSource(VkExtent2D extent, VkFormat format)
+    {
+        // D16 texels are half the size the simulation reads
+        const bool readable = format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+            format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_X8_D24_UNORM_PACK32;
+        depthFormat_ = readable ? format : VK_FORMAT_UNDEFINED;
+        depthExtent_ = { 0, 0 }; // The last copy was of the old image
+        if (!readable) return;
+
+        const uint64_t texels = static_cast<uint64_t>(extent.width) * extent.height;
+        if (texels > static_cast<uint64_t>(depthCapacity_.width) * depthCapacity_.height) {
+            if (depth_.buffer != VK_NULL_HANDLE) {
+                tracker_.forget(depth_.buffer);
+                destroyBuffer(handles_.device, depth_);
+            }
+            depth_ = createBuffer(handles_, sizeof(uint32_t) * texels,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            tracker_.trackBuffer(depth_.buffer);
+            depthCapacity_ = extent;
+        }
+    }
+
+    ParticleSystem::GpuEmitter
+    ParticleSystem::packEmitter(const ParticleEmitterDesc& desc)
+    {
+        GpuEmitter gpu{};
+        for (uint32_t i = 0; i < 3; i++) {
+            gpu.positionSpread[i] = desc.position[i];
+            gpu.velocitySpread[i] = desc.velocity[i];
+            gpu.gravityDrag[i] = desc.gravity[i];
+        }
+        gpu.positionSpread[3] = desc.positionSpread;
+        gpu.velocitySpread[3] = desc.velocitySpread;
+        gpu.gravityDrag[3] = desc.drag;
+        gpu.colors[0] = packColor(desc.startColor);
+        gpu.colors[1] = packColor(desc.endColor);
+        gpu.sizes = floatToHalf(desc.startSize) | floatToHalf(desc.endSize) << 16;
+        gpu.bounce = desc.bounce;
+        // particle.vert divides the age by the lifetime
+        gpu.lifetimeMin = std::max(desc.lifetimeMin, 0.001f);
+        gpu.lifetimeMax = std::max(desc.lifetimeMax, gpu.lifetimeMin);
+        return gpu;
+    }
+
+    ParticleSystem::Emitter&
+    ParticleSystem::emitter(EmitterHandle handle)
+    {
+        if (handle >= emitters_.size() || !emitters_[handle].active) {
+            throw std::runtime_error("invalid particle emitter handle!");
+        }
+        return emitters_[handle];
+    }
+
+    EmitterHandle
+    ParticleSystem::addEmitter(const ParticleEmitterDesc& desc)
+    {
+        // A removed emitter's slot is free once the last of its particles died, they read it until then
+        EmitterHandle handle = VF_INVALID_EMITTER;
+        for (EmitterHandle i = 0; i < emitters_.size(); i++) {
+            if (!emitters_[i].active && emitters_[i].reusableAt <= time_) {
+                handle = i;
+                break;
+            }
+        }
+        if (handle == VF_INVALID_EMITTER) {
+            if (emitters_.size() >= VF_MAX_EMITTERS) {
+                throw std::runtime_error("particle emitter limit reached!");
+            }
+            handle = static_cast<EmitterHandle>(emitters_.size());
+            emitters_.emplace_back();
+        }
+
+        Emitter& slot = emitters_[handle];
+        slot = Emitter{};
+        slot.desc = desc;
+        slot.gpu = packEmitter(desc);
+        slot.active = true;
+        return handle;
+    }
+
+    void
+    ParticleSystem::updateEmitter(EmitterHandle handle, const ParticleEmitterDesc& desc)
+    {
+        // Forces apply to the particles already emitted as well
+        Emitter& slot = emitter(handle);
+        slot.desc = desc;
+        slot.gpu = packEmitter(desc);
+    }
+
+    void
+    ParticleSystem::removeEmitter(EmitterHandle handle)
+    {
+        Emitter& slot = emitter(handle);
+        slot.active = false;
+        slot.burst = 0;
+        slot.reusableAt = time_ + slot.gpu.lifetimeMax;
+    }
+
+    void
+    ParticleSystem::burst(EmitterHandle handle, uint32_t count)
+    {
+        Emitter& slot = emitter(handle);
+        slot.burst = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(slot.burst) + count, settings_.maxParticles));
+    }
+
+    // Live count after this step, at most: the count read back for the frame slot plus everything emitted
+    // since. Without a usable readback the whole capacity is sorted
+    uint32_t
+    ParticleSystem::sortBound(uint32_t frame) const
+    {
+        const uint64_t last = slotSteps_[frame];
+        if (last == 0 || step_ - last >= EMIT_HISTORY) {
+            return settings_.maxParticles;
+        }
+
+        uint64_t bound = static_cast<const uint32_t*>(readback_.mapped)[frame];
+        for (uint64_t step = last + 1; step <= step_; step++) {
+            bound += emitHistory_[step % EMIT_HISTORY];
+        }
+        return static_cast<uint32_t>(std::min<uint64_t>(bound, settings_.maxParticles));
+    }
+
+    void
+    ParticleSystem::pushSimulate(VkCommandBuffer commandBuffer, SimulatePush& push, uint32_t mode) const
+    {
+        push.mode = mode;
+        vkCmdPushConstants(commandBuffer, simulateLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulatePush), &push);
+    }
+
+    void
+    ParticleSystem::recordSimulation(VkCommandBuffer commandBuffer, uint32_t frame, const float viewProjection[16],
+        const float cameraPosition[3])
+    {
+        VF_TRACE_ZONE("Particle simulation");
+
+        std::memcpy(viewProjection_, viewProjection, sizeof(viewProjection_));
+        simulated_ = false;
+        sorted_ = false;
+
+        VkPipeline simulatePipeline = pipelines_.get(simulatePipeline_);
+        if (simulatePipeline == VK_NULL_HANDLE) return;
+
+        const auto now = std::chrono::steady_clock::now();
+        const float deltaTime = std::min(std::chrono::duration<float>(now - lastStep_).count(), MAX_STEP);
+        lastStep_ = now;
+        time_ += deltaTime;
+        step_++;
+
+        // Slot of this frame is free: its fence was waited in drawFrame, so is its readback
+        if (slotSteps_[frame] != 0) {
+            stats_.aliveParticles = static_cast<const uint32_t*>(readback_.mapped)[frame];
+        }
+
+        // Emission: whole particles per emitter, the fraction carries over
+        FrameData* data = static_cast<FrameData*>(frameData_.mapped) + frame;
+        uint32_t emitTotal = 0;
+        uint32_t emissionCount = 0;
+        for (EmitterHandle i = 0; i < emitters_.size(); i++) {
+            Emitter& slot = emitters_[i];
+            data->emitters[i] = slot.gpu;
+            if (!slot.active) continue;
+
+            slot.accumulator = std::min(slot.accumulator + std::max(slot.desc.rate, 0.0f) * deltaTime,
+                static_cast<float>(settings_.maxParticles));
+            uint32_t count = static_cast<uint32_t>(slot.accumulator);
+            slot.accumulator -= static_cast<float>(count);
+            count = std::min(count + slot.burst, settings_.maxParticles - emitTotal);
+            slot.burst = 0;
+            if (count == 0) continue;
+
+            uint32_t* emission = data->emissions[emissionCount++];
+            emission[0] = i;
+            emission[1] = emitTotal;
+            emission[2] = count;
+            emission[3] = 0;
+            emitTotal += count;
+        }
+        emitHistory_[step_ % EMIT_HISTORY] = emitTotal;
+
+        VkPipeline sortPipeline = settings_.sortAlpha ? pipelines_.get(sortPipeline_) : VK_NULL_HANDLE;
+        uint32_t sortCount = 0;
+        if (sortPipeline != VK_NULL_HANDLE) {
+            const uint32_t bound = sortBound(frame);
+            if (bound > 0) {
+                sortCount = std::min(std::max(nextPowerOfTwo(bound), SORT_BLOCK), keyCapacity_);
+            }
+        }
+        slotSteps_[frame] = step_;
+
+        const bool collide = depthFormat_ != VK_FORMAT_UNDEFINED && depthExtent_.width > 0 && depthExtent_.height > 0;
+
+        SimulateParams& params = data->params;
+        std::memcpy(params.depthViewProjection, depthViewProjection_, sizeof(params.depthViewProjection));
+        if (collide) {
+            vf_core::Mat4 depthToWorld;
+            std::memcpy(&depthToWorld.columns[0].x, depthViewProjection_, sizeof(depthToWorld));
+            depthToWorld = vf_core::inverse(depthToWorld);
+            std::memcpy(params.inverseDepthViewProjection, &depthToWorld.columns[0].x, sizeof(params.inverseDepthViewProjection));
+        }
+        params.cameraPosition[0] = cameraPosition[0];
+        params.cameraPosition[1] = cameraPosition[1];
+        params.cameraPosition[2] = cameraPosition[2];
+        params.cameraPosition[3] = 1.0f;
+        params.depthExtent[0] = static_cast<float>(depthExtent_.width);
+        params.depthExtent[1] = static_cast<float>(depthExtent_.height);
+        params.deltaTime = deltaTime;
+        params.maxParticles = settings_.maxParticles;
+        params.emitTotal = emitTotal;
+        params.emissionCount = emissionCount;
+        params.seed = static_cast<uint32_t>(step_ * 2654435761u);
+        params.collide = collide ? 1u : 0u;
+        params.depthUnorm24 = depthFormat_ == VK_FORMAT_D24_UNORM_S8_UINT || depthFormat_ == VK_FORMAT_X8_D24_UNORM_PACK32 ? 1u : 0u;
+        params.thickness = COLLISION_THICKNESS;
+        params.sortCount = sortCount;
+
+        const uint32_t source = current_;
+        const uint32_t destination = 1 - current_;
+        const VkDeviceAddress frameAddress = frameData_.address + sizeof(FrameData) * frame;
+
+        SimulatePush push{};
+        push.params = frameAddress + offsetof(FrameData, params);
+        push.emitters = frameAddress + offsetof(FrameData, emitters);
+        push.emissions = frameAddress + offsetof(FrameData, emissions);
+        push.source = particles_[source].address;
+        push.destination = particles_[destination].address;
+        push.counters = counters_.address;
+        push.arguments = arguments_.address;
+        push.keys = keys_.address;
+        push.depth = depth_.address;
+        push.sourceIndex = source;
+
+        // Simulate: survivors of the source are appended to the destination
+        tracker_.useBuffer(particles_[source].buffer, ResourceUsage::COMPUTE_READ);
+        tracker_.useBuffer(particles_[destination].buffer, ResourceUsage::COMPUTE_WRITE);
+        tracker_.useBuffer(counters_.buffer, ResourceUsage::COMPUTE_READ_WRITE); // atomicAdd
+        tracker_.useBuffer(arguments_.buffer, ResourceUsage::INDIRECT_READ);
+        if (collide) {
+            tracker_.useBuffer(depth_.buffer, ResourceUsage::COMPUTE_READ);
+        }
+        tracker_.flush(commandBuffer);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+        pushSimulate(commandBuffer, push, MODE_SIMULATE);
+        vkCmdDispatchIndirect(commandBuffer, arguments_.buffer, sizeof(VkDrawIndirectCommand));
+
+        // Emit behind the survivors
+        if (emitTotal > 0) {
+            tracker_.useBuffer(counters_.buffer, ResourceUsage::COMPUTE_READ_WRITE);
+            tracker_.useBuffer(particles_[destination].buffer, ResourceUsage::COMPUTE_WRITE);
+            tracker_.flush(commandBuffer);
+
+            pushSimulate(commandBuffer, push, MODE_EMIT);
+            vkCmdDispatch(commandBuffer, (emitTotal + SIMULATE_WORKGROUP_SIZE - 1) / SIMULATE_WORKGROUP_SIZE, 1, 1);
+        }
+
+        // Live count -> indirect draw and the next frame's dispatch
+        tracker_.useBuffer(counters_.buffer, ResourceUsage::COMPUTE_READ_WRITE);
+        tracker_.useBuffer(arguments_.buffer, ResourceUsage::COMPUTE_WRITE);
+        tracker_.flush(commandBuffer);
+
+        pushSimulate(commandBuffer, push, MODE_FINALIZE);
+        vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+        if (sortCount > 0) {
+            tracker_.useBuffer(counters_.buffer, ResourceUsage::COMPUTE_READ);
+            tracker_.useBuffer(particles_[destination].buffer, ResourceUsage::COMPUTE_READ);
+            tracker_.useBuffer(keys_.buffer, ResourceUsage::COMPUTE_WRITE);
+            tracker_.flush(commandBuffer);
+
+            pushSimulate(commandBuffer, push, MODE_SORT_KEYS);
+            vkCmdDispatch(commandBuffer, sortCount / SIMULATE_WORKGROUP_SIZE, 1, 1);
+
+            recordSort(commandBuffer, sortPipeline, sortCount);
+            tracker_.useBuffer(keys_.buffer, ResourceUsage::VERTEX_SHADER_READ);
+        }
+
+        // Live count for stats() and the next sort bound of this slot
+        tracker_.useBuffer(counters_.buffer, ResourceUsage::TRANSFER_SRC);
+        tracker_.useBuffer(readback_.buffer, ResourceUsage::TRANSFER_DST);
+        tracker_.flush(commandBuffer);
+
+        VkBufferCopy copy{ sizeof(uint32_t) * destination, sizeof(uint32_t) * frame, sizeof(uint32_t) };
+        vkCmdCopyBuffer(commandBuffer, counters_.buffer, readback_.buffer, 1, &copy);
+
+        tracker_.useBuffer(readback_.buffer, ResourceState{ VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT });
+        tracker_.useBuffer(arguments_.buffer, ResourceUsage::INDIRECT_READ);
+        tracker_.useBuffer(particles_[destination].buffer, ResourceUsage::VERTEX_SHADER_READ);
+        tracker_.flush(commandBuffer);
+
+        current_ = destination;
+        simulated_ = true;
+        sorted_ = sortCount > 0;
+        stats_.emitted = emitTotal;
+        stats_.sortedElements = sortCount;
+    }
+
+    // Bitonic sort: each block of SORT_BLOCK keys sorts in shared memory, then every merge size k above it
+    // runs its steps j >= SORT_BLOCK globally and the rest in one shared memory pass
+    void
+    ParticleSystem::recordSort(VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t count)
+    {
+        const uint32_t groups = count / SORT_BLOCK;
+
+        SortPush push{};
+        push.keys = keys_.address;
+
+        auto pass = [&](uint32_t mode, uint32_t k, uint32_t j) {
+            tracker_.useBuffer(keys_.buffer, ResourceUsage::COMPUTE_READ_WRITE);
+            tracker_.flush(commandBuffer);
+
+            push.mode = mode;
+            push.k = k;
+            push.j = j;
+            vkCmdPushConstants(commandBuffer, sortLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortPush), &push);
+            vkCmdDispatch(commandBuffer, groups, 1, 1);
+        };
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        pass(SORT_LOCAL, 0, 0);
+        for (uint32_t k = SORT_BLOCK * 2; k <= count; k <<= 1) {
+            for (uint32_t j = k / 2; j >= SORT_BLOCK; j >>= 1) {
+                pass(SORT_GLOBAL_STEP, k, j);
+            }
+            pass(SORT_LOCAL_MERGE, k, SORT_BLOCK / 2);
+        }
+    }
+
+    void
+    ParticleSystem::recordDraw(VkCommandBuffer commandBuffer)
+    {
+        // Without this frame's simulation the indirect arguments belong to the other buffer
+        VkPipeline drawPipeline = pipelines_.get(drawPipeline_);
+        if (!simulated_ || drawPipeline == VK_NULL_HANDLE) return;
+
+        DrawPush push{};
+        std::memcpy(push.viewProjection, viewProjection_, sizeof(push.viewProjection));
+        normalizedRow(viewProjection_, 0, push.right);
+        normalizedRow(viewProjection_, 1, push.up);
+        push.particles = particles_[current_].address;
+        push.keys = keys_.address;
+        push.sorted = sorted_ ? 1u : 0u;
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipeline);
+        vkCmdPushConstants(commandBuffer, drawLayout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPush), &push);
+        vkCmdDrawIndirect(commandBuffer, arguments_.buffer, 0, 1, sizeof(VkDrawIndirectCommand));
+    }
+
+    void
+    ParticleSystem::recordDepthCopy(VkCommandBuffer commandBuffer, VkImage depthImage, VkExtent2D renderExtent)
+    {
+        if (depthFormat_ == VK_FORMAT_UNDEFINED || depth_.buffer == VK_NULL_HANDLE) return;
+
+        const VkExtent2D extent = {
+            std::min(renderExtent.width, depthCapacity_.width),
+            std::min(renderExtent.height, depthCapacity_.height),
+        };
+
+        tracker_.useImage(depthImage, ResourceUsage::TRANSFER_SRC);
+        tracker_.useBuffer(depth_.buffer, ResourceUsage::TRANSFER_DST);
+        tracker_.flush(commandBuffer);
+
+        // Depth aspect only: D24 lands in the low bits of 32 bit texels, D32 as floats
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { extent.width, extent.height, 1 };
+        vkCmdCopyImageToBuffer(commandBuffer, depthImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, depth_.buffer, 1, &region);
+
+        std::memcpy(depthViewProjection_, viewProjection_, sizeof(depthViewProjection_));
+        depthExtent_ = extent;
+    }
+
+    ParticleStats
+    ParticleSystem::stats() const
+    {
+        ParticleStats stats = stats_;
+        stats.emitters = static_cast<uint32_t>(std::count_if(emitters_.begin(), emitters_.end(),
+            [](const Emitter& slot) { return slot.active; }));
+        stats.depthCollisions = depthFormat_ != VK_FORMAT_UNDEFINED;
+        return stats;
+    }
+
+} // namespace vf_vulkan
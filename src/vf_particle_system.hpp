@@ -0,0 +1,211 @@
+﻿#pragma once
+#ifndef VFRAME_PARTICLE_SYSTEM_HPP
+#define VFRAME_PARTICLE_SYSTEM_HPP
+
+#include <vFrame/vf_scene_types.hpp>
+#include "vf_buffer.hpp"
+#include "vf_pipeline_manager.hpp"
+#include "vf_resource_tracker.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Particles live in two device local buffers that swap roles every frame. particles.comp simulates
+    // the previous frame's buffer (dispatched indirectly from its live count) and appends the survivors
+    // to the other one, which is the compaction; new particles are appended behind them. A one thread
+    // pass then clamps the count and writes the indirect draw and the next frame's dispatch, so the CPU
+    // never sees the count except through a stats readback. With sortAlpha, (distance, index) keys of the
+    // live particles are bitonic sorted back to front (particle_sort.comp) and the draw goes through them.
+    //
+    // Depth collisions test against the depth buffer of the previous frame, copied to a buffer after the
+    // scene pass (recordDepthCopy) and read with the camera it was rendered with.
+    class ParticleSystem {
+    public:
+        ParticleSystem(const DeviceHandles& handles, PipelineManager& pipelines, ResourceTracker& tracker,
+            const ParticleSettings& settings, uint32_t framesInFlight,
+            std::vector<char> simulateShaderCode, std::vector<char> sortShaderCode);
+        ~ParticleSystem();
+
+        ParticleSystem(const ParticleSystem&) = delete;
+        ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+        // Same contract as GpuScene::createPipeline: requested again when the render pass format changes
+        void createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+            VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode);
+        void setRenderPass(VkRenderPass renderPass) { drawState_.renderPass = renderPass; } // See GpuScene::setRenderPass
+        VkPipeline buildDrawPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const;
+        VkPipeline buildSimulatePipeline(const std::vector<char>& shaderCode) const;
+        VkPipeline buildSortPipeline(const std::vector<char>& shaderCode) const;
+        VkPipeline swapDrawPipeline(VkPipeline pipeline);
+        VkPipeline swapSimulatePipeline(VkPipeline pipeline);
+        VkPipeline swapSortPipeline(VkPipeline pipeline);
+
+        // With the device idle (swap chain recreation): depth images up to extent are copied from now on.
+        // VK_FORMAT_UNDEFINED turns collisions off
+        void setDepthSource(VkExtent2D extent, VkFormat format);
+
+        EmitterHandle addEmitter(const ParticleEmitterDesc& desc);
+        void updateEmitter(EmitterHandle emitter, const ParticleEmitterDesc& desc);
+        void removeEmitter(EmitterHandle emitter);
+        void burst(EmitterHandle emitter, uint32_t count);
+
+        // Outside of the render pass, after the fence of frame was waited: emit, simulate, compact, sort.
+        // Leaves the buffers ready for recordDraw
+        void recordSimulation(VkCommandBuffer commandBuffer, uint32_t frame, const float viewProjection[16],
+            const float cameraPosition[3]);
+        // Inside the render pass
+        void recordDraw(VkCommandBuffer commandBuffer);
+        // After the render pass: depth of renderExtent (the rendered part of image) for the next frame's collisions
+        void recordDepthCopy(VkCommandBuffer commandBuffer, VkImage depthImage, VkExtent2D renderExtent);
+
+        ParticleStats stats() const;
+
+    private:
+        // std430 mirror of Particle in particles.comp / particle.vert
+        struct GpuParticle {
+            float position[3];
+            float age;
+            float velocity[3];
+            float lifetime;
+            uint32_t colors[2];   // Start, end: RGBA8
+            uint32_t sizes;       // Start, end: half floats
+            uint32_t emitter;
+        };
+        static_assert(sizeof(GpuParticle) == 48, "GpuParticle must match the std430 layout in particles.comp");
+
+        // std430 mirror of Emitter in particles.comp
+        struct GpuEmitter {
+            float positionSpread[4];
+            float velocitySpread[4];
+            float gravityDrag[4];
+            uint32_t colors[2];
+            uint32_t sizes;
+            float bounce;
+            float lifetimeMin;
+            float lifetimeMax;
+            uint32_t padding[2];
+        };
+        static_assert(sizeof(GpuEmitter) == 80, "GpuEmitter must match the std430 layout in particles.comp");
+
+        // std430 mirror of Params in particles.comp
+        struct SimulateParams {
+            float depthViewProjection[16];        // Camera the depth buffer was rendered with
+            float inverseDepthViewProjection[16];
+            float cameraPosition[4];
+            float depthExtent[2];                 // Pixels of the depth buffer covered by the scene
+            float deltaTime;
+            uint32_t maxParticles;
+            uint32_t emitTotal;
+            uint32_t emissionCount;
+            uint32_t seed;
+            uint32_t collide;
+            uint32_t depthUnorm24;                // D24: low 24 bits of every texel, floats otherwise
+            float thickness;                      // World units behind the depth that still count as a hit
+            uint32_t sortCount;
+            uint32_t padding;
+        };
+
+        // Fixed part of every host visible frame slot: params, the emitter table, the emission list
+        struct FrameData {
+            SimulateParams params;
+            GpuEmitter emitters[VF_MAX_EMITTERS];
+            uint32_t emissions[VF_MAX_EMITTERS][4]; // Emitter, first particle, count, padding
+        };
+
+        struct SimulatePush {
+            VkDeviceAddress params;
+            VkDeviceAddress emitters;
+            VkDeviceAddress emissions;
+            VkDeviceAddress source;
+            VkDeviceAddress destination;
+            VkDeviceAddress counters;
+            VkDeviceAddress arguments;
+            VkDeviceAddress keys;
+            VkDeviceAddress depth;
+            uint32_t mode;
+            uint32_t sourceIndex;  // Counter of source; destination's is the other one
+        };
+
+        struct SortPush {
+            VkDeviceAddress keys;
+            uint32_t mode;
+            uint32_t k;
+            uint32_t j;
+            uint32_t padding;
+        };
+
+        struct DrawPush {
+            float viewProjection[16];
+            float right[4];
+            float up[4];
+            VkDeviceAddress particles;
+            VkDeviceAddress keys;
+            uint32_t sorted;
+        };
+
+        struct Emitter {
+            ParticleEmitterDesc desc;
+            GpuEmitter gpu;
+            bool active = false;
+            float accumulator = 0.0f;  // Fraction of a particle carried to the next frame
+            uint32_t burst = 0;
+            double reusableAt = 0.0;   // Seconds: particles of a removed emitter read its slot until they die
+        };
+
+        void createPipelineLayouts();
+        static GpuEmitter packEmitter(const ParticleEmitterDesc& desc);
+        uint32_t sortBound(uint32_t frame) const;
+        void pushSimulate(VkCommandBuffer commandBuffer, SimulatePush& push, uint32_t mode) const;
+        void recordSort(VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t count);
+        Emitter& emitter(EmitterHandle handle);
+
+        DeviceHandles handles_;
+        PipelineManager& pipelines_;
+        ResourceTracker& tracker_;
+        ParticleSettings settings_;
+        uint32_t framesInFlight_;
+        uint32_t keyCapacity_;                  // maxParticles rounded up to a power of two
+
+        GpuBuffer particles_[2];
+        GpuBuffer counters_;                    // Live count of each particle buffer
+        GpuBuffer arguments_;                   // VkDrawIndirectCommand, VkDispatchIndirectCommand
+        GpuBuffer keys_;                        // sortAlpha only
+        GpuBuffer frameData_;                   // Host visible, one FrameData per frame in flight
+        GpuBuffer readback_;                    // Host visible, live count after each frame slot
+        GpuBuffer depth_;                       // Previous frame's depth, one 32 bit texel per pixel
+        uint32_t current_ = 0;                  // Particle buffer holding the last frame's particles
+
+        VkExtent2D depthCapacity_{ 0, 0 };
+        VkFormat depthFormat_ = VK_FORMAT_UNDEFINED;
+        VkExtent2D depthExtent_{ 0, 0 };        // Of the last copy, 0 until there is one
+        float depthViewProjection_[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+        float viewProjection_[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+
+        VkPipelineLayout simulateLayout_ = VK_NULL_HANDLE;
+        VkPipelineLayout sortLayout_ = VK_NULL_HANDLE;
+        VkPipelineLayout drawLayout_ = VK_NULL_HANDLE;
+        PipelineHandle simulatePipeline_ = VF_INVALID_PIPELINE;
+        PipelineHandle sortPipeline_ = VF_INVALID_PIPELINE;
+        PipelineHandle drawPipeline_ = VF_INVALID_PIPELINE;
+        PipelineState drawState_;
+
+        std::vector<Emitter> emitters_;
+        std::chrono::steady_clock::time_point lastStep_;
+        double time_ = 0.0;
+        uint64_t step_ = 0;
+        bool simulated_ = false;               // This frame's simulation was recorded, the draw may use it
+        bool sorted_ = false;                  // ... and its keys were sorted
+
+        // Upper bound of the live count for the sort: readback of a slot plus what was emitted since
+        static constexpr uint32_t EMIT_HISTORY = 16;
+        uint32_t emitHistory_[EMIT_HISTORY] = {};
+        std::vector<uint64_t> slotSteps_;       // Step last recorded into each frame slot, 0: never
+
+        ParticleStats stats_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_PARTICLE_SYSTEM_HPP
@@ -0,0 +1,256 @@
+﻿#include "vf_pipeline_manager.hpp"
+
+#include <vFrame/vf_log.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        // VkPipelineCacheHeaderVersionOne: length, version, vendorID, deviceID, pipelineCacheUUID
+        constexpr size_t CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+        bool
+        cacheMatchesDevice(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties)
+        {
+            if (data.size() < CACHE_HEADER_SIZE) return false;
+
+            uint32_t header[4];
+            std::memcpy(header, data.data(), sizeof(header));
+            return header[0] >= CACHE_HEADER_SIZE &&
+                header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                header[2] == properties.vendorID &&
+                header[3] == properties.deviceID &&
+                std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+
+    } // namespace
+
+    PipelineManager::PipelineManager(VkPhysicalDevice physicalDevice, VkDevice device, vf_core::ThreadPool& threadPool,
+        const std::string& cacheFilename)
+        : device_(device)
+        , threadPool_(threadPool)
+        , cacheFilename_(cacheFilename)
+    {
+        loadCache(physicalDevice);
+    }
+
+    PipelineManager::~PipelineManager()
+    {
+        waitIdle();
+
+        for (const Compiled& item : compiled_) {
+            vkDestroyPipeline(device_, item.pipeline, nullptr);
+        }
+        for (const Slot& slot : slots_) {
+            if (slot.pipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device_, slot.pipeline, nullptr);
+            }
+        }
+
+        saveCache();
+        vkDestroyPipelineCache(device_, cache_, nullptr);
+    }
+
+    void
+    PipelineManager::loadCache(VkPhysicalDevice physicalDevice)
+    {
+        // A cache from another driver or GPU is ignored, some drivers do not check it themselves
+        std::vector<char> data;
+        if (!cacheFilename_.empty()) {
+            std::ifstream file(cacheFilename_, std::ios::ate | std::ios::binary);
+            if (file.is_open()) {
+                data.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+                VkPhysicalDeviceProperties properties;
+                vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+                if (!file || !cacheMatchesDevice(data, properties)) {
+                    data.clear();
+                }
+            }
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        if (vkCreatePipelineCache(device_, &createInfo, nullptr, &cache_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    void
+    PipelineManager::saveCache() const
+    {
+        if (cacheFilename_.empty()) return;
+
+        size_t size = 0;
+        if (vkGetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS || size == 0) return;
+
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS) return;
+
+        // Written aside and renamed, a crash while saving must not leave a truncated cache
+        const std::string temporary = cacheFilename_ + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(data.data(), static_cast<std::streamsize>(size));
+            if (!file) {
+                VF_LOG_WARNING("pipeline", "failed to write pipeline cache: %s", temporary.c_str());
+                return;
+            }
+        }
+        std::remove(cacheFilename_.c_str());
+        std::rename(temporary.c_str(), cacheFilename_.c_str());
+    }
+
+    PipelineHandle
+    PipelineManager::request(BuildFunction build, PipelineHandle fallback)
+    {
+        PipelineHandle handle = static_cast<PipelineHandle>(slots_.size());
+        Slot slot;
+        slot.fallback = fallback;
+        slots_.push_back(slot);
+
+        submit(handle, std::move(build));
+        return handle;
+    }
+
+    PipelineHandle
+    PipelineManager::requestGraphics(const PipelineState& state, PipelineHandle fallback)
+    {
+        requests_++;
+        auto it = graphicsStates_.find(state);
+        if (it != graphicsStates_.end()) {
+            deduplicated_++;
+            return it->second;
+        }
+
+        // The state is copied into the job: shader code is shared, not duplicated
+        PipelineHandle handle = request([this, state]() { return createGraphicsPipeline(device_, cache_, state); }, fallback);
+        graphicsStates_.emplace(state, handle);
+        return handle;
+    }
+
+    VkPipeline
+    PipelineManager::replace(PipelineHandle handle, VkPipeline pipeline)
+    {
+        Slot& slot = slots_.at(handle);
+        std::swap(slot.pipeline, pipeline);
+        return pipeline;
+    }
+
+    VkPipeline
+    PipelineManager::get(PipelineHandle handle) const
+    {
+        // Fallbacks may chain, a request never refers to a later handle so this ends
+        while (handle < slots_.size()) {
+            const Slot& slot = slots_[handle];
+            if (slot.pipeline != VK_NULL_HANDLE) {
+                return slot.pipeline;
+            }
+            handle = slot.fallback;
+        }
+        return VK_NULL_HANDLE;
+    }
+
+    bool
+    PipelineManager::isReady(PipelineHandle handle) const
+    {
+        return handle < slots_.size() && slots_[handle].pipeline != VK_NULL_HANDLE;
+    }
+
+    std::vector<VkPipeline>
+    PipelineManager::update()
+    {
+        std::vector<Compiled> compiled;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (compiled_.empty()) {
+                return {};
+            }
+            compiled.swap(compiled_);
+        }
+
+        std::vector<VkPipeline> retired;
+        for (const Compiled& item : compiled) {
+            Slot& slot = slots_[item.handle];
+            if (slot.pipeline != VK_NULL_HANDLE) {
+                retired.push_back(slot.pipeline);
+            }
+            slot.pipeline = item.pipeline;
+        }
+        return retired;
+    }
+
+    void
+    PipelineManager::waitIdle()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+    PipelineStats
+    PipelineManager::stats() const
+    {
+        PipelineStats stats;
+        stats.pipelineCount = static_cast<uint32_t>(slots_.size());
+        stats.requests = requests_;
+        stats.deduplicated = deduplicated_;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.pendingCompiles = pending_;
+        stats.compiled = compiledCount_;
+        stats.failed = failedCount_;
+        stats.compileMilliseconds = compileMilliseconds_;
+        stats.maxCompileMilliseconds = maxCompileMilliseconds_;
+        return stats;
+    }
+
+    void
+    PipelineManager::submit(PipelineHandle handle, BuildFunction build)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_++;
+        }
+
+        threadPool_.submit([this, handle, build = std::move(build)]() {
+            VF_TRACE_ZONE("Pipeline compile");
+            auto start = std::chrono::steady_clock::now();
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            try {
+                pipeline = build();
+            }
+            catch (const std::exception& e) {
+                // The handle keeps using its fallback
+                VF_LOG_SEVERE("pipeline", "%s", e.what());
+            }
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pipeline != VK_NULL_HANDLE) {
+                compiled_.push_back({ handle, pipeline });
+                compiledCount_++;
+            }
+            else {
+                failedCount_++;
+            }
+            compileMilliseconds_ += milliseconds;
+            maxCompileMilliseconds_ = std::max(maxCompileMilliseconds_, milliseconds);
+            pending_--;
+            idle_.notify_all();
+        });
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,99 @@
+﻿#pragma once
+#ifndef VFRAME_PIPELINE_MANAGER_HPP
+#define VFRAME_PIPELINE_MANAGER_HPP
+
+#include <vFrame/vf_scene_types.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include "vf_pipeline_state.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vf_vulkan {
+
+    using PipelineHandle = uint32_t;
+    constexpr PipelineHandle VF_INVALID_PIPELINE = ~0u;
+
+    // Compiles pipelines on the thread pool so a new pipeline never stalls the frame.
+    //
+    // request() returns a handle right away; the pipeline appears in get() at the first frame
+    // boundary (update()) after the compile finished. Until then get() returns the fallback's
+    // pipeline, or VK_NULL_HANDLE and the caller skips the draw. All compiles share one
+    // VkPipelineCache which is loaded from and saved to cacheFilename (empty: memory only).
+    // Graphics pipelines are requested by PipelineState: an identical state returns the existing handle.
+    //
+    // Handles and get()/update() belong to the render thread, only the compiles run elsewhere.
+    class PipelineManager {
+    public:
+        using BuildFunction = std::function<VkPipeline()>;
+
+        PipelineManager(VkPhysicalDevice physicalDevice, VkDevice device, vf_core::ThreadPool& threadPool,
+            const std::string& cacheFilename);
+        ~PipelineManager();
+
+        PipelineManager(const PipelineManager&) = delete;
+        PipelineManager& operator=(const PipelineManager&) = delete;
+
+        // Thread safe, build functions pass it to vkCreate*Pipelines
+        VkPipelineCache cache() const { return cache_; }
+
+        PipelineHandle request(BuildFunction build, PipelineHandle fallback = VF_INVALID_PIPELINE);
+        // Deduplicated by state, the fallback only applies when the state is new
+        PipelineHandle requestGraphics(const PipelineState& state, PipelineHandle fallback = VF_INVALID_PIPELINE);
+        // Installs a pipeline built elsewhere (shader hot reload), returns the previous one
+        VkPipeline replace(PipelineHandle handle, VkPipeline pipeline);
+
+        VkPipeline get(PipelineHandle handle) const;
+        bool isReady(PipelineHandle handle) const;
+
+        // Frame boundary: publishes finished compiles, returns replaced pipelines for deferred destruction
+        std::vector<VkPipeline> update();
+        // Blocks until every compile has finished, e.g. before the objects they read are destroyed
+        void waitIdle();
+
+        PipelineStats stats() const;
+
+    private:
+        struct Slot {
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            PipelineHandle fallback = VF_INVALID_PIPELINE;
+        };
+
+        struct Compiled {
+            PipelineHandle handle;
+            VkPipeline pipeline;
+        };
+
+        void submit(PipelineHandle handle, BuildFunction build);
+        void loadCache(VkPhysicalDevice physicalDevice);
+        void saveCache() const;
+
+        VkDevice device_;
+        vf_core::ThreadPool& threadPool_;
+        std::string cacheFilename_;
+        VkPipelineCache cache_ = VK_NULL_HANDLE;
+
+        // Render thread only
+        std::vector<Slot> slots_;
+        std::unordered_map<PipelineState, PipelineHandle, PipelineStateHash> graphicsStates_;
+        uint64_t requests_ = 0;
+        uint64_t deduplicated_ = 0;
+
+        mutable std::mutex mutex_; // Guards everything below
+        std::vector<Compiled> compiled_;
+        uint32_t pending_ = 0;
+        uint64_t compiledCount_ = 0;
+        uint64_t failedCount_ = 0;
+        double compileMilliseconds_ = 0.0;
+        double maxCompileMilliseconds_ = 0.0;
+        std::condition_variable idle_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_PIPELINE_MANAGER_HPP
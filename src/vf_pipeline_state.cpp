@@ -0,0 +1,253 @@
+﻿#include "vf_pipeline_state.hpp"
+
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        // FNV-1a 64, fields are mixed one by one so struct padding never reaches the hash
+        struct Hasher {
+            uint64_t value = 0xCBF29CE484222325ull;
+
+            void
+            bytes(const void* data, size_t size)
+            {
+                const uint8_t* ptr = static_cast<const uint8_t*>(data);
+                for (size_t i = 0; i < size; i++) {
+                    value ^= ptr[i];
+                    value *= 0x100000001B3ull;
+                }
+            }
+
+            template <typename T>
+            void
+            field(const T& item)
+            {
+                bytes(&item, sizeof(item));
+            }
+        };
+
+        VkShaderModule
+        createShaderModule(VkDevice device, const ShaderCode& shader)
+        {
+            if (!shader.spirv) {
+                throw std::runtime_error("pipeline state has no shader code!");
+            }
+
+            VkShaderModuleCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            createInfo.codeSize = shader.spirv->size();
+            // In 32 bits because it's SPIR-V bytecode
+            createInfo.pCode = reinterpret_cast<const uint32_t*>(shader.spirv->data());
+
+            VkShaderModule shaderModule;
+            if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shader module!");
+            }
+            return shaderModule;
+        }
+
+    } // namespace
+
+    ShaderCode
+    ShaderCode::fromSpirv(std::vector<char> code)
+    {
+        Hasher hasher;
+        hasher.bytes(code.data(), code.size());
+
+        ShaderCode shader;
+        shader.hash = hasher.value;
+        shader.spirv = std::make_shared<const std::vector<char>>(std::move(code));
+        return shader;
+    }
+
+    bool
+    ShaderCode::operator==(const ShaderCode& other) const
+    {
+        if (spirv == other.spirv) return true;
+        if (!spirv || !other.spirv || hash != other.hash) return false;
+        return *spirv == *other.spirv;
+    }
+
+    size_t
+    PipelineState::hash() const
+    {
+        Hasher hasher;
+        hasher.field(vertexShader.hash);
+        hasher.field(fragmentShader.hash);
+        hasher.field(layout);
+        hasher.field(subpass);
+        hasher.field(colorFormat);
+        hasher.field(depthFormat);
+        hasher.field(samples);
+        hasher.field(topology);
+        hasher.field(polygonMode);
+        hasher.field(cullMode);
+        hasher.field(frontFace);
+        hasher.field(blend);
+        hasher.field(depthTest);
+        hasher.field(depthWrite);
+        hasher.field(depthCompare);
+        return static_cast<size_t>(hasher.value);
+    }
+
+    bool
+    PipelineState::operator==(const PipelineState& other) const
+    {
+        return vertexShader == other.vertexShader &&
+            fragmentShader == other.fragmentShader &&
+            layout == other.layout &&
+            subpass == other.subpass &&
+            colorFormat == other.colorFormat &&
+            depthFormat == other.depthFormat &&
+            samples == other.samples &&
+            topology == other.topology &&
+            polygonMode == other.polygonMode &&
+            cullMode == other.cullMode &&
+            frontFace == other.frontFace &&
+            blend == other.blend &&
+            depthTest == other.depthTest &&
+            depthWrite == other.depthWrite &&
+            depthCompare == other.depthCompare;
+    }
+
+    VkPipeline
+    createGraphicsPipeline(VkDevice device, VkPipelineCache cache, const PipelineState& state)
+    {
+        VkShaderModule vertShaderModule = createShaderModule(device, state.vertexShader);
+        VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+        try {
+            fragShaderModule = createShaderModule(device, state.fragmentShader);
+        }
+        catch (...) {
+            vkDestroyShaderModule(device, vertShaderModule, nullptr);
+            throw;
+        }
+
+        VkPipelineShaderStageCreateInfo shaderStages[2]{};
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;   // Vertex shader stage
+        shaderStages[0].module = vertShaderModule;
+        shaderStages[0].pName = "main";                       // Entry point in the shader
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT; // Fragment shader stage
+        shaderStages[1].module = fragShaderModule;
+        shaderStages[1].pName = "main";
+
+        // Немає жодного прив'язування буферів вершин: вершини задаються в шейдері
+        // або читаються з storage буфера (scene.vert)
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        // Input Assembly
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = state.topology;
+        inputAssembly.primitiveRestartEnable = VK_FALSE; // Restart strichky (for strip)
+
+        // Viewport and scissor are set with vkCmdSetViewport/vkCmdSetScissor, only their count is needed here
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        VkDynamicState dynamicStates[] = {
+            VK_DYNAMIC_STATE_VIEWPORT, // Dynamic viewport state
+            VK_DYNAMIC_STATE_SCISSOR   // Dynamic scissor state
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
+        dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicStateInfo.dynamicStateCount = 2;
+        dynamicStateInfo.pDynamicStates = dynamicStates;
+
+        // Rasterizer
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;        // Затискати до ближньої/далекої площини замість відкидання (карти тіней)
+        rasterizer.rasterizerDiscardEnable = VK_FALSE; // VK_TRUE вимикає будь-який вивід до буфера кадру
+        rasterizer.polygonMode = state.polygonMode;
+        rasterizer.lineWidth = 1.0f;                   // Товщина ліній
+        rasterizer.cullMode = state.cullMode;          // Чи ми будем рендерити задню частину
+        rasterizer.frontFace = state.frontFace;        // Яку саме будем вважати задньою частиною
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        // Multisampling
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = state.samples;
+        multisampling.minSampleShading = 1.0f;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = state.depthTest ? VK_TRUE : VK_FALSE;
+        depthStencil.depthWriteEnable = state.depthWrite ? VK_TRUE : VK_FALSE;
+        depthStencil.depthCompareOp = state.depthCompare;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.stencilTestEnable = VK_FALSE;
+
+        // Color blending
+        /*	if (blendEnable) {
+            finalColor.rgb = (srcColorBlendFactor * newColor.rgb)
+                < colorBlendOp > (dstColorBlendFactor * oldColor.rgb);
+            finalColor.a = (srcAlphaBlendFactor * newColor.a) < alphaBlendOp >
+                (dstAlphaBlendFactor * oldColor.a);
+        }
+        else {
+            finalColor = newColor;
+        }
+        finalColor = finalColor & colorWriteMask;*/
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+            VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+            VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = state.blend == BlendMode::NONE ? VK_FALSE : VK_TRUE;
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        colorBlendAttachment.dstColorBlendFactor = state.blend == BlendMode::ADDITIVE ?
+            VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.logicOp = VK_LOGIC_OP_COPY;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = shaderStages;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pDepthStencilState = state.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicStateInfo;
+        pipelineInfo.layout = state.layout;
+        pipelineInfo.renderPass = state.renderPass;
+        pipelineInfo.subpass = state.subpass;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+
+        // Modules are only needed while the pipeline is created
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        vkDestroyShaderModule(device, fragShaderModule, nullptr);
+
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create graphics pipeline!");
+        }
+        return pipeline;
+    }
+
+} // namespace vf_vulkan
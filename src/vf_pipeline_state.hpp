@@ -0,0 +1,70 @@
+﻿#pragma once
+#ifndef VFRAME_PIPELINE_STATE_HPP
+#define VFRAME_PIPELINE_STATE_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // SPIR-V shared between every state that uses it, hashed once
+    struct ShaderCode {
+        std::shared_ptr<const std::vector<char>> spirv;
+        uint64_t hash = 0;
+
+        static ShaderCode fromSpirv(std::vector<char> code);
+
+        bool operator==(const ShaderCode& other) const;
+        bool operator!=(const ShaderCode& other) const { return !(*this == other); }
+    };
+
+    enum class BlendMode : uint32_t {
+        NONE,       // Opaque, blending disabled
+        ALPHA,      // src * a + dst * (1 - a)
+        ADDITIVE,   // src * a + dst
+    };
+
+    // Everything that makes two graphics pipelines different. Viewport and scissor are always dynamic.
+    //
+    // renderPass is what the pipeline is created against, but it is not part of the key:
+    // a pipeline works with every compatible render pass, which the formats and sample count describe.
+    struct PipelineState {
+        ShaderCode vertexShader;
+        ShaderCode fragmentShader;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        uint32_t subpass = 0;
+
+        VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+        VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+        BlendMode blend = BlendMode::NONE;
+
+        bool depthTest = false;
+        bool depthWrite = false;
+        VkCompareOp depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+        size_t hash() const;
+        bool operator==(const PipelineState& other) const;
+        bool operator!=(const PipelineState& other) const { return !(*this == other); }
+    };
+
+    struct PipelineStateHash {
+        size_t operator()(const PipelineState& state) const { return state.hash(); }
+    };
+
+    // Shader modules live only while the pipeline is created. Safe to call from any thread.
+    VkPipeline createGraphicsPipeline(VkDevice device, VkPipelineCache cache, const PipelineState& state);
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_PIPELINE_STATE_HPP
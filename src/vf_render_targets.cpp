@@ -0,0 +1,160 @@
+﻿#include "vf_render_targets.hpp"
+#include "vf_memory_budget.hpp"
+
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        // Like findMemoryType, but reports a missing type instead of throwing
+        bool
+        findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties,
+            uint32_t& index)
+        {
+            VkPhysicalDeviceMemoryProperties memProperties;
+            vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+            for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+                if ((typeFilter & (1u << i)) &&
+                    (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                    index = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    } // namespace
+
+    AttachmentImage
+    createAttachment(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format,
+        VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageAspectFlags aspect, bool transient,
+        MemoryTracker* tracker)
+    {
+        AttachmentImage result;
+        result.format = format;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = samples;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = transient ? usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &result.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create attachment image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, result.image, &memRequirements);
+
+        // Desktop GPUs have no lazily allocated memory, there the attachment is a normal device local image
+        uint32_t memoryType = 0;
+        result.lazilyAllocated = transient && findMemoryTypeIndex(physicalDevice, memRequirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, memoryType);
+        if (!result.lazilyAllocated) {
+            memoryType = findMemoryType(physicalDevice, memRequirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &result.memory) != VK_SUCCESS) {
+            vkDestroyImage(device, result.image, nullptr);
+            throw std::runtime_error("failed to allocate attachment memory!");
+        }
+        vkBindImageMemory(device, result.image, result.memory, 0);
+        result.bytes = memRequirements.size;
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = result.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &result.view) != VK_SUCCESS) {
+            vkFreeMemory(device, result.memory, nullptr);
+            vkDestroyImage(device, result.image, nullptr);
+            throw std::runtime_error("failed to create attachment image view!");
+        }
+
+        // Lazily allocated memory is accounted at its full size, the driver budget shows what is committed
+        if (tracker != nullptr) {
+            tracker->allocated(result.memory, MemoryCategory::RENDER_TARGETS, memoryType, result.bytes);
+            result.tracker = tracker;
+        }
+
+        return result;
+    }
+
+    void
+    destroyAttachment(VkDevice device, AttachmentImage& attachment)
+    {
+        if (attachment.view != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, attachment.view, nullptr);
+        }
+        if (attachment.image != VK_NULL_HANDLE) {
+            vkDestroyImage(device, attachment.image, nullptr);
+        }
+        if (attachment.memory != VK_NULL_HANDLE) {
+            if (attachment.tracker != nullptr) {
+                attachment.tracker->freed(attachment.memory);
+            }
+            vkFreeMemory(device, attachment.memory, nullptr);
+        }
+        attachment = AttachmentImage();
+    }
+
+    VkFormat
+    findDepthFormat(VkPhysicalDevice physicalDevice)
+    {
+        const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
+
+        for (VkFormat format : candidates) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                return format;
+            }
+        }
+
+        throw std::runtime_error("failed to find supported depth format!");
+    }
+
+    VkSampleCountFlagBits
+    findSampleCount(VkPhysicalDevice physicalDevice, uint32_t requested, bool depth)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        VkSampleCountFlags supported = properties.limits.framebufferColorSampleCounts;
+        if (depth) {
+            supported &= properties.limits.framebufferDepthSampleCounts;
+        }
+
+        for (uint32_t count = VK_SAMPLE_COUNT_64_BIT; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1) {
+            if (count <= requested && (supported & count)) {
+                return static_cast<VkSampleCountFlagBits>(count);
+            }
+        }
+        return VK_SAMPLE_COUNT_1_BIT;
+    }
+
+} // namespace vf_vulkan
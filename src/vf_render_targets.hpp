@@ -0,0 +1,38 @@
+﻿#pragma once
+#ifndef VFRAME_RENDER_TARGETS_HPP
+#define VFRAME_RENDER_TARGETS_HPP
+
+#include "vf_buffer.hpp"
+
+namespace vf_vulkan {
+
+    // Image that only lives inside a render pass (depth, multisampled color).
+    // Created with TRANSIENT_ATTACHMENT usage and put into LAZILY_ALLOCATED memory where the device has it:
+    // on tile-based GPUs such an attachment stays in tile memory and never gets physical pages.
+    struct AttachmentImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkDeviceSize bytes = 0;        // Committed size may be smaller when lazilyAllocated
+        bool lazilyAllocated = false;
+        MemoryTracker* tracker = nullptr;
+    };
+
+    // transient: contents are never loaded or stored outside of the render pass
+    // tracker: accounts the memory as RENDER_TARGETS, may be null
+    AttachmentImage createAttachment(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format,
+        VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageAspectFlags aspect, bool transient,
+        MemoryTracker* tracker = nullptr);
+
+    void destroyAttachment(VkDevice device, AttachmentImage& attachment);
+
+    // First of D32 / D32S8 / D24S8 usable as an optimal tiling depth attachment
+    VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
+
+    // Highest count up to requested that both color and (when used) depth attachments support
+    VkSampleCountFlagBits findSampleCount(VkPhysicalDevice physicalDevice, uint32_t requested, bool depth);
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_RENDER_TARGETS_HPP
@@ -0,0 +1,270 @@
+﻿#include "vf_resource_tracker.hpp"
+
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        constexpr VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+            VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+        // Everything in the usage table fits the 32-bit synchronization 1 flags
+        constexpr uint64_t LEGACY_MASK = 0xFFFFFFFFull;
+
+    } // namespace
+
+    ResourceState
+    resourceState(ResourceUsage usage)
+    {
+        switch (usage) {
+        case ResourceUsage::TRANSFER_SRC:
+            return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+        case ResourceUsage::TRANSFER_DST:
+            return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+        case ResourceUsage::INDIRECT_READ:
+            return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+        case ResourceUsage::INDEX_READ:
+            return { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+        case ResourceUsage::VERTEX_SHADER_READ:
+            return { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+        case ResourceUsage::FRAGMENT_SAMPLED:
+            return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        case ResourceUsage::COMPUTE_READ:
+            return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+        case ResourceUsage::COMPUTE_WRITE:
+            return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+        case ResourceUsage::COMPUTE_READ_WRITE:
+            return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL };
+        case ResourceUsage::COLOR_ATTACHMENT:
+            return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        case ResourceUsage::DEPTH_ATTACHMENT:
+            return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+        case ResourceUsage::PRESENT:
+            // Presentation engine waits on a semaphore, the barrier only changes the layout
+            return { VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+        }
+        throw std::runtime_error("unknown resource usage!");
+    }
+
+    ResourceTracker::ResourceTracker(bool synchronization2)
+        : synchronization2_(synchronization2)
+    {
+    }
+
+    void
+    ResourceTracker::trackBuffer(VkBuffer buffer)
+    {
+        buffers_[buffer] = Tracked();
+    }
+
+    void
+    ResourceTracker::trackImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout layout)
+    {
+        Tracked tracked;
+        tracked.layout = layout;
+        tracked.aspect = aspect;
+        images_[image] = tracked;
+    }
+
+    void
+    ResourceTracker::forget(VkBuffer buffer)
+    {
+        buffers_.erase(buffer);
+    }
+
+    void
+    ResourceTracker::forget(VkImage image)
+    {
+        images_.erase(image);
+    }
+
+    bool
+    ResourceTracker::transition(Tracked& tracked, const ResourceState& next, bool image, bool discard, Transition& result)
+    {
+        const bool writes = (next.access & WRITE_ACCESS) != 0;
+        const bool layoutChange = image && (next.layout != tracked.layout || discard);
+
+        if (!writes && !layoutChange) {
+            tracked.readStages |= next.stages;
+
+            // Never written, or the last write is already visible to this stage and access
+            if (tracked.writeStages == VK_PIPELINE_STAGE_2_NONE ||
+                ((next.stages & ~tracked.visibleStages) == 0 && (next.access & ~tracked.visibleAccess) == 0)) {
+                return false;
+            }
+
+            result = { tracked.writeStages, tracked.writeAccess, tracked.layout };
+            tracked.visibleStages |= next.stages;
+            tracked.visibleAccess |= next.access;
+            return true;
+        }
+
+        // Write after read only needs an execution dependency, after a write the data must be made available
+        result = { tracked.writeStages | tracked.readStages, tracked.writeAccess,
+            discard ? VK_IMAGE_LAYOUT_UNDEFINED : tracked.layout };
+        const bool needed = layoutChange || result.srcStages != VK_PIPELINE_STAGE_2_NONE;
+
+        // A layout transition is a write as well: later reads chain on its stages
+        tracked.writeStages = next.stages;
+        tracked.writeAccess = next.access & WRITE_ACCESS;
+        tracked.readStages = writes ? VK_PIPELINE_STAGE_2_NONE : next.stages;
+        tracked.visibleStages = next.stages;
+        tracked.visibleAccess = next.access;
+        tracked.layout = next.layout;
+        return needed;
+    }
+
+    void
+    ResourceTracker::useBuffer(VkBuffer buffer, const ResourceState& state)
+    {
+        auto it = buffers_.find(buffer);
+        if (it == buffers_.end()) {
+            throw std::runtime_error("buffer is not tracked!");
+        }
+
+        Transition transition_{};
+        if (!transition(it->second, state, false, false, transition_)) {
+            stats_.skipped++;
+            return;
+        }
+
+        // Two uses of one buffer before a flush: widen the queued barrier, barriers in one batch are unordered
+        for (auto& barrier : pendingBuffers_) {
+            if (barrier.buffer == buffer) {
+                barrier.dstStageMask |= state.stages;
+                barrier.dstAccessMask |= state.access;
+                return;
+            }
+        }
+
+        VkBufferMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        barrier.srcStageMask = transition_.srcStages;
+        barrier.srcAccessMask = transition_.srcAccess;
+        barrier.dstStageMask = state.stages;
+        barrier.dstAccessMask = state.access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        pendingBuffers_.push_back(barrier);
+    }
+
+    void
+    ResourceTracker::useImage(VkImage image, const ResourceState& state, bool discard)
+    {
+        auto it = images_.find(image);
+        if (it == images_.end()) {
+            throw std::runtime_error("image is not tracked!");
+        }
+
+        Transition transition_{};
+        if (!transition(it->second, state, true, discard, transition_)) {
+            stats_.skipped++;
+            return;
+        }
+
+        for (auto& barrier : pendingImages_) {
+            if (barrier.image == image) {
+                barrier.dstStageMask |= state.stages;
+                barrier.dstAccessMask |= state.access;
+                barrier.newLayout = state.layout;
+                return;
+            }
+        }
+
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = transition_.srcStages;
+        barrier.srcAccessMask = transition_.srcAccess;
+        barrier.dstStageMask = state.stages;
+        barrier.dstAccessMask = state.access;
+        barrier.oldLayout = transition_.oldLayout;
+        barrier.newLayout = state.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = it->second.aspect;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        pendingImages_.push_back(barrier);
+    }
+
+    void
+    ResourceTracker::flush(VkCommandBuffer commandBuffer)
+    {
+        if (pendingBuffers_.empty() && pendingImages_.empty()) return;
+
+        stats_.barriers += pendingBuffers_.size() + pendingImages_.size();
+        stats_.batches++;
+
+        if (synchronization2_) {
+            VkDependencyInfo dependency{};
+            dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(pendingBuffers_.size());
+            dependency.pBufferMemoryBarriers = pendingBuffers_.data();
+            dependency.imageMemoryBarrierCount = static_cast<uint32_t>(pendingImages_.size());
+            dependency.pImageMemoryBarriers = pendingImages_.data();
+            vkCmdPipelineBarrier2(commandBuffer, &dependency);
+        }
+        else {
+            // Synchronization 1 has one stage pair per command: the union of all of them
+            VkPipelineStageFlags srcStages = 0;
+            VkPipelineStageFlags dstStages = 0;
+
+            std::vector<VkBufferMemoryBarrier> buffers;
+            for (const auto& barrier2 : pendingBuffers_) {
+                VkBufferMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask & LEGACY_MASK);
+                barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask & LEGACY_MASK);
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = barrier2.buffer;
+                barrier.offset = barrier2.offset;
+                barrier.size = barrier2.size;
+                buffers.push_back(barrier);
+                srcStages |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask & LEGACY_MASK);
+                dstStages |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask & LEGACY_MASK);
+            }
+
+            std::vector<VkImageMemoryBarrier> images;
+            for (const auto& barrier2 : pendingImages_) {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask & LEGACY_MASK);
+                barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask & LEGACY_MASK);
+                barrier.oldLayout = barrier2.oldLayout;
+                barrier.newLayout = barrier2.newLayout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = barrier2.image;
+                barrier.subresourceRange = barrier2.subresourceRange;
+                images.push_back(barrier);
+                srcStages |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask & LEGACY_MASK);
+                dstStages |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask & LEGACY_MASK);
+            }
+
+            vkCmdPipelineBarrier(commandBuffer,
+                srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                dstStages != 0 ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0, 0, nullptr,
+                static_cast<uint32_t>(buffers.size()), buffers.data(),
+                static_cast<uint32_t>(images.size()), images.data());
+        }
+
+        pendingBuffers_.clear();
+        pendingImages_.clear();
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,99 @@
+﻿#pragma once
+#ifndef VFRAME_RESOURCE_TRACKER_HPP
+#define VFRAME_RESOURCE_TRACKER_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // How a resource is accessed next
+    struct ResourceState {
+        VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 access = VK_ACCESS_2_NONE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED; // Images only
+    };
+
+    enum class ResourceUsage : uint32_t {
+        TRANSFER_SRC,
+        TRANSFER_DST,
+        INDIRECT_READ,         // Draw/dispatch indirect arguments and counts
+        INDEX_READ,
+        VERTEX_SHADER_READ,    // Storage buffers pulled in the vertex shader
+        FRAGMENT_SAMPLED,      // Sampled image in the fragment shader
+        COMPUTE_READ,
+        COMPUTE_WRITE,
+        COMPUTE_READ_WRITE,
+        COLOR_ATTACHMENT,
+        DEPTH_ATTACHMENT,
+        PRESENT,
+    };
+
+    ResourceState resourceState(ResourceUsage usage);
+
+    // Remembers the last stage/access/layout of every tracked buffer and image.
+    //
+    // use*() declares the next access; a barrier is queued only when it is needed
+    // (read after write, write after read/write, layout change), a read after a read that
+    // already sees the last write costs nothing. flush() emits everything queued as one
+    // vkCmdPipelineBarrier2, or one vkCmdPipelineBarrier without synchronization2.
+    // Images are tracked as a whole (all mips and layers).
+    class ResourceTracker {
+    public:
+        struct Stats {
+            uint64_t barriers = 0;  // Buffer + image barriers emitted
+            uint64_t batches = 0;   // Pipeline barrier commands
+            uint64_t skipped = 0;   // Declared uses that needed no barrier
+        };
+
+        explicit ResourceTracker(bool synchronization2);
+
+        void trackBuffer(VkBuffer buffer);
+        void trackImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+        void forget(VkBuffer buffer);
+        void forget(VkImage image);
+
+        void useBuffer(VkBuffer buffer, ResourceUsage usage) { useBuffer(buffer, resourceState(usage)); }
+        void useBuffer(VkBuffer buffer, const ResourceState& state);
+        // discard: the old contents are not needed, the transition starts from UNDEFINED
+        void useImage(VkImage image, ResourceUsage usage, bool discard = false) { useImage(image, resourceState(usage), discard); }
+        void useImage(VkImage image, const ResourceState& state, bool discard = false);
+
+        void flush(VkCommandBuffer commandBuffer);
+
+        const Stats& stats() const { return stats_; }
+
+    private:
+        struct Tracked {
+            VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;  // Last write
+            VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+            VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;   // Reads since the last write
+            VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE; // Where the last write is visible
+            VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkImageAspectFlags aspect = 0;
+        };
+
+        struct Transition {
+            VkPipelineStageFlags2 srcStages;
+            VkAccessFlags2 srcAccess;
+            VkImageLayout oldLayout;
+        };
+
+        // Updates the tracked state, returns false when no barrier is needed
+        bool transition(Tracked& tracked, const ResourceState& next, bool image, bool discard, Transition& result);
+
+        bool synchronization2_;
+        std::unordered_map<VkBuffer, Tracked> buffers_;
+        std::unordered_map<VkImage, Tracked> images_;
+        std::vector<VkBufferMemoryBarrier2> pendingBuffers_;
+        std::vector<VkImageMemoryBarrier2> pendingImages_;
+        Stats stats_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_RESOURCE_TRACKER_HPP
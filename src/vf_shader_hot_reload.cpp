@@ -0,0 +1,356 @@
+﻿#include "vf_shader_hot_reload.hpp"
+
+#include <vFrame/vf_log.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace vf_vulkan {
+
+    namespace {
+
+        // Editors write a file in several steps, a change is compiled once it has been quiet this long
+        constexpr auto DEBOUNCE = std::chrono::milliseconds(100);
+        constexpr int POLL_INTERVAL_MS = 50;
+
+        std::string
+        quote(const std::string& value)
+        {
+            return "\"" + value + "\"";
+        }
+
+        // "post.frag.hlsl" -> " -x hlsl -fshader-stage=frag -fentry-point=main", GLSL needs nothing
+        std::string
+        languageFlags(const std::string& source)
+        {
+            fs::path path(source);
+            if (path.extension() != ".hlsl") {
+                return std::string();
+            }
+
+            std::string stage = path.stem().extension().string();
+            if (stage.empty()) {
+                throw std::runtime_error("HLSL shader name must contain the stage (name.vert.hlsl): " + source);
+            }
+            return " -x hlsl -fshader-stage=" + stage.substr(1) + " -fentry-point=main";
+        }
+
+        std::vector<char>
+        readSpirv(const fs::path& filename)
+        {
+            std::ifstream file(filename, std::ios::ate | std::ios::binary);
+            if (!file.is_open()) {
+                throw std::runtime_error("failed to open file: " + filename.string());
+            }
+            std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            return buffer;
+        }
+
+    } // namespace
+
+    ShaderHotReload::ShaderHotReload(VkDevice device, vf_core::ThreadPool& threadPool, const std::string& sourceDir,
+        const std::string& outputDir, const std::string& compiler)
+        : device_(device)
+        , threadPool_(threadPool)
+        , sourceDir_(sourceDir)
+        , outputDir_(outputDir)
+        , compiler_(compiler)
+    {
+        if (!fs::is_directory(sourceDir_)) {
+            throw std::runtime_error("shader source directory does not exist: " + sourceDir_);
+        }
+        watcher_ = std::thread([this]() { watchLoop(); });
+    }
+
+    ShaderHotReload::~ShaderHotReload()
+    {
+        stopping_ = true;
+        if (watcher_.joinable()) {
+            watcher_.join();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        jobsDone_.wait(lock, [this]() { return runningJobs_ == 0; });
+        for (auto& item : ready_) {
+            vkDestroyPipeline(device_, item.second, nullptr);
+        }
+        ready_.clear();
+    }
+
+    void
+    ShaderHotReload::watchShader(const std::string& source, const std::string& spvName)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shaders_[source] = spvName;
+    }
+
+    void
+    ShaderHotReload::addPipeline(const std::vector<std::string>& spvNames, BuildFunction build, SwapFunction swap)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pipelines_.push_back({ spvNames, std::move(build), std::move(swap) });
+    }
+
+    std::vector<VkPipeline>
+    ShaderHotReload::update()
+    {
+        std::vector<std::pair<size_t, VkPipeline>> ready;
+        std::vector<SwapFunction> swaps;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ready_.empty()) {
+                return {};
+            }
+            ready.swap(ready_);
+            for (auto& item : ready) {
+                swaps.push_back(pipelines_[item.first].swap);
+            }
+        }
+
+        std::vector<VkPipeline> retired;
+        for (size_t i = 0; i < ready.size(); i++) {
+            VkPipeline old = swaps[i](ready[i].second);
+            if (old != VK_NULL_HANDLE) {
+                retired.push_back(old);
+            }
+        }
+        return retired;
+    }
+
+    void
+    ShaderHotReload::pauseBuilds()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        paused_ = true;
+        jobsDone_.wait(lock, [this]() { return activeBuilds_ == 0; });
+
+        // Built against the objects being recreated: build again after resumeBuilds(), a recreation
+        // that rebuilds nothing itself (same-format resize) must not lose the shader edit
+        for (auto& item : ready_) {
+            vkDestroyPipeline(device_, item.second, nullptr);
+            const size_t index = item.first;
+            const bool alreadyDeferred = std::any_of(deferred_.begin(), deferred_.end(),
+                [index](const std::pair<size_t, PipelineEntry>& deferred) { return deferred.first == index; });
+            if (!alreadyDeferred) {
+                deferred_.push_back({ index, pipelines_[index] });
+            }
+        }
+        ready_.clear();
+    }
+
+    void
+    ShaderHotReload::resumeBuilds()
+    {
+        std::vector<std::pair<size_t, PipelineEntry>> deferred;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            paused_ = false;
+            deferred.swap(deferred_);
+        }
+        for (auto& item : deferred) {
+            size_t index = item.first;
+            submitJob([this, index, entry = std::move(item.second)]() { rebuild(index, entry); });
+        }
+    }
+
+    void
+    ShaderHotReload::submitJob(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            runningJobs_++;
+        }
+
+        threadPool_.submit([this, job = std::move(job)]() {
+            VF_TRACE_ZONE("Shader reload");
+            try {
+                job();
+            }
+            catch (const std::exception& e) {
+                VF_LOG_SEVERE("shader reload", "%s", e.what());
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            runningJobs_--;
+            jobsDone_.notify_all();
+        });
+    }
+
+    void
+    ShaderHotReload::compile(const std::string& source, const std::string& spvName)
+    {
+        const fs::path input = fs::path(sourceDir_) / source;
+        const fs::path output = fs::path(outputDir_) / spvName;
+        const fs::path temporary = output.string() + ".tmp";
+
+        // Compile next to the target and rename, a failed compile never leaves a broken .spv behind
+        std::string command = quote(compiler_) + " --target-env=vulkan1.2" + languageFlags(source) +
+            " -o " + quote(temporary.string()) + " " + quote(input.string());
+        if (std::system(command.c_str()) != 0) {
+            std::error_code ignored;
+            fs::remove(temporary, ignored);
+            VF_LOG_WARNING("shader reload", "failed to compile %s, keeping the old pipeline", source.c_str());
+            return;
+        }
+        fs::rename(temporary, output);
+        VF_LOG_INFO("shader reload", "%s -> %s", source.c_str(), spvName.c_str());
+
+        std::vector<std::pair<size_t, PipelineEntry>> affected;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < pipelines_.size(); i++) {
+                const auto& names = pipelines_[i].spvNames;
+                if (std::find(names.begin(), names.end(), spvName) != names.end()) {
+                    affected.push_back({ i, pipelines_[i] });
+                }
+            }
+        }
+        for (auto& item : affected) {
+            size_t index = item.first;
+            submitJob([this, index, entry = std::move(item.second)]() { rebuild(index, entry); });
+        }
+    }
+
+    void
+    ShaderHotReload::rebuild(size_t pipelineIndex, PipelineEntry entry)
+    {
+        // Straight from the output directory: mounted archives still hold the shipped SPIR-V
+        std::vector<std::vector<char>> spirv;
+        for (const std::string& name : entry.spvNames) {
+            spirv.push_back(readSpirv(fs::path(outputDir_) / name));
+        }
+
+        // A paused build is parked rather than blocked: the render thread may need pool workers meanwhile
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (paused_) {
+                deferred_.push_back({ pipelineIndex, std::move(entry) });
+                return;
+            }
+            activeBuilds_++;
+        }
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try {
+            pipeline = entry.build(spirv);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            activeBuilds_--;
+            jobsDone_.notify_all();
+            throw;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        activeBuilds_--;
+        jobsDone_.notify_all();
+        // A newer build of the same pipeline replaces one that was not picked up yet
+        for (auto& item : ready_) {
+            if (item.first == pipelineIndex) {
+                vkDestroyPipeline(device_, item.second, nullptr);
+                item.second = pipeline;
+                return;
+            }
+        }
+        ready_.push_back({ pipelineIndex, pipeline });
+    }
+
+    void
+    ShaderHotReload::watchLoop()
+    {
+        using Clock = std::chrono::steady_clock;
+        std::map<std::string, Clock::time_point> changed;
+
+#ifdef __linux__
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0 || inotify_add_watch(fd, sourceDir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            VF_LOG_WARNING("shader reload", "failed to watch %s", sourceDir_.c_str());
+            if (fd >= 0) close(fd);
+            return;
+        }
+#else
+        // Polling fallback: compare modification times of the registered sources
+        std::map<std::string, fs::file_time_type> writeTimes;
+#endif
+
+        while (!stopping_) {
+#ifdef __linux__
+            pollfd descriptor{ fd, POLLIN, 0 };
+            if (poll(&descriptor, 1, POLL_INTERVAL_MS) > 0) {
+                alignas(inotify_event) char buffer[4096];
+                ssize_t length;
+                while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+                    for (char* ptr = buffer; ptr < buffer + length;) {
+                        const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                        if (event->len > 0) {
+                            changed[event->name] = Clock::now();
+                        }
+                        ptr += sizeof(inotify_event) + event->len;
+                    }
+                }
+            }
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+            std::vector<std::string> sources;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto& item : shaders_) sources.push_back(item.first);
+            }
+            for (const std::string& source : sources) {
+                std::error_code ec;
+                fs::file_time_type time = fs::last_write_time(fs::path(sourceDir_) / source, ec);
+                if (ec) continue;
+
+                auto it = writeTimes.find(source);
+                if (it == writeTimes.end()) {
+                    writeTimes[source] = time;
+                }
+                else if (it->second != time) {
+                    it->second = time;
+                    changed[source] = Clock::now();
+                }
+            }
+#endif
+
+            const Clock::time_point now = Clock::now();
+            for (auto it = changed.begin(); it != changed.end();) {
+                if (now - it->second < DEBOUNCE) {
+                    ++it;
+                    continue;
+                }
+
+                std::string source = it->first;
+                it = changed.erase(it);
+
+                std::string spvName;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto shader = shaders_.find(source);
+                    if (shader == shaders_.end()) continue;
+                    spvName = shader->second;
+                }
+                submitJob([this, source, spvName]() { compile(source, spvName); });
+            }
+        }
+
+#ifdef __linux__
+        close(fd);
+#endif
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,88 @@
+﻿#pragma once
+#ifndef VFRAME_SHADER_HOT_RELOAD_HPP
+#define VFRAME_SHADER_HOT_RELOAD_HPP
+
+#include <vFrame/vf_thread_pool.hpp>
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Development mode shader reload.
+    //
+    // A watcher thread follows the shader source directory (inotify on Linux, polling elsewhere).
+    // A changed source is compiled to SPIR-V on the thread pool (glslc, GLSL or HLSL) and every
+    // pipeline that uses the resulting .spv is rebuilt on the pool as well. The render thread picks
+    // the new pipelines up in update() at a frame boundary; the replaced ones are returned to the
+    // caller, which destroys them after the frames in flight that may still use them.
+    class ShaderHotReload {
+    public:
+        // Runs on a worker thread with the fresh SPIR-V of every file passed to addPipeline, in that order
+        using BuildFunction = std::function<VkPipeline(const std::vector<std::vector<char>>& spirv)>;
+        // Runs on the render thread, installs the new pipeline and returns the previous one
+        using SwapFunction = std::function<VkPipeline(VkPipeline pipeline)>;
+
+        ShaderHotReload(VkDevice device, vf_core::ThreadPool& threadPool, const std::string& sourceDir,
+            const std::string& outputDir, const std::string& compiler);
+        ~ShaderHotReload();
+
+        ShaderHotReload(const ShaderHotReload&) = delete;
+        ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+        // source is relative to sourceDir ("scene.vert", "post.frag.hlsl"), spvName to outputDir
+        void watchShader(const std::string& source, const std::string& spvName);
+        void addPipeline(const std::vector<std::string>& spvNames, BuildFunction build, SwapFunction swap);
+
+        // Render thread, frame boundary
+        std::vector<VkPipeline> update();
+
+        // Holds pipeline builds back while the objects they read (render pass, layouts) are recreated.
+        // Waits for running builds; pipelines built before the pause but not yet swapped in are dropped
+        // and built again after resumeBuilds(), together with the builds requested meanwhile.
+        void pauseBuilds();
+        void resumeBuilds();
+
+    private:
+        struct PipelineEntry {
+            std::vector<std::string> spvNames;
+            BuildFunction build;
+            SwapFunction swap;
+        };
+
+        void watchLoop();
+        void submitJob(std::function<void()> job);
+        void compile(const std::string& source, const std::string& spvName);
+        void rebuild(size_t pipelineIndex, PipelineEntry entry);
+
+        VkDevice device_;
+        vf_core::ThreadPool& threadPool_;
+        std::string sourceDir_;
+        std::string outputDir_;
+        std::string compiler_;
+
+        std::mutex mutex_;                          // Guards everything below
+        std::map<std::string, std::string> shaders_; // Source -> .spv
+        std::vector<PipelineEntry> pipelines_;
+        std::vector<std::pair<size_t, VkPipeline>> ready_;
+        std::vector<std::pair<size_t, PipelineEntry>> deferred_;
+        uint32_t runningJobs_ = 0;
+        uint32_t activeBuilds_ = 0;
+        bool paused_ = false;
+        std::condition_variable jobsDone_;
+
+        std::atomic<bool> stopping_{ false };
+        std::thread watcher_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_SHADER_HOT_RELOAD_HPP
@@ -0,0 +1,1056 @@
+﻿#include <vFrame/vf_spatial.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+
+namespace vf_core {
+
+    namespace {
+
+        constexpr uint32_t NULL_NODE = 0xFFFFFFFFu;
+        constexpr uint32_t INSIDE_BIT = 0x80000000u;  // Frustum traversal: subtree needs no more tests
+        constexpr uint32_t STACK_SIZE = 128;          // The tree is height balanced, 2^32 leaves stay below 64 levels
+        constexpr size_t BATCH_GRAIN = 8;             // Queries per task in the batch calls
+
+        // ### Box helpers ###
+
+        Aabb
+        unionOf(const Aabb& a, const Aabb& b)
+        {
+            return { componentMin(a.min, b.min), componentMax(a.max, b.max) };
+        }
+
+        // Surface area heuristic only compares, half the area is enough
+        float
+        halfArea(const Aabb& box)
+        {
+            const Vec3 size = box.max - box.min;
+            return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+
+        bool
+        contains(const Aabb& outer, const Aabb& inner)
+        {
+            return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+                && inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+        }
+
+        bool
+        overlaps(const Aabb& a, const Aabb& b)
+        {
+            return a.min.x <= b.max.x && b.min.x <= a.max.x
+                && a.min.y <= b.max.y && b.min.y <= a.max.y
+                && a.min.z <= b.max.z && b.min.z <= a.max.z;
+        }
+
+        bool
+        overlapsSphere(const Aabb& box, const Vec3& center, float radiusSquared)
+        {
+            const Vec3 nearest = componentMin(componentMax(center, box.min), box.max);
+            return lengthSquared(nearest - center) <= radiusSquared;
+        }
+
+        enum class Containment { OUTSIDE, INTERSECTS, INSIDE };
+
+        Containment
+        classify(const Frustum& frustum, const Aabb& box)
+        {
+            const Vec3 center = (box.min + box.max) * 0.5f;
+            const Vec3 extent = (box.max - box.min) * 0.5f;
+            Containment result = Containment::INSIDE;
+            for (const Vec4& plane : frustum.planes) {
+                const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+                const float reach = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+                if (distance + reach < 0.0f) return Containment::OUTSIDE;
+                if (distance - reach < 0.0f) result = Containment::INTERSECTS;
+            }
+            return result;
+        }
+
+        struct RayInfo {
+            Vec3 origin;
+            Vec3 direction;
+            Vec3 inverse; // 1 / direction
+        };
+
+        RayInfo
+        prepareRay(const Ray& ray)
+        {
+            return { ray.origin, ray.direction, Vec3{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z } };
+        }
+
+        // Slab test: entry distance, or a negative value when the ray misses before limit
+        float
+        rayEnter(const RayInfo& ray, const Aabb& box, float limit)
+        {
+            const Vec3 t1 = (box.min - ray.origin) * ray.inverse;
+            const Vec3 t2 = (box.max - ray.origin) * ray.inverse;
+            const Vec3 near = componentMin(t1, t2);
+            const Vec3 far = componentMax(t1, t2);
+            const float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+            const float exit = std::min(std::min(far.x, far.y), std::min(far.z, limit));
+            return enter <= exit ? enter : -1.0f;
+        }
+
+        // Committed state of one proxy
+        struct Proxy {
+            Aabb bounds;
+            uint32_t userData = 0;
+            uint32_t node = NULL_NODE;  // Tree leaf or grid cell
+            uint32_t slot = 0;          // Position in the grid cell
+            bool alive = false;
+        };
+
+        // #############################################
+        // Dynamic AABB tree
+        // #############################################
+
+        struct TreeNode {
+            Aabb box;                   // Fattened for leaves
+            uint32_t parent = NULL_NODE;
+            uint32_t child1 = NULL_NODE;
+            uint32_t child2 = NULL_NODE;
+            int32_t height = 0;         // Leaf 0
+            uint32_t proxy = NULL_NODE;
+
+            bool leaf() const { return child1 == NULL_NODE; }
+        };
+
+        // Leaves are inserted next to the sibling that grows the tree's surface area least and
+        // AVL-style rotations keep it balanced, so queries stay logarithmic whatever the insert order
+        class AabbTree {
+        public:
+            std::vector<TreeNode> nodes;
+            uint32_t root = NULL_NODE;
+
+            uint32_t
+            insert(uint32_t proxy, const Aabb& fatBox)
+            {
+                const uint32_t leaf = allocateNode();
+                nodes[leaf].box = fatBox;
+                nodes[leaf].proxy = proxy;
+                insertLeaf(leaf);
+                return leaf;
+            }
+
+            void
+            remove(uint32_t leaf)
+            {
+                removeLeaf(leaf);
+                freeNode(leaf);
+            }
+
+            // Reinserted only when the new bounds leave the fattened box
+            bool
+            move(uint32_t leaf, const Aabb& bounds, float margin)
+            {
+                if (contains(nodes[leaf].box, bounds)) {
+                    return false;
+                }
+                removeLeaf(leaf);
+                nodes[leaf].box = { bounds.min - Vec3{ margin, margin, margin }, bounds.max + Vec3{ margin, margin, margin } };
+                insertLeaf(leaf);
+                return true;
+            }
+
+            template <typename Visit>
+            void
+            queryBox(const Aabb& box, Visit&& visit) const
+            {
+                if (root == NULL_NODE) return;
+                uint32_t stack[STACK_SIZE];
+                uint32_t top = 0;
+                stack[top++] = root;
+                while (top > 0) {
+                    const TreeNode& node = nodes[stack[--top]];
+                    if (!overlaps(node.box, box)) continue;
+                    if (node.leaf()) {
+                        visit(node.proxy);
+                    }
+                    else {
+                        stack[top++] = node.child1;
+                        stack[top++] = node.child2;
+                    }
+                }
+            }
+
+            template <typename Visit>
+            void
+            querySphere(const Vec3& center, float radiusSquared, Visit&& visit) const
+            {
+                if (root == NULL_NODE) return;
+                uint32_t stack[STACK_SIZE];
+                uint32_t top = 0;
+                stack[top++] = root;
+                while (top > 0) {
+                    const TreeNode& node = nodes[stack[--top]];
+                    if (!overlapsSphere(node.box, center, radiusSquared)) continue;
+                    if (node.leaf()) {
+                        visit(node.proxy);
+                    }
+                    else {
+                        stack[top++] = node.child1;
+                        stack[top++] = node.child2;
+                    }
+                }
+            }
+
+            // visit(proxy, inside): inside - the fattened box is entirely in the frustum
+            template <typename Visit>
+            void
+            queryFrustum(const Frustum& frustum, Visit&& visit) const
+            {
+                if (root == NULL_NODE) return;
+                uint32_t stack[STACK_SIZE];
+                uint32_t top = 0;
+                stack[top++] = root;
+                while (top > 0) {
+                    const uint32_t entry = stack[--top];
+                    const TreeNode& node = nodes[entry & ~INSIDE_BIT];
+                    uint32_t inside = entry & INSIDE_BIT;
+                    if (!inside) {
+                        const Containment containment = classify(frustum, node.box);
+                        if (containment == Containment::OUTSIDE) continue;
+                        if (containment == Containment::INSIDE) inside = INSIDE_BIT;
+                    }
+                    if (node.leaf()) {
+                        visit(node.proxy, inside != 0);
+                    }
+                    else {
+                        stack[top++] = node.child1 | inside;
+                        stack[top++] = node.child2 | inside;
+                    }
+                }
+            }
+
+            // testLeaf(proxy, limit) returns the hit distance or a negative value
+            template <typename TestLeaf>
+            void
+            raycast(const RayInfo& ray, float& best, TestLeaf&& testLeaf) const
+            {
+                if (root == NULL_NODE) return;
+                uint32_t stack[STACK_SIZE];
+                uint32_t top = 0;
+                stack[top++] = root;
+                while (top > 0) {
+                    const TreeNode& node = nodes[stack[--top]];
+                    if (rayEnter(ray, node.box, best) < 0.0f) continue;
+                    if (node.leaf()) {
+                        const float distance = testLeaf(node.proxy, best);
+                        if (distance >= 0.0f && distance < best) best = distance;
+                        continue;
+                    }
+                    // Nearer child on top, its hits shrink best before the other one is tested
+                    const float enter1 = rayEnter(ray, nodes[node.child1].box, best);
+                    const float enter2 = rayEnter(ray, nodes[node.child2].box, best);
+                    const bool firstNearer = enter1 >= 0.0f && (enter2 < 0.0f || enter1 <= enter2);
+                    const uint32_t nearChild = firstNearer ? node.child1 : node.child2;
+                    const uint32_t farChild = firstNearer ? node.child2 : node.child1;
+                    if ((firstNearer ? enter2 : enter1) >= 0.0f) stack[top++] = farChild;
+                    if ((firstNearer ? enter1 : enter2) >= 0.0f) stack[top++] = nearChild;
+                }
+            }
+
+        private:
+            std::vector<uint32_t> freeNodes;
+
+            uint32_t
+            allocateNode()
+            {
+                if (!freeNodes.empty()) {
+                    const uint32_t index = freeNodes.back();
+                    freeNodes.pop_back();
+                    nodes[index] = TreeNode{};
+                    return index;
+                }
+                nodes.emplace_back();
+                return static_cast<uint32_t>(nodes.size() - 1);
+            }
+
+            void
+            freeNode(uint32_t index)
+            {
+                nodes[index].height = -1;
+                freeNodes.push_back(index);
+            }
+
+            void
+            insertLeaf(uint32_t leaf)
+            {
+                if (root == NULL_NODE) {
+                    root = leaf;
+                    nodes[leaf].parent = NULL_NODE;
+                    return;
+                }
+
+                // Descend towards the cheapest sibling: cost of a new parent here vs pushing the leaf further down
+                const Aabb leafBox = nodes[leaf].box;
+                uint32_t index = root;
+                while (!nodes[index].leaf()) {
+                    const TreeNode& node = nodes[index];
+                    const float area = halfArea(node.box);
+                    const float combinedArea = halfArea(unionOf(node.box, leafBox));
+                    const float cost = 2.0f * combinedArea;
+                    const float inheritance = 2.0f * (combinedArea - area);
+
+                    auto descendCost = [&](uint32_t child) {
+                        const float grown = halfArea(unionOf(nodes[child].box, leafBox));
+                        return nodes[child].leaf() ? grown + inheritance : grown - halfArea(nodes[child].box) + inheritance;
+                    };
+                    const float cost1 = descendCost(node.child1);
+                    const float cost2 = descendCost(node.child2);
+                    if (cost < cost1 && cost < cost2) break;
+                    index = cost1 < cost2 ? node.child1 : node.child2;
+                }
+
+                const uint32_t sibling = index;
+                const uint32_t oldParent = nodes[sibling].parent;
+                const uint32_t newParent = allocateNode();
+                nodes[newParent].parent = oldParent;
+                nodes[newParent].box = unionOf(leafBox, nodes[sibling].box);
+                nodes[newParent].height = nodes[sibling].height + 1;
+                nodes[newParent].child1 = sibling;
+                nodes[newParent].child2 = leaf;
+                nodes[sibling].parent = newParent;
+                nodes[leaf].parent = newParent;
+                if (oldParent != NULL_NODE) {
+                    (nodes[oldParent].child1 == sibling ? nodes[oldParent].child1 : nodes[oldParent].child2) = newParent;
+                }
+                else {
+                    root = newParent;
+                }
+
+                refitFrom(nodes[leaf].parent);
+            }
+
+            void
+            removeLeaf(uint32_t leaf)
+            {
+                if (leaf == root) {
+                    root = NULL_NODE;
+                    return;
+                }
+
+                const uint32_t parent = nodes[leaf].parent;
+                const uint32_t grandParent = nodes[parent].parent;
+                const uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+                freeNode(parent);
+                if (grandParent != NULL_NODE) {
+                    (nodes[grandParent].child1 == parent ? nodes[grandParent].child1 : nodes[grandParent].child2) = sibling;
+                    nodes[sibling].parent = grandParent;
+                    refitFrom(grandParent);
+                }
+                else {
+                    root = sibling;
+                    nodes[sibling].parent = NULL_NODE;
+                }
+            }
+
+            // Rebalance and refit boxes and heights up to the root
+            void
+            refitFrom(uint32_t index)
+            {
+                while (index != NULL_NODE) {
+                    index = balance(index);
+                    TreeNode& node = nodes[index];
+                    node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+                    node.box = unionOf(nodes[node.child1].box, nodes[node.child2].box);
+                    index = node.parent;
+                }
+            }
+
+            // Rotates the taller grandchild up when the children's heights differ by more than one.
+            // Returns the node now at a's place
+            uint32_t
+            balance(uint32_t iA)
+            {
+                TreeNode& a = nodes[iA];
+                if (a.leaf() || a.height < 2) {
+                    return iA;
+                }
+
+                const uint32_t iB = a.child1;
+                const uint32_t iC = a.child2;
+                TreeNode& b = nodes[iB];
+                TreeNode& c = nodes[iC];
+                const int32_t difference = c.height - b.height;
+
+                if (difference > 1) {
+                    return rotateUp(iA, iC, false);
+                }
+                if (difference < -1) {
+                    return rotateUp(iA, iB, true);
+                }
+                return iA;
+            }
+
+            // Child (first or second child of a) takes a's place; a keeps the other child and the
+            // lower of child's children, child keeps the taller one
+            uint32_t
+            rotateUp(uint32_t iA, uint32_t iChild, bool childIsFirst)
+            {
+                TreeNode& a = nodes[iA];
+                TreeNode& child = nodes[iChild];
+                const uint32_t iF = child.child1;
+                const uint32_t iG = child.child2;
+                TreeNode& f = nodes[iF];
+                TreeNode& g = nodes[iG];
+                const uint32_t iOther = childIsFirst ? a.child2 : a.child1;
+                const TreeNode& other = nodes[iOther];
+
+                child.child1 = iA;
+                child.parent = a.parent;
+                a.parent = iChild;
+                if (child.parent != NULL_NODE) {
+                    (nodes[child.parent].child1 == iA ? nodes[child.parent].child1 : nodes[child.parent].child2) = iChild;
+                }
+                else {
+                    root = iChild;
+                }
+
+                const bool keepF = f.height > g.height;
+                const uint32_t iKeep = keepF ? iF : iG;
+                const uint32_t iMove = keepF ? iG : iF;
+                child.child2 = iKeep;
+                (childIsFirst ? a.child1 : a.child2) = iMove;
+                nodes[iMove].parent = iA;
+
+                a.box = unionOf(other.box, nodes[iMove].box);
+                a.height = 1 + std::max(other.height, nodes[iMove].height);
+                child.box = unionOf(a.box, nodes[iKeep].box);
+                child.height = 1 + std::max(a.height, nodes[iKeep].height);
+                return iChild;
+            }
+        };
+
+        // #############################################
+        // Loose uniform grid
+        // #############################################
+
+        constexpr int32_t GRID_COORDINATE_LIMIT = (1 << 20) - 1; // 21 bits per axis in the cell key
+        constexpr uint32_t OVERSIZED = NULL_NODE - 1;            // Proxy::node of objects kept outside the cells
+        constexpr uint32_t RAY_SEEN = 64;                        // Cells a ray remembers to test each once
+
+        struct GridCell {
+            int32_t x, y, z;
+            Aabb bounds;                  // Union of the objects: the loose cell
+            std::vector<uint32_t> proxies;
+            bool boundsDirty = false;     // Something left the cell, bounds may shrink at finish()
+        };
+
+        // Each object lives in the cell of its center and reaches at most half a cell out of it
+        // (loose factor 2), larger objects go to a separate list. Moves inside a cell touch nothing else
+        class LooseGrid {
+        public:
+            float cellSize = 8.0f;
+            std::vector<GridCell> cells;
+            std::vector<uint32_t> oversized;
+            Aabb occupied;                // Union of the cell bounds, as of finish()
+
+            void
+            insert(std::vector<Proxy>& proxies, uint32_t proxy)
+            {
+                Proxy& entry = proxies[proxy];
+                if (isOversized(entry.bounds)) {
+                    entry.node = OVERSIZED;
+                    entry.slot = static_cast<uint32_t>(oversized.size());
+                    oversized.push_back(proxy);
+                    return;
+                }
+                int32_t x, y, z;
+                cellOf(entry.bounds, x, y, z);
+                const uint32_t cellIndex = findOrCreate(x, y, z);
+                GridCell& cell = cells[cellIndex];
+                cell.bounds = cell.proxies.empty() && !cell.boundsDirty ? entry.bounds : unionOf(cell.bounds, entry.bounds);
+                entry.node = cellIndex;
+                entry.slot = static_cast<uint32_t>(cell.proxies.size());
+                cell.proxies.push_back(proxy);
+            }
+
+            void
+            remove(std::vector<Proxy>& proxies, uint32_t proxy)
+            {
+                Proxy& entry = proxies[proxy];
+                std::vector<uint32_t>& list = entry.node == OVERSIZED ? oversized : cells[entry.node].proxies;
+                const uint32_t last = list.back();
+                list[entry.slot] = last;
+                proxies[last].slot = entry.slot;
+                list.pop_back();
+                if (entry.node != OVERSIZED) {
+                    cells[entry.node].boundsDirty = true;
+                }
+            }
+
+            void
+            move(std::vector<Proxy>& proxies, uint32_t proxy, const Aabb& bounds)
+            {
+                Proxy& entry = proxies[proxy];
+                if (entry.node == OVERSIZED && isOversized(bounds)) {
+                    entry.bounds = bounds;
+                    return;
+                }
+                if (entry.node != OVERSIZED && !isOversized(bounds)) {
+                    int32_t x, y, z;
+                    cellOf(bounds, x, y, z);
+                    GridCell& cell = cells[entry.node];
+                    if (cell.x == x && cell.y == y && cell.z == z) {
+                        entry.bounds = bounds;
+                        cell.bounds = unionOf(cell.bounds, bounds);
+                        cell.boundsDirty = true;
+                        return;
+                    }
+                }
+                remove(proxies, proxy);
+                entry.bounds = bounds;
+                insert(proxies, proxy);
+            }
+
+            // Tightens the bounds of the cells that lost objects and drops empty cells
+            void
+            finish(std::vector<Proxy>& proxies)
+            {
+                for (uint32_t index = 0; index < cells.size();) {
+                    GridCell& cell = cells[index];
+                    if (cell.proxies.empty()) {
+                        cellByKey.erase(key(cell.x, cell.y, cell.z));
+                        if (index + 1 != cells.size()) {
+                            cell = std::move(cells.back());
+                            cellByKey[key(cell.x, cell.y, cell.z)] = index;
+                            for (uint32_t proxy : cell.proxies) {
+                                proxies[proxy].node = index;
+                            }
+                        }
+                        cells.pop_back();
+                        continue;
+                    }
+                    if (cell.boundsDirty) {
+                        cell.bounds = proxies[cell.proxies[0]].bounds;
+                        for (uint32_t proxy : cell.proxies) {
+                            cell.bounds = unionOf(cell.bounds, proxies[proxy].bounds);
+                        }
+                        cell.boundsDirty = false;
+                    }
+                    index++;
+                }
+
+                occupied = cells.empty() ? Aabb{} : cells[0].bounds;
+                for (const GridCell& cell : cells) {
+                    occupied = unionOf(occupied, cell.bounds);
+                }
+            }
+
+            // visitCell(cell) for the cells whose loose bounds may overlap box
+            template <typename VisitCell>
+            void
+            cellsNear(const Aabb& box, VisitCell&& visitCell) const
+            {
+                const float loose = cellSize * 0.5f;
+                int32_t x0, y0, z0, x1, y1, z1;
+                coordinates(box.min - Vec3{ loose, loose, loose }, x0, y0, z0);
+                coordinates(box.max + Vec3{ loose, loose, loose }, x1, y1, z1);
+                const double range = (double(x1) - x0 + 1) * (double(y1) - y0 + 1) * (double(z1) - z0 + 1);
+
+                // Small query: look its cells up; large one: walking the occupied cells is cheaper
+                if (range <= double(cells.size())) {
+                    for (int32_t z = z0; z <= z1; z++) {
+                        for (int32_t y = y0; y <= y1; y++) {
+                            for (int32_t x = x0; x <= x1; x++) {
+                                const uint32_t cell = find(x, y, z);
+                                if (cell != NULL_NODE) {
+                                    visitCell(cells[cell]);
+                                }
+                            }
+                        }
+                    }
+                }
+                else {
+                    for (const GridCell& cell : cells) {
+                        visitCell(cell);
+                    }
+                }
+            }
+
+            // Walks the cells the ray passes (3D DDA) until best; candidates are each passed cell and
+            // its neighbours, since an object reaches at most half a cell into the next one.
+            // visitCell(cell) may lower best
+            template <typename VisitCell>
+            void
+            cellsAlongRay(const RayInfo& ray, const float& best, VisitCell&& visitCell) const
+            {
+                if (cells.empty()) return;
+                const float loose = cellSize * 0.5f;
+                const Aabb region = { occupied.min - Vec3{ loose, loose, loose }, occupied.max + Vec3{ loose, loose, loose } };
+                float t = rayEnter(ray, region, best);
+                if (t < 0.0f) return;
+
+                const Vec3 start = ray.origin + ray.direction * t;
+                int32_t cell[3];
+                coordinates(start, cell[0], cell[1], cell[2]);
+
+                const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+                const float inverse[3] = { ray.inverse.x, ray.inverse.y, ray.inverse.z };
+                int32_t step[3];
+                float next[3], delta[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    step[axis] = inverse[axis] >= 0.0f ? 1 : -1;
+                    const float boundary = (float(cell[axis]) + (step[axis] > 0 ? 1.0f : 0.0f)) * cellSize;
+                    next[axis] = std::isinf(inverse[axis]) ? INFINITY : (boundary - origin[axis]) * inverse[axis];
+                    delta[axis] = std::fabs(cellSize * inverse[axis]);
+                }
+
+                const Vec3 t1 = (region.min - ray.origin) * ray.inverse;
+                const Vec3 t2 = (region.max - ray.origin) * ray.inverse;
+                const Vec3 far = componentMax(t1, t2);
+                const float exit = std::min(std::min(far.x, far.y), far.z);
+
+                uint32_t seen[RAY_SEEN];
+                uint32_t seenCount = 0;
+                while (t <= best && t <= exit) {
+                    for (int32_t dz = -1; dz <= 1; dz++) {
+                        for (int32_t dy = -1; dy <= 1; dy++) {
+                            for (int32_t dx = -1; dx <= 1; dx++) {
+                                const uint32_t index = find(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+                                if (index == NULL_NODE) continue;
+                                uint32_t* seenEnd = seen + std::min(seenCount, RAY_SEEN);
+                                if (std::find(seen, seenEnd, index) != seenEnd) continue;
+                                seen[seenCount++ % RAY_SEEN] = index;
+                                visitCell(cells[index]);
+                            }
+                        }
+                    }
+
+                    const int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+                    t = next[axis];
+                    next[axis] += delta[axis];
+                    cell[axis] += step[axis];
+                    if (cell[axis] < -GRID_COORDINATE_LIMIT || cell[axis] > GRID_COORDINATE_LIMIT) break;
+                }
+            }
+
+        private:
+            std::unordered_map<uint64_t, uint32_t> cellByKey;
+
+            bool
+            isOversized(const Aabb& bounds) const
+            {
+                const Vec3 size = bounds.max - bounds.min;
+                return std::max(std::max(size.x, size.y), size.z) > cellSize;
+            }
+
+            static uint64_t
+            key(int32_t x, int32_t y, int32_t z)
+            {
+                const uint64_t mask = (1u << 21) - 1;
+                return (uint64_t(x + GRID_COORDINATE_LIMIT) & mask)
+                    | ((uint64_t(y + GRID_COORDINATE_LIMIT) & mask) << 21)
+                    | ((uint64_t(z + GRID_COORDINATE_LIMIT) & mask) << 42);
+            }
+
+            uint32_t
+            find(int32_t x, int32_t y, int32_t z) const
+            {
+                auto found = cellByKey.find(key(x, y, z));
+                return found != cellByKey.end() ? found->second : NULL_NODE;
+            }
+
+            int32_t
+            coordinate(float value) const
+            {
+                const float cell = std::floor(value / cellSize);
+                return static_cast<int32_t>(std::clamp(cell, float(-GRID_COORDINATE_LIMIT), float(GRID_COORDINATE_LIMIT)));
+            }
+
+            void
+            coordinates(const Vec3& point, int32_t& x, int32_t& y, int32_t& z) const
+            {
+                x = coordinate(point.x);
+                y = coordinate(point.y);
+                z = coordinate(point.z);
+            }
+
+            void
+            cellOf(const Aabb& bounds, int32_t& x, int32_t& y, int32_t& z) const
+            {
+                coordinates((bounds.min + bounds.max) * 0.5f, x, y, z);
+            }
+
+            uint32_t
+            findOrCreate(int32_t x, int32_t y, int32_t z)
+            {
+                const uint32_t existing = find(x, y, z);
+                if (existing != NULL_NODE) {
+                    return existing;
+                }
+                const uint32_t index = static_cast<uint32_t>(cells.size());
+                GridCell cell;
+                cell.x = x;
+                cell.y = y;
+                cell.z = z;
+                cells.push_back(std::move(cell));
+                cellByKey.emplace(key(x, y, z), index);
+                return index;
+            }
+        };
+
+        // Corners of the frustum from its planes, three at a time; false when they do not meet in a point
+        bool
+        frustumBounds(const Frustum& frustum, Aabb& bounds)
+        {
+            const int sides[2][2] = { { 0, 1 }, { 2, 3 } }; // Left/right, bottom/top
+            bool first = true;
+            for (int depth = 4; depth <= 5; depth++) {
+                for (int horizontal : sides[0]) {
+                    for (int vertical : sides[1]) {
+                        const Vec4& p1 = frustum.planes[depth];
+                        const Vec4& p2 = frustum.planes[horizontal];
+                        const Vec4& p3 = frustum.planes[vertical];
+                        const Vec3 n1 = { p1.x, p1.y, p1.z }, n2 = { p2.x, p2.y, p2.z }, n3 = { p3.x, p3.y, p3.z };
+                        const Vec3 c23 = cross(n2, n3), c31 = cross(n3, n1), c12 = cross(n1, n2);
+                        const float determinant = dot(n1, c23);
+                        if (std::fabs(determinant) < 1.0e-12f) return false;
+                        const Vec3 corner = (c23 * -p1.w + c31 * -p2.w + c12 * -p3.w) * (1.0f / determinant);
+                        if (!std::isfinite(corner.x) || !std::isfinite(corner.y) || !std::isfinite(corner.z)) return false;
+                        bounds = first ? Aabb{ corner, corner } : Aabb{ componentMin(bounds.min, corner), componentMax(bounds.max, corner) };
+                        first = false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        enum class PendingType : uint8_t { INSERT, UPDATE, REMOVE };
+
+        struct PendingChange {
+            PendingType type;
+            uint32_t proxy;
+            uint32_t userData;
+            Aabb bounds;
+        };
+
+    } // namespace
+
+    class SpatialIndex::Impl {
+    public:
+        SpatialConfig config;
+        std::vector<Proxy> proxies;
+        uint32_t committed = 0;
+        AabbTree tree;
+        LooseGrid grid;
+
+        // Producers of insert / update / remove
+        std::mutex mutex;
+        std::vector<PendingChange> pending;
+        std::vector<uint32_t> freeProxies;   // Removed at a commit, safe to hand out again
+        uint32_t nextProxy = 0;
+
+        std::vector<PendingChange> applying; // Swapped with pending at commit, keeps its capacity
+
+        explicit Impl(const SpatialConfig& spatialConfig) : config(spatialConfig)
+        {
+            grid.cellSize = std::max(config.cellSize, 1.0e-3f);
+        }
+
+        Aabb
+        fatten(const Aabb& bounds) const
+        {
+            const Vec3 margin = { config.fatMargin, config.fatMargin, config.fatMargin };
+            return { bounds.min - margin, bounds.max + margin };
+        }
+
+        void
+        apply(const PendingChange& change, std::vector<uint32_t>& freed)
+        {
+            if (change.proxy >= proxies.size()) {
+                proxies.resize(size_t(change.proxy) + 1);
+            }
+            Proxy& proxy = proxies[change.proxy];
+            const bool useTree = config.structure == SpatialStructure::AABB_TREE;
+
+            switch (change.type) {
+            case PendingType::INSERT:
+                proxy.bounds = change.bounds;
+                proxy.userData = change.userData;
+                proxy.alive = true;
+                if (useTree) {
+                    proxy.node = tree.insert(change.proxy, fatten(change.bounds));
+                }
+                else {
+                    grid.insert(proxies, change.proxy);
+                }
+                committed++;
+                break;
+            case PendingType::UPDATE:
+                if (!proxy.alive) break;
+                if (useTree) {
+                    proxy.bounds = change.bounds;
+                    tree.move(proxy.node, change.bounds, config.fatMargin);
+                }
+                else {
+                    grid.move(proxies, change.proxy, change.bounds);
+                }
+                break;
+            case PendingType::REMOVE:
+                if (!proxy.alive) break;
+                if (useTree) {
+                    tree.remove(proxy.node);
+                }
+                else {
+                    grid.remove(proxies, change.proxy);
+                }
+                proxy.alive = false;
+                committed--;
+                freed.push_back(change.proxy);
+                break;
+            }
+        }
+
+        // Per query type: candidate proxies from the structure, exact test on the proxy bounds
+
+        void
+        queryBox(const Aabb& box, std::vector<uint32_t>& results) const
+        {
+            auto visit = [&](uint32_t proxy) {
+                if (overlaps(proxies[proxy].bounds, box)) results.push_back(proxies[proxy].userData);
+            };
+            if (config.structure == SpatialStructure::AABB_TREE) {
+                tree.queryBox(box, visit);
+                return;
+            }
+            grid.cellsNear(box, [&](const GridCell& cell) {
+                if (!overlaps(cell.bounds, box)) return;
+                for (uint32_t proxy : cell.proxies) visit(proxy);
+            });
+            for (uint32_t proxy : grid.oversized) visit(proxy);
+        }
+
+        void
+        querySphere(const Vec3& center, float radius, std::vector<uint32_t>& results) const
+        {
+            const float radiusSquared = radius * radius;
+            auto visit = [&](uint32_t proxy) {
+                if (overlapsSphere(proxies[proxy].bounds, center, radiusSquared)) results.push_back(proxies[proxy].userData);
+            };
+            if (config.structure == SpatialStructure::AABB_TREE) {
+                tree.querySphere(center, radiusSquared, visit);
+                return;
+            }
+            const Aabb box = { center - Vec3{ radius, radius, radius }, center + Vec3{ radius, radius, radius } };
+            grid.cellsNear(box, [&](const GridCell& cell) {
+                if (!overlapsSphere(cell.bounds, center, radiusSquared)) return;
+                for (uint32_t proxy : cell.proxies) visit(proxy);
+            });
+            for (uint32_t proxy : grid.oversized) visit(proxy);
+        }
+
+        void
+        queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const
+        {
+            // inside: the enclosing box is in the frustum, so are the exact bounds
+            auto visit = [&](uint32_t proxy, bool inside) {
+                if (inside || classify(frustum, proxies[proxy].bounds) != Containment::OUTSIDE) {
+                    results.push_back(proxies[proxy].userData);
+                }
+            };
+            if (config.structure == SpatialStructure::AABB_TREE) {
+                tree.queryFrustum(frustum, visit);
+                return;
+            }
+            auto visitCell = [&](const GridCell& cell) {
+                const Containment containment = classify(frustum, cell.bounds);
+                if (containment == Containment::OUTSIDE) return;
+                for (uint32_t proxy : cell.proxies) visit(proxy, containment == Containment::INSIDE);
+            };
+            Aabb bounds;
+            if (frustumBounds(frustum, bounds)) {
+                grid.cellsNear(bounds, visitCell);
+            }
+            else {
+                for (const GridCell& cell : grid.cells) visitCell(cell);
+            }
+            for (uint32_t proxy : grid.oversized) visit(proxy, false);
+        }
+
+        RayHit
+        raycast(const Ray& ray) const
+        {
+            const RayInfo info = prepareRay(ray);
+            RayHit hit;
+            float best = ray.maxDistance;
+            auto testLeaf = [&](uint32_t proxy, float limit) {
+                const float distance = rayEnter(info, proxies[proxy].bounds, limit);
+                if (distance >= 0.0f && (hit.userData == VF_NO_HIT || distance < best)) {
+                    hit.userData = proxies[proxy].userData;
+                    hit.distance = distance;
+                }
+                return distance;
+            };
+            if (config.structure == SpatialStructure::AABB_TREE) {
+                tree.raycast(info, best, testLeaf);
+                return hit;
+            }
+            auto testProxy = [&](uint32_t proxy) {
+                const float distance = testLeaf(proxy, best);
+                if (distance >= 0.0f && distance < best) best = distance;
+            };
+            for (uint32_t proxy : grid.oversized) testProxy(proxy);
+            grid.cellsAlongRay(info, best, [&](const GridCell& cell) {
+                if (rayEnter(info, cell.bounds, best) < 0.0f) return;
+                for (uint32_t proxy : cell.proxies) testProxy(proxy);
+            });
+            return hit;
+        }
+
+        template <typename Query>
+        static void
+        batch(uint32_t count, ThreadPool* pool, Query&& query)
+        {
+            auto run = [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) {
+                    query(i);
+                }
+            };
+            if (pool != nullptr && count > BATCH_GRAIN) {
+                pool->parallelFor(0, count, BATCH_GRAIN, run);
+            }
+            else {
+                run(0, count);
+            }
+        }
+    };
+
+    SpatialIndex::SpatialIndex(const SpatialConfig& config)
+        : pImpl(std::make_unique<Impl>(config))
+    {
+    }
+
+    SpatialIndex::~SpatialIndex() = default;
+
+    uint32_t
+    SpatialIndex::insert(const Aabb& bounds, uint32_t userData)
+    {
+        std::lock_guard<std::mutex> lock(pImpl->mutex);
+        uint32_t proxy;
+        if (!pImpl->freeProxies.empty()) {
+            proxy = pImpl->freeProxies.back();
+            pImpl->freeProxies.pop_back();
+        }
+        else {
+            proxy = pImpl->nextProxy++;
+        }
+        pImpl->pending.push_back({ PendingType::INSERT, proxy, userData, bounds });
+        return proxy;
+    }
+
+    void
+    SpatialIndex::update(uint32_t proxy, const Aabb& bounds)
+    {
+        std::lock_guard<std::mutex> lock(pImpl->mutex);
+        pImpl->pending.push_back({ PendingType::UPDATE, proxy, 0, bounds });
+    }
+
+    void
+    SpatialIndex::remove(uint32_t proxy)
+    {
+        std::lock_guard<std::mutex> lock(pImpl->mutex);
+        pImpl->pending.push_back({ PendingType::REMOVE, proxy, 0, Aabb{} });
+    }
+
+    void
+    SpatialIndex::commit()
+    {
+        VF_TRACE_ZONE("Spatial index commit");
+        Impl& impl = *pImpl;
+        {
+            std::lock_guard<std::mutex> lock(impl.mutex);
+            impl.applying.swap(impl.pending);
+        }
+
+        std::vector<uint32_t> freed;
+        for (const PendingChange& change : impl.applying) {
+            impl.apply(change, freed);
+        }
+        impl.applying.clear();
+        if (impl.config.structure == SpatialStructure::LOOSE_GRID) {
+            impl.grid.finish(impl.proxies);
+        }
+
+        if (!freed.empty()) {
+            std::lock_guard<std::mutex> lock(impl.mutex);
+            impl.freeProxies.insert(impl.freeProxies.end(), freed.begin(), freed.end());
+        }
+    }
+
+    uint32_t
+    SpatialIndex::size() const
+    {
+        return pImpl->committed;
+    }
+
+    void
+    SpatialIndex::queryBox(const Aabb& box, std::vector<uint32_t>& results) const
+    {
+        pImpl->queryBox(box, results);
+    }
+
+    void
+    SpatialIndex::querySphere(const Vec3& center, float radius, std::vector<uint32_t>& results) const
+    {
+        pImpl->querySphere(center, radius, results);
+    }
+
+    void
+    SpatialIndex::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const
+    {
+        pImpl->queryFrustum(frustum, results);
+    }
+
+    RayHit
+    SpatialIndex::raycast(const Ray& ray) const
+    {
+        return pImpl->raycast(ray);
+    }
+
+    void
+    SpatialIndex::queryBoxes(const Aabb* boxes, uint32_t count, std::vector<uint32_t>* results, ThreadPool* pool) const
+    {
+        const Impl& impl = *pImpl;
+        Impl::batch(count, pool, [&](size_t i) {
+            results[i].clear();
+            impl.queryBox(boxes[i], results[i]);
+        });
+    }
+
+    void
+    SpatialIndex::querySpheres(const Vec3* centers, const float* radii, uint32_t count, std::vector<uint32_t>* results, ThreadPool* pool) const
+    {
+        const Impl& impl = *pImpl;
+        Impl::batch(count, pool, [&](size_t i) {
+            results[i].clear();
+            impl.querySphere(centers[i], radii[i], results[i]);
+        });
+    }
+
+    void
+    SpatialIndex::queryFrustums(const Frustum* frustums, uint32_t count, std::vector<uint32_t>* results, ThreadPool* pool) const
+    {
+        const Impl& impl = *pImpl;
+        Impl::batch(count, pool, [&](size_t i) {
+            results[i].clear();
+            impl.queryFrustum(frustums[i], results[i]);
+        });
+    }
+
+    void
+    SpatialIndex::raycasts(const Ray* rays, uint32_t count, RayHit* hits, ThreadPool* pool) const
+    {
+        const Impl& impl = *pImpl;
+        Impl::batch(count, pool, [&](size_t i) {
+            hits[i] = impl.raycast(rays[i]);
+        });
+    }
+
+} // namespace vf_core
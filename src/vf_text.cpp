@@ -0,0 +1,1169 @@
+﻿#include <vFrame/vf_text.hpp>
+#include <vFrame/vf_log.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace vf_core {
+
+    namespace {
+
+        constexpr uint32_t CACHE_MAGIC = 0x44534656;  // "VFSD"
+        constexpr uint32_t CACHE_VERSION = 1;
+        constexpr uint32_t ATLAS_PADDING = 1;         // Between glyphs, so bilinear taps stay inside their own field
+        constexpr uint32_t MAX_COMPOSITE_DEPTH = 8;
+        constexpr uint32_t MAX_CURVE_STEPS = 16;
+        constexpr size_t GLYPH_GRAIN = 4;             // Glyphs per task while rasterizing
+        constexpr uint32_t SWEEP_INTERVAL = 32;       // Frames between sweeps of the layout cache
+
+        uint64_t
+        hashBytes(const void* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull)
+        {
+            const uint8_t* ptr = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash ^= ptr[i];
+                hash *= 0x100000001B3ull;
+            }
+            return hash;
+        }
+
+        uint32_t
+        nextPowerOfTwo(uint32_t value)
+        {
+            uint32_t result = 1;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        // ### TrueType reading ###
+
+        // Big endian reads with bounds checks: a truncated or hostile file throws instead of reading past the data
+        class FontData {
+        public:
+            FontData(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+            void
+            check(size_t offset, size_t bytes) const
+            {
+                if (offset > size_ || bytes > size_ - offset) {
+                    throw std::runtime_error("corrupted font data!");
+                }
+            }
+
+            uint8_t u8(size_t offset) const { check(offset, 1); return data_[offset]; }
+            int8_t i8(size_t offset) const { return static_cast<int8_t>(u8(offset)); }
+
+            uint16_t
+            u16(size_t offset) const
+            {
+                check(offset, 2);
+                return static_cast<uint16_t>(data_[offset] << 8 | data_[offset + 1]);
+            }
+
+            int16_t i16(size_t offset) const { return static_cast<int16_t>(u16(offset)); }
+
+            uint32_t
+            u32(size_t offset) const
+            {
+                check(offset, 4);
+                return static_cast<uint32_t>(data_[offset]) << 24 | static_cast<uint32_t>(data_[offset + 1]) << 16
+                    | static_cast<uint32_t>(data_[offset + 2]) << 8 | data_[offset + 3];
+            }
+
+        private:
+            const uint8_t* data_;
+            size_t size_;
+        };
+
+        struct Point {
+            float x, y;
+        };
+
+        // Quadratic curve in font units, a line has its control point in the middle
+        struct Curve {
+            Point p0, control, p1;
+        };
+
+        struct Segment {
+            float ax, ay, bx, by;
+            float minY, maxY;
+        };
+
+        class TrueTypeFont {
+        public:
+            TrueTypeFont(const uint8_t* data, size_t size)
+                : file_(data, size)
+            {
+                const uint32_t version = file_.u32(0);
+                if (version != 0x00010000 && version != 0x74727565) { // 1.0 or 'true'; 'OTTO' is CFF
+                    throw std::runtime_error("unsupported font data: only TrueType outlines are supported!");
+                }
+
+                const uint16_t tableCount = file_.u16(4);
+                for (uint32_t i = 0; i < tableCount; i++) {
+                    const size_t record = 12 + 16 * static_cast<size_t>(i);
+                    const uint32_t tag = file_.u32(record);
+                    const uint32_t offset = file_.u32(record + 8);
+                    const uint32_t length = file_.u32(record + 12);
+                    file_.check(offset, length);
+                    switch (tag) {
+                    case 0x636D6170: cmap_ = offset; break; // cmap
+                    case 0x676C7966: glyf_ = offset; break; // glyf
+                    case 0x68656164: head_ = offset; break; // head
+                    case 0x68686561: hhea_ = offset; break; // hhea
+                    case 0x686D7478: hmtx_ = offset; break; // hmtx
+                    case 0x6B65726E: kern_ = offset; break; // kern
+                    case 0x6C6F6361: loca_ = offset; break; // loca
+                    case 0x6D617870: maxp_ = offset; break; // maxp
+                    default: break;
+                    }
+                }
+                if (!cmap_ || !glyf_ || !head_ || !hhea_ || !hmtx_ || !loca_ || !maxp_) {
+                    throw std::runtime_error("unsupported font data: missing TrueType tables!");
+                }
+
+                unitsPerEm = file_.u16(head_ + 18);
+                longLoca_ = file_.i16(head_ + 50) != 0;
+                glyphCount_ = file_.u16(maxp_ + 4);
+                ascender = file_.i16(hhea_ + 4);
+                descender = file_.i16(hhea_ + 6);
+                lineGap = file_.i16(hhea_ + 8);
+                hMetricCount_ = file_.u16(hhea_ + 34);
+                if (unitsPerEm == 0 || hMetricCount_ == 0) {
+                    throw std::runtime_error("corrupted font data!");
+                }
+                selectCharacterMap();
+            }
+
+            uint32_t
+            glyphIndex(uint32_t codepoint) const
+            {
+                uint32_t index = 0;
+                if (cmapFormat_ == 4) {
+                    index = glyphIndexFormat4(codepoint);
+                }
+                else if (cmapFormat_ == 12) {
+                    index = glyphIndexFormat12(codepoint);
+                }
+                return index < glyphCount_ ? index : 0;
+            }
+
+            float
+            advance(uint32_t glyph) const
+            {
+                const uint32_t metric = std::min(glyph, static_cast<uint32_t>(hMetricCount_ - 1));
+                return file_.u16(hmtx_ + 4 * static_cast<size_t>(metric));
+            }
+
+            // False for glyphs without outline (space)
+            bool
+            bounds(uint32_t glyph, float& xMin, float& yMin, float& xMax, float& yMax) const
+            {
+                size_t offset;
+                if (!glyphOffset(glyph, offset)) return false;
+                xMin = file_.i16(offset + 2);
+                yMin = file_.i16(offset + 4);
+                xMax = file_.i16(offset + 6);
+                yMax = file_.i16(offset + 8);
+                return xMax > xMin && yMax > yMin;
+            }
+
+            void
+            outline(uint32_t glyph, std::vector<Curve>& curves) const
+            {
+                const float identity[6] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+                appendOutline(glyph, identity, 0, curves);
+            }
+
+            // Format 0 horizontal pairs, only those between glyphs in the set (sorted glyph indices)
+            void
+            kerningPairs(const std::vector<uint32_t>& glyphs, std::unordered_map<uint32_t, float>& pairs) const
+            {
+                if (!kern_ || file_.u16(kern_) != 0) return; // Apple's version 1 table is not read
+
+                const uint16_t tableCount = file_.u16(kern_ + 2);
+                size_t offset = kern_ + 4;
+                for (uint32_t t = 0; t < tableCount; t++) {
+                    const uint16_t length = file_.u16(offset + 2);
+                    const uint16_t coverage = file_.u16(offset + 4);
+                    // Format 0, horizontal, not minimum values, not cross stream
+                    if ((coverage >> 8) == 0 && (coverage & 0x7) == 0x1) {
+                        const uint16_t pairCount = file_.u16(offset + 6);
+                        for (uint32_t i = 0; i < pairCount; i++) {
+                            const size_t pair = offset + 14 + 6 * static_cast<size_t>(i);
+                            const uint16_t left = file_.u16(pair);
+                            const uint16_t right = file_.u16(pair + 2);
+                            if (std::binary_search(glyphs.begin(), glyphs.end(), left) &&
+                                std::binary_search(glyphs.begin(), glyphs.end(), right)) {
+                                pairs[static_cast<uint32_t>(left) << 16 | right] += file_.i16(pair + 4);
+                            }
+                        }
+                    }
+                    if (length == 0) break;
+                    offset += length;
+                }
+            }
+
+            uint16_t unitsPerEm = 0;
+            int16_t ascender = 0;
+            int16_t descender = 0;
+            int16_t lineGap = 0;
+
+        private:
+            void
+            selectCharacterMap()
+            {
+                // Full Unicode (format 12) over the Basic Multilingual Plane (format 4)
+                const uint16_t tableCount = file_.u16(cmap_ + 2);
+                for (uint32_t i = 0; i < tableCount; i++) {
+                    const size_t record = cmap_ + 4 + 8 * static_cast<size_t>(i);
+                    const uint16_t platform = file_.u16(record);
+                    const uint16_t encoding = file_.u16(record + 2);
+                    const size_t subtable = cmap_ + file_.u32(record + 4);
+                    const bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+                    if (!unicode) continue;
+
+                    const uint16_t format = file_.u16(subtable);
+                    if (format == 12 || (format == 4 && cmapFormat_ != 12)) {
+                        cmapFormat_ = format;
+                        cmapSubtable_ = subtable;
+                    }
+                }
+                if (cmapFormat_ == 0) {
+                    throw std::runtime_error("unsupported font data: no Unicode character map!");
+                }
+            }
+
+            uint32_t
+            glyphIndexFormat4(uint32_t codepoint) const
+            {
+                if (codepoint > 0xFFFF) return 0;
+
+                const size_t segmentCount = file_.u16(cmapSubtable_ + 6) / 2;
+                const size_t endCodes = cmapSubtable_ + 14;
+                const size_t startCodes = endCodes + 2 * segmentCount + 2;
+                const size_t deltas = startCodes + 2 * segmentCount;
+                const size_t rangeOffsets = deltas + 2 * segmentCount;
+
+                // First segment whose end is not below the codepoint
+                size_t low = 0;
+                size_t high = segmentCount;
+                while (low < high) {
+                    const size_t middle = (low + high) / 2;
+                    if (file_.u16(endCodes + 2 * middle) < codepoint) {
+                        low = middle + 1;
+                    }
+                    else {
+                        high = middle;
+                    }
+                }
+                if (low == segmentCount) return 0;
+
+                const uint16_t start = file_.u16(startCodes + 2 * low);
+                if (codepoint < start) return 0;
+
+                const uint16_t delta = file_.u16(deltas + 2 * low);
+                const uint16_t rangeOffset = file_.u16(rangeOffsets + 2 * low);
+                if (rangeOffset == 0) {
+                    return (codepoint + delta) & 0xFFFF;
+                }
+                const uint16_t glyph = file_.u16(rangeOffsets + 2 * low + rangeOffset + 2 * (codepoint - start));
+                return glyph == 0 ? 0 : (glyph + delta) & 0xFFFF;
+            }
+
+            uint32_t
+            glyphIndexFormat12(uint32_t codepoint) const
+            {
+                const uint32_t groupCount = file_.u32(cmapSubtable_ + 12);
+                const size_t groups = cmapSubtable_ + 16;
+
+                uint32_t low = 0;
+                uint32_t high = groupCount;
+                while (low < high) {
+                    const uint32_t middle = low + (high - low) / 2;
+                    const size_t group = groups + 12 * static_cast<size_t>(middle);
+                    if (file_.u32(group + 4) < codepoint) {
+                        low = middle + 1;
+                    }
+                    else {
+                        high = middle;
+                    }
+                }
+                if (low == groupCount) return 0;
+
+                const size_t group = groups + 12 * static_cast<size_t>(low);
+                const uint32_t start = file_.u32(group);
+                return codepoint < start ? 0 : file_.u32(group + 8) + (codepoint - start);
+            }
+
+            bool
+            glyphOffset(uint32_t glyph, size_t& offset) const
+            {
+                if (glyph >= glyphCount_) return false;
+
+                size_t begin, end;
+                if (longLoca_) {
+                    begin = file_.u32(loca_ + 4 * static_cast<size_t>(glyph));
+                    end = file_.u32(loca_ + 4 * static_cast<size_t>(glyph) + 4);
+                }
+                else {
+                    begin = 2 * static_cast<size_t>(file_.u16(loca_ + 2 * static_cast<size_t>(glyph)));
+                    end = 2 * static_cast<size_t>(file_.u16(loca_ + 2 * static_cast<size_t>(glyph) + 2));
+                }
+                if (end <= begin) return false;
+
+                offset = glyf_ + begin;
+                file_.check(offset, end - begin);
+                return true;
+            }
+
+            // transform: x' = m[0] x + m[2] y + m[4], y' = m[1] x + m[3] y + m[5]
+            void
+            appendOutline(uint32_t glyph, const float transform[6], uint32_t depth, std::vector<Curve>& curves) const
+            {
+                size_t offset;
+                if (depth > MAX_COMPOSITE_DEPTH || !glyphOffset(glyph, offset)) return;
+
+                const int16_t contourCount = file_.i16(offset);
+                if (contourCount >= 0) {
+                    appendSimple(offset, static_cast<uint32_t>(contourCount), transform, curves);
+                }
+                else {
+                    appendComposite(offset, transform, depth, curves);
+                }
+            }
+
+            void
+            appendSimple(size_t offset, uint32_t contourCount, const float transform[6], std::vector<Curve>& curves) const
+            {
+                if (contourCount == 0) return;
+
+                const size_t endPoints = offset + 10;
+                const uint32_t pointCount = file_.u16(endPoints + 2 * (contourCount - 1)) + 1u;
+                const size_t instructionLength = file_.u16(endPoints + 2 * contourCount);
+                size_t cursor = endPoints + 2 * contourCount + 2 + instructionLength;
+
+                std::vector<uint8_t> flags(pointCount);
+                for (uint32_t i = 0; i < pointCount;) {
+                    const uint8_t flag = file_.u8(cursor++);
+                    uint32_t repeat = 1;
+                    if (flag & 0x08) {
+                        repeat += file_.u8(cursor++);
+                    }
+                    for (; repeat > 0 && i < pointCount; repeat--) {
+                        flags[i++] = flag;
+                    }
+                }
+
+                // Coordinates are deltas: one byte with a sign flag, a repeated value or a signed short
+                std::vector<Point> points(pointCount);
+                int32_t value = 0;
+                for (uint32_t i = 0; i < pointCount; i++) {
+                    if (flags[i] & 0x02) {
+                        const int32_t delta = file_.u8(cursor++);
+                        value += (flags[i] & 0x10) ? delta : -delta;
+                    }
+                    else if (!(flags[i] & 0x10)) {
+                        value += file_.i16(cursor);
+                        cursor += 2;
+                    }
+                    points[i].x = static_cast<float>(value);
+                }
+                value = 0;
+                for (uint32_t i = 0; i < pointCount; i++) {
+                    if (flags[i] & 0x04) {
+                        const int32_t delta = file_.u8(cursor++);
+                        value += (flags[i] & 0x20) ? delta : -delta;
+                    }
+                    else if (!(flags[i] & 0x20)) {
+                        value += file_.i16(cursor);
+                        cursor += 2;
+                    }
+                    points[i].y = static_cast<float>(value);
+                }
+
+                for (Point& point : points) {
+                    const Point source = point;
+                    point.x = transform[0] * source.x + transform[2] * source.y + transform[4];
+                    point.y = transform[1] * source.x + transform[3] * source.y + transform[5];
+                }
+
+                uint32_t first = 0;
+                for (uint32_t c = 0; c < contourCount; c++) {
+                    const uint32_t last = file_.u16(endPoints + 2 * c);
+                    if (last < first || last >= pointCount) {
+                        throw std::runtime_error("corrupted font data!");
+                    }
+                    appendContour(points.data() + first, flags.data() + first, last - first + 1, curves);
+                    first = last + 1;
+                }
+            }
+
+            // Two off curve points in a row have an implied on curve point between them
+            static void
+            appendContour(const Point* points, const uint8_t* flags, uint32_t count, std::vector<Curve>& curves)
+            {
+                if (count < 2) return;
+
+                auto onCurve = [flags](uint32_t i) { return (flags[i] & 0x01) != 0; };
+                auto middle = [](Point a, Point b) { return Point{ (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f }; };
+
+                Point start;
+                uint32_t begin = 0;
+                uint32_t end = count;
+                if (onCurve(0)) {
+                    start = points[0];
+                    begin = 1;
+                }
+                else if (onCurve(count - 1)) {
+                    start = points[count - 1];
+                    end = count - 1;
+                }
+                else {
+                    start = middle(points[0], points[count - 1]);
+                }
+
+                Point current = start;
+                Point control{};
+                bool hasControl = false;
+                for (uint32_t i = begin; i < end; i++) {
+                    const Point point = points[i];
+                    if (onCurve(i)) {
+                        curves.push_back({ current, hasControl ? control : middle(current, point), point });
+                        current = point;
+                        hasControl = false;
+                    }
+                    else {
+                        if (hasControl) {
+                            const Point implied = middle(control, point);
+                            curves.push_back({ current, control, implied });
+                            current = implied;
+                        }
+                        control = point;
+                        hasControl = true;
+                    }
+                }
+                curves.push_back({ current, hasControl ? control : middle(current, start), start });
+            }
+
+            void
+            appendComposite(size_t offset, const float transform[6], uint32_t depth, std::vector<Curve>& curves) const
+            {
+                size_t cursor = offset + 10;
+                uint16_t flags;
+                do {
+                    flags = file_.u16(cursor);
+                    const uint16_t component = file_.u16(cursor + 2);
+                    cursor += 4;
+
+                    float dx = 0.0f, dy = 0.0f;
+                    if (flags & 0x0001) { // ARG_1_AND_2_ARE_WORDS
+                        dx = file_.i16(cursor);
+                        dy = file_.i16(cursor + 2);
+                        cursor += 4;
+                    }
+                    else {
+                        dx = file_.i8(cursor);
+                        dy = file_.i8(cursor + 1);
+                        cursor += 2;
+                    }
+                    if (!(flags & 0x0002)) { // Point matching instead of offsets is not supported
+                        dx = dy = 0.0f;
+                    }
+
+                    float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+                    auto f2dot14 = [this](size_t at) { return file_.i16(at) / 16384.0f; };
+                    if (flags & 0x0008) { // WE_HAVE_A_SCALE
+                        a = d = f2dot14(cursor);
+                        cursor += 2;
+                    }
+                    else if (flags & 0x0040) { // WE_HAVE_AN_X_AND_Y_SCALE
+                        a = f2dot14(cursor);
+                        d = f2dot14(cursor + 2);
+                        cursor += 4;
+                    }
+                    else if (flags & 0x0080) { // WE_HAVE_A_TWO_BY_TWO
+                        a = f2dot14(cursor);
+                        b = f2dot14(cursor + 2);
+                        c = f2dot14(cursor + 4);
+                        d = f2dot14(cursor + 6);
+                        cursor += 8;
+                    }
+
+                    // Component transform first, then the parent's
+                    const float combined[6] = {
+                        transform[0] * a + transform[2] * b,
+                        transform[1] * a + transform[3] * b,
+                        transform[0] * c + transform[2] * d,
+                        transform[1] * c + transform[3] * d,
+                        transform[0] * dx + transform[2] * dy + transform[4],
+                        transform[1] * dx + transform[3] * dy + transform[5],
+                    };
+                    appendOutline(component, combined, depth + 1, curves);
+                } while (flags & 0x0020); // MORE_COMPONENTS
+            }
+
+            FontData file_;
+            size_t cmap_ = 0, glyf_ = 0, head_ = 0, hhea_ = 0, hmtx_ = 0, kern_ = 0, loca_ = 0, maxp_ = 0;
+            size_t cmapSubtable_ = 0;
+            uint16_t cmapFormat_ = 0;
+            uint16_t glyphCount_ = 0;
+            uint16_t hMetricCount_ = 0;
+            bool longLoca_ = false;
+        };
+
+        // ### Distance field ###
+
+        // Glyph bitmap placement: pixel (i, j) of the field has its center at font pixel (left + i + 0.5, top - j - 0.5)
+        struct GlyphBox {
+            uint32_t glyphIndex = 0;
+            int32_t left = 0;
+            int32_t top = 0;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t atlasX = 0;
+            uint32_t atlasY = 0;
+        };
+
+        void
+        flatten(const std::vector<Curve>& curves, float scale, const GlyphBox& box, std::vector<Segment>& segments)
+        {
+            auto toField = [&](Point p) {
+                return Point{ p.x * scale - static_cast<float>(box.left), static_cast<float>(box.top) - p.y * scale };
+            };
+            auto push = [&segments](Point a, Point b) {
+                segments.push_back({ a.x, a.y, b.x, b.y, std::min(a.y, b.y), std::max(a.y, b.y) });
+            };
+
+            for (const Curve& curve : curves) {
+                const Point p0 = toField(curve.p0);
+                const Point control = toField(curve.control);
+                const Point p1 = toField(curve.p1);
+
+                // Flattening error is |p0 - 2c + p1| / (8 n^2), kept under 0.1 pixel
+                const float bendX = p0.x - 2.0f * control.x + p1.x;
+                const float bendY = p0.y - 2.0f * control.y + p1.y;
+                const float bend = std::sqrt(bendX * bendX + bendY * bendY);
+                const uint32_t steps = std::min(MAX_CURVE_STEPS,
+                    std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(bend / 0.8f)))));
+
+                Point previous = p0;
+                for (uint32_t s = 1; s <= steps; s++) {
+                    const float t = static_cast<float>(s) / static_cast<float>(steps);
+                    const float u = 1.0f - t;
+                    const Point next{ u * u * p0.x + 2.0f * u * t * control.x + t * t * p1.x,
+                                      u * u * p0.y + 2.0f * u * t * control.y + t * t * p1.y };
+                    push(previous, next);
+                    previous = next;
+                }
+            }
+        }
+
+        // Nearest segment for the distance, nonzero winding for the sign. The distance of the previous pixel
+        // plus one bounds the next one, so segments whose vertical extent is farther than that are skipped
+        void
+        rasterizeField(const std::vector<Segment>& segments, const GlyphBox& box, uint32_t spread,
+            uint8_t* atlas, uint32_t atlasWidth)
+        {
+            const float range = 2.0f * static_cast<float>(spread);
+            for (uint32_t j = 0; j < box.height; j++) {
+                uint8_t* row = atlas + static_cast<size_t>(box.atlasY + j) * atlasWidth + box.atlasX;
+                const float py = static_cast<float>(j) + 0.5f;
+                float previous = range;
+
+                for (uint32_t i = 0; i < box.width; i++) {
+                    const float px = static_cast<float>(i) + 0.5f;
+                    float nearest = (previous + 1.0f) * (previous + 1.0f);
+                    int32_t winding = 0;
+
+                    for (const Segment& s : segments) {
+                        if ((s.ay <= py) != (s.by <= py)) {
+                            const float crossX = s.ax + (py - s.ay) * (s.bx - s.ax) / (s.by - s.ay);
+                            if (crossX > px) {
+                                winding += s.by > s.ay ? 1 : -1;
+                            }
+                        }
+
+                        const float outsideY = std::max(s.minY - py, py - s.maxY);
+                        if (outsideY > 0.0f && outsideY * outsideY >= nearest) continue;
+
+                        const float ex = s.bx - s.ax;
+                        const float ey = s.by - s.ay;
+                        const float lengthSquared = ex * ex + ey * ey;
+                        float t = lengthSquared > 0.0f ? ((px - s.ax) * ex + (py - s.ay) * ey) / lengthSquared : 0.0f;
+                        t = std::clamp(t, 0.0f, 1.0f);
+                        const float dx = s.ax + t * ex - px;
+                        const float dy = s.ay + t * ey - py;
+                        nearest = std::min(nearest, dx * dx + dy * dy);
+                    }
+
+                    previous = std::sqrt(nearest);
+                    const float distance = winding != 0 ? previous : -previous;
+                    const float value = std::clamp(0.5f + distance / range, 0.0f, 1.0f);
+                    row[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+                }
+            }
+        }
+
+        // Tallest first into shelves of the fixed width, the height is the next power of two
+        uint32_t
+        packAtlas(std::vector<GlyphBox>& boxes, uint32_t atlasWidth)
+        {
+            std::vector<GlyphBox*> order;
+            order.reserve(boxes.size());
+            for (GlyphBox& box : boxes) {
+                if (box.width > 0) {
+                    if (box.width + ATLAS_PADDING > atlasWidth) {
+                        throw std::runtime_error("glyph does not fit the font atlas width!");
+                    }
+                    order.push_back(&box);
+                }
+            }
+            std::stable_sort(order.begin(), order.end(),
+                [](const GlyphBox* a, const GlyphBox* b) { return a->height > b->height; });
+
+            uint32_t x = ATLAS_PADDING;
+            uint32_t y = ATLAS_PADDING;
+            uint32_t shelfHeight = 0;
+            for (GlyphBox* box : order) {
+                if (x + box->width + ATLAS_PADDING > atlasWidth) {
+                    x = ATLAS_PADDING;
+                    y += shelfHeight + ATLAS_PADDING;
+                    shelfHeight = 0;
+                }
+                box->atlasX = x;
+                box->atlasY = y;
+                x += box->width + ATLAS_PADDING;
+                shelfHeight = std::max(shelfHeight, box->height);
+            }
+            return nextPowerOfTwo(y + shelfHeight + ATLAS_PADDING);
+        }
+
+        // ### Disk cache ###
+
+        // [CacheHeader][GlyphInfo x glyphCount][KerningPair x kerningCount][atlas pixels]
+        struct CacheHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceHash;    // Font data and config
+            uint32_t atlasWidth;
+            uint32_t atlasHeight;
+            uint32_t glyphCount;
+            uint32_t kerningCount;
+            float ascender;
+            float descender;
+            float lineGap;
+            uint32_t reserved;
+        };
+        static_assert(sizeof(CacheHeader) == 48, "CacheHeader layout is part of the cache file");
+        static_assert(std::is_trivially_copyable<GlyphInfo>::value, "GlyphInfo is stored in the cache file as is");
+
+        struct KerningPair {
+            uint32_t glyphs; // Left << 16 | right
+            float value;
+        };
+
+        uint64_t
+        sourceHash(const uint8_t* data, size_t size, const FontConfig& config)
+        {
+            uint64_t hash = hashBytes(data, size);
+            hash = hashBytes(&config.pixelHeight, sizeof(config.pixelHeight), hash);
+            hash = hashBytes(&config.spread, sizeof(config.spread), hash);
+            hash = hashBytes(&config.atlasWidth, sizeof(config.atlasWidth), hash);
+            return hashBytes(config.ranges.data(), sizeof(CodepointRange) * config.ranges.size(), hash);
+        }
+
+        // ### UTF-8 ###
+
+        // Invalid sequences decode to U+FFFD one byte at a time
+        uint32_t
+        decodeUtf8(std::string_view text, size_t& cursor)
+        {
+            const uint8_t lead = static_cast<uint8_t>(text[cursor++]);
+            if (lead < 0x80) return lead;
+
+            uint32_t length;
+            uint32_t codepoint;
+            if ((lead & 0xE0) == 0xC0) { length = 1; codepoint = lead & 0x1F; }
+            else if ((lead & 0xF0) == 0xE0) { length = 2; codepoint = lead & 0x0F; }
+            else if ((lead & 0xF8) == 0xF0) { length = 3; codepoint = lead & 0x07; }
+            else return 0xFFFD;
+
+            if (text.size() - cursor < length) return 0xFFFD;
+            for (uint32_t i = 0; i < length; i++) {
+                const uint8_t next = static_cast<uint8_t>(text[cursor + i]);
+                if ((next & 0xC0) != 0x80) return 0xFFFD;
+                codepoint = codepoint << 6 | (next & 0x3F);
+            }
+            cursor += length;
+            return codepoint;
+        }
+
+    } // namespace
+
+    // ### Font ###
+    class
+    Font::Impl
+    {
+    public:
+        Impl(const uint8_t* data, size_t size, const FontConfig& config, ThreadPool* pool)
+            : pixelHeight(config.pixelHeight)
+            , spread(config.spread)
+        {
+            if (config.pixelHeight <= 0.0f || config.atlasWidth == 0) {
+                throw std::runtime_error("invalid font config!");
+            }
+
+            const uint64_t hash = sourceHash(data, size, config);
+            if (!config.cacheFile.empty() && loadCache(config.cacheFile, hash, config.atlasWidth)) {
+                fromCache = true;
+            }
+            else {
+                build(data, size, config, pool);
+                if (!config.cacheFile.empty()) {
+                    saveCache(config.cacheFile, hash);
+                }
+            }
+            index();
+        }
+
+        const GlyphInfo*
+        glyph(uint32_t codepoint) const
+        {
+            if (codepoint < ASCII_COUNT) {
+                const uint32_t slot = ascii[codepoint];
+                return slot == 0 ? nullptr : &glyphs[slot - 1];
+            }
+            auto it = std::lower_bound(glyphs.begin(), glyphs.end(), codepoint,
+                [](const GlyphInfo& info, uint32_t value) { return info.codepoint < value; });
+            return it != glyphs.end() && it->codepoint == codepoint ? &*it : nullptr;
+        }
+
+        static constexpr uint32_t ASCII_COUNT = 128;
+
+        float pixelHeight;
+        uint32_t spread;
+        float ascender = 0.0f;
+        float descender = 0.0f;
+        float lineGap = 0.0f;
+        uint32_t atlasWidth = 0;
+        uint32_t atlasHeight = 0;
+        std::vector<uint8_t> atlas;
+        std::vector<GlyphInfo> glyphs;                 // Sorted by codepoint
+        std::unordered_map<uint32_t, float> kerning;   // Glyph pair -> em units
+        uint32_t ascii[ASCII_COUNT] = {};              // Glyph + 1 by codepoint, 0: missing
+        const GlyphInfo* fallback = nullptr;
+        bool fromCache = false;
+
+    private:
+        void
+        build(const uint8_t* data, size_t size, const FontConfig& config, ThreadPool* pool)
+        {
+            VF_TRACE_ZONE("Font atlas build");
+
+            TrueTypeFont font(data, size);
+            const float emScale = 1.0f / static_cast<float>(font.unitsPerEm); // Font units -> em
+            const float scale = config.pixelHeight * emScale;                  // Font units -> atlas pixels
+            ascender = font.ascender * emScale;
+            descender = font.descender * emScale;
+            lineGap = font.lineGap * emScale;
+
+            std::vector<uint32_t> codepoints;
+            for (const CodepointRange& range : config.ranges) {
+                for (uint32_t codepoint = range.first; codepoint <= range.last && codepoint <= 0x10FFFF; codepoint++) {
+                    codepoints.push_back(codepoint);
+                }
+            }
+            std::sort(codepoints.begin(), codepoints.end());
+            codepoints.erase(std::unique(codepoints.begin(), codepoints.end()), codepoints.end());
+
+            std::vector<GlyphBox> boxes;
+            for (uint32_t codepoint : codepoints) {
+                const uint32_t glyphIndex = font.glyphIndex(codepoint);
+                if (glyphIndex == 0) continue; // .notdef
+
+                GlyphInfo info;
+                info.codepoint = codepoint;
+                info.glyphIndex = glyphIndex;
+                info.advance = font.advance(glyphIndex) * emScale;
+
+                GlyphBox box;
+                box.glyphIndex = glyphIndex;
+                float xMin, yMin, xMax, yMax;
+                if (font.bounds(glyphIndex, xMin, yMin, xMax, yMax)) {
+                    const int32_t pad = static_cast<int32_t>(config.spread);
+                    const int32_t left = static_cast<int32_t>(std::floor(xMin * scale));
+                    const int32_t bottom = static_cast<int32_t>(std::floor(yMin * scale));
+                    const int32_t right = static_cast<int32_t>(std::ceil(xMax * scale));
+                    const int32_t top = static_cast<int32_t>(std::ceil(yMax * scale));
+                    box.left = left - pad;
+                    box.top = top + pad;
+                    box.width = static_cast<uint32_t>(right - left + 2 * pad);
+                    box.height = static_cast<uint32_t>(top - bottom + 2 * pad);
+                }
+                glyphs.push_back(info);
+                boxes.push_back(box);
+            }
+
+            atlasWidth = config.atlasWidth;
+            atlasHeight = packAtlas(boxes, atlasWidth);
+            atlas.assign(static_cast<size_t>(atlasWidth) * atlasHeight, 0);
+
+            // Glyphs own disjoint atlas rectangles, workers write straight into it
+            auto rasterize = [&](size_t begin, size_t end) {
+                std::vector<Curve> curves;
+                std::vector<Segment> segments;
+                for (size_t i = begin; i < end; i++) {
+                    const GlyphBox& box = boxes[i];
+                    if (box.width == 0) continue;
+                    curves.clear();
+                    segments.clear();
+                    font.outline(box.glyphIndex, curves);
+                    flatten(curves, scale, box, segments);
+                    rasterizeField(segments, box, config.spread, atlas.data(), atlasWidth);
+                }
+            };
+            if (pool) {
+                pool->parallelFor(0, boxes.size(), GLYPH_GRAIN, rasterize);
+            }
+            else {
+                rasterize(0, boxes.size());
+            }
+
+            const float invWidth = 1.0f / static_cast<float>(atlasWidth);
+            const float invHeight = 1.0f / static_cast<float>(atlasHeight);
+            for (size_t i = 0; i < glyphs.size(); i++) {
+                const GlyphBox& box = boxes[i];
+                if (box.width == 0) continue;
+                GlyphInfo& info = glyphs[i];
+                info.x0 = static_cast<float>(box.left) / config.pixelHeight;
+                info.x1 = static_cast<float>(box.left + static_cast<int32_t>(box.width)) / config.pixelHeight;
+                info.y0 = -static_cast<float>(box.top) / config.pixelHeight;
+                info.y1 = static_cast<float>(static_cast<int32_t>(box.height) - box.top) / config.pixelHeight;
+                info.u0 = static_cast<float>(box.atlasX) * invWidth;
+                info.v0 = static_cast<float>(box.atlasY) * invHeight;
+                info.u1 = static_cast<float>(box.atlasX + box.width) * invWidth;
+                info.v1 = static_cast<float>(box.atlasY + box.height) * invHeight;
+            }
+
+            std::vector<uint32_t> glyphIndices;
+            for (const GlyphInfo& info : glyphs) {
+                glyphIndices.push_back(info.glyphIndex);
+            }
+            std::sort(glyphIndices.begin(), glyphIndices.end());
+            std::unordered_map<uint32_t, float> pairs;
+            font.kerningPairs(glyphIndices, pairs);
+            for (const auto& pair : pairs) {
+                kerning[pair.first] = pair.second * emScale;
+            }
+        }
+
+        void
+        index()
+        {
+            for (size_t i = 0; i < glyphs.size(); i++) {
+                if (glyphs[i].codepoint < ASCII_COUNT) {
+                    ascii[glyphs[i].codepoint] = static_cast<uint32_t>(i + 1);
+                }
+            }
+            fallback = glyph('?');
+            if (!fallback && !glyphs.empty()) {
+                fallback = &glyphs[0];
+            }
+        }
+
+        // A stale, foreign or truncated file is rebuilt over
+        bool
+        loadCache(const std::string& filename, uint64_t hash, uint32_t expectedWidth)
+        {
+            std::ifstream file(filename, std::ios::binary);
+            if (!file.is_open()) return false;
+
+            CacheHeader header{};
+            file.read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+                header.sourceHash != hash || header.atlasWidth != expectedWidth ||
+                header.atlasHeight == 0 || header.atlasHeight > (1u << 16)) {
+                return false;
+            }
+
+            glyphs.resize(header.glyphCount);
+            std::vector<KerningPair> pairs(header.kerningCount);
+            atlas.resize(static_cast<size_t>(header.atlasWidth) * header.atlasHeight);
+            file.read(reinterpret_cast<char*>(glyphs.data()), static_cast<std::streamsize>(sizeof(GlyphInfo) * glyphs.size()));
+            file.read(reinterpret_cast<char*>(pairs.data()), static_cast<std::streamsize>(sizeof(KerningPair) * pairs.size()));
+            file.read(reinterpret_cast<char*>(atlas.data()), static_cast<std::streamsize>(atlas.size()));
+            if (!file) {
+                glyphs.clear();
+                atlas.clear();
+                return false;
+            }
+
+            atlasWidth = header.atlasWidth;
+            atlasHeight = header.atlasHeight;
+            ascender = header.ascender;
+            descender = header.descender;
+            lineGap = header.lineGap;
+            for (const KerningPair& pair : pairs) {
+                kerning[pair.glyphs] = pair.value;
+            }
+            return true;
+        }
+
+        void
+        saveCache(const std::string& filename, uint64_t hash) const
+        {
+            CacheHeader header{};
+            header.magic = CACHE_MAGIC;
+            header.version = CACHE_VERSION;
+            header.sourceHash = hash;
+            header.atlasWidth = atlasWidth;
+            header.atlasHeight = atlasHeight;
+            header.glyphCount = static_cast<uint32_t>(glyphs.size());
+            header.kerningCount = static_cast<uint32_t>(kerning.size());
+            header.ascender = ascender;
+            header.descender = descender;
+            header.lineGap = lineGap;
+
+            std::vector<KerningPair> pairs;
+            pairs.reserve(kerning.size());
+            for (const auto& pair : kerning) {
+                pairs.push_back({ pair.first, pair.second });
+            }
+
+            // Written aside and renamed, a crash while saving must not leave a truncated cache
+            const std::string temporary = filename + ".tmp";
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(reinterpret_cast<const char*>(glyphs.data()), static_cast<std::streamsize>(sizeof(GlyphInfo) * glyphs.size()));
+                file.write(reinterpret_cast<const char*>(pairs.data()), static_cast<std::streamsize>(sizeof(KerningPair) * pairs.size()));
+                file.write(reinterpret_cast<const char*>(atlas.data()), static_cast<std::streamsize>(atlas.size()));
+                if (!file) {
+                    VF_LOG_WARNING("text", "failed to write font cache: %s", temporary.c_str());
+                    return;
+                }
+            }
+            std::remove(filename.c_str());
+            std::rename(temporary.c_str(), filename.c_str());
+        }
+    };
+
+    Font::Font(const uint8_t* data, size_t size, const FontConfig& config, ThreadPool* pool)
+        : pImpl(std::make_unique<Impl>(data, size, config, pool))
+    {
+    }
+
+    Font::~Font() = default;
+
+    const GlyphInfo*
+    Font::glyph(uint32_t codepoint) const
+    {
+        return pImpl->glyph(codepoint);
+    }
+
+    const GlyphInfo*
+    Font::fallbackGlyph() const
+    {
+        return pImpl->fallback;
+    }
+
+    float
+    Font::kerning(const GlyphInfo& left, const GlyphInfo& right) const
+    {
+        if (pImpl->kerning.empty()) return 0.0f;
+        auto it = pImpl->kerning.find(left.glyphIndex << 16 | right.glyphIndex);
+        return it != pImpl->kerning.end() ? it->second : 0.0f;
+    }
+
+    float Font::ascender() const { return pImpl->ascender; }
+    float Font::descender() const { return pImpl->descender; }
+    float Font::lineHeight() const { return pImpl->ascender - pImpl->descender + pImpl->lineGap; }
+    float Font::pixelHeight() const { return pImpl->pixelHeight; }
+    uint32_t Font::spread() const { return pImpl->spread; }
+    uint32_t Font::glyphCount() const { return static_cast<uint32_t>(pImpl->glyphs.size()); }
+    uint32_t Font::atlasWidth() const { return pImpl->atlasWidth; }
+    uint32_t Font::atlasHeight() const { return pImpl->atlasHeight; }
+    const uint8_t* Font::atlasPixels() const { return pImpl->atlas.data(); }
+    bool Font::loadedFromCache() const { return pImpl->fromCache; }
+
+    // ### Layout ###
+    void
+    layoutText(const Font& font, std::string_view text, float size, float maxWidth, TextLayout& layout)
+    {
+        layout.glyphs.clear();
+        layout.width = 0.0f;
+
+        const float lineHeight = font.lineHeight() * size;
+        float baseline = font.ascender() * size;
+        float penX = 0.0f;
+        uint32_t lineCount = 1;
+
+        // Wrapping moves everything after the last space of the line down
+        bool hasBreak = false;
+        size_t breakGlyph = 0;   // First quad after the space
+        float breakX = 0.0f;     // Pen position after the space
+        float breakWidth = 0.0f; // Line width before the space
+
+        const GlyphInfo* previous = nullptr;
+        size_t cursor = 0;
+        while (cursor < text.size()) {
+            const uint32_t codepoint = decodeUtf8(text, cursor);
+            if (codepoint == '\n') {
+                layout.width = std::max(layout.width, penX);
+                penX = 0.0f;
+                baseline += lineHeight;
+                lineCount++;
+                hasBreak = false;
+                previous = nullptr;
+                continue;
+            }
+            if (codepoint == '\r') continue;
+
+            const GlyphInfo* glyph = font.glyph(codepoint);
+            if (!glyph) {
+                glyph = font.fallbackGlyph();
+                if (!glyph) continue;
+            }
+            if (previous) {
+                penX += font.kerning(*previous, *glyph) * size;
+            }
+
+            if (codepoint == ' ') {
+                hasBreak = true;
+                breakGlyph = layout.glyphs.size();
+                breakWidth = penX;
+                breakX = penX + glyph->advance * size;
+            }
+            else if (maxWidth > 0.0f && hasBreak && penX + glyph->x1 * size > maxWidth) {
+                for (size_t i = breakGlyph; i < layout.glyphs.size(); i++) {
+                    TextGlyph& moved = layout.glyphs[i];
+                    moved.x0 -= breakX;
+                    moved.x1 -= breakX;
+                    moved.y0 += lineHeight;
+                    moved.y1 += lineHeight;
+                }
+                layout.width = std::max(layout.width, breakWidth);
+                penX -= breakX;
+                baseline += lineHeight;
+                lineCount++;
+                hasBreak = false;
+            }
+
+            if (glyph->x1 > glyph->x0) {
+                TextGlyph quad;
+                quad.x0 = penX + glyph->x0 * size;
+                quad.x1 = penX + glyph->x1 * size;
+                quad.y0 = baseline + glyph->y0 * size;
+                quad.y1 = baseline + glyph->y1 * size;
+                quad.u0 = glyph->u0;
+                quad.v0 = glyph->v0;
+                quad.u1 = glyph->u1;
+                quad.v1 = glyph->v1;
+                layout.glyphs.push_back(quad);
+            }
+            penX += glyph->advance * size;
+            previous = glyph;
+        }
+
+        layout.width = std::max(layout.width, penX);
+        layout.lineCount = lineCount;
+        layout.height = static_cast<float>(lineCount) * lineHeight;
+    }
+
+    // ### TextLayoutCache ###
+    class
+    TextLayoutCache::Impl
+    {
+    public:
+        struct Entry {
+            const Font* font = nullptr;
+            std::string text;
+            float size = 0.0f;
+            float maxWidth = 0.0f;
+            uint64_t lastFrame = 0;
+            TextLayout layout;
+        };
+
+        explicit Impl(uint32_t idle) : idleFrames(idle) {}
+
+        // A hash collision replaces the older entry
+        std::unordered_map<uint64_t, Entry> entries;
+        uint32_t idleFrames;
+        uint64_t frame = 0;
+        TextLayoutStats stats;
+    };
+
+    TextLayoutCache::TextLayoutCache(uint32_t idleFrames)
+        : pImpl(std::make_unique<Impl>(idleFrames))
+    {
+    }
+
+    TextLayoutCache::~TextLayoutCache() = default;
+
+    const TextLayout&
+    TextLayoutCache::get(const Font& font, std::string_view text, float size, float maxWidth)
+    {
+        const Font* fontKey = &font;
+        uint64_t key = hashBytes(text.data(), text.size());
+        key = hashBytes(&fontKey, sizeof(fontKey), key);
+        key = hashBytes(&size, sizeof(size), key);
+        key = hashBytes(&maxWidth, sizeof(maxWidth), key);
+
+        Impl::Entry& entry = pImpl->entries[key];
+        entry.lastFrame = pImpl->frame;
+        if (entry.font == fontKey && entry.size == size && entry.maxWidth == maxWidth && entry.text == text) {
+            pImpl->stats.hits++;
+            return entry.layout;
+        }
+
+        pImpl->stats.misses++;
+        entry.font = fontKey;
+        entry.text.assign(text.data(), text.size());
+        entry.size = size;
+        entry.maxWidth = maxWidth;
+        layoutText(font, text, size, maxWidth, entry.layout);
+        return entry.layout;
+    }
+
+    void
+    TextLayoutCache::nextFrame()
+    {
+        pImpl->frame++;
+        if (pImpl->frame % SWEEP_INTERVAL != 0) return;
+
+        for (auto it = pImpl->entries.begin(); it != pImpl->entries.end();) {
+            if (pImpl->frame - it->second.lastFrame > pImpl->idleFrames) {
+                it = pImpl->entries.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    void
+    TextLayoutCache::clear()
+    {
+        pImpl->entries.clear();
+    }
+
+    TextLayoutStats
+    TextLayoutCache::stats() const
+    {
+        TextLayoutStats stats = pImpl->stats;
+        stats.entries = static_cast<uint32_t>(pImpl->entries.size());
+        return stats;
+    }
+
+} // namespace vf_core
@@ -0,0 +1,403 @@
+﻿#include "vf_text_renderer.hpp"
+#include "vf_memory_budget.hpp"
+
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        constexpr uint32_t ATLAS_LAYER_SIZE = 1024; // Every font atlas must fit one layer
+
+        uint32_t
+        packColor(const float color[4])
+        {
+            uint32_t packed = 0;
+            for (uint32_t i = 0; i < 4; i++) {
+                const float value = std::clamp(color[i], 0.0f, 1.0f);
+                packed |= static_cast<uint32_t>(value * 255.0f + 0.5f) << (8 * i);
+            }
+            return packed;
+        }
+
+        void
+        transitionAtlas(VkCommandBuffer commandBuffer, VkImage image, uint32_t firstLayer, uint32_t layerCount,
+            VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+            VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+        {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = oldLayout;
+            barrier.newLayout = newLayout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = firstLayer;
+            barrier.subresourceRange.layerCount = layerCount;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+            vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
+    } // namespace
+
+    TextRenderer::TextRenderer(const DeviceHandles& handles, PipelineManager& pipelines, DescriptorManager& descriptors,
+        uint32_t framesInFlight, uint32_t maxGlyphsPerFrame)
+        : handles_(handles)
+        , pipelines_(pipelines)
+        , descriptors_(descriptors)
+        , framesInFlight_(framesInFlight)
+        , maxGlyphs_(maxGlyphsPerFrame)
+    {
+        ring_ = createBuffer(handles_, sizeof(GlyphInstance) * maxGlyphs_ * (framesInFlight_ + 1),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = 0.0f;
+
+        if (vkCreateSampler(handles_.device, &samplerInfo, nullptr, &sampler_) != VK_SUCCESS) {
+            destroyBuffer(handles_.device, ring_);
+            throw std::runtime_error("failed to create text sampler!");
+        }
+
+        createAtlas();
+        createPipelineLayout();
+    }
+
+    TextRenderer::~TextRenderer()
+    {
+        // Compiles in flight read the layout
+        pipelines_.waitIdle();
+
+        if (pipelineLayout_ != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(handles_.device, pipelineLayout_, nullptr);
+        }
+        descriptorLayout_.reset();
+
+        if (atlasView_ != VK_NULL_HANDLE) {
+            vkDestroyImageView(handles_.device, atlasView_, nullptr);
+        }
+        if (atlasImage_ != VK_NULL_HANDLE) {
+            vkDestroyImage(handles_.device, atlasImage_, nullptr);
+        }
+        if (atlasMemory_ != VK_NULL_HANDLE) {
+            if (handles_.memory != nullptr) {
+                handles_.memory->freed(atlasMemory_);
+            }
+            vkFreeMemory(handles_.device, atlasMemory_, nullptr);
+        }
+        if (sampler_ != VK_NULL_HANDLE) {
+            vkDestroySampler(handles_.device, sampler_, nullptr);
+        }
+        destroyBuffer(handles_.device, ring_);
+    }
+
+    // One layer per font, all cleared up front so the whole array is in SHADER_READ_ONLY_OPTIMAL
+    void
+    TextRenderer::createAtlas()
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R8_UNORM;
+        imageInfo.extent = { ATLAS_LAYER_SIZE, ATLAS_LAYER_SIZE, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = VF_MAX_FONTS;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(handles_.device, &imageInfo, nullptr, &atlasImage_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create glyph atlas image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(handles_.device, atlasImage_, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(handles_.physicalDevice, memRequirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(handles_.device, &allocInfo, nullptr, &atlasMemory_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate glyph atlas memory!");
+        }
+        vkBindImageMemory(handles_.device, atlasImage_, atlasMemory_, 0);
+        if (handles_.memory != nullptr) {
+            handles_.memory->allocated(atlasMemory_, MemoryCategory::TEXTURES, allocInfo.memoryTypeIndex,
+                memRequirements.size);
+        }
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = atlasImage_;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.format = VK_FORMAT_R8_UNORM;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = VF_MAX_FONTS;
+
+        if (vkCreateImageView(handles_.device, &viewInfo, nullptr, &atlasView_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create glyph atlas image view!");
+        }
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(handles_);
+        transitionAtlas(commandBuffer, atlasImage_, 0, VF_MAX_FONTS,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkClearColorValue clear{};
+        VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, VF_MAX_FONTS };
+        vkCmdClearColorImage(commandBuffer, atlasImage_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1, &range);
+
+        transitionAtlas(commandBuffer, atlasImage_, 0, VF_MAX_FONTS,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        endSingleTimeCommands(handles_, commandBuffer);
+    }
+
+    void
+    TextRenderer::createPipelineLayout()
+    {
+        VkDescriptorSetLayoutBinding atlasBinding{};
+        atlasBinding.binding = 0;
+        atlasBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        atlasBinding.descriptorCount = 1;
+        atlasBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        descriptorLayout_ = std::make_unique<DescriptorLayout>(handles_.device,
+            std::vector<VkDescriptorSetLayoutBinding>{ atlasBinding });
+
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushRange.offset = 0;
+        pushRange.size = sizeof(DrawPush);
+
+        VkDescriptorSetLayout setLayout = descriptorLayout_->layout();
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushRange;
+
+        if (vkCreatePipelineLayout(handles_.device, &layoutInfo, nullptr, &pipelineLayout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create text pipeline layout!");
+        }
+    }
+
+    FontHandle
+    TextRenderer::addFont(std::unique_ptr<vf_core::Font> font)
+    {
+        if (fonts_.size() >= VF_MAX_FONTS) {
+            throw std::runtime_error("text renderer font limit reached!");
+        }
+        if (font->atlasWidth() > ATLAS_LAYER_SIZE || font->atlasHeight() > ATLAS_LAYER_SIZE) {
+            throw std::runtime_error("font atlas does not fit the text renderer, lower pixelHeight or the ranges!");
+        }
+
+        const uint32_t layer = static_cast<uint32_t>(fonts_.size());
+        const VkDeviceSize bytes = static_cast<VkDeviceSize>(font->atlasWidth()) * font->atlasHeight();
+
+        GpuBuffer staging = createBuffer(handles_, bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        std::memcpy(staging.mapped, font->atlasPixels(), static_cast<size_t>(bytes));
+
+        // Frames in flight only sample the layers of earlier fonts
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(handles_);
+        transitionAtlas(commandBuffer, atlasImage_, layer, 1,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = layer;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { font->atlasWidth(), font->atlasHeight(), 1 };
+        vkCmdCopyBufferToImage(commandBuffer, staging.buffer, atlasImage_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        transitionAtlas(commandBuffer, atlasImage_, layer, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        endSingleTimeCommands(handles_, commandBuffer);
+        destroyBuffer(handles_.device, staging);
+
+        fonts_.push_back(std::move(font));
+        return layer;
+    }
+
+    void
+    TextRenderer::createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+        VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode)
+    {
+        // Overlay: drawn last in the pass, blended, never depth tested
+        state_.vertexShader = ShaderCode::fromSpirv(std::move(vertShaderCode));
+        state_.fragmentShader = ShaderCode::fromSpirv(std::move(fragShaderCode));
+        state_.layout = pipelineLayout_;
+        state_.renderPass = renderPass;
+        state_.colorFormat = colorFormat;
+        state_.depthFormat = depthFormat;
+        state_.samples = samples;
+        state_.depthTest = false;
+        state_.depthWrite = false;
+        state_.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        state_.cullMode = VK_CULL_MODE_NONE;
+        state_.blend = BlendMode::ALPHA;
+
+        pipeline_ = pipelines_.requestGraphics(state_);
+    }
+
+    VkPipeline
+    TextRenderer::buildPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const
+    {
+        PipelineState state = state_;
+        state.vertexShader = ShaderCode::fromSpirv(vertShaderCode);
+        state.fragmentShader = ShaderCode::fromSpirv(fragShaderCode);
+        return createGraphicsPipeline(handles_.device, handles_.pipelineCache, state);
+    }
+
+    VkPipeline
+    TextRenderer::swapPipeline(VkPipeline pipeline)
+    {
+        return pipelines_.replace(pipeline_, pipeline);
+    }
+
+    const vf_core::Font&
+    TextRenderer::font(FontHandle handle) const
+    {
+        if (handle >= fonts_.size()) {
+            throw std::runtime_error("invalid font handle!");
+        }
+        return *fonts_[handle];
+    }
+
+    void
+    TextRenderer::drawText(FontHandle handle, std::string_view text, float x, float y, float size,
+        const float color[4], float maxWidth)
+    {
+        VF_TRACE_ZONE("drawText");
+
+        const vf_core::Font& textFont = font(handle);
+        const vf_core::TextLayout& layout = layouts_.get(textFont, text, size, maxWidth);
+        stringCount_++;
+
+        uint32_t count = static_cast<uint32_t>(layout.glyphs.size());
+        const uint32_t room = maxGlyphs_ - glyphCount_;
+        if (count > room) {
+            stats_.droppedGlyphs += count - room;
+            count = room;
+        }
+
+        // Font atlases sit in the top left corner of their layer
+        const float uScale = static_cast<float>(textFont.atlasWidth()) / static_cast<float>(ATLAS_LAYER_SIZE);
+        const float vScale = static_cast<float>(textFont.atlasHeight()) / static_cast<float>(ATLAS_LAYER_SIZE);
+        const uint32_t packed = packColor(color);
+        const float distanceScale = 2.0f * static_cast<float>(textFont.spread()) * size / textFont.pixelHeight();
+
+        // Whole instances go out in order: the ring is write-combined memory, it is never read back
+        GlyphInstance* out = static_cast<GlyphInstance*>(ring_.mapped) + static_cast<size_t>(slot_) * maxGlyphs_ + glyphCount_;
+        for (uint32_t i = 0; i < count; i++) {
+            const vf_core::TextGlyph& glyph = layout.glyphs[i];
+            GlyphInstance instance;
+            instance.rect[0] = x + glyph.x0;
+            instance.rect[1] = y + glyph.y0;
+            instance.rect[2] = x + glyph.x1;
+            instance.rect[3] = y + glyph.y1;
+            instance.uv[0] = glyph.u0 * uScale;
+            instance.uv[1] = glyph.v0 * vScale;
+            instance.uv[2] = glyph.u1 * uScale;
+            instance.uv[3] = glyph.v1 * vScale;
+            instance.color = packed;
+            instance.layer = handle;
+            instance.distanceScale = distanceScale;
+            instance.padding = 0;
+            out[i] = instance;
+        }
+        glyphCount_ += count;
+    }
+
+    void
+    TextRenderer::measureText(FontHandle handle, std::string_view text, float size, float maxWidth,
+        float& width, float& height)
+    {
+        const vf_core::TextLayout& layout = layouts_.get(font(handle), text, size, maxWidth);
+        width = layout.width;
+        height = layout.height;
+    }
+
+    void
+    TextRenderer::recordDraw(VkCommandBuffer commandBuffer, VkExtent2D screenExtent)
+    {
+        stats_.strings = stringCount_;
+        stats_.glyphs = glyphCount_;
+        stats_.drawCalls = 0;
+
+        VkPipeline pipeline = pipelines_.get(pipeline_);
+        if (glyphCount_ > 0 && pipeline != VK_NULL_HANDLE) {
+            DescriptorData atlas{};
+            atlas.image.sampler = sampler_;
+            atlas.image.imageView = atlasView_;
+            atlas.image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            VkDescriptorSet set = descriptors_.getStaticSet(*descriptorLayout_, &atlas);
+
+            DrawPush push{};
+            push.glyphs = ring_.address + sizeof(GlyphInstance) * maxGlyphs_ * slot_;
+            push.invScreenSize[0] = 1.0f / static_cast<float>(std::max(screenExtent.width, 1u));
+            push.invScreenSize[1] = 1.0f / static_cast<float>(std::max(screenExtent.height, 1u));
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout_, 0, 1, &set, 0, nullptr);
+            vkCmdPushConstants(commandBuffer, pipelineLayout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPush), &push);
+            vkCmdDraw(commandBuffer, 6, glyphCount_, 0, 0);
+            stats_.drawCalls = 1;
+        }
+
+        slot_ = (slot_ + 1) % (framesInFlight_ + 1);
+        glyphCount_ = 0;
+        stringCount_ = 0;
+        layouts_.nextFrame();
+    }
+
+    void
+    TextRenderer::discardFrame()
+    {
+        glyphCount_ = 0;
+        stringCount_ = 0;
+    }
+
+    TextStats
+    TextRenderer::stats() const
+    {
+        TextStats stats = stats_;
+        const vf_core::TextLayoutStats layoutStats = layouts_.stats();
+        stats.fontCount = static_cast<uint32_t>(fonts_.size());
+        stats.layoutHits = layoutStats.hits;
+        stats.layoutMisses = layoutStats.misses;
+        stats.cachedLayouts = layoutStats.entries;
+        return stats;
+    }
+
+} // namespace vf_vulkan
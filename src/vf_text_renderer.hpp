@@ -0,0 +1,108 @@
+﻿#pragma once
+#ifndef VFRAME_TEXT_RENDERER_HPP
+#define VFRAME_TEXT_RENDERER_HPP
+
+#include <vFrame/vf_scene_types.hpp>
+#include <vFrame/vf_text.hpp>
+#include "vf_buffer.hpp"
+#include "vf_descriptors.hpp"
+#include "vf_pipeline_manager.hpp"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Screen space SDF text. Fonts share one R8 2D array image, a layer each, so glyphs of every font
+    // sample the same descriptor. drawText lays the string out (through the layout cache) and writes
+    // its glyph instances straight into a persistently mapped ring; recordDraw emits everything the
+    // frame queued as one instanced draw of 6 vertices per glyph, pulled in text.vert.
+    //
+    // The ring has framesInFlight + 1 slots: the slot being filled is never read by a frame in flight.
+    class TextRenderer {
+    public:
+        TextRenderer(const DeviceHandles& handles, PipelineManager& pipelines, DescriptorManager& descriptors,
+            uint32_t framesInFlight, uint32_t maxGlyphsPerFrame = 16384);
+        ~TextRenderer();
+
+        TextRenderer(const TextRenderer&) = delete;
+        TextRenderer& operator=(const TextRenderer&) = delete;
+
+        // Atlas goes to its layer with a blocking upload. Throws past VF_MAX_FONTS or
+        // when the atlas is bigger than a layer
+        FontHandle addFont(std::unique_ptr<vf_core::Font> font);
+
+        // Same contract as GpuScene::createPipeline: requested again when the render pass format changes
+        void createPipeline(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat,
+            VkSampleCountFlagBits samples, std::vector<char> vertShaderCode, std::vector<char> fragShaderCode);
+        void setRenderPass(VkRenderPass renderPass) { state_.renderPass = renderPass; } // See GpuScene::setRenderPass
+        VkPipeline buildPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode) const;
+        VkPipeline swapPipeline(VkPipeline pipeline);
+
+        // x, y: top left of the text box in window pixels, color: linear RGBA
+        void drawText(FontHandle font, std::string_view text, float x, float y, float size,
+            const float color[4], float maxWidth);
+        void measureText(FontHandle font, std::string_view text, float size, float maxWidth,
+            float& width, float& height);
+
+        // Inside the render pass, once per frame: draws the queued glyphs and moves to the next ring slot.
+        // screenExtent is the window size the text was positioned in
+        void recordDraw(VkCommandBuffer commandBuffer, VkExtent2D screenExtent);
+        // A frame that was not recorded (swap chain out of date) drops its glyphs
+        void discardFrame();
+
+        TextStats stats() const;
+        uint32_t fontCount() const { return static_cast<uint32_t>(fonts_.size()); }
+
+    private:
+        // std430 mirror of Glyph in text.vert
+        struct GlyphInstance {
+            float rect[4];        // x0, y0, x1, y1 in window pixels
+            float uv[4];
+            uint32_t color;       // RGBA8, R in the low byte
+            uint32_t layer;
+            float distanceScale;  // Screen pixels per unit of the normalized distance field
+            uint32_t padding;
+        };
+        static_assert(sizeof(GlyphInstance) == 48, "GlyphInstance must match the std430 layout in text.vert");
+
+        struct DrawPush {
+            VkDeviceAddress glyphs;
+            float invScreenSize[2];
+        };
+
+        void createAtlas();
+        void createPipelineLayout();
+        const vf_core::Font& font(FontHandle handle) const;
+
+        DeviceHandles handles_;
+        PipelineManager& pipelines_;
+        DescriptorManager& descriptors_;
+        uint32_t framesInFlight_;
+        uint32_t maxGlyphs_;
+
+        std::vector<std::unique_ptr<vf_core::Font>> fonts_;
+        vf_core::TextLayoutCache layouts_;
+
+        VkImage atlasImage_ = VK_NULL_HANDLE;
+        VkDeviceMemory atlasMemory_ = VK_NULL_HANDLE;
+        VkImageView atlasView_ = VK_NULL_HANDLE;
+        VkSampler sampler_ = VK_NULL_HANDLE;
+
+        GpuBuffer ring_;          // Host visible, (framesInFlight + 1) * maxGlyphs instances
+        uint32_t slot_ = 0;
+        uint32_t glyphCount_ = 0; // In the current slot
+        uint32_t stringCount_ = 0;
+
+        std::unique_ptr<DescriptorLayout> descriptorLayout_;
+        VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+        PipelineHandle pipeline_ = VF_INVALID_PIPELINE;
+        PipelineState state_;
+
+        TextStats stats_;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_TEXT_RENDERER_HPP
@@ -0,0 +1,602 @@
+﻿#include "vf_texture_streamer.hpp"
+#include "vf_memory_budget.hpp"
+
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace vf_vulkan {
+
+    namespace {
+
+        // Offsets into staging memory must be a multiple of the texel block size (8 or 16 bytes)
+        constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+        uint32_t
+        mipExtent(uint32_t extent, uint32_t level)
+        {
+            return std::max(extent >> level, 1u);
+        }
+
+    } // namespace
+
+    TextureStreamer::TextureStreamer(const DeviceHandles& handles, vf_core::ThreadPool& threadPool,
+        uint32_t framesInFlight, const Settings& settings)
+        : handles_(handles)
+        , threadPool_(threadPool)
+        , framesInFlight_(framesInFlight)
+        , settings_(settings)
+    {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(handles_.device, &samplerInfo, nullptr, &sampler_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture sampler!");
+        }
+
+        // 1x1 white image for descriptor slots without a texture: untextured objects sample 1.0
+        Texture white;
+        white.format = VK_FORMAT_R8G8B8A8_UNORM;
+        white.ktx.width = 1;
+        white.ktx.height = 1;
+        white.ktx.levels.resize(1);
+        fallback_ = createImage(white, 0);
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = fallback_.image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        VkClearColorValue clearColor{};
+        clearColor.float32[0] = clearColor.float32[1] = clearColor.float32[2] = clearColor.float32[3] = 1.0f;
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(handles_);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+        vkCmdClearColorImage(commandBuffer, fallback_.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            &clearColor, 1, &barrier.subresourceRange);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+        endSingleTimeCommands(handles_, commandBuffer);
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        // Workers write into staging memory, it must outlive the jobs
+        for (auto& texture : textures_) {
+            if (texture->pending) {
+                texture->pending->job.wait();
+                destroyBuffer(handles_.device, texture->pending->staging);
+            }
+            destroyImage(texture->resident);
+        }
+        releaseRetired(true);
+        destroyImage(fallback_);
+
+        if (sampler_ != VK_NULL_HANDLE) {
+            vkDestroySampler(handles_.device, sampler_, nullptr);
+        }
+    }
+
+    TextureHandle
+    TextureStreamer::load(const std::string& filename, AssetBlob data)
+    {
+        auto texture = std::make_unique<Texture>();
+        texture->filename = filename;
+        texture->data = std::move(data);
+        texture->ktx = parseKtx2(texture->data.data(), texture->data.size(), filename);
+
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(handles_.physicalDevice, texture->ktx.format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) {
+            texture->format = texture->ktx.format;
+        }
+        else if (decodedFormat(texture->ktx.format) != VK_FORMAT_UNDEFINED) {
+            texture->format = decodedFormat(texture->ktx.format);
+            texture->decode = true;
+        }
+        else {
+            throw std::runtime_error("texture format is not supported by the device: " + filename);
+        }
+
+        // Small mips stay resident for the whole lifetime of the texture
+        const uint32_t count = levelCount(*texture);
+        texture->baseLevel = count - 1;
+        for (uint32_t level = 0; level < count; level++) {
+            if (std::max(mipExtent(texture->ktx.width, level), mipExtent(texture->ktx.height, level)) <= settings_.minResidentSize) {
+                texture->baseLevel = level;
+                break;
+            }
+        }
+        texture->desiredLevel = texture->baseLevel;
+        texture->lastDemandFrame = frame_;
+
+        VkDeviceSize stagingSize = 0;
+        std::vector<VkDeviceSize> offsets = stagingLayout(*texture, texture->baseLevel, count, stagingSize);
+        GpuBuffer staging = createBuffer(handles_, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        fillStaging(*texture, texture->baseLevel, count, offsets, static_cast<uint8_t*>(staging.mapped));
+
+        texture->resident = createImage(*texture, texture->baseLevel);
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(handles_);
+        recordTransfer(commandBuffer, *texture, texture->resident, nullptr, &staging, offsets);
+        endSingleTimeCommands(handles_, commandBuffer);
+        destroyBuffer(handles_.device, staging);
+
+        residentBytes_ += texture->resident.bytes;
+        streamedBytes_ += stagingSize;
+
+        textures_.push_back(std::move(texture));
+        return static_cast<TextureHandle>(textures_.size() - 1);
+    }
+
+    void
+    TextureStreamer::setDemand(TextureHandle handle, float screenPixels)
+    {
+        if (handle >= textures_.size()) {
+            throw std::runtime_error("invalid texture handle!");
+        }
+        Texture& texture = *textures_[handle];
+
+        // One texel per pixel: every halving of the on-screen size drops one mip
+        const float size = static_cast<float>(std::max(texture.ktx.width, texture.ktx.height));
+        const float ratio = size / std::max(screenPixels, 1.0f);
+        uint32_t level = ratio > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(ratio))) : 0;
+        level = std::min(level, texture.baseLevel);
+
+        // Several objects may share a texture: the biggest one within a frame wins
+        if (texture.lastDemandFrame == frame_) {
+            texture.desiredLevel = std::min(texture.desiredLevel, level);
+        }
+        else {
+            texture.desiredLevel = level;
+        }
+        texture.lastDemandFrame = frame_;
+    }
+
+    void
+    TextureStreamer::setBudget(uint64_t bytes)
+    {
+        settings_.budgetBytes = bytes;
+    }
+
+    void
+    TextureStreamer::recordUpdates(VkCommandBuffer commandBuffer)
+    {
+        frame_++;
+        releaseRetired(false);
+
+        for (auto& texture : textures_) {
+            if (frame_ - texture->lastDemandFrame > settings_.idleFrames) {
+                texture->desiredLevel = texture->baseLevel;
+            }
+        }
+
+        finishUploads(commandBuffer);
+        evictUnderPressure(commandBuffer);
+        scheduleUploads();
+    }
+
+    VkImageView
+    TextureStreamer::imageView(TextureHandle handle) const
+    {
+        if (handle >= textures_.size()) {
+            throw std::runtime_error("invalid texture handle!");
+        }
+        return textures_[handle]->resident.view;
+    }
+
+    void
+    TextureStreamer::writeDescriptors(DescriptorData* data, uint32_t count) const
+    {
+        for (uint32_t i = 0; i < count; i++) {
+            data[i] = DescriptorData{};
+            data[i].image.sampler = sampler_;
+            data[i].image.imageView = i < textures_.size() ? textures_[i]->resident.view : fallback_.view;
+            data[i].image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+    }
+
+    TextureStreamingStats
+    TextureStreamer::stats() const
+    {
+        TextureStreamingStats result;
+        result.textureCount = static_cast<uint32_t>(textures_.size());
+        for (const auto& texture : textures_) {
+            if (texture->pending) {
+                result.pendingUploads++;
+            }
+        }
+        result.residentBytes = residentBytes_;
+        result.budgetBytes = settings_.budgetBytes;
+        result.streamedBytes = streamedBytes_;
+        result.evictions = evictions_;
+        return result;
+    }
+
+    uint32_t
+    TextureStreamer::levelCount(const Texture& texture) const
+    {
+        return static_cast<uint32_t>(texture.ktx.levels.size());
+    }
+
+    uint64_t
+    TextureStreamer::levelUploadSize(const Texture& texture, uint32_t level) const
+    {
+        return levelByteSize(texture.format, mipExtent(texture.ktx.width, level), mipExtent(texture.ktx.height, level));
+    }
+
+    uint64_t
+    TextureStreamer::estimateImageBytes(const Texture& texture, uint32_t firstLevel) const
+    {
+        uint64_t bytes = 0;
+        for (uint32_t level = firstLevel; level < levelCount(texture); level++) {
+            bytes += levelUploadSize(texture, level);
+        }
+        return bytes;
+    }
+
+    TextureStreamer::ResidentImage
+    TextureStreamer::createImage(const Texture& texture, uint32_t firstLevel)
+    {
+        ResidentImage result;
+        result.firstLevel = firstLevel;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = texture.format;
+        imageInfo.extent.width = mipExtent(texture.ktx.width, firstLevel);
+        imageInfo.extent.height = mipExtent(texture.ktx.height, firstLevel);
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = levelCount(texture) - firstLevel;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        // TRANSFER_SRC: mips are copied into the next image when residency changes
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(handles_.device, &imageInfo, nullptr, &result.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(handles_.device, result.image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(handles_.physicalDevice, memRequirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(handles_.device, &allocInfo, nullptr, &result.memory) != VK_SUCCESS) {
+            vkDestroyImage(handles_.device, result.image, nullptr);
+            throw std::runtime_error("failed to allocate texture memory!");
+        }
+        vkBindImageMemory(handles_.device, result.image, result.memory, 0);
+        result.bytes = memRequirements.size;
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = result.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = texture.format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = imageInfo.mipLevels;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(handles_.device, &viewInfo, nullptr, &result.view) != VK_SUCCESS) {
+            vkFreeMemory(handles_.device, result.memory, nullptr);
+            vkDestroyImage(handles_.device, result.image, nullptr);
+            throw std::runtime_error("failed to create texture image view!");
+        }
+
+        if (handles_.memory != nullptr) {
+            handles_.memory->allocated(result.memory, MemoryCategory::TEXTURES, allocInfo.memoryTypeIndex,
+                memRequirements.size);
+        }
+
+        return result;
+    }
+
+    void
+    TextureStreamer::destroyImage(ResidentImage& image)
+    {
+        if (image.view != VK_NULL_HANDLE) {
+            vkDestroyImageView(handles_.device, image.view, nullptr);
+        }
+        if (image.image != VK_NULL_HANDLE) {
+            vkDestroyImage(handles_.device, image.image, nullptr);
+        }
+        if (image.memory != VK_NULL_HANDLE) {
+            if (handles_.memory != nullptr) {
+                handles_.memory->freed(image.memory);
+            }
+            vkFreeMemory(handles_.device, image.memory, nullptr);
+        }
+        image = ResidentImage{};
+    }
+
+    // Frames in flight may still sample the old image, it is destroyed once their fences passed
+    void
+    TextureStreamer::retire(ResidentImage& image, GpuBuffer staging)
+    {
+        retired_.push_back({ frame_, image, staging });
+        image = ResidentImage{};
+    }
+
+    void
+    TextureStreamer::releaseRetired(bool all)
+    {
+        auto it = retired_.begin();
+        while (it != retired_.end()) {
+            if (all || frame_ >= it->frame + framesInFlight_) {
+                destroyImage(it->image);
+                destroyBuffer(handles_.device, it->staging);
+                it = retired_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    void
+    TextureStreamer::recordTransfer(VkCommandBuffer commandBuffer, const Texture& texture, const ResidentImage& dst,
+        const ResidentImage* src, const GpuBuffer* staging, const std::vector<VkDeviceSize>& offsets)
+    {
+        const uint32_t count = levelCount(texture);
+        const uint32_t copyFrom = src ? std::max(dst.firstLevel, src->firstLevel) : count;
+
+        VkImageMemoryBarrier barriers[2]{};
+        for (VkImageMemoryBarrier& barrier : barriers) {
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+            barrier.subresourceRange.layerCount = 1;
+        }
+
+        barriers[0].image = dst.image;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        if (src) {
+            barriers[1].image = src->image;
+            barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        }
+
+        // Previous frames may still sample the source image
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, src ? 2 : 1, barriers);
+
+        if (staging) {
+            std::vector<VkBufferImageCopy> regions;
+            for (uint32_t level = dst.firstLevel; level < copyFrom; level++) {
+                VkBufferImageCopy region{};
+                region.bufferOffset = offsets[level - dst.firstLevel];
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel = level - dst.firstLevel;
+                region.imageSubresource.layerCount = 1;
+                region.imageExtent = { mipExtent(texture.ktx.width, level), mipExtent(texture.ktx.height, level), 1 };
+                regions.push_back(region);
+            }
+            if (!regions.empty()) {
+                vkCmdCopyBufferToImage(commandBuffer, staging->buffer, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    static_cast<uint32_t>(regions.size()), regions.data());
+            }
+        }
+
+        if (src) {
+            std::vector<VkImageCopy> regions;
+            for (uint32_t level = copyFrom; level < count; level++) {
+                VkImageCopy region{};
+                region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.srcSubresource.mipLevel = level - src->firstLevel;
+                region.srcSubresource.layerCount = 1;
+                region.dstSubresource = region.srcSubresource;
+                region.dstSubresource.mipLevel = level - dst.firstLevel;
+                region.extent = { mipExtent(texture.ktx.width, level), mipExtent(texture.ktx.height, level), 1 };
+                regions.push_back(region);
+            }
+            vkCmdCopyImage(commandBuffer, src->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst.image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+        }
+
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, barriers);
+    }
+
+    std::vector<VkDeviceSize>
+    TextureStreamer::stagingLayout(const Texture& texture, uint32_t firstLevel, uint32_t endLevel,
+        VkDeviceSize& totalSize) const
+    {
+        std::vector<VkDeviceSize> offsets;
+        totalSize = 0;
+        for (uint32_t level = firstLevel; level < endLevel; level++) {
+            offsets.push_back(totalSize);
+            totalSize += levelUploadSize(texture, level);
+            totalSize = (totalSize + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+        }
+        return offsets;
+    }
+
+    // Runs on worker threads: touches only immutable texture data and its own staging memory
+    void
+    TextureStreamer::fillStaging(const Texture& texture, uint32_t firstLevel, uint32_t endLevel,
+        const std::vector<VkDeviceSize>& offsets, uint8_t* dst) const
+    {
+        for (uint32_t level = firstLevel; level < endLevel; level++) {
+            const uint8_t* src = texture.data.data() + texture.ktx.levels[level].byteOffset;
+            uint8_t* out = dst + offsets[level - firstLevel];
+
+            if (texture.decode) {
+                decodeBlocksToRgba8(texture.ktx.format, src, mipExtent(texture.ktx.width, level),
+                    mipExtent(texture.ktx.height, level), out);
+            }
+            else {
+                std::memcpy(out, src, static_cast<size_t>(levelUploadSize(texture, level)));
+            }
+        }
+    }
+
+    void
+    TextureStreamer::finishUploads(VkCommandBuffer commandBuffer)
+    {
+        for (auto& texture : textures_) {
+            PendingUpload* pending = texture->pending.get();
+            if (!pending || pending->job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                continue;
+            }
+            pending->job.get(); // Rethrows errors of the worker
+
+            ResidentImage image = createImage(*texture, pending->firstLevel);
+            recordTransfer(commandBuffer, *texture, image, &texture->resident, &pending->staging, pending->offsets);
+
+            reservedBytes_ -= pending->reservedBytes;
+            residentBytes_ = residentBytes_ - texture->resident.bytes + image.bytes;
+            streamedBytes_ += pending->staging.size;
+
+            retire(texture->resident, pending->staging);
+            texture->resident = image;
+            texture->pending.reset();
+        }
+    }
+
+    void
+    TextureStreamer::evictUnderPressure(VkCommandBuffer commandBuffer)
+    {
+        while (residentBytes_ + reservedBytes_ > settings_.budgetBytes) {
+            // Mips nobody asks for go first, then the least recently used texture
+            Texture* victim = nullptr;
+            bool victimUnneeded = false;
+            for (auto& texture : textures_) {
+                if (texture->pending || texture->resident.firstLevel >= texture->baseLevel) {
+                    continue;
+                }
+                bool unneeded = texture->resident.firstLevel < texture->desiredLevel;
+                if (!victim || (unneeded && !victimUnneeded) ||
+                    (unneeded == victimUnneeded && texture->lastDemandFrame < victim->lastDemandFrame)) {
+                    victim = texture.get();
+                    victimUnneeded = unneeded;
+                }
+            }
+            if (!victim) {
+                break; // Only the always resident mips are left
+            }
+
+            uint32_t firstLevel = victimUnneeded ? victim->desiredLevel : victim->resident.firstLevel + 1;
+            firstLevel = std::min(firstLevel, victim->baseLevel);
+
+            ResidentImage image = createImage(*victim, firstLevel);
+            recordTransfer(commandBuffer, *victim, image, &victim->resident, nullptr, {});
+
+            residentBytes_ = residentBytes_ - victim->resident.bytes + image.bytes;
+            retire(victim->resident, GpuBuffer{});
+            victim->resident = image;
+            evictions_++;
+        }
+    }
+
+    void
+    TextureStreamer::scheduleUploads()
+    {
+        uint32_t pendingCount = 0;
+        std::vector<Texture*> candidates;
+        for (auto& texture : textures_) {
+            if (texture->pending) {
+                pendingCount++;
+            }
+            else if (texture->desiredLevel < texture->resident.firstLevel) {
+                candidates.push_back(texture.get());
+            }
+        }
+
+        // Textures seen in the latest frames and missing most mips first
+        std::sort(candidates.begin(), candidates.end(), [](const Texture* a, const Texture* b) {
+            if (a->lastDemandFrame != b->lastDemandFrame) return a->lastDemandFrame > b->lastDemandFrame;
+            return a->resident.firstLevel - a->desiredLevel > b->resident.firstLevel - b->desiredLevel;
+        });
+
+        uint64_t uploadBytes = 0;
+        for (Texture* texture : candidates) {
+            if (pendingCount >= settings_.maxPendingUploads || uploadBytes >= settings_.maxUploadBytesPerFrame) {
+                break;
+            }
+
+            // Give up the biggest mips until the texture fits into the budget
+            const uint32_t endLevel = texture->resident.firstLevel;
+            uint32_t firstLevel = texture->desiredLevel;
+            uint64_t growth = 0;
+            for (; firstLevel < endLevel; firstLevel++) {
+                uint64_t bytes = estimateImageBytes(*texture, firstLevel);
+                growth = bytes > texture->resident.bytes ? bytes - texture->resident.bytes : 0;
+                if (residentBytes_ + reservedBytes_ + growth <= settings_.budgetBytes) {
+                    break;
+                }
+            }
+            if (firstLevel >= endLevel) {
+                continue;
+            }
+
+            auto pending = std::make_unique<PendingUpload>();
+            pending->firstLevel = firstLevel;
+            pending->reservedBytes = growth;
+
+            VkDeviceSize stagingSize = 0;
+            pending->offsets = stagingLayout(*texture, firstLevel, endLevel, stagingSize);
+            pending->staging = createBuffer(handles_, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            uint8_t* dst = static_cast<uint8_t*>(pending->staging.mapped);
+            pending->job = threadPool_.submit([this, texture, firstLevel, endLevel, offsets = pending->offsets, dst]() {
+                VF_TRACE_ZONE("Texture mips");
+                fillStaging(*texture, firstLevel, endLevel, offsets, dst);
+            });
+
+            reservedBytes_ += growth;
+            uploadBytes += stagingSize;
+            pendingCount++;
+            texture->pending = std::move(pending);
+        }
+    }
+
+} // namespace vf_vulkan
@@ -0,0 +1,139 @@
+﻿#pragma once
+#ifndef VFRAME_TEXTURE_STREAMER_HPP
+#define VFRAME_TEXTURE_STREAMER_HPP
+
+#include <vFrame/vf_scene_types.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include "vf_asset_archive.hpp"
+#include "vf_buffer.hpp"
+#include "vf_descriptors.hpp"
+#include "vf_ktx2.hpp"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vf_vulkan {
+
+    // Streams mip levels of KTX2 textures by demand.
+    //
+    // Level data is read from the AssetBlob of the file (a mapping as long as the file is not compressed).
+    // A texture starts with only its small mips resident (<= minResidentSize). The renderer reports
+    // how many pixels a texture covers on screen (setDemand), higher mips are then read from the
+    // mapped file on worker threads into staging memory and copied into a bigger image at the start
+    // of a frame. When resident memory goes over the budget, mips that are not needed (or were not
+    // used for the longest time) are dropped by copying the remaining mips into a smaller image.
+    //
+    // The VkImage/VkImageView of a texture change when its residency changes:
+    // fetch imageView() every frame instead of caching it.
+    class TextureStreamer {
+    public:
+        struct Settings {
+            uint64_t budgetBytes = 256ull << 20;
+            uint32_t minResidentSize = 64;           // Mips up to this size never leave memory
+            uint32_t maxPendingUploads = 4;
+            uint64_t maxUploadBytesPerFrame = 16ull << 20;
+            uint32_t idleFrames = 120;               // Without demand a texture falls back to its small mips
+        };
+
+        TextureStreamer(const DeviceHandles& handles, vf_core::ThreadPool& threadPool,
+            uint32_t framesInFlight, const Settings& settings);
+        ~TextureStreamer();
+
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        TextureHandle load(const std::string& filename, AssetBlob data);
+        void setDemand(TextureHandle texture, float screenPixels);
+        void setBudget(uint64_t bytes);
+
+        // Once per frame, after the fence of the frame was waited on and outside of a render pass
+        void recordUpdates(VkCommandBuffer commandBuffer);
+
+        VkImageView imageView(TextureHandle texture) const;
+        VkSampler sampler() const { return sampler_; }
+        // Combined image samplers for handles [0, count), slots without a texture get a 1x1 white image.
+        // Written after recordUpdates of the frame: the views of that frame are final then
+        void writeDescriptors(DescriptorData* data, uint32_t count) const;
+        TextureStreamingStats stats() const;
+
+    private:
+        // Image that holds mips [firstLevel, levelCount) of a texture, image mip 0 == firstLevel
+        struct ResidentImage {
+            VkImage image = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkDeviceSize bytes = 0;
+            uint32_t firstLevel = 0;
+        };
+
+        struct PendingUpload {
+            uint32_t firstLevel = 0;
+            GpuBuffer staging;
+            std::vector<VkDeviceSize> offsets; // Per level from firstLevel to the resident first level
+            uint64_t reservedBytes = 0;        // Growth of resident memory once the upload lands
+            std::future<void> job;
+        };
+
+        struct Texture {
+            std::string filename;
+            AssetBlob data;
+            Ktx2Texture ktx;
+            VkFormat format = VK_FORMAT_UNDEFINED; // Format of the GPU image
+            bool decode = false;                   // BCn payload decoded to RGBA8 on the workers
+            uint32_t baseLevel = 0;                // Always resident from here to the last level
+            uint32_t desiredLevel = 0;
+            uint64_t lastDemandFrame = 0;
+            ResidentImage resident;
+            std::unique_ptr<PendingUpload> pending;
+        };
+
+        struct Retired {
+            uint64_t frame;
+            ResidentImage image;
+            GpuBuffer staging;
+        };
+
+        uint32_t levelCount(const Texture& texture) const;
+        uint64_t levelUploadSize(const Texture& texture, uint32_t level) const;
+        uint64_t estimateImageBytes(const Texture& texture, uint32_t firstLevel) const;
+
+        ResidentImage createImage(const Texture& texture, uint32_t firstLevel);
+        void destroyImage(ResidentImage& image);
+        void retire(ResidentImage& image, GpuBuffer staging);
+        void releaseRetired(bool all);
+
+        // Fills dst: [dst.firstLevel, copyFrom) from staging, [copyFrom, levelCount) from src
+        void recordTransfer(VkCommandBuffer commandBuffer, const Texture& texture, const ResidentImage& dst,
+            const ResidentImage* src, const GpuBuffer* staging, const std::vector<VkDeviceSize>& offsets);
+
+        void fillStaging(const Texture& texture, uint32_t firstLevel, uint32_t endLevel,
+            const std::vector<VkDeviceSize>& offsets, uint8_t* dst) const;
+        std::vector<VkDeviceSize> stagingLayout(const Texture& texture, uint32_t firstLevel, uint32_t endLevel,
+            VkDeviceSize& totalSize) const;
+
+        void finishUploads(VkCommandBuffer commandBuffer);
+        void evictUnderPressure(VkCommandBuffer commandBuffer);
+        void scheduleUploads();
+
+        DeviceHandles handles_;
+        vf_core::ThreadPool& threadPool_;
+        uint32_t framesInFlight_;
+        Settings settings_;
+
+        VkSampler sampler_ = VK_NULL_HANDLE;
+        ResidentImage fallback_;
+        std::vector<std::unique_ptr<Texture>> textures_;
+        std::vector<Retired> retired_;
+
+        uint64_t frame_ = 0;
+        uint64_t residentBytes_ = 0;
+        uint64_t reservedBytes_ = 0;
+        uint64_t streamedBytes_ = 0;
+        uint64_t evictions_ = 0;
+    };
+
+} // namespace vf_vulkan
+
+#endif // VFRAME_TEXTURE_STREAMER_HPP
@@ -0,0 +1,170 @@
+﻿#include <vFrame/vf_thread_pool.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vf_core {
+
+    class ThreadPool::Impl {
+    public:
+        explicit Impl(size_t threadCount)
+        {
+            if (threadCount == 0) {
+                size_t hardware = std::thread::hardware_concurrency();
+                threadCount = hardware > 1 ? hardware - 1 : 1; // Main thread keeps one core
+            }
+
+            workers.reserve(threadCount);
+            for (size_t i = 0; i < threadCount; i++) {
+                workers.emplace_back([this]() {
+                    traceSetThreadName("vFrame worker");
+                    workerLoop();
+                });
+            }
+        }
+
+        ~Impl()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        void
+        enqueue(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push_back(std::move(task));
+            }
+            condition.notify_one();
+        }
+
+        // Runs one queued task on the calling thread, used while waiting in parallelFor
+        bool
+        tryRunOne()
+        {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (tasks.empty()) return false;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+            return true;
+        }
+
+        std::vector<std::thread> workers;
+
+    private:
+        void
+        workerLoop()
+        {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                    if (stopping && tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::function<void()>> tasks;
+        bool stopping = false;
+    };
+
+    ThreadPool::ThreadPool(size_t threadCount)
+        : pImpl(std::make_unique<Impl>(threadCount))
+    {
+    }
+
+    ThreadPool::~ThreadPool() = default;
+
+    void
+    ThreadPool::enqueue(std::function<void()> task)
+    {
+        pImpl->enqueue(std::move(task));
+    }
+
+    void
+    ThreadPool::parallelFor(size_t begin, size_t end, size_t grainSize,
+        const std::function<void(size_t, size_t)>& fn)
+    {
+        if (begin >= end) return;
+
+        const size_t count = end - begin;
+        grainSize = std::max<size_t>(grainSize, 1);
+        const size_t maxChunks = (pImpl->workers.size() + 1) * 4; // A few chunks per thread for balance
+        const size_t chunkSize = std::max(grainSize, (count + maxChunks - 1) / maxChunks);
+        const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        if (chunkCount == 1) {
+            fn(begin, end);
+            return;
+        }
+
+        // Chunks are claimed through an atomic counter, so the caller and the workers
+        // share the same work and nobody waits on a particular chunk
+        struct Shared {
+            std::atomic<size_t> nextChunk{ 0 };
+            std::atomic<size_t> doneChunks{ 0 };
+        };
+        auto shared = std::make_shared<Shared>();
+
+        auto runChunks = [shared, begin, end, chunkSize, chunkCount, &fn]() {
+            for (;;) {
+                size_t chunk = shared->nextChunk.fetch_add(1);
+                if (chunk >= chunkCount) return;
+                size_t chunkBegin = begin + chunk * chunkSize;
+                fn(chunkBegin, std::min(end, chunkBegin + chunkSize));
+                shared->doneChunks.fetch_add(1, std::memory_order_release);
+            }
+        };
+
+        const size_t helpers = std::min(pImpl->workers.size(), chunkCount - 1);
+        for (size_t i = 0; i < helpers; i++) {
+            pImpl->enqueue(runChunks);
+        }
+
+        runChunks();
+
+        // Help with other queued work instead of spinning idle
+        while (shared->doneChunks.load(std::memory_order_acquire) < chunkCount) {
+            if (!pImpl->tryRunOne()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    size_t
+    ThreadPool::size() const
+    {
+        return pImpl->workers.size();
+    }
+
+    ThreadPool&
+    ThreadPool::global()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+} // namespace vf_core
@@ -0,0 +1,257 @@
+﻿#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace vf_core {
+
+    namespace {
+
+        enum class EventKind : uint32_t {
+            CPU_ZONE,
+            GPU_ZONE,
+            FRAME,
+        };
+
+        struct TraceEvent {
+            const char* name;
+            int64_t begin;
+            int64_t end;
+            uint64_t frame;
+            EventKind kind;
+        };
+
+        // Written only by its thread. The exporter reads events [0, count) after the capture stopped,
+        // count is published with release after the event itself is written.
+        struct ThreadBuffer {
+            uint32_t threadId = 0;
+            std::string name;                    // Guarded by TraceState::mutex
+            std::vector<TraceEvent> events;      // Allocated on the first event of a capture
+            std::atomic<uint32_t> session{ 0 };  // Capture the events belong to
+            std::atomic<uint32_t> count{ 0 };
+            std::atomic<uint32_t> dropped{ 0 };
+        };
+
+        struct TraceState {
+            std::atomic<bool> enabled{ false };
+            std::atomic<uint32_t> session{ 0 };
+            std::atomic<uint32_t> capacity{ 0 };
+            std::atomic<int64_t> startTime{ 0 };
+
+            // Only taken when a thread writes its first event ever and by the exporter
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers; // Outlive their threads
+            uint32_t nextThreadId = 1;
+        };
+
+        TraceState&
+        state()
+        {
+            static TraceState traceState;
+            return traceState;
+        }
+
+        thread_local std::shared_ptr<ThreadBuffer> localBuffer;
+
+        ThreadBuffer&
+        threadBuffer()
+        {
+            if (!localBuffer) {
+                TraceState& trace = state();
+                auto buffer = std::make_shared<ThreadBuffer>();
+                std::lock_guard<std::mutex> lock(trace.mutex);
+                buffer->threadId = trace.nextThreadId++;
+                trace.buffers.push_back(buffer);
+                localBuffer = std::move(buffer);
+            }
+            return *localBuffer;
+        }
+
+        void
+        push(const TraceEvent& event)
+        {
+            TraceState& trace = state();
+            if (!trace.enabled.load(std::memory_order_acquire)) return;
+
+            ThreadBuffer& buffer = threadBuffer();
+            const uint32_t session = trace.session.load(std::memory_order_acquire);
+            if (buffer.session.load(std::memory_order_relaxed) != session) {
+                // First event of this thread in the capture
+                buffer.events.resize(trace.capacity.load(std::memory_order_relaxed));
+                buffer.count.store(0, std::memory_order_relaxed);
+                buffer.dropped.store(0, std::memory_order_relaxed);
+                buffer.session.store(session, std::memory_order_release);
+            }
+
+            const uint32_t index = buffer.count.load(std::memory_order_relaxed);
+            if (index >= buffer.events.size()) {
+                buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            buffer.events[index] = event;
+            buffer.count.store(index + 1, std::memory_order_release);
+        }
+
+        void
+        writeEscaped(std::ofstream& out, const char* text)
+        {
+            for (const char* c = text; *c != '\0'; c++) {
+                if (*c == '"' || *c == '\\') out << '\\';
+                if (static_cast<unsigned char>(*c) < 0x20) continue;
+                out << *c;
+            }
+        }
+
+        // Chrome trace timestamps are microseconds, fractions keep the nanoseconds
+        void
+        writeMicroseconds(std::ofstream& out, int64_t nanoseconds)
+        {
+            // GPU zones collected late may start before the capture did
+            if (nanoseconds < 0) {
+                out << '-';
+                nanoseconds = -nanoseconds;
+            }
+            const int64_t whole = nanoseconds / 1000;
+            const int64_t fraction = nanoseconds % 1000;
+            out << whole << '.' << static_cast<char>('0' + fraction / 100)
+                << static_cast<char>('0' + fraction / 10 % 10) << static_cast<char>('0' + fraction % 10);
+        }
+
+        constexpr int CPU_PROCESS = 1;
+        constexpr int GPU_PROCESS = 2;
+
+    } // namespace
+
+    void
+    traceStart(uint32_t maxEventsPerThread)
+    {
+        TraceState& trace = state();
+        trace.enabled.store(false, std::memory_order_release);
+        trace.capacity.store(maxEventsPerThread, std::memory_order_relaxed);
+        trace.startTime.store(traceNow(), std::memory_order_relaxed);
+        trace.session.fetch_add(1, std::memory_order_release);
+        trace.enabled.store(true, std::memory_order_release);
+    }
+
+    void
+    traceStop()
+    {
+        state().enabled.store(false, std::memory_order_release);
+    }
+
+    bool
+    traceEnabled()
+    {
+        return state().enabled.load(std::memory_order_relaxed);
+    }
+
+    int64_t
+    traceNow()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void
+    traceSetThreadName(const char* name)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(state().mutex);
+        buffer.name = name;
+    }
+
+    void
+    traceZone(const char* name, int64_t beginNanoseconds, int64_t endNanoseconds)
+    {
+        push({ name, beginNanoseconds, endNanoseconds, 0, EventKind::CPU_ZONE });
+    }
+
+    void
+    traceGpuZone(const char* name, int64_t beginNanoseconds, int64_t endNanoseconds)
+    {
+        push({ name, beginNanoseconds, endNanoseconds, 0, EventKind::GPU_ZONE });
+    }
+
+    void
+    traceFrame(uint64_t frameNumber)
+    {
+        const int64_t now = traceNow();
+        push({ "Frame", now, now, frameNumber, EventKind::FRAME });
+    }
+
+    void
+    traceWriteChromeJson(const char* filename)
+    {
+        TraceState& trace = state();
+        if (trace.enabled.load(std::memory_order_acquire)) {
+            throw std::runtime_error("trace capture must be stopped before it is written!");
+        }
+
+        std::ofstream out(filename, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error(std::string("failed to open trace file: ") + filename);
+        }
+
+        const uint32_t session = trace.session.load(std::memory_order_acquire);
+        const int64_t start = trace.startTime.load(std::memory_order_relaxed);
+        uint64_t dropped = 0;
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << CPU_PROCESS << ",\"args\":{\"name\":\"CPU\"}},\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << GPU_PROCESS << ",\"args\":{\"name\":\"GPU\"}},\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << GPU_PROCESS
+            << ",\"tid\":1,\"args\":{\"name\":\"Graphics queue\"}}";
+
+        std::lock_guard<std::mutex> lock(trace.mutex);
+        for (const std::shared_ptr<ThreadBuffer>& buffer : trace.buffers) {
+            if (buffer->session.load(std::memory_order_acquire) != session) continue;
+            const uint32_t count = buffer->count.load(std::memory_order_acquire);
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << CPU_PROCESS << ",\"tid\":" << buffer->threadId
+                << ",\"args\":{\"name\":\"";
+            if (buffer->name.empty()) {
+                out << "Thread " << buffer->threadId;
+            }
+            else {
+                writeEscaped(out, buffer->name.c_str());
+            }
+            out << "\"}}";
+
+            for (uint32_t i = 0; i < count; i++) {
+                const TraceEvent& event = buffer->events[i];
+                const bool gpu = event.kind == EventKind::GPU_ZONE;
+
+                out << ",\n{\"name\":\"";
+                writeEscaped(out, event.name);
+                if (event.kind == EventKind::FRAME) {
+                    out << ' ' << event.frame;
+                }
+                out << "\",\"pid\":" << (gpu ? GPU_PROCESS : CPU_PROCESS)
+                    << ",\"tid\":" << (gpu ? 1u : buffer->threadId) << ",\"ts\":";
+                writeMicroseconds(out, event.begin - start);
+                if (event.kind == EventKind::FRAME) {
+                    out << ",\"ph\":\"i\",\"s\":\"g\"}"; // Global instant: a line across every track
+                }
+                else {
+                    out << ",\"ph\":\"X\",\"dur\":";
+                    writeMicroseconds(out, std::max<int64_t>(0, event.end - event.begin));
+                    out << '}';
+                }
+            }
+        }
+
+        out << "\n],\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+        if (!out) {
+            throw std::runtime_error(std::string("failed to write trace file: ") + filename);
+        }
+    }
+
+} // namespace vf_core
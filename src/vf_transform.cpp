@@ -0,0 +1,410 @@
+﻿#include <vFrame/vf_transform.hpp>
+#include <vFrame/vf_thread_pool.hpp>
+#include <vFrame/vf_trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+
+namespace vf_core {
+
+    namespace {
+
+        constexpr uint32_t NO_SLOT = 0xFFFFFFFFu;
+        constexpr size_t LEVEL_GRAIN = 1024;    // Nodes per task inside one level
+        constexpr uint32_t GATHER_BLOCK = 4096; // Nodes per task when packing the changed list
+
+        // Depth while re-sorting
+        constexpr int32_t DEPTH_UNKNOWN = -2;
+        constexpr int32_t DEPTH_DEAD = -3;
+
+    } // namespace
+
+    class TransformHierarchy::Impl {
+    public:
+        // Per slot. Sorted by depth after rebuild(), new nodes are appended until then
+        std::vector<Transform> locals;
+        std::vector<Mat4> worlds;
+        std::vector<uint32_t> ids;
+        std::vector<uint32_t> parentIds;
+        std::vector<uint32_t> parentSlots;  // Valid while sorted
+        std::vector<uint8_t> dirty;         // Local changed, created or reparented
+        std::vector<uint8_t> changed;       // World recomputed by the running update
+        std::vector<uint32_t> levelStarts;  // Slots of depth d: [levelStarts[d], levelStarts[d + 1])
+        std::vector<uint8_t> levelDirty;    // Some node of the level is dirty
+        std::vector<uint8_t> levelChanged;  // Some node of the level was recomputed; when not, its changed flags are stale
+
+        // Per id
+        std::vector<uint32_t> slotOf;       // NO_SLOT when free
+        std::vector<uint8_t> destroyed;     // Removed at the next rebuild, with the subtree
+        std::vector<uint32_t> freeIds;
+
+        bool sorted = true;
+        bool anyDirty = false;
+        std::vector<uint32_t> blockStarts;   // Gather blocks over the changed levels
+
+        std::vector<uint32_t> changedNodes;
+        std::vector<Mat4> changedWorlds;
+        std::vector<uint32_t> blockOffsets;
+
+        // Drops destroyed subtrees and sorts the live slots by depth, then by parent.
+        // Siblings keep their relative order between rebuilds
+        void
+        rebuild()
+        {
+            const size_t count = ids.size();
+            std::vector<int32_t> depth(count, DEPTH_UNKNOWN);
+            std::vector<uint32_t> path;
+
+            for (size_t slot = 0; slot < count; slot++) {
+                // Up to the first ancestor with a known depth, then back down
+                uint32_t current = static_cast<uint32_t>(slot);
+                int32_t base;
+                for (;;) {
+                    if (depth[current] != DEPTH_UNKNOWN) {
+                        base = depth[current];
+                        break;
+                    }
+                    path.push_back(current);
+                    if (destroyed[ids[current]]) {
+                        base = DEPTH_DEAD;
+                        break;
+                    }
+                    if (parentIds[current] == VF_NO_PARENT) {
+                        base = -1;
+                        break;
+                    }
+                    current = slotOf[parentIds[current]];
+                }
+                while (!path.empty()) {
+                    const uint32_t node = path.back();
+                    path.pop_back();
+                    if (base == DEPTH_DEAD || destroyed[ids[node]]) {
+                        base = DEPTH_DEAD;
+                    }
+                    else {
+                        base++;
+                    }
+                    depth[node] = base;
+                }
+            }
+
+            int32_t maxDepth = -1;
+            for (int32_t d : depth) {
+                maxDepth = std::max(maxDepth, d);
+            }
+            levelStarts.assign(static_cast<size_t>(maxDepth) + 2, 0);
+            for (int32_t d : depth) {
+                if (d >= 0) {
+                    levelStarts[static_cast<size_t>(d) + 1]++;
+                }
+            }
+            for (size_t level = 1; level < levelStarts.size(); level++) {
+                levelStarts[level] += levelStarts[level - 1];
+            }
+
+            // Within a level children are grouped by parent, in parent order: the update reads
+            // the previous level front to back instead of jumping around
+            const uint32_t live = levelStarts.back();
+            std::vector<uint32_t> order(live);               // New slot -> old slot
+            std::vector<uint32_t> cursor(levelStarts.begin(), levelStarts.end() - 1);
+            for (size_t slot = 0; slot < count; slot++) {
+                if (depth[slot] >= 0) {
+                    order[cursor[static_cast<size_t>(depth[slot])]++] = static_cast<uint32_t>(slot);
+                }
+                else {
+                    const uint32_t id = ids[slot];
+                    slotOf[id] = NO_SLOT;
+                    destroyed[id] = 0;
+                    freeIds.push_back(id);
+                }
+            }
+
+            std::vector<std::pair<uint32_t, uint32_t>> keys; // Parent's new slot, old slot
+            for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+                const uint32_t begin = levelStarts[level];
+                const uint32_t end = levelStarts[level + 1];
+                if (level > 0) {
+                    keys.clear();
+                    for (uint32_t slot = begin; slot < end; slot++) {
+                        keys.emplace_back(slotOf[parentIds[order[slot]]], order[slot]);
+                    }
+                    std::sort(keys.begin(), keys.end());
+                    for (uint32_t slot = begin; slot < end; slot++) {
+                        order[slot] = keys[slot - begin].second;
+                    }
+                }
+                for (uint32_t slot = begin; slot < end; slot++) {
+                    slotOf[ids[order[slot]]] = slot;
+                }
+            }
+
+            std::vector<Transform> newLocals(live);
+            std::vector<Mat4> newWorlds(live);
+            std::vector<uint32_t> newIds(live), newParentIds(live);
+            std::vector<uint8_t> newDirty(live);
+            for (uint32_t slot = 0; slot < live; slot++) {
+                const uint32_t old = order[slot];
+                newLocals[slot] = locals[old];
+                newWorlds[slot] = worlds[old];
+                newIds[slot] = ids[old];
+                newParentIds[slot] = parentIds[old];
+                newDirty[slot] = dirty[old];
+            }
+
+            locals.swap(newLocals);
+            worlds.swap(newWorlds);
+            ids.swap(newIds);
+            parentIds.swap(newParentIds);
+            dirty.swap(newDirty);
+            changed.assign(live, 0);
+            levelDirty.assign(levelStarts.size() - 1, 1);
+            levelChanged.assign(levelStarts.size() - 1, 0);
+            parentSlots.resize(live);
+            for (uint32_t slot = 0; slot < live; slot++) {
+                parentSlots[slot] = parentIds[slot] == VF_NO_PARENT ? NO_SLOT : slotOf[parentIds[slot]];
+            }
+            sorted = true;
+        }
+
+        // Returns how many nodes were recomputed. Without parentsChanged the previous level's flags are stale
+        uint32_t
+        updateRange(size_t begin, size_t end, bool parentsChanged)
+        {
+            uint32_t recomputed = 0;
+            for (size_t slot = begin; slot < end; slot++) {
+                const uint32_t parentSlot = parentSlots[slot];
+                const bool parentChanged = parentsChanged && parentSlot != NO_SLOT && changed[parentSlot];
+                if (dirty[slot] || parentChanged) {
+                    worlds[slot] = parentSlot == NO_SLOT ? toMat4(locals[slot]) : worlds[parentSlot] * toMat4(locals[slot]);
+                    dirty[slot] = 0;
+                    changed[slot] = 1;
+                    recomputed++;
+                }
+                else {
+                    changed[slot] = 0;
+                }
+            }
+            return recomputed;
+        }
+
+        // Changed slots into changedNodes / changedWorlds: count per block, prefix sum, fill per block.
+        // Only levels with changes are scanned
+        void
+        gather(ThreadPool* pool)
+        {
+            blockStarts.clear();
+            for (size_t level = 0; level < levelChanged.size(); level++) {
+                if (!levelChanged[level]) continue;
+                for (uint32_t begin = levelStarts[level]; begin < levelStarts[level + 1]; begin += GATHER_BLOCK) {
+                    blockStarts.push_back(begin);
+                }
+            }
+            const uint32_t blockCount = static_cast<uint32_t>(blockStarts.size());
+            blockOffsets.assign(static_cast<size_t>(blockCount) + 1, 0);
+
+            // A block never crosses into the next level: it ends at GATHER_BLOCK or the level end
+            auto blockEnd = [&](size_t block) {
+                const uint32_t begin = blockStarts[block];
+                const size_t level = static_cast<size_t>(std::upper_bound(levelStarts.begin(), levelStarts.end(), begin) - levelStarts.begin());
+                return std::min(begin + GATHER_BLOCK, levelStarts[level]);
+            };
+            auto forBlocks = [&](const std::function<void(size_t, size_t)>& fn) {
+                if (pool != nullptr && blockCount > 1) {
+                    pool->parallelFor(0, blockCount, 1, fn);
+                }
+                else {
+                    fn(0, blockCount);
+                }
+            };
+
+            forBlocks([&](size_t first, size_t last) {
+                for (size_t block = first; block < last; block++) {
+                    const uint32_t end = blockEnd(block);
+                    uint32_t blockChanged = 0;
+                    for (uint32_t slot = blockStarts[block]; slot < end; slot++) {
+                        blockChanged += changed[slot];
+                    }
+                    blockOffsets[block + 1] = blockChanged;
+                }
+            });
+            for (uint32_t block = 0; block < blockCount; block++) {
+                blockOffsets[block + 1] += blockOffsets[block];
+            }
+
+            changedNodes.resize(blockOffsets.back());
+            changedWorlds.resize(blockOffsets.back());
+            forBlocks([&](size_t first, size_t last) {
+                for (size_t block = first; block < last; block++) {
+                    const uint32_t end = blockEnd(block);
+                    uint32_t out = blockOffsets[block];
+                    for (uint32_t slot = blockStarts[block]; slot < end; slot++) {
+                        if (changed[slot]) {
+                            changedNodes[out] = ids[slot];
+                            changedWorlds[out] = worlds[slot];
+                            out++;
+                        }
+                    }
+                }
+            });
+        }
+    };
+
+    TransformHierarchy::TransformHierarchy()
+        : pImpl(std::make_unique<Impl>())
+    {
+    }
+
+    TransformHierarchy::~TransformHierarchy() = default;
+
+    uint32_t
+    TransformHierarchy::create(const Transform& local, uint32_t parent)
+    {
+        Impl& impl = *pImpl;
+        uint32_t id;
+        if (!impl.freeIds.empty()) {
+            id = impl.freeIds.back();
+            impl.freeIds.pop_back();
+        }
+        else {
+            id = static_cast<uint32_t>(impl.slotOf.size());
+            impl.slotOf.push_back(NO_SLOT);
+            impl.destroyed.push_back(0);
+        }
+
+        impl.slotOf[id] = static_cast<uint32_t>(impl.ids.size());
+        impl.locals.push_back(local);
+        impl.worlds.push_back(Mat4{});
+        impl.ids.push_back(id);
+        impl.parentIds.push_back(parent);
+        impl.parentSlots.push_back(NO_SLOT);
+        impl.dirty.push_back(1);
+        impl.changed.push_back(0);
+        impl.sorted = false;
+        return id;
+    }
+
+    void
+    TransformHierarchy::destroy(uint32_t node)
+    {
+        pImpl->destroyed[node] = 1;
+        pImpl->sorted = false;
+    }
+
+    void
+    TransformHierarchy::setLocal(uint32_t node, const Transform& local)
+    {
+        const uint32_t slot = pImpl->slotOf[node];
+        pImpl->locals[slot] = local;
+        pImpl->dirty[slot] = 1;
+        pImpl->anyDirty = true;
+        if (pImpl->sorted) {
+            const auto level = std::upper_bound(pImpl->levelStarts.begin(), pImpl->levelStarts.end(), slot) - pImpl->levelStarts.begin() - 1;
+            pImpl->levelDirty[static_cast<size_t>(level)] = 1;
+        }
+    }
+
+    const Transform&
+    TransformHierarchy::local(uint32_t node) const
+    {
+        return pImpl->locals[pImpl->slotOf[node]];
+    }
+
+    void
+    TransformHierarchy::setParent(uint32_t node, uint32_t parent)
+    {
+        Impl& impl = *pImpl;
+        for (uint32_t ancestor = parent; ancestor != VF_NO_PARENT; ancestor = impl.parentIds[impl.slotOf[ancestor]]) {
+            if (ancestor == node) {
+                throw std::runtime_error("failed to set transform parent: node would become its own ancestor!");
+            }
+        }
+        const uint32_t slot = impl.slotOf[node];
+        impl.parentIds[slot] = parent;
+        impl.dirty[slot] = 1;
+        impl.sorted = false;
+    }
+
+    uint32_t
+    TransformHierarchy::parent(uint32_t node) const
+    {
+        return pImpl->parentIds[pImpl->slotOf[node]];
+    }
+
+    const Mat4&
+    TransformHierarchy::world(uint32_t node) const
+    {
+        return pImpl->worlds[pImpl->slotOf[node]];
+    }
+
+    bool
+    TransformHierarchy::alive(uint32_t node) const
+    {
+        return node < pImpl->slotOf.size() && pImpl->slotOf[node] != NO_SLOT && !pImpl->destroyed[node];
+    }
+
+    uint32_t
+    TransformHierarchy::size() const
+    {
+        return static_cast<uint32_t>(pImpl->ids.size());
+    }
+
+    void
+    TransformHierarchy::update(ThreadPool* pool)
+    {
+        VF_TRACE_ZONE("Transform hierarchy");
+        Impl& impl = *pImpl;
+        impl.changedNodes.clear();
+        impl.changedWorlds.clear();
+
+        if (!impl.sorted) {
+            impl.rebuild();
+            impl.anyDirty = true;
+        }
+        if (!impl.anyDirty) {
+            return;
+        }
+
+        // Level d only reads level d - 1, which is complete when parallelFor returns.
+        // A level with no dirty node under an unchanged level is skipped
+        bool parentsChanged = false;
+        for (size_t level = 0; level + 1 < impl.levelStarts.size(); level++) {
+            if (!impl.levelDirty[level] && !parentsChanged) {
+                impl.levelChanged[level] = 0;
+                continue;
+            }
+            const size_t begin = impl.levelStarts[level];
+            const size_t end = impl.levelStarts[level + 1];
+            std::atomic<uint32_t> recomputed{ 0 };
+            auto updateLevel = [&](size_t first, size_t last) {
+                recomputed += impl.updateRange(first, last, parentsChanged);
+            };
+            if (pool != nullptr && end - begin > LEVEL_GRAIN) {
+                pool->parallelFor(begin, end, LEVEL_GRAIN, updateLevel);
+            }
+            else {
+                updateLevel(begin, end);
+            }
+            impl.levelDirty[level] = 0;
+            impl.levelChanged[level] = recomputed > 0 ? 1 : 0;
+            parentsChanged = impl.levelChanged[level] != 0;
+        }
+
+        impl.gather(pool);
+        impl.anyDirty = false;
+    }
+
+    const std::vector<uint32_t>&
+    TransformHierarchy::changedNodes() const
+    {
+        return pImpl->changedNodes;
+    }
+
+    const std::vector<Mat4>&
+    TransformHierarchy::changedWorlds() const
+    {
+        return pImpl->changedWorlds;
+    }
+
+} // namespace vf_core
@@ -9,6 +9,30 @@
 #endif
 
 #include <vFrame/vf_vulkan.hpp>
+#include <vFrame/vf_mesh_format.hpp>
+#include <vFrame/vf_log.hpp>
+#include <vFrame/vf_trace.hpp>
+#include "vf_gpu_scene.hpp"
+#include "vf_asset_archive.hpp"
+#include "vf_texture_streamer.hpp"
+#include "vf_text_renderer.hpp"
+#include "vf_debug_renderer.hpp"
+#include "vf_particle_system.hpp"
+#include "vf_deletion_queue.hpp"
+#include "vf_descriptors.hpp"
+#include "vf_dynamic_resolution.hpp"
+#include "vf_gpu_timer.hpp"
+#include "vf_gpu_trace.hpp"
+#include "vf_memory_budget.hpp"
+#include "vf_render_targets.hpp"
+#include "vf_resource_tracker.hpp"
+#include "vf_pipeline_manager.hpp"
+#include "vf_shader_hot_reload.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 
 namespace vf_vulkan {
     GLFWwindow* window = nullptr;
@@ -28,8 +52,6 @@ namespace vf_vulkan {
             , swapChain{}
             , deviceProperties{}
             , deviceFeatures{}
-            , fragShaderModule{}
-            , vertShaderModule{}
             , swapChainImageFormat{}
             , swapChainExtent{}
 			, commandPool{ VK_NULL_HANDLE }
@@ -39,8 +61,34 @@ namespace vf_vulkan {
             if (device.has_value()) {
                 vkDeviceWaitIdle(*device);
 
+                // Builds in flight read the render pass and pipeline layouts
+                shaderHotReload.reset();
+                if (pipelineManager) {
+                    pipelineManager->waitIdle();
+                }
+                deletionQueue.flushAll();
+
                 cleanupSwapChain();
 
+                textureStreamer.reset();
+                textRenderer.reset();
+#if VFRAME_DEBUG_DRAW
+                debugRenderer.reset();
+#endif
+                particleSystem.reset();
+                gpuScene.reset();
+                pipelineManager.reset(); // Saves the pipeline cache
+                descriptors.reset();
+                resourceTracker.reset();
+                gpuTimer.reset();
+                gpuTrace.reset();
+                memoryTracker.reset(); // After everything that frees memory
+
+                if (pipelineLayout.has_value()) {
+                    vkDestroyPipelineLayout(*device, *pipelineLayout, nullptr);
+                    pipelineLayout.reset();
+                }
+
                 for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
                     if (imageAvailableSemaphores[i] != VK_NULL_HANDLE) {
                         vkDestroySemaphore(*device, imageAvailableSemaphores[i], nullptr);
@@ -60,16 +108,6 @@ namespace vf_vulkan {
                     }
                 }
 
-                if (vertShaderModule != VK_NULL_HANDLE) {
-                    vkDestroyShaderModule(*device, vertShaderModule, nullptr);
-                    vertShaderModule = VK_NULL_HANDLE;
-                }
-
-                if (fragShaderModule != VK_NULL_HANDLE) {
-                    vkDestroyShaderModule(*device, fragShaderModule, nullptr);
-                    fragShaderModule = VK_NULL_HANDLE;
-                }
-
                 if (commandPool != VK_NULL_HANDLE) {
                     vkDestroyCommandPool(*device, commandPool, nullptr);
                     commandPool = VK_NULL_HANDLE;
@@ -113,14 +151,48 @@ namespace vf_vulkan {
             createSurface(window);
             pickPhysicalDevice();
             createLogicalDevice();
+            memoryTracker = std::make_unique<MemoryTracker>(*physicalDevice, supportsMemoryBudget);
+            memoryTracker->addWarning(0.9f, [](const MemoryStats& stats) {
+                VF_LOG_WARNING("memory", "device local memory at %d%% of the budget",
+                    static_cast<int>(stats.deviceLocalPressure * 100.0f));
+            });
+            pipelineManager = std::make_unique<PipelineManager>(*physicalDevice, *device,
+                vf_core::ThreadPool::global(), pipelineCacheFile);
+            descriptors = std::make_unique<DescriptorManager>(*device, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+            resourceTracker = std::make_unique<ResourceTracker>(supportsSynchronization2);
+            gpuTimer = std::make_unique<GpuTimer>(*physicalDevice, *device,
+                findQueueFamilies(*physicalDevice).graphicsFamily.value(), static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+            gpuTrace = std::make_unique<GpuTraceRecorder>(*instance, *physicalDevice, *device,
+                findQueueFamilies(*physicalDevice).graphicsFamily.value(), static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
+                calibratedTimestampsExtension);
+            chooseRenderTargets();
             createSwapChain();        // Create swap chain after logical device creation
             createImageViews();
+            createRenderTargets();
             createRenderPass();
             createGraphicsPipeline(); // Create graphics pipeline after image views
             createFrameBuffers();     // Save result rendering tobto GPU draw and present on screen and connect to concrent render pass
             createCommandPull();
             createCommandBuffer();
             createSyncObjects();
+
+            deviceHandles.physicalDevice = *physicalDevice;
+            deviceHandles.device = *device;
+            deviceHandles.graphicsQueue = *graphicsQueue;
+            deviceHandles.graphicsFamily = findQueueFamilies(*physicalDevice).graphicsFamily.value();
+            deviceHandles.commandPool = commandPool;
+            deviceHandles.pipelineCache = pipelineManager->cache();
+            deviceHandles.memory = memoryTracker.get();
+
+#if VFRAME_DEBUG_DRAW
+            // Lines are pulled through a buffer device address; without it the debug draw calls only fill
+            // their thread buffers up to the limit
+            if (supportsBufferDeviceAddress) {
+                debugRenderer = std::make_unique<DebugRenderer>(deviceHandles, *pipelineManager,
+                    static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                createDebugPipeline();
+            }
+#endif
         }
 
         VkInstance getInstance() const {
@@ -134,18 +206,61 @@ namespace vf_vulkan {
         void
             drawFrame()
         {
+            VF_TRACE_ZONE("drawFrame");
+
             // 1. Очікуємо на паркан поточного кадру
         // Це гарантує, що GPU завершив роботу над цим 'currentFrame' з попереднього циклу.
-            vkWaitForFences(*device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+            {
+                VF_TRACE_ZONE("Wait for frame");
+                vkWaitForFences(*device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+                waitForFrameLatency();
+            }
+
+            if (presentModeChanged) {
+                presentModeChanged = false;
+                recreateSwapChain();
+            }
+
+            // Frame boundary: retire what older frames no longer use, pick up compiled and reloaded pipelines
+            frameNumber++;
+            VF_TRACE_FRAME(frameNumber);
+            deletionQueue.flush(frameNumber);
+            descriptors->beginFrame(static_cast<uint32_t>(currentFrame));
+            memoryTracker->update();
+            for (VkPipeline old : pipelineManager->update()) {
+                retirePipeline(old);
+            }
+            if (shaderHotReload) {
+                for (VkPipeline old : shaderHotReload->update()) {
+                    retirePipeline(old);
+                }
+            }
+
+            // Timestamps of the frame that last used this slot are ready now that its fence was waited
+            float gpuMilliseconds = 0.0f;
+            if (gpuTimer->read(static_cast<uint32_t>(currentFrame), gpuMilliseconds)) {
+                gpuFrameMilliseconds = gpuMilliseconds;
+                if (resolutionController) {
+                    resolutionController->update(gpuMilliseconds);
+                }
+            }
+            gpuTrace->collect(static_cast<uint32_t>(currentFrame));
 
             // 2. Отримуємо індекс наступного доступного зображення зі swapchain.
             // imageAvailableSemaphores[currentFrame] буде сигналізовано, коли зображення стане доступним.
             uint32_t imageIndex;
-            VkResult result = vkAcquireNextImageKHR(*device, *swapChain, UINT64_MAX,
-                imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+            VkResult result;
+            {
+                VF_TRACE_ZONE("Acquire image");
+                result = vkAcquireNextImageKHR(*device, *swapChain, UINT64_MAX,
+                    imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+            }
 
             // Обробка помилок
             if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                if (textRenderer) {
+                    textRenderer->discardFrame();
+                }
                 recreateSwapChain();
                 return;
             }
@@ -169,7 +284,10 @@ namespace vf_vulkan {
 
             // 5. Запис команд у командний буфер поточного кадру
             // vkResetCommandBuffer(commandBuffers[currentFrame], 0); // Не обов'язково, якщо recordCommandBuffer завжди перезаписує
-            recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+            {
+                VF_TRACE_ZONE("Record commands");
+                recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+            }
 
             // 6. Налаштовуємо інформацію про відправлення команд
             VkSubmitInfo submitInfo{};
@@ -177,7 +295,9 @@ namespace vf_vulkan {
 
             // Чекаємо на imageAvailableSemaphores[currentFrame] перед рендерингом
             VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-            VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+            // With dynamic resolution the swap chain image is only written by the upscaling blit
+            VkPipelineStageFlags waitStages[] = {
+                dynamicResolution ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
             submitInfo.waitSemaphoreCount = 1;
             submitInfo.pWaitSemaphores = waitSemaphores;
             submitInfo.pWaitDstStageMask = waitStages;
@@ -195,6 +315,7 @@ namespace vf_vulkan {
             if (vkQueueSubmit(*graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to submit draw command buffer!");
             }
+            gpuTrace->submitted(static_cast<uint32_t>(currentFrame));
 
             // 7. Налаштовуємо інформацію про представлення кадру
             VkPresentInfoKHR presentInfo{};
@@ -209,10 +330,28 @@ namespace vf_vulkan {
             presentInfo.pSwapchains = swapChains;
             presentInfo.pImageIndices = &imageIndex;
 
+            // Every present gets an id that waitForFrameLatency can wait on
+            presentId++;
+            VkPresentIdKHR presentIdInfo{};
+            presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+            presentIdInfo.swapchainCount = 1;
+            presentIdInfo.pPresentIds = &presentId;
+            if (supportsPresentWait) {
+                presentInfo.pNext = &presentIdInfo;
+            }
+
             presentInfo.pResults = nullptr;
 
             // Представляємо кадр
-            result = vkQueuePresentKHR(*presentQueue, &presentInfo);
+            {
+                VF_TRACE_ZONE("Present");
+                result = vkQueuePresentKHR(*presentQueue, &presentInfo);
+            }
+
+            // Without present wait the interval between present calls is the best estimate there is
+            if (!supportsPresentWait || frameLatency == 0) {
+                recordPresentInterval();
+            }
 
             // Check if we resize window
             if (result == VK_ERROR_OUT_OF_DATE_KHR ||
@@ -227,6 +366,344 @@ namespace vf_vulkan {
             // 8. Переходимо до наступного кадру в циклі
             currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
         }
+
+        // ### GPU-DRIVEN SCENE ###
+        void
+        setSceneCapacity(uint32_t maxObjects, uint32_t maxVertices, uint32_t maxIndices)
+        {
+            if (gpuScene) {
+                throw std::runtime_error("scene capacity must be set before the first scene upload!");
+            }
+            sceneCapacity.maxObjects = maxObjects;
+            sceneCapacity.maxVertices = maxVertices;
+            sceneCapacity.maxIndices = maxIndices;
+        }
+
+        MeshRange
+        uploadSceneMesh(const SceneVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+        {
+            return getGpuScene().uploadMesh(vertices, vertexCount, indices, indexCount);
+        }
+
+        // Cooked .vfmesh: header is validated, streams go from the mapping straight to staging memory
+        SceneMesh
+        loadSceneMesh(const std::string& filename)
+        {
+            AssetBlob file = assets.read(filename);
+            if (file.size() < sizeof(VfMeshHeader)) {
+                throw std::runtime_error("invalid mesh file: " + filename);
+            }
+
+            VfMeshHeader header;
+            std::memcpy(&header, file.data(), sizeof(header));
+
+            const uint64_t vertexBytes = static_cast<uint64_t>(header.vertexStride) * header.vertexCount;
+            const uint64_t indexBytes = sizeof(uint32_t) * static_cast<uint64_t>(header.indexCount);
+            if (header.magic != VF_MESH_MAGIC || header.version != VF_MESH_VERSION) {
+                throw std::runtime_error("unsupported mesh file: " + filename);
+            }
+            if (header.vertexStride != sizeof(SceneVertex) ||
+                header.lodCount == 0 || header.lodCount > VF_MAX_MESH_LODS ||
+                header.vertexDataOffset % VF_MESH_STREAM_ALIGNMENT != 0 ||
+                header.indexDataOffset % VF_MESH_STREAM_ALIGNMENT != 0 ||
+                header.vertexDataOffset > file.size() || vertexBytes > file.size() - header.vertexDataOffset ||
+                header.indexDataOffset > file.size() || indexBytes > file.size() - header.indexDataOffset) {
+                throw std::runtime_error("corrupted mesh file: " + filename);
+            }
+            for (uint32_t i = 0; i < header.lodCount; i++) {
+                if (header.lods[i].firstIndex + static_cast<uint64_t>(header.lods[i].indexCount) > header.indexCount) {
+                    throw std::runtime_error("corrupted mesh file: " + filename);
+                }
+            }
+
+            // The GPU reads vertices through these indices unchecked
+            const auto* vertices = reinterpret_cast<const SceneVertex*>(file.data() + header.vertexDataOffset);
+            const auto* indices = reinterpret_cast<const uint32_t*>(file.data() + header.indexDataOffset);
+            uint32_t maxIndex = 0;
+            for (uint32_t i = 0; i < header.indexCount; i++) {
+                maxIndex = std::max(maxIndex, indices[i]);
+            }
+            if (header.indexCount > 0 && maxIndex >= header.vertexCount) {
+                throw std::runtime_error("corrupted mesh file: " + filename);
+            }
+
+            MeshRange base = getGpuScene().uploadMesh(vertices, header.vertexCount, indices, header.indexCount);
+
+            SceneMesh mesh;
+            mesh.lodCount = header.lodCount;
+            for (uint32_t i = 0; i < header.lodCount; i++) {
+                mesh.lods[i].firstIndex = base.firstIndex + header.lods[i].firstIndex;
+                mesh.lods[i].indexCount = header.lods[i].indexCount;
+                mesh.lods[i].vertexOffset = base.vertexOffset;
+            }
+            std::memcpy(mesh.boundsCenter, header.boundsCenter, sizeof(mesh.boundsCenter));
+            mesh.boundsRadius = header.boundsRadius;
+            return mesh;
+        }
+
+        uint32_t
+        addSceneObjects(const SceneObjectDesc* objects, uint32_t count)
+        {
+            return getGpuScene().addObjects(objects, count);
+        }
+
+        void
+        clearSceneObjects()
+        {
+            if (!gpuScene) return;
+            vkDeviceWaitIdle(*device);
+            gpuScene->clearObjects();
+        }
+
+        void
+        setCamera(const float viewProjection[16], const float position[3])
+        {
+            std::memcpy(cameraViewProjection, viewProjection, sizeof(cameraViewProjection));
+            std::memcpy(cameraPosition, position, sizeof(cameraPosition));
+            getGpuScene().setCamera(viewProjection, position);
+        }
+
+        // ### SHADER HOT RELOAD ###
+        void
+        enableShaderHotReload(const std::string& sourceDir, const std::string& compiler)
+        {
+            if (!device.has_value()) {
+                throw std::runtime_error("Vulkan context not initialized!");
+            }
+            if (shaderHotReload) return;
+
+            shaderHotReload = std::make_unique<ShaderHotReload>(*device, vf_core::ThreadPool::global(),
+                sourceDir, "shaders", compiler);
+            shaderHotReload->addPipeline({ "vert.spv", "frag.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) { return buildGraphicsPipeline(spirv[0], spirv[1]); },
+                [this](VkPipeline pipeline) { return pipelineManager->replace(graphicsPipeline, pipeline); });
+            watchScenePipelines();
+            watchTextPipeline();
+            watchDebugPipeline();
+            watchParticlePipelines();
+        }
+
+        void
+        watchShader(const std::string& source, const std::string& spvName)
+        {
+            if (!shaderHotReload) {
+                throw std::runtime_error("shader hot reload is not enabled!");
+            }
+            shaderHotReload->watchShader(source, spvName);
+        }
+
+        PipelineStats
+        getPipelineStats() const
+        {
+            return pipelineManager ? pipelineManager->stats() : PipelineStats();
+        }
+
+        void
+        setRenderTargets(bool depth, uint32_t samples)
+        {
+            if (device.has_value()) {
+                throw std::runtime_error("render targets must be set before init()!");
+            }
+            depthEnabled = depth;
+            requestedSamples = std::max(samples, 1u);
+        }
+
+        void
+        enableDynamicResolution(float targetMilliseconds, float minScale)
+        {
+            if (device.has_value()) {
+                throw std::runtime_error("dynamic resolution must be enabled before init()!");
+            }
+            dynamicResolutionRequested = true;
+            resolutionSettings.targetMilliseconds = targetMilliseconds;
+            resolutionSettings.minScale = std::clamp(minScale, 0.1f, 1.0f);
+        }
+
+        DynamicResolutionStats
+        getDynamicResolutionStats() const
+        {
+            DynamicResolutionStats stats;
+            stats.enabled = dynamicResolution;
+            stats.scale = resolutionController ? resolutionController->scale() : 1.0f;
+            stats.gpuMilliseconds = gpuFrameMilliseconds;
+            stats.smoothedGpuMilliseconds = resolutionController ? resolutionController->smoothedMilliseconds() : gpuFrameMilliseconds;
+            stats.renderWidth = renderExtent.width;
+            stats.renderHeight = renderExtent.height;
+            return stats;
+        }
+
+        void
+        setPresentMode(PresentMode mode)
+        {
+            if (mode == requestedPresentMode) return;
+            requestedPresentMode = mode;
+            presentModeChanged = swapChain.has_value();
+        }
+
+        void
+        setFrameLatency(uint32_t frames)
+        {
+            frameLatency = frames;
+        }
+
+        void
+        addMemoryWarning(float fraction, std::function<void(const MemoryStats&)> callback)
+        {
+            if (!memoryTracker) {
+                throw std::runtime_error("Vulkan context not initialized!");
+            }
+            memoryTracker->addWarning(fraction, std::move(callback));
+        }
+
+        MemoryStats
+        getMemoryStats() const
+        {
+            return memoryTracker ? memoryTracker->stats() : MemoryStats{};
+        }
+
+        PresentStats
+        getPresentStats() const
+        {
+            PresentStats stats = presentStats;
+            stats.requestedMode = requestedPresentMode;
+            stats.activeMode = activePresentMode;
+            stats.presentWait = supportsPresentWait;
+            stats.frameLatency = supportsPresentWait ? frameLatency : 0;
+            return stats;
+        }
+
+        void
+        setPipelineCacheFile(const std::string& filename)
+        {
+            if (pipelineManager) {
+                throw std::runtime_error("pipeline cache file must be set before init()!");
+            }
+            pipelineCacheFile = filename;
+        }
+
+        // ### ASSETS ###
+        void
+        mountAssetArchive(const std::string& filename)
+        {
+            assets.mount(filename);
+        }
+
+        // ### TEXTURE STREAMING ###
+        TextureHandle
+        loadTexture(const std::string& filename)
+        {
+            return getTextureStreamer().load(filename, assets.read(filename));
+        }
+
+        void
+        setTextureDemand(TextureHandle texture, float screenPixels)
+        {
+            getTextureStreamer().setDemand(texture, screenPixels);
+        }
+
+        void
+        setTextureBudget(uint64_t bytes)
+        {
+            textureSettings.budgetBytes = bytes;
+            if (textureStreamer) {
+                textureStreamer->setBudget(bytes);
+            }
+        }
+
+        TextureStreamingStats
+        getTextureStats() const
+        {
+            if (!textureStreamer) {
+                TextureStreamingStats stats;
+                stats.budgetBytes = textureSettings.budgetBytes;
+                return stats;
+            }
+            return textureStreamer->stats();
+        }
+
+        // ### TEXT ###
+        FontHandle
+        loadFont(const std::string& filename, const vf_core::FontConfig& config)
+        {
+            TextRenderer& renderer = getTextRenderer();
+
+            // One cache per font file, the header inside rejects it when the file or the config changed
+            vf_core::FontConfig fontConfig = config;
+            if (fontConfig.cacheFile.empty()) {
+                const uint64_t hash = vfPakHashPath(filename.data(), filename.size());
+                char name[64];
+                std::snprintf(name, sizeof(name), "vframe_font_%016llx.sdf", static_cast<unsigned long long>(hash));
+                fontConfig.cacheFile = name;
+            }
+
+            AssetBlob file = assets.read(filename);
+            auto font = std::make_unique<vf_core::Font>(file.data(), file.size(), fontConfig, &vf_core::ThreadPool::global());
+            return renderer.addFont(std::move(font));
+        }
+
+        void
+        drawText(FontHandle font, const char* text, float x, float y, float size, const float color[4], float maxWidth)
+        {
+            getTextRenderer().drawText(font, text, x, y, size, color, maxWidth);
+        }
+
+        void
+        measureText(FontHandle font, const char* text, float size, float maxWidth, float& width, float& height)
+        {
+            getTextRenderer().measureText(font, text, size, maxWidth, width, height);
+        }
+
+        TextStats
+        getTextStats() const
+        {
+            return textRenderer ? textRenderer->stats() : TextStats{};
+        }
+
+        // ### PARTICLES ###
+        void
+        setParticleSettings(const ParticleSettings& settings)
+        {
+            if (device.has_value()) {
+                throw std::runtime_error("particle settings must be set before init()!");
+            }
+            particleSettings = settings;
+        }
+
+        EmitterHandle
+        addParticleEmitter(const ParticleEmitterDesc& desc)
+        {
+            return getParticleSystem().addEmitter(desc);
+        }
+
+        void
+        updateParticleEmitter(EmitterHandle emitter, const ParticleEmitterDesc& desc)
+        {
+            getParticleSystem().updateEmitter(emitter, desc);
+        }
+
+        void
+        removeParticleEmitter(EmitterHandle emitter)
+        {
+            getParticleSystem().removeEmitter(emitter);
+        }
+
+        void
+        burstParticles(EmitterHandle emitter, uint32_t count)
+        {
+            getParticleSystem().burst(emitter, count);
+        }
+
+        ParticleStats
+        getParticleStats() const
+        {
+            if (!particleSystem) {
+                ParticleStats stats;
+                stats.maxParticles = particleSettings.maxParticles;
+                return stats;
+            }
+            return particleSystem->stats();
+        }
+
     private:
         struct VulkanConfig {
             const char* appName = "Vulkan App";
@@ -247,14 +724,12 @@ namespace vf_vulkan {
         std::optional<VkRenderPass> renderPass;
         // Pipeline Layout — це "контракт" для uniform буферів, текстур і push constants, що дає шейдерам доступ до потрібних ресурсів.
         std::optional<VkPipelineLayout> pipelineLayout;
-        std::optional<VkPipeline> graphicsPipeline;
+        PipelineState graphicsState;
+        PipelineHandle graphicsPipeline = VF_INVALID_PIPELINE;
        
         // Don't optional because he always have value
         VkPhysicalDeviceProperties deviceProperties;
         VkPhysicalDeviceFeatures deviceFeatures;
-        // Image views for the swap chain images
-        VkShaderModule vertShaderModule;
-        VkShaderModule fragShaderModule;
         VkFormat swapChainImageFormat; // Format of the swap chain images
         VkExtent2D swapChainExtent; // Resolution of the swap chain images
         VkCommandPool commandPool;
@@ -262,6 +737,38 @@ namespace vf_vulkan {
         std::vector<VkImage> swapChainImages; // Images in the swap chain
         std::vector<VkImageView> swapChainImageViews; // Image views for the swap chain images
         std::vector<VkFramebuffer> swapChainFramebuffers;
+
+        // Depth and MSAA color are shared by every framebuffer, only the swap chain image differs
+        bool depthEnabled = true;
+        uint32_t requestedSamples = 1;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        AttachmentImage depthAttachment;
+        AttachmentImage msaaColorAttachment; // Resolved into the swap chain image at the end of the subpass
+
+        // Dynamic resolution: the scene is drawn into the top left renderExtent of sceneColorTarget,
+        // which is blitted (upscaled) into the swap chain image at the end of the frame
+        bool dynamicResolutionRequested = false;
+        bool dynamicResolution = false; // Requested and supported by the swap chain
+        ResolutionController::Settings resolutionSettings;
+        std::unique_ptr<ResolutionController> resolutionController;
+        std::unique_ptr<GpuTimer> gpuTimer;
+        std::unique_ptr<GpuTraceRecorder> gpuTrace; // GPU zones while a vf_core trace capture runs
+        std::unique_ptr<MemoryTracker> memoryTracker; // Every device allocation, heap budgets, warnings
+        float gpuFrameMilliseconds = 0.0f;
+        AttachmentImage sceneColorTarget;
+        VkExtent2D renderExtent{};
+
+        // Presentation: mode changes recreate the swap chain at the next frame boundary
+        PresentMode requestedPresentMode = PresentMode::MAILBOX;
+        PresentMode activePresentMode = PresentMode::FIFO;
+        bool presentModeChanged = false;
+        uint32_t frameLatency = 0;      // Presents allowed to be queued, 0: only the fences limit the CPU
+        PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+        uint64_t presentId = 0;         // Id of the last present
+        uint64_t firstPresentId = 1;    // First id presented to the current swap chain
+        std::chrono::steady_clock::time_point lastPresentTime;
+        PresentStats presentStats;
         std::vector<VkCommandBuffer> commandBuffers;
         // Нові/змінені змінні для "кадрів на льоту"
         std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -273,44 +780,278 @@ namespace vf_vulkan {
         size_t currentFrame = 0; // Для відстеження поточного кадруa
         bool framebufferResized = false;
 
-        // ### PRE CONFIGURATION ###
-        // Function from GLSL to SPIR-V bytecode
-		const int MAX_FRAMES_IN_FLIGHT = 2; // Maximum number of frames in flight
+        // Optional device features (filled in createLogicalDevice)
+        bool supportsBufferDeviceAddress = false;
+        bool supportsDrawIndirectCount = false;
+        bool supportsMultiDrawIndirect = false;
+        bool supportsDrawIndirectFirstInstance = false;
+        bool supportsTextureArrayIndexing = false;
+        bool supportsSynchronization2 = false;
+        bool supportsPresentWait = false;
+        const char* calibratedTimestampsExtension = nullptr; // KHR or EXT, nullptr without either
+        bool supportsMemoryBudget = false;
+
+        DeviceHandles deviceHandles;
+        AssetLoader assets{ vf_core::ThreadPool::global() };
+        std::string pipelineCacheFile = "vframe_pipeline_cache.bin";
+        std::unique_ptr<PipelineManager> pipelineManager;
+        std::unique_ptr<DescriptorManager> descriptors; // Transient sets per frame in flight, cached static sets
+        std::unique_ptr<ResourceTracker> resourceTracker; // Last use of tracked buffers/images, emits the barriers
+        GpuScene::Capacity sceneCapacity;
+        std::unique_ptr<GpuScene> gpuScene; // Created on the first scene upload
+        TextureStreamer::Settings textureSettings;
+        std::unique_ptr<TextureStreamer> textureStreamer; // Created on the first texture load
+        std::unique_ptr<TextRenderer> textRenderer; // Created on the first font load
+#if VFRAME_DEBUG_DRAW
+        std::unique_ptr<DebugRenderer> debugRenderer; // Needs bufferDeviceAddress
+        std::vector<vf_core::DebugText> debugTexts;
+#endif
+        ParticleSettings particleSettings;
+        bool particleDepth = false; // Depth collisions: the depth attachment is stored and copied after the pass
+        std::unique_ptr<ParticleSystem> particleSystem; // Created with the first emitter
+        float cameraViewProjection[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 }; // Last setCamera()
+        float cameraPosition[3] = { 0.0f, 0.0f, 0.0f };
+
+        // GPU scene needs cull/scene shaders and buffer device address, so it is created lazily
+        GpuScene&
+        getGpuScene()
+        {
+            if (!gpuScene) {
+                if (!device.has_value()) {
+                    throw std::runtime_error("Vulkan context not initialized!");
+                }
+                if (!supportsBufferDeviceAddress) {
+                    throw std::runtime_error("GPU-driven scene requires bufferDeviceAddress support!");
+                }
+                if (!supportsDrawIndirectFirstInstance) {
+                    throw std::runtime_error("GPU-driven scene requires drawIndirectFirstInstance support!");
+                }
+                if (!supportsTextureArrayIndexing) {
+                    throw std::runtime_error("GPU-driven scene requires shaderSampledImageArrayDynamicIndexing support!");
+                }
+                gpuScene = std::make_unique<GpuScene>(deviceHandles, *pipelineManager, *descriptors, *resourceTracker,
+                    sceneCapacity, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT), supportsDrawIndirectCount,
+                    supportsMultiDrawIndirect, readFile("shaders/cull.spv"));
+                getTextureStreamer(); // Fills the texture slots of the scene pass
+                createScenePipeline();
+                watchScenePipelines();
+            }
+            return *gpuScene;
+        }
 
-        VkShaderModule createShaderModule(const std::vector<char>& code) {
-            VkShaderModuleCreateInfo createInfo{};
-            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            createInfo.codeSize = code.size();
+        TextureStreamer&
+        getTextureStreamer()
+        {
+            if (!textureStreamer) {
+                if (!device.has_value()) {
+                    throw std::runtime_error("Vulkan context not initialized!");
+                }
+                textureStreamer = std::make_unique<TextureStreamer>(deviceHandles, vf_core::ThreadPool::global(),
+                    static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT), textureSettings);
+            }
+            return *textureStreamer;
+        }
 
-            // In 32 bits because it's SPIR-V bytecode
-            createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-            VkShaderModule shaderModule;
+        // Glyphs are pulled through a buffer device address like the scene vertices
+        TextRenderer&
+        getTextRenderer()
+        {
+            if (!textRenderer) {
+                if (!device.has_value()) {
+                    throw std::runtime_error("Vulkan context not initialized!");
+                }
+                if (!supportsBufferDeviceAddress) {
+                    throw std::runtime_error("text rendering requires bufferDeviceAddress support!");
+                }
+                textRenderer = std::make_unique<TextRenderer>(deviceHandles, *pipelineManager, *descriptors,
+                    static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                createTextPipeline();
+                watchTextPipeline();
+            }
+            return *textRenderer;
+        }
 
-            if (vkCreateShaderModule(*device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create shader module!");
+        // Emission, simulation and sorting run on buffers addressed through buffer device address
+        ParticleSystem&
+        getParticleSystem()
+        {
+            if (!particleSystem) {
+                if (!device.has_value()) {
+                    throw std::runtime_error("Vulkan context not initialized!");
+                }
+                if (!supportsBufferDeviceAddress) {
+                    throw std::runtime_error("GPU particles require bufferDeviceAddress support!");
+                }
+                std::vector<AssetBlob> shaders = assets.readAll({ "shaders/particles.spv", "shaders/particle_sort.spv" });
+                particleSystem = std::make_unique<ParticleSystem>(deviceHandles, *pipelineManager, *resourceTracker,
+                    particleSettings, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT), shaders[0].toChars(), shaders[1].toChars());
+                if (particleDepth) {
+                    particleSystem->setDepthSource(swapChainExtent, depthFormat);
+                }
+                createParticlePipeline();
+                watchParticlePipelines();
             }
+            return *particleSystem;
+        }
 
-            return shaderModule; // Return the created shader module
+        void
+        createTextPipeline()
+        {
+            if (textRenderer) {
+                std::vector<AssetBlob> shaders = assets.readAll({ "shaders/text_vert.spv", "shaders/text_frag.spv" });
+                textRenderer->createPipeline(*renderPass, swapChainImageFormat, depthFormat, msaaSamples,
+                    shaders[0].toChars(), shaders[1].toChars());
+            }
         }
 
-        static std::vector<char> readFile(const std::string& filename) {
-            std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        void
+        createDebugPipeline()
+        {
+#if VFRAME_DEBUG_DRAW
+            if (debugRenderer) {
+                std::vector<AssetBlob> shaders = assets.readAll({ "shaders/debug_vert.spv", "shaders/debug_frag.spv" });
+                debugRenderer->createPipeline(*renderPass, swapChainImageFormat, depthFormat, msaaSamples,
+                    shaders[0].toChars(), shaders[1].toChars());
+            }
+#endif
+        }
 
-            if (!file.is_open()) {
-                throw std::runtime_error("failed to open file: " + filename);
+        void
+        createParticlePipeline()
+        {
+            if (particleSystem) {
+                std::vector<AssetBlob> shaders = assets.readAll({ "shaders/particle_vert.spv", "shaders/particle_frag.spv" });
+                particleSystem->createPipeline(*renderPass, swapChainImageFormat, depthFormat, msaaSamples,
+                    shaders[0].toChars(), shaders[1].toChars());
             }
+        }
+
+        void
+        createScenePipeline()
+        {
+            if (gpuScene) {
+                // Both stages are looked up and decompressed on the thread pool at once
+                std::vector<AssetBlob> shaders = assets.readAll({ "shaders/scene_vert.spv", "shaders/scene_frag.spv" });
+                gpuScene->createPipeline(*renderPass, swapChainImageFormat, depthFormat, msaaSamples,
+                    shaders[0].toChars(), shaders[1].toChars());
+            }
+        }
+
+        // ### PRE CONFIGURATION ###
+        // Function from GLSL to SPIR-V bytecode
+		const int MAX_FRAMES_IN_FLIGHT = 2; // Maximum number of frames in flight
+
+        uint64_t frameNumber = 0;
+        DeletionQueue deletionQueue{ static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) };
+        std::unique_ptr<ShaderHotReload> shaderHotReload; // Development mode only
 
-            // Allocate a buffer 
-            size_t fileSize = (size_t)file.tellg();
-            std::vector<char> buffer(fileSize);
+        void
+        retirePipeline(VkPipeline pipeline)
+        {
+            VkDevice handle = *device;
+            deletionQueue.push(frameNumber, [handle, pipeline]() { vkDestroyPipeline(handle, pipeline, nullptr); });
+        }
+
+        // Scene shaders are part of the library, their sources sit next to the user's shaders
+        void
+        watchScenePipelines()
+        {
+            if (!shaderHotReload || !gpuScene) return;
+
+            shaderHotReload->watchShader("cull.comp", "cull.spv");
+            shaderHotReload->watchShader("scene.vert", "scene_vert.spv");
+            shaderHotReload->watchShader("scene.frag", "scene_frag.spv");
+
+            shaderHotReload->addPipeline({ "cull.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) { return gpuScene->buildCullPipeline(spirv[0]); },
+                [this](VkPipeline pipeline) { return gpuScene->swapCullPipeline(pipeline); });
+            shaderHotReload->addPipeline({ "scene_vert.spv", "scene_frag.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) {
+                    return gpuScene->buildDrawPipeline(spirv[0], spirv[1]);
+                },
+                [this](VkPipeline pipeline) { return gpuScene->swapDrawPipeline(pipeline); });
+        }
+
+        void
+        watchTextPipeline()
+        {
+            if (!shaderHotReload || !textRenderer) return;
+
+            shaderHotReload->watchShader("text.vert", "text_vert.spv");
+            shaderHotReload->watchShader("text.frag", "text_frag.spv");
+            shaderHotReload->addPipeline({ "text_vert.spv", "text_frag.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) {
+                    return textRenderer->buildPipeline(spirv[0], spirv[1]);
+                },
+                [this](VkPipeline pipeline) { return textRenderer->swapPipeline(pipeline); });
+        }
+
+        void
+        watchDebugPipeline()
+        {
+#if VFRAME_DEBUG_DRAW
+            if (!shaderHotReload || !debugRenderer) return;
+
+            shaderHotReload->watchShader("debug.vert", "debug_vert.spv");
+            shaderHotReload->watchShader("debug.frag", "debug_frag.spv");
+            shaderHotReload->addPipeline({ "debug_vert.spv", "debug_frag.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) {
+                    return debugRenderer->buildPipeline(spirv[0], spirv[1]);
+                },
+                [this](VkPipeline pipeline) { return debugRenderer->swapPipeline(pipeline); });
+#endif
+        }
 
-            // Read a bytes file
-            file.seekg(0);
-            file.read(buffer.data(), fileSize);
+        void
+        watchParticlePipelines()
+        {
+            if (!shaderHotReload || !particleSystem) return;
+
+            shaderHotReload->watchShader("particles.comp", "particles.spv");
+            shaderHotReload->watchShader("particle_sort.comp", "particle_sort.spv");
+            shaderHotReload->watchShader("particle.vert", "particle_vert.spv");
+            shaderHotReload->watchShader("particle.frag", "particle_frag.spv");
+
+            shaderHotReload->addPipeline({ "particles.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) { return particleSystem->buildSimulatePipeline(spirv[0]); },
+                [this](VkPipeline pipeline) { return particleSystem->swapSimulatePipeline(pipeline); });
+            shaderHotReload->addPipeline({ "particle_sort.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) { return particleSystem->buildSortPipeline(spirv[0]); },
+                [this](VkPipeline pipeline) { return particleSystem->swapSortPipeline(pipeline); });
+            shaderHotReload->addPipeline({ "particle_vert.spv", "particle_frag.spv" },
+                [this](const std::vector<std::vector<char>>& spirv) {
+                    return particleSystem->buildDrawPipeline(spirv[0], spirv[1]);
+                },
+                [this](VkPipeline pipeline) { return particleSystem->swapDrawPipeline(pipeline); });
+        }
 
-            file.close();
+#if VFRAME_DEBUG_DRAW
+        // Labels of the debug anchors go out with the rest of the text, in the first font
+        void
+        drawDebugTexts()
+        {
+            if (!textRenderer || textRenderer->fontCount() == 0) return;
+
+            vf_core::Mat4 viewProjection;
+            std::memcpy(&viewProjection, cameraViewProjection, sizeof(viewProjection));
+            for (const vf_core::DebugText& label : debugTexts) {
+                const vf_core::Vec4 clip = viewProjection * vf_core::Vec4{ label.anchor.x, label.anchor.y, label.anchor.z, 1.0f };
+                if (clip.w <= 0.0f) continue; // Behind the camera
+
+                const float x = (clip.x / clip.w * 0.5f + 0.5f) * static_cast<float>(swapChainExtent.width);
+                const float y = (clip.y / clip.w * 0.5f + 0.5f) * static_cast<float>(swapChainExtent.height);
+                float color[4];
+                for (uint32_t i = 0; i < 4; i++) {
+                    color[i] = static_cast<float>((label.color >> (8 * i)) & 0xFFu) / 255.0f;
+                }
+                textRenderer->drawText(0, label.text, x + 4.0f, y, 16.0f, color, 0.0f);
+            }
+        }
+#endif
 
-            return buffer; // Return the buffer with file data
+        // Every resource load goes through the asset loader: mounted .vfpak archives first, loose files otherwise
+        std::vector<char> readFile(const std::string& filename) {
+            return assets.read(filename).toChars();
         }
 
         std::vector<const char*> getRequiredExtensions() {
@@ -374,17 +1115,36 @@ namespace vf_vulkan {
             return availableFormats[0]; // Return the first available format if preferred is not found
         }
 
-        // Presentation mode
+        // Presentation mode: the one set with setPresentMode when the surface has it
         VkPresentModeKHR chooseSwapPresentMode(const
             std::vector<VkPresentModeKHR>& aviablePresentMode)
         {
+            VkPresentModeKHR preferred = VK_PRESENT_MODE_FIFO_KHR;
+            switch (requestedPresentMode) {
+            case PresentMode::FIFO:         preferred = VK_PRESENT_MODE_FIFO_KHR; break;
+            case PresentMode::FIFO_RELAXED: preferred = VK_PRESENT_MODE_FIFO_RELAXED_KHR; break;
+            case PresentMode::MAILBOX:      preferred = VK_PRESENT_MODE_MAILBOX_KHR; break;
+            case PresentMode::IMMEDIATE:    preferred = VK_PRESENT_MODE_IMMEDIATE_KHR; break;
+            }
+
             for (const auto& availablePresentMode : aviablePresentMode) {
-                if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+                if (availablePresentMode == preferred) {
                     return availablePresentMode; // Return the preferred mode
                 }
             }
 
-            return VK_PRESENT_MODE_FIFO_KHR; // Return FIFO as a fallback if preferred is not found
+            return VK_PRESENT_MODE_FIFO_KHR; // FIFO is always supported
+        }
+
+        static PresentMode
+        toPresentMode(VkPresentModeKHR mode)
+        {
+            switch (mode) {
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return PresentMode::FIFO_RELAXED;
+            case VK_PRESENT_MODE_MAILBOX_KHR:      return PresentMode::MAILBOX;
+            case VK_PRESENT_MODE_IMMEDIATE_KHR:    return PresentMode::IMMEDIATE;
+            default:                               return PresentMode::FIFO;
+            }
         }
 
         // Swap chain extent (resolution of the swap chain images)
@@ -479,6 +1239,21 @@ namespace vf_vulkan {
             return indices;
         }
 
+        bool
+        hasDeviceExtension(const char* name)
+        {
+            uint32_t extensionCount;
+            vkEnumerateDeviceExtensionProperties(*physicalDevice, nullptr, &extensionCount, nullptr);
+
+            std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+            vkEnumerateDeviceExtensionProperties(*physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+            for (const auto& extension : availableExtensions) {
+                if (strcmp(extension.extensionName, name) == 0) return true;
+            }
+            return false;
+        }
+
         bool
         checkDeviceExtensionsSupport(VkPhysicalDevice device)
         {
@@ -505,8 +1280,15 @@ namespace vf_vulkan {
             const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
             void* /*pUserData*/) {
 
-            if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
-                std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+            // Runs on whatever thread made the Vulkan call, the log does not block it
+            if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+                VF_LOG_SEVERE("vulkan", "%s", pCallbackData->pMessage);
+            }
+            else if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+                VF_LOG_WARNING("vulkan", "%s", pCallbackData->pMessage);
+            }
+            else {
+                VF_LOG_VERBOSE("vulkan", "%s", pCallbackData->pMessage); // Layer/loader INFO and VERBOSE
             }
             return VK_FALSE;
         }
@@ -543,9 +1325,17 @@ namespace vf_vulkan {
             createInfo = {};
             createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
             createInfo.messageSeverity =
-                VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
                 VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
                 VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+            // Layer and loader chatter is only requested with logSetLevel(LogLevel::VERBOSE) before init(),
+            // messages the log would drop are never produced by the layers
+#if VFRAME_LOG_LEVEL <= 0
+            if (vf_core::logLevel() <= vf_core::LogLevel::VERBOSE) {
+                createInfo.messageSeverity |=
+                    VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+                    VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+            }
+#endif
             createInfo.messageType =
                 VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
                 VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
@@ -569,6 +1359,52 @@ namespace vf_vulkan {
             {
                 throw std::runtime_error("failed to begin recording command buffer!");
             }
+            const uint32_t frame = static_cast<uint32_t>(currentFrame);
+            gpuTimer->begin(commandBuffer, frame);
+            gpuTrace->beginFrame(commandBuffer, frame);
+
+            // Debug lines of every thread since the last frame, into the ring slot the fence of this frame freed
+#if VFRAME_DEBUG_DRAW
+            if (debugRenderer) {
+                debugTexts.clear();
+                debugRenderer->collect(frame, debugTexts);
+                drawDebugTexts();
+            }
+#endif
+
+            // Scale picked from the GPU time of earlier frames, the aspect ratio stays the same
+            renderExtent = swapChainExtent;
+            if (resolutionController) {
+                const float scale = resolutionController->scale();
+                renderExtent.width = std::max(1u, static_cast<uint32_t>(swapChainExtent.width * scale));
+                renderExtent.height = std::max(1u, static_cast<uint32_t>(swapChainExtent.height * scale));
+            }
+
+            // Texture residency changes (mip uploads, evictions) are copies, outside of the render pass too
+            if (textureStreamer) {
+                const uint32_t zone = gpuTrace->beginZone(commandBuffer, frame, "Texture uploads");
+                textureStreamer->recordUpdates(commandBuffer);
+                gpuTrace->endZone(commandBuffer, frame, zone);
+            }
+
+            // Compute culling must run outside of the render pass
+            if (gpuScene) {
+                const uint32_t zone = gpuTrace->beginZone(commandBuffer, frame, "Culling");
+                gpuScene->recordCulling(commandBuffer, frame);
+                gpuTrace->endZone(commandBuffer, frame, zone);
+            }
+
+            if (particleSystem) {
+                const uint32_t zone = gpuTrace->beginZone(commandBuffer, frame, "Particles");
+                particleSystem->recordSimulation(commandBuffer, frame, cameraViewProjection, cameraPosition);
+                gpuTrace->endZone(commandBuffer, frame, zone);
+
+                // The last pass copied the depth out: cleared again, so the old contents can go
+                if (particleDepth) {
+                    resourceTracker->useImage(depthAttachment.image, ResourceUsage::DEPTH_ATTACHMENT, true);
+                    resourceTracker->flush(commandBuffer);
+                }
+            }
 
             // Render Pass визначає, як буде використовуватися Framebuffer
             VkRenderPassBeginInfo renderPassInfo{};
@@ -576,28 +1412,31 @@ namespace vf_vulkan {
             renderPassInfo.renderPass = *renderPass; // Ваш створений Render Pass
             renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex]; // Фреймбуфер для поточного зображення
             renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = swapChainExtent; // Розмір області рендерингу
-
-            VkClearValue clearColor = { {{0.1f, 0.1f, 0.1f, 1.0f}} };
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
+            renderPassInfo.renderArea.extent = renderExtent; // Розмір області рендерингу
+
+            // Indexed by attachment: color, depth; the resolve target is not cleared
+            VkClearValue clearValues[2]{};
+            clearValues[0].color = { {0.1f, 0.1f, 0.1f, 1.0f} };
+            clearValues[1].depthStencil = { 1.0f, 0 };
+            renderPassInfo.clearValueCount = depthEnabled ? 2 : 1;
+            renderPassInfo.pClearValues = clearValues;
             // Починаємо рендер-пас. Команди, що йдуть далі, будуть частиною цього пасу.
             // VK_SUBPASS_CONTENTS_INLINE: всі команди для цього рендер-пасу будуть записані безпосередньо в цей буфер.
             // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: команди для цього рендер-пасу будуть у вторинних буферах.
+            const uint32_t sceneZone = gpuTrace->beginZone(commandBuffer, frame, "Scene pass");
             vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *graphicsPipeline);
             VkViewport viewport{};
             viewport.x = 0.0f;
             viewport.y = 0.0f;
-            viewport.width = static_cast<float>(swapChainExtent.width);
-            viewport.height = static_cast<float>(swapChainExtent.height);
+            viewport.width = static_cast<float>(renderExtent.width);
+            viewport.height = static_cast<float>(renderExtent.height);
             viewport.minDepth = 0.0f;
             viewport.maxDepth = 1.0f;
             vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
             VkRect2D scissor{};
             scissor.offset = { 0, 0 };
-            scissor.extent = swapChainExtent;
+            scissor.extent = renderExtent;
             vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
             // Команда малювання
@@ -611,9 +1450,51 @@ namespace vf_vulkan {
              • firstInstance: Used as an offset for instanced rendering, defines the
              lowest value of gl_InstanceIndex.
             */
-            vkCmdDraw(commandBuffer, 4, 1, 0, 0);
+            // Still compiling on the first frames: skip the draw instead of waiting
+            VkPipeline pipeline = pipelineManager->get(graphicsPipeline);
+            if (pipeline != VK_NULL_HANDLE) {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                vkCmdDraw(commandBuffer, 4, 1, 0, 0);
+            }
+
+            if (gpuScene) {
+                DescriptorData textures[VF_MAX_SCENE_TEXTURES];
+                textureStreamer->writeDescriptors(textures, VF_MAX_SCENE_TEXTURES);
+                gpuScene->recordDraw(commandBuffer, frame, textures);
+            }
+
+            if (particleSystem) {
+                particleSystem->recordDraw(commandBuffer);
+            }
+
+#if VFRAME_DEBUG_DRAW
+            if (debugRenderer) {
+                debugRenderer->recordDraw(commandBuffer, frame, cameraViewProjection);
+            }
+#endif
+
+            // Overlay on top of the scene: every string of the frame in one draw
+            if (textRenderer) {
+                textRenderer->recordDraw(commandBuffer, swapChainExtent);
+            }
 
             vkCmdEndRenderPass(commandBuffer); // Enable Render Pass
+            gpuTrace->endZone(commandBuffer, frame, sceneZone);
+
+            // Depth of this frame is what the next frame's particles collide with
+            if (particleSystem && particleDepth) {
+                particleSystem->recordDepthCopy(commandBuffer, depthAttachment.image, renderExtent);
+            }
+
+            // Before the upscale: the blit waits for the acquire (up to a refresh period under FIFO),
+            // that wait must not count as GPU work for the resolution controller
+            gpuTimer->end(commandBuffer, frame);
+
+            if (dynamicResolution) {
+                const uint32_t zone = gpuTrace->beginZone(commandBuffer, frame, "Upscale");
+                recordUpscale(commandBuffer, swapChainImages[imageIndex]);
+                gpuTrace->endZone(commandBuffer, frame, zone);
+            }
 
             // Finish recording buffer
             if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
@@ -622,6 +1503,80 @@ namespace vf_vulkan {
             }
         }
 
+        // Blocks until the present frameLatency frames back is on screen: the CPU runs at most that far ahead
+        // of the display instead of MAX_FRAMES_IN_FLIGHT frames ahead of the GPU
+        void
+        waitForFrameLatency()
+        {
+            if (!supportsPresentWait || frameLatency == 0 || presentId < firstPresentId + frameLatency - 1) return;
+
+            const uint64_t waitId = presentId + 1 - frameLatency;
+            const uint64_t timeout = 100000000; // 100 ms, e.g. a minimized window never presents
+            if (waitForPresent(*device, *swapChain, waitId, timeout) == VK_SUCCESS) {
+                recordPresentInterval();
+            }
+        }
+
+        void
+        recordPresentInterval()
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (presentStats.presents > 0) {
+                const double interval = std::chrono::duration<double, std::milli>(now - lastPresentTime).count();
+                presentStats.lastIntervalMilliseconds = interval;
+                presentStats.averageIntervalMilliseconds = presentStats.presents == 1 ? interval :
+                    presentStats.averageIntervalMilliseconds * 0.95 + interval * 0.05;
+                presentStats.maxIntervalMilliseconds = std::max(presentStats.maxIntervalMilliseconds, interval);
+            }
+            lastPresentTime = now;
+            presentStats.presents++;
+        }
+
+        // Rendered part of the scene color target is stretched over the whole swap chain image
+        void
+        recordUpscale(VkCommandBuffer commandBuffer, VkImage swapChainImage)
+        {
+            // Old contents are not needed; the acquire semaphore is waited at the transfer stage
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = swapChainImage;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkImageBlit blit{};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.layerCount = 1;
+            blit.srcOffsets[1] = { static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1 };
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.layerCount = 1;
+            blit.dstOffsets[1] = { static_cast<int32_t>(swapChainExtent.width), static_cast<int32_t>(swapChainExtent.height), 1 };
+
+            // Render pass left the scene color target in TRANSFER_SRC_OPTIMAL
+            vkCmdBlitImage(commandBuffer, sceneColorTarget.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                swapChainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+            // Presentation waits on the render finished semaphore, the barrier only changes the layout
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
         void
         recreateSwapChain()
         {
@@ -634,14 +1589,52 @@ namespace vf_vulkan {
 
             vkDeviceWaitIdle(*device);
 
+            if (shaderHotReload) {
+                shaderHotReload->pauseBuilds();
+            }
+            pipelineManager->waitIdle(); // Compiles in flight read the render pass
+            deletionQueue.flushAll();
+
+            const VkFormat previousFormat = swapChainImageFormat;
             cleanupSwapChain();
             createSwapChain();
             createImageViews();
+            createRenderTargets();
             // ВАЖЛИВО: перестворювати Render Pass, Graphics Pipeline, та Command Buffers!
             createRenderPass();
-            createGraphicsPipeline();
+            // Viewport and scissor are dynamic: pipelines survive a resize, the new render pass is compatible
+            // with the old one as long as the format is the same
+            if (swapChainImageFormat != previousFormat) {
+                createGraphicsPipeline();
+                createScenePipeline();
+                createTextPipeline();
+                createDebugPipeline();
+                createParticlePipeline();
+            }
+            else {
+                // Stored states still point at the destroyed render pass, hot reload builds from them
+                graphicsState.renderPass = *renderPass;
+                if (gpuScene) {
+                    gpuScene->setRenderPass(*renderPass);
+                }
+                if (textRenderer) {
+                    textRenderer->setRenderPass(*renderPass);
+                }
+#if VFRAME_DEBUG_DRAW
+                if (debugRenderer) {
+                    debugRenderer->setRenderPass(*renderPass);
+                }
+#endif
+                if (particleSystem) {
+                    particleSystem->setRenderPass(*renderPass);
+                }
+            }
             createFrameBuffers();
             createCommandBuffer();
+
+            if (shaderHotReload) {
+                shaderHotReload->resumeBuilds();
+            }
         }
 
         void
@@ -652,21 +1645,18 @@ namespace vf_vulkan {
                 }
                 swapChainFramebuffers.clear();
 
+                if (resourceTracker && depthAttachment.image != VK_NULL_HANDLE) {
+                    resourceTracker->forget(depthAttachment.image);
+                }
+                destroyAttachment(*device, depthAttachment);
+                destroyAttachment(*device, msaaColorAttachment);
+                destroyAttachment(*device, sceneColorTarget);
+
                 for (auto imageView : swapChainImageViews) {
                     vkDestroyImageView(*device, imageView, nullptr);
                 }
                 swapChainImageViews.clear();
 
-                if (graphicsPipeline.has_value()) {
-                    vkDestroyPipeline(*device, *graphicsPipeline, nullptr);
-                    graphicsPipeline.reset();
-                }
-
-                if (pipelineLayout.has_value()) {
-                    vkDestroyPipelineLayout(*device, *pipelineLayout, nullptr);
-                    pipelineLayout.reset();
-                }
-
                 if (renderPass.has_value()) {
                     vkDestroyRenderPass(*device, *renderPass, nullptr);
                     renderPass.reset();
@@ -797,16 +1787,17 @@ namespace vf_vulkan {
                 throw std::runtime_error("Validation layers requested, but not available!");
             }
 
+#if VFRAME_LOG_LEVEL <= 0
             uint32_t extensionCount = 0;
             vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
 
             std::vector<VkExtensionProperties> availableExtensions(extensionCount);
             vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
 
-            std::cout << "Available Vulkan extensions:\n";
             for (const auto& ext : availableExtensions) {
-                std::cout << "\t" << ext.extensionName << "\n";
+                VF_LOG_VERBOSE("vulkan", "available instance extension %s", ext.extensionName);
             }
+#endif
         }
 
         void
@@ -884,7 +1875,7 @@ namespace vf_vulkan {
             {
                 physicalDevice = candidates.rbegin()->second;
                 vkGetPhysicalDeviceProperties(*physicalDevice, &deviceProperties);
-                std::cout << "Selected physical device: " << deviceProperties.deviceName << std::endl;
+                VF_LOG_INFO("vulkan", "selected physical device: %s", deviceProperties.deviceName);
             }
             else
             {
@@ -911,16 +1902,114 @@ namespace vf_vulkan {
                 queueCreateInfos.push_back(queueCreateInfo);
             }
 
-            VkPhysicalDeviceFeatures deviceFeatures{}; // Enable any required features like geometry shaders, etc.
+            // Features for the GPU-driven scene (buffer device address, indirect count) are optional:
+            // enable what the device has, GpuScene falls back when something is missing
+            VkPhysicalDeviceVulkan12Features supported12{};
+            supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            VkPhysicalDeviceFeatures2 supportedFeatures{};
+            supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+            VkPhysicalDeviceVulkan13Features supported13{};
+            supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+            const bool hasVulkan12 = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+            const bool hasVulkan13 = deviceProperties.apiVersion >= VK_API_VERSION_1_3;
+            if (hasVulkan12) {
+                supportedFeatures.pNext = &supported12;
+            }
+            if (hasVulkan13) {
+                supported12.pNext = &supported13;
+            }
+
+            // Present id + present wait let the frame loop wait for the image to reach the screen
+            const bool hasPresentWait = hasDeviceExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+                hasDeviceExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+            VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId{};
+            supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+            VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait{};
+            supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+            if (hasPresentWait) {
+                supportedPresentWait.pNext = supportedFeatures.pNext;
+                supportedPresentId.pNext = &supportedPresentWait;
+                supportedFeatures.pNext = &supportedPresentId;
+            }
+            vkGetPhysicalDeviceFeatures2(*physicalDevice, &supportedFeatures);
+
+            VkPhysicalDeviceVulkan12Features enabled12{};
+            enabled12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            enabled12.bufferDeviceAddress = supported12.bufferDeviceAddress;
+            enabled12.drawIndirectCount = supported12.drawIndirectCount;
+
+            // Barriers go through vkCmdPipelineBarrier2 when the device has it (ResourceTracker)
+            VkPhysicalDeviceVulkan13Features enabled13{};
+            enabled13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+            enabled13.synchronization2 = supported13.synchronization2;
+            if (hasVulkan13) {
+                enabled12.pNext = &enabled13;
+            }
+
+            VkPhysicalDeviceFeatures2 deviceFeatures{}; // Enable any required features like geometry shaders, etc.
+            deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            deviceFeatures.pNext = hasVulkan12 ? &enabled12 : nullptr;
+            deviceFeatures.features.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+            // cull.comp passes the object index to scene.vert through firstInstance
+            deviceFeatures.features.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+            // Block-compressed textures are sampled as is where the device can, BCn is decoded on the CPU otherwise
+            deviceFeatures.features.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+            deviceFeatures.features.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
+            deviceFeatures.features.textureCompressionETC2 = supportedFeatures.features.textureCompressionETC2;
+            // scene.frag picks the texture of an object from an array by index
+            deviceFeatures.features.shaderSampledImageArrayDynamicIndexing = supportedFeatures.features.shaderSampledImageArrayDynamicIndexing;
+
+            supportsBufferDeviceAddress = hasVulkan12 && supported12.bufferDeviceAddress;
+            supportsDrawIndirectCount = hasVulkan12 && supported12.drawIndirectCount;
+            supportsMultiDrawIndirect = supportedFeatures.features.multiDrawIndirect == VK_TRUE;
+            supportsDrawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance == VK_TRUE;
+            supportsTextureArrayIndexing = supportedFeatures.features.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+            supportsSynchronization2 = hasVulkan13 && supported13.synchronization2;
+            supportsPresentWait = hasPresentWait && supportedPresentId.presentId && supportedPresentWait.presentWait;
+
+            std::vector<const char*> extensions = deviceExtensions;
+            VkPhysicalDevicePresentIdFeaturesKHR enabledPresentId{};
+            enabledPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+            VkPhysicalDevicePresentWaitFeaturesKHR enabledPresentWait{};
+            enabledPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+            if (supportsPresentWait) {
+                extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+                extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+                enabledPresentId.presentId = VK_TRUE;
+                enabledPresentWait.presentWait = VK_TRUE;
+                enabledPresentWait.pNext = deviceFeatures.pNext;
+                enabledPresentId.pNext = &enabledPresentWait;
+                deviceFeatures.pNext = &enabledPresentId;
+            }
+
+            // GPU trace zones are placed on the CPU timeline through calibrated timestamps
+            if (hasDeviceExtension(VK_KHR_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+                calibratedTimestampsExtension = VK_KHR_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+            }
+            else if (hasDeviceExtension(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+                calibratedTimestampsExtension = VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+            }
+            if (calibratedTimestampsExtension != nullptr) {
+                extensions.push_back(calibratedTimestampsExtension);
+            }
+
+            // Real heap budget and process usage instead of a guess from the heap size
+            supportsMemoryBudget = hasDeviceExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            if (supportsMemoryBudget) {
+                extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            }
 
             VkDeviceCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+            createInfo.pNext = &deviceFeatures; // Features go through VkPhysicalDeviceFeatures2 chain
             createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
             createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-            createInfo.pEnabledFeatures = &deviceFeatures;  // Enable required features
-            createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-            createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+            createInfo.pEnabledFeatures = nullptr;  // Must be null when VkPhysicalDeviceFeatures2 is chained
+            createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+            createInfo.ppEnabledExtensionNames = extensions.data();
 
             if (enableValidationLayers) {
                 createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -944,6 +2033,11 @@ namespace vf_vulkan {
             VkQueue tempPresentQueue;
             vkGetDeviceQueue(*device, indices.presentFamily.value(), 0, &tempPresentQueue);
             presentQueue = tempPresentQueue;
+
+            if (supportsPresentWait) {
+                waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(*device, "vkWaitForPresentKHR"));
+                supportsPresentWait = waitForPresent != nullptr;
+            }
         }
 
         void
@@ -953,6 +2047,7 @@ namespace vf_vulkan {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(*physicalDevice);
             VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
             VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+            activePresentMode = toPresentMode(presentMode);
             VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
             // Images rendering before presenting on screen
@@ -971,6 +2066,9 @@ namespace vf_vulkan {
             createInfo.imageExtent = extent; // Resolution of the images
             createInfo.imageArrayLayers = 1; // Number of layers in the images (1 for 2D images)
             createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; // Usage of the images (color attachment for rendering)
+            if (dynamicResolution) {
+                createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; // Upscaling blit
+            }
 
             /*Якщо малювання та показ кадру відбувається в різних чергах, зображення має бути доступне обом. (present, render)
 
@@ -1005,6 +2103,7 @@ namespace vf_vulkan {
                 throw std::runtime_error("failed to create swap chain!");
             }
             swapChain = tempSwapChain;
+            firstPresentId = presentId + 1; // Present ids of the old swap chain can not be waited on any more
 
             // Get the images in the swap chain
             vkGetSwapchainImagesKHR(*device, *swapChain, &imageCount, nullptr);
@@ -1045,22 +2144,135 @@ namespace vf_vulkan {
             }
         }
 
+        // Device dependent part of the render targets, fixed for the lifetime of the device
+        void
+        chooseRenderTargets()
+        {
+            depthFormat = depthEnabled ? findDepthFormat(*physicalDevice) : VK_FORMAT_UNDEFINED;
+            msaaSamples = findSampleCount(*physicalDevice, requestedSamples, depthEnabled);
+
+            // Particles read the depth of the previous frame from a buffer: a single sample copy of the attachment
+            if (particleSettings.depthCollisions) {
+                VkFormatProperties properties{};
+                if (depthEnabled) {
+                    vkGetPhysicalDeviceFormatProperties(*physicalDevice, depthFormat, &properties);
+                }
+                particleDepth = depthEnabled && msaaSamples == VK_SAMPLE_COUNT_1_BIT &&
+                    (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_TRANSFER_SRC_BIT) != 0;
+                if (!particleDepth) {
+                    VF_LOG_WARNING("render", "particle depth collisions need a depth buffer without MSAA, disabled");
+                }
+            }
+
+            // Upscaling is a linear blit into the swap chain image: needs TRANSFER_DST usage and blit support
+            if (dynamicResolutionRequested) {
+                SwapChainSupportDetails swapChainSupport = querySwapChainSupport(*physicalDevice);
+                VkFormat format = chooseSwapSurfaceFormat(swapChainSupport.formats).format;
+                VkFormatProperties properties;
+                vkGetPhysicalDeviceFormatProperties(*physicalDevice, format, &properties);
+
+                const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+                dynamicResolution = (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+                    (properties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+                if (dynamicResolution) {
+                    resolutionController = std::make_unique<ResolutionController>(resolutionSettings,
+                        static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+                }
+                else {
+                    VF_LOG_WARNING("render", "dynamic resolution is not supported by the swap chain, rendering at full size");
+                }
+            }
+        }
+
+        // Size of the render targets follows the swap chain
+        void
+        createRenderTargets()
+        {
+            // Neither is loaded before nor stored after the render pass: transient, lazily allocated where possible.
+            // Except depth with particle collisions, it is copied out after the pass
+            if (depthEnabled) {
+                VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                if (particleDepth) {
+                    depthUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                }
+                depthAttachment = createAttachment(*physicalDevice, *device, swapChainExtent, depthFormat, msaaSamples,
+                    depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT, !particleDepth, memoryTracker.get());
+            }
+            if (particleDepth) {
+                // Layout transitions of a combined format cover both aspects
+                VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+                if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+                    depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+                }
+                resourceTracker->trackImage(depthAttachment.image, depthAspect);
+                if (particleSystem) {
+                    particleSystem->setDepthSource(swapChainExtent, depthFormat);
+                }
+            }
+            if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+                msaaColorAttachment = createAttachment(*physicalDevice, *device, swapChainExtent, swapChainImageFormat, msaaSamples,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, true, memoryTracker.get());
+            }
+            // Stored and read by the blit, so not transient
+            if (dynamicResolution) {
+                sceneColorTarget = createAttachment(*physicalDevice, *device, swapChainExtent, swapChainImageFormat,
+                    VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    VK_IMAGE_ASPECT_COLOR_BIT, false, memoryTracker.get());
+            }
+        }
+
         void
         createRenderPass()
         {
+            const bool multisampled = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+            // Last layout of the image the subpass outputs: presented directly or blitted to the swap chain
+            const VkImageLayout outputLayout = dynamicResolution ?
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
             VkAttachmentDescription colorAttachment{};
             colorAttachment.format = swapChainImageFormat; // Такий самий формат зображення наприклад VK_FORMAT_B8G8R8A8_SRGB
-            colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT; // Без MSAA
+            colorAttachment.samples = msaaSamples;
             colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; //перед початком субпасу очищаємо буфер (до кольору, заданого у vkCmdBeginRenderPass).
-            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // після завершення кадру результат треба зберегти (щоб передати на екран).
+            // Without MSAA the result is kept to be presented, the multisampled image is only resolved
+            colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
             colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
             colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
             colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; //GPU може не турбуватись про попередній вміст (ми все одно зробимо CLEAR).
-            colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // ісля рендеру зображення одразу готове до vkQueuePresentKHR.
+            colorAttachment.finalLayout = multisampled ?
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : outputLayout; // ісля рендеру зображення одразу готове до vkQueuePresentKHR.
+
+            // Depth is only needed while the subpass runs, unless particles collide with it
+            VkAttachmentDescription depthAttachmentDesc{};
+            depthAttachmentDesc.format = depthFormat;
+            depthAttachmentDesc.samples = msaaSamples;
+            depthAttachmentDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            depthAttachmentDesc.storeOp = particleDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            depthAttachmentDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            depthAttachmentDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            depthAttachmentDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            depthAttachmentDesc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+            // Swap chain image receives the resolved samples, its old contents are overwritten completely
+            VkAttachmentDescription resolveAttachment{};
+            resolveAttachment.format = swapChainImageFormat;
+            resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            resolveAttachment.finalLayout = outputLayout;
+
+            // Attachment order matches createFrameBuffers and the clear values: color, depth, resolve
+            std::vector<VkAttachmentDescription> attachments = { colorAttachment };
+            if (depthEnabled) {
+                attachments.push_back(depthAttachmentDesc);
+            }
 
             // Subpasses and attachment referance
             VkAttachmentReference colorAttachmentRef{};
-            // 	VkAttachmentDescription alone so value is 0
             colorAttachmentRef.attachment = 0;
             /*	Vulkan will automatically transition the attachment to this layout
                 when the subpass is started.We intend to use the attachment to function as
@@ -1068,32 +2280,67 @@ namespace vf_vulkan {
                     will give us the best performance, as its name implies.*/
             colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+            VkAttachmentReference depthAttachmentRef{};
+            depthAttachmentRef.attachment = 1;
+            depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+            VkAttachmentReference resolveAttachmentRef{};
+            resolveAttachmentRef.attachment = static_cast<uint32_t>(attachments.size());
+            resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            if (multisampled) {
+                attachments.push_back(resolveAttachment);
+            }
+
             VkSubpassDependency dependency{};
             dependency.srcSubpass = VK_SUBPASS_EXTERNAL; // Зовнішні операції
             dependency.dstSubpass = 0; // Наш перший (і єдиний) суппас
 
-            // Які стадії конвеєра мають завершитися перед початком суппаса
-            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.srcAccessMask = 0; // Ми ще не записуємо в цю пам'ять
+            // Які стадії конвеєра мають завершитися перед початком суппаса:
+            // вихід кольору (чекає на семафор acquire) і тест глибини попереднього кадру, бо depth буфер спільний
+            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dependency.srcAccessMask = 0;
 
             // Які стадії конвеєра можуть початися після виконання залежності
-            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
             // GPU може записувати в кольоровий атачмент після цієї точки
             dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            if (depthEnabled) {
+                dependency.srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            }
+
+            // Scene color target is shared by the frames: the blit of the previous frame reads it (write after read),
+            // and the blit of this frame waits for the color output
+            VkSubpassDependency dependencies[2] = { dependency, {} };
+            if (dynamicResolution) {
+                dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+                dependencies[1].srcSubpass = 0;
+                dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+                dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+                dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            }
 
             VkSubpassDescription subpass{};
             // Support graphics subpasses
             subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
             subpass.colorAttachmentCount = 1; // Цей Subpass буде писав у наш кольоровий attachment
             subpass.pColorAttachments = &colorAttachmentRef;
+            subpass.pDepthStencilAttachment = depthEnabled ? &depthAttachmentRef : nullptr;
+            // Resolve happens at the end of the subpass, on tilers straight from tile memory
+            subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
 
             // Render Pass
             VkRenderPassCreateInfo renderPassInfo{};
             renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-            renderPassInfo.attachmentCount = 1; // Масив із одного VkAttachmentDescription.
-            renderPassInfo.pAttachments = &colorAttachment;
+            renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            renderPassInfo.pAttachments = attachments.data();
             renderPassInfo.subpassCount = 1; // масив із одного VkSubpassDescription.
             renderPassInfo.pSubpasses = &subpass;
+            renderPassInfo.dependencyCount = dynamicResolution ? 2 : 1;
+            renderPassInfo.pDependencies = dependencies;
 
 			VkRenderPass tempRenderPass;
             if (vkCreateRenderPass(*device, &renderPassInfo, nullptr,
@@ -1105,160 +2352,32 @@ namespace vf_vulkan {
 			renderPass = tempRenderPass; 
         }
 
+        // Compiled on the pipeline manager, the triangle is skipped until it is ready
         void
         createGraphicsPipeline()
         {
-            // This function would create the graphics pipeline, shaders, etc.
-            // For simplicity, we will not implement it in this example.
-            auto vertShaderCode =
-                readFile("shaders/vert.spv");
-            auto fragShaderCode =
-                readFile("shaders/frag.spv");
-
-            vertShaderModule = createShaderModule(vertShaderCode);
-            fragShaderModule = createShaderModule(fragShaderCode);
-
-            VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-            vertShaderStageInfo.sType =
-                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT; // Vertex shader stage
-            vertShaderStageInfo.module = vertShaderModule; // Shader module for vertex shader
-            vertShaderStageInfo.pName = "main"; // Entry point in the shader
-
-            VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-            fragShaderStageInfo.sType =
-                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT; // Fragment shader stage
-            fragShaderStageInfo.module = fragShaderModule; // Shader module for fragment shader
-            fragShaderStageInfo.pName = "main"; // Entry point in the shader
-
-            VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-            VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-            vertexInputInfo.sType =
-                VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-            // Тут ти кажеш Vulkan, що немає жодного прив’язування буферів вершин, тобто ти не передаєш жодних геометричних даних(це нормально, якщо наприклад ти жорстко задаєш вершини прямо в шейдері).
-            vertexInputInfo.vertexBindingDescriptionCount = 0;
-            vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-            // Те ж саме: ти не описуєш атрибути вершини, такі як позиція, колір, UV тощо.
-            vertexInputInfo.vertexAttributeDescriptionCount = 0;
-            vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-
-            // Input Assembly
-            VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-            inputAssembly.sType =
-                VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-            inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-            inputAssembly.primitiveRestartEnable = VK_FALSE; // Restart strichky (for strip)
-
-            // Viewport and scrirros
-            VkViewport viewport{};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = (float)swapChainExtent.width;
-            viewport.height = (float)swapChainExtent.height;
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-
-            VkRect2D scissor{};
-            scissor.offset = { 0, 0 };
-            scissor.extent = swapChainExtent;
-
-            // And then you only need to specify their count at pipeline creation time:
-            VkPipelineViewportStateCreateInfo viewportState{};
-            viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-            viewportState.viewportCount = 1;
-            viewportState.pViewports = &viewport;
-            viewportState.scissorCount = 1;
-            viewportState.pScissors = &scissor;
-
-            std::vector<VkDynamicState> dynamicStates = {
-                VK_DYNAMIC_STATE_VIEWPORT, // Dynamic viewport state
-                VK_DYNAMIC_STATE_SCISSOR // Dynamic scissor state
-            };
-
-            VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
-            dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-            dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-            dynamicStateInfo.pDynamicStates = dynamicStates.data(); // Pointer to the dynamic states
-
-            // Rasterizer
-            VkPipelineRasterizationStateCreateInfo rasterizer{};
-            rasterizer.sType =
-                VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-            rasterizer.depthClampEnable = VK_FALSE; // Якщо ці картинки вийшли за межі ближньої та далекої площин то затискається до них а не відкидається це корисно для карти тінів
-            rasterizer.rasterizerDiscardEnable = VK_FALSE; // Якщо для rasterizerDiscardEnable встановлено значення VK_TRUE, то геометрія ніколи не проходить через етап растеризації. Це фактично вимикає будь-який вивід до буфера кадру.
-            rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-            // Товшина ліній
-            rasterizer.lineWidth = 1.0f;
-            // Чи ми будем рендирити сзадню частину
-            rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-            // Яку саме будем вважати заадньою частиною
-            rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-            // Це невеликий додатковий зсув значень глибини (depth) для полігонів під час растеризації.
-            rasterizer.depthBiasEnable = VK_FALSE;
-            rasterizer.depthBiasConstantFactor = 0.0f; // Optional константний зсув глибини.
-            rasterizer.depthBiasClamp = 0.0f; // Optional  зсув залежно від кута нахилу полігону (для більш точного усунення артефактів на нахилених поверхнях).
-            rasterizer.depthBiasSlopeFactor = 0.0f; // Optional	максимальне обмеження зсуву.
-
-            // Multisampling
-            VkPipelineMultisampleStateCreateInfo multisampling{};
-            multisampling.sType =
-                VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-            multisampling.sampleShadingEnable = VK_FALSE; // в нашому випадку він не потрібний для трикутника
-            multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-            multisampling.minSampleShading = 1.0f; // Optional
-            multisampling.pSampleMask = nullptr; // Optional
-            multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-            multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-            // Color blending
-            /*
-            After a fragment shader has returned a color, it needs to be combined with the
-            color that is already in the framebuffer. This transformation is known as color
-            blending and there are two ways to do it:
-                • Mix the old and new value to produce a final color
-                • Combine the old and new value using a bitwise operation */
-            VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-            colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
-                VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
-                VK_COLOR_COMPONENT_A_BIT;
-            colorBlendAttachment.blendEnable = VK_FALSE;
-            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;  // Множник для кольору джерела (ми множим на 1 тому без змін)
-            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Множим на 0 (ігнорувати старий колір)
-            colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;             // Додати 2 кольори з урахуванням множників
-            // Це все аналогічно тільки для альфа каналу
-            colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-            colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-            colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-            // Псевдо код
-            /*	if (blendEnable) {
-                finalColor.rgb = (srcColorBlendFactor * newColor.rgb)
-                    < colorBlendOp > (dstColorBlendFactor * oldColor.rgb);
-                finalColor.a = (srcAlphaBlendFactor * newColor.a) < alphaBlendOp >
-                    (dstAlphaBlendFactor * oldColor.a);
-
-            }
-            else {
-                finalColor = newColor;
-
-            }
-                finalColor = finalColor & colorWriteMask;*/
-
-            VkPipelineColorBlendStateCreateInfo colorBlending{};
-            colorBlending.sType =
-                VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-            colorBlending.logicOpEnable = VK_FALSE;              // Чи включені логічні операції замість змішування кольору
-            colorBlending.logicOp = VK_LOGIC_OP_COPY;            // Копіювання кольору без змін
-            colorBlending.attachmentCount = 1;                   // Кількість вкладених структур VkPipelineColorBlendAttachmentState — тобто скільки color attachment в рендері буде конфігуровано. У твоєму випадку — 1 (зазвичай для одного кольорового буфера).
-            colorBlending.pAttachments = &colorBlendAttachment;  // Вказівник на елемент структур де описані налаштування змішування
-            // Константи змішування кольорів (RGBA)
-            colorBlending.blendConstants[0] = 0.0f;
-            colorBlending.blendConstants[1] = 0.0f;
-            colorBlending.blendConstants[2] = 0.0f;
-            colorBlending.blendConstants[3] = 0.0f;
+            if (!pipelineLayout.has_value()) {
+                createPipelineLayout();
+            }
+
+            graphicsState.vertexShader = ShaderCode::fromSpirv(readFile("shaders/vert.spv"));
+            graphicsState.fragmentShader = ShaderCode::fromSpirv(readFile("shaders/frag.spv"));
+            graphicsState.layout = *pipelineLayout;
+            graphicsState.renderPass = *renderPass;
+            graphicsState.colorFormat = swapChainImageFormat;
+            graphicsState.depthFormat = depthFormat;
+            graphicsState.samples = msaaSamples;
+            graphicsState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+            graphicsState.cullMode = VK_CULL_MODE_BACK_BIT;
+            graphicsState.frontFace = VK_FRONT_FACE_CLOCKWISE;
+            graphicsState.blend = BlendMode::NONE;
+
+            graphicsPipeline = pipelineManager->requestGraphics(graphicsState);
+        }
 
+        void
+        createPipelineLayout()
+        {
             // Pipeline layout
             VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
             pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -1279,36 +2398,16 @@ namespace vf_vulkan {
                 throw std::runtime_error("Failed to create pipeline layout!");
             }
             pipelineLayout = tempPipelineLayout;
+        }
 
-            VkGraphicsPipelineCreateInfo pipelineInfo{};
-            pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-            pipelineInfo.stageCount = 2;
-            pipelineInfo.pStages = shaderStages;
-            pipelineInfo.pVertexInputState = &vertexInputInfo;
-            pipelineInfo.pInputAssemblyState = &inputAssembly;
-            pipelineInfo.pViewportState = &viewportState;
-            pipelineInfo.pRasterizationState = &rasterizer;
-            pipelineInfo.pMultisampleState = &multisampling;
-            pipelineInfo.pDepthStencilState = nullptr; // Optional
-            pipelineInfo.pColorBlendState = &colorBlending;
-            pipelineInfo.pDynamicState = &dynamicStateInfo;
-            //Then we reference all of the structures describing the fixed-function stage.
-            pipelineInfo.layout = *pipelineLayout;
-            // After that comes the pipeline layout, which is a Vulkan handle rather than a struct pointer
-            pipelineInfo.renderPass = *renderPass;
-            pipelineInfo.subpass = 0;
-            // Optionals
-            pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-            pipelineInfo.basePipelineIndex = -1;
-
-            VkPipeline tempGraphicsPipeline;
-            if (vkCreateGraphicsPipelines(*device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                &tempGraphicsPipeline) != VK_SUCCESS)
-            {
-                throw std::runtime_error("failed to create graphics pipeline!");
-            }
-
-            graphicsPipeline = tempGraphicsPipeline;
+        // Same state with other shaders (shader hot reload), runs on a worker thread
+        VkPipeline
+        buildGraphicsPipeline(const std::vector<char>& vertShaderCode, const std::vector<char>& fragShaderCode)
+        {
+            PipelineState state = graphicsState;
+            state.vertexShader = ShaderCode::fromSpirv(vertShaderCode);
+            state.fragmentShader = ShaderCode::fromSpirv(fragShaderCode);
+            return vf_vulkan::createGraphicsPipeline(*device, pipelineManager->cache(), state);
         }
 
         // Framebuffer	Об’єкт, що містить зображення для малювання (attachments)
@@ -1319,17 +2418,24 @@ namespace vf_vulkan {
             swapChainFramebuffers.resize(swapChainImageViews.size());
             for (size_t i = 0; i < swapChainImageViews.size(); i++)
             {
-                VkImageView attachments[] = {
-                    swapChainImageViews[i],
-                };
+                // Same order as in createRenderPass: color (MSAA or the output image), depth, resolve
+                VkImageView output = dynamicResolution ? sceneColorTarget.view : swapChainImageViews[i];
+                std::vector<VkImageView> attachments;
+                attachments.push_back(msaaSamples != VK_SAMPLE_COUNT_1_BIT ? msaaColorAttachment.view : output);
+                if (depthEnabled) {
+                    attachments.push_back(depthAttachment.view);
+                }
+                if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+                    attachments.push_back(output);
+                }
 
                 // It this trongly attachments and layers must be same in Render Pass
                 VkFramebufferCreateInfo framebufferInfo{};
                 framebufferInfo.sType =
                     VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
                 framebufferInfo.renderPass = *renderPass;
-                framebufferInfo.attachmentCount = 1;
-                framebufferInfo.pAttachments = attachments;
+                framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+                framebufferInfo.pAttachments = attachments.data();
                 framebufferInfo.width = swapChainExtent.width;
                 framebufferInfo.height = swapChainExtent.height;
                 framebufferInfo.layers = 1;
@@ -1448,6 +2554,173 @@ namespace vf_vulkan {
         pImpl->drawFrame();
 	}
 
+    void
+    VulkanContext::setSceneCapacity(uint32_t maxObjects, uint32_t maxVertices, uint32_t maxIndices) {
+        pImpl->setSceneCapacity(maxObjects, maxVertices, maxIndices);
+    }
+
+    MeshRange
+    VulkanContext::uploadSceneMesh(const SceneVertex* vertices, uint32_t vertexCount,
+        const uint32_t* indices, uint32_t indexCount) {
+        return pImpl->uploadSceneMesh(vertices, vertexCount, indices, indexCount);
+    }
+
+    SceneMesh
+    VulkanContext::loadSceneMesh(const char* filename) {
+        return pImpl->loadSceneMesh(filename);
+    }
+
+    uint32_t
+    VulkanContext::addSceneObjects(const SceneObjectDesc* objects, uint32_t count) {
+        return pImpl->addSceneObjects(objects, count);
+    }
+
+    void
+    VulkanContext::clearSceneObjects() {
+        pImpl->clearSceneObjects();
+    }
+
+    void
+    VulkanContext::setCamera(const float viewProjection[16], const float cameraPosition[3]) {
+        pImpl->setCamera(viewProjection, cameraPosition);
+    }
+
+    void
+    VulkanContext::mountAssetArchive(const char* filename) {
+        pImpl->mountAssetArchive(filename);
+    }
+
+    TextureHandle
+    VulkanContext::loadTexture(const char* filename) {
+        return pImpl->loadTexture(filename);
+    }
+
+    void
+    VulkanContext::setTextureDemand(TextureHandle texture, float screenPixels) {
+        pImpl->setTextureDemand(texture, screenPixels);
+    }
+
+    void
+    VulkanContext::setTextureBudget(uint64_t bytes) {
+        pImpl->setTextureBudget(bytes);
+    }
+
+    TextureStreamingStats
+    VulkanContext::getTextureStats() const {
+        return pImpl->getTextureStats();
+    }
+
+    FontHandle
+    VulkanContext::loadFont(const char* filename, const vf_core::FontConfig& config) {
+        return pImpl->loadFont(filename, config);
+    }
+
+    void
+    VulkanContext::drawText(FontHandle font, const char* text, float x, float y, float size,
+        const float color[4], float maxWidth) {
+        pImpl->drawText(font, text, x, y, size, color, maxWidth);
+    }
+
+    void
+    VulkanContext::measureText(FontHandle font, const char* text, float size, float maxWidth, float& width, float& height) {
+        pImpl->measureText(font, text, size, maxWidth, width, height);
+    }
+
+    TextStats
+    VulkanContext::getTextStats() const {
+        return pImpl->getTextStats();
+    }
+
+    void
+    VulkanContext::setParticleSettings(const ParticleSettings& settings) {
+        pImpl->setParticleSettings(settings);
+    }
+
+    EmitterHandle
+    VulkanContext::addParticleEmitter(const ParticleEmitterDesc& desc) {
+        return pImpl->addParticleEmitter(desc);
+    }
+
+    void
+    VulkanContext::updateParticleEmitter(EmitterHandle emitter, const ParticleEmitterDesc& desc) {
+        pImpl->updateParticleEmitter(emitter, desc);
+    }
+
+    void
+    VulkanContext::removeParticleEmitter(EmitterHandle emitter) {
+        pImpl->removeParticleEmitter(emitter);
+    }
+
+    void
+    VulkanContext::burstParticles(EmitterHandle emitter, uint32_t count) {
+        pImpl->burstParticles(emitter, count);
+    }
+
+    ParticleStats
+    VulkanContext::getParticleStats() const {
+        return pImpl->getParticleStats();
+    }
+
+    PipelineStats
+    VulkanContext::getPipelineStats() const {
+        return pImpl->getPipelineStats();
+    }
+
+    void
+    VulkanContext::enableDynamicResolution(float targetMilliseconds, float minScale) {
+        pImpl->enableDynamicResolution(targetMilliseconds, minScale);
+    }
+
+    DynamicResolutionStats
+    VulkanContext::getDynamicResolutionStats() const {
+        return pImpl->getDynamicResolutionStats();
+    }
+
+    void
+    VulkanContext::setPresentMode(PresentMode mode) {
+        pImpl->setPresentMode(mode);
+    }
+
+    void
+    VulkanContext::setFrameLatency(uint32_t frames) {
+        pImpl->setFrameLatency(frames);
+    }
+
+    PresentStats
+    VulkanContext::getPresentStats() const {
+        return pImpl->getPresentStats();
+    }
+
+    MemoryStats
+    VulkanContext::getMemoryStats() const {
+        return pImpl->getMemoryStats();
+    }
+
+    void
+    VulkanContext::addMemoryWarning(float fraction, std::function<void(const MemoryStats&)> callback) {
+        pImpl->addMemoryWarning(fraction, std::move(callback));
+    }
+
+    void
+    VulkanContext::setRenderTargets(bool depth, uint32_t msaaSamples) {
+        pImpl->setRenderTargets(depth, msaaSamples);
+    }
+
+    void
+    VulkanContext::setPipelineCacheFile(const char* filename) {
+        pImpl->setPipelineCacheFile(filename);
+    }
+
+    void
+    VulkanContext::enableShaderHotReload(const char* sourceDir, const char* compiler) {
+        pImpl->enableShaderHotReload(sourceDir, compiler);
+    }
+
+    void
+    VulkanContext::watchShader(const char* source, const char* spvName) {
+        pImpl->watchShader(source, spvName);
+    }
+
     void
     VulkanContextDeleter::operator()(VulkanContext* ctx) const {
         if (ctx) {
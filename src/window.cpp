@@ -3,12 +3,13 @@
 #include <stdexcept>
 
 namespace vf_window {
-    Window::Window(int w, int h, const char* title) {
+    Window::Window(int w, int h, const char* title, bool visible) {
         if (!glfwInit())
             throw std::runtime_error("Failed to initialize GLFW");
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
         glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 
         window = glfwCreateWindow(w, h, title, nullptr, nullptr);
         if (!window) {
@@ -34,5 +35,9 @@ namespace vf_window {
     void Window::pollEvents() const {
         glfwPollEvents();
     }
+
+    void Window::setSize(int w, int h) {
+        glfwSetWindowSize(window, w, h);
+    }
 }
 
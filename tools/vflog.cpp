@@ -0,0 +1,113 @@
+﻿// vflog - prints a binary .vflog file written by vf_core::logOpenBinaryFile as text
+//
+// Usage: vflog [--level <verbose|info|warning|severe>] [--category <name>] <input.vflog>
+//
+// One line per record: seconds since the file was opened, thread number, level, category, message.
+// A truncated last record (the process died while writing) is reported and ignored.
+
+#include <vFrame/vf_log_format.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using vf_core::VfLogFileHeader;
+using vf_core::VfLogRecord;
+
+namespace {
+
+    const char* const LEVEL_NAMES[] = { "VERBOSE", "INFO", "WARNING", "SEVERE" };
+
+    // Returns -1 for an unknown name
+    int
+    parseLevel(const std::string& name)
+    {
+        const char* const names[] = { "verbose", "info", "warning", "severe" };
+        for (int i = 0; i < 4; i++) {
+            if (name == names[i]) return i;
+        }
+        return -1;
+    }
+
+    void
+    dump(const std::string& filename, uint32_t minimumLevel, const std::string& category)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filename);
+        }
+
+        VfLogFileHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != vf_core::VF_LOG_MAGIC) {
+            throw std::runtime_error("not a vflog file: " + filename);
+        }
+        if (header.version != vf_core::VF_LOG_VERSION) {
+            throw std::runtime_error("unsupported vflog version " + std::to_string(header.version));
+        }
+
+        std::string recordCategory;
+        std::string message;
+        uint64_t count = 0;
+        VfLogRecord record{};
+        while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            recordCategory.resize(record.categoryLength);
+            message.resize(record.messageLength);
+            if (!file.read(&recordCategory[0], record.categoryLength) || !file.read(&message[0], record.messageLength)) {
+                std::cerr << "vflog: truncated record after " << count << " records" << std::endl;
+                return;
+            }
+            count++;
+
+            if (record.level < minimumLevel) continue;
+            if (!category.empty() && recordCategory != category) continue;
+
+            const char* levelName = record.level < 4 ? LEVEL_NAMES[record.level] : "?";
+            std::printf("[%10.6f] [%u] %s %s: %s\n", (record.nanoseconds - header.startNanoseconds) / 1e9, record.threadId,
+                levelName, recordCategory.c_str(), message.c_str());
+        }
+        if (file.gcount() != 0) {
+            std::cerr << "vflog: truncated record after " << count << " records" << std::endl;
+        }
+    }
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+    uint32_t minimumLevel = 0;
+    std::string category;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--level" && i + 1 < argc) {
+            const int level = parseLevel(argv[++i]);
+            if (level < 0) {
+                std::cerr << "vflog: unknown level " << argv[i] << std::endl;
+                return 1;
+            }
+            minimumLevel = static_cast<uint32_t>(level);
+        }
+        else if (arg == "--category" && i + 1 < argc) category = argv[++i];
+        else positional.push_back(arg);
+    }
+
+    if (positional.size() != 1) {
+        std::cerr << "usage: vflog [--level <verbose|info|warning|severe>] [--category <name>] <input.vflog>" << std::endl;
+        return 1;
+    }
+
+    try {
+        dump(positional[0], minimumLevel, category);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "vflog: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,301 @@
+﻿// vfmesh_cook - offline converter Wavefront OBJ -> cooked .vfmesh
+//
+// Usage: vfmesh_cook <input.obj> <output.vfmesh>
+//
+// Polygons are triangulated as fans, identical v/vt/vn triplets are merged
+// and missing normals are generated from faces. The output is loaded with
+// VulkanContext::loadSceneMesh without any parsing.
+
+#include <vFrame/vf_mesh_format.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using vf_vulkan::SceneVertex;
+using vf_vulkan::VfMeshHeader;
+
+namespace {
+
+    struct ObjIndex {
+        int position = 0;
+        int uv = 0;
+        int normal = 0;
+    };
+
+    // Resolved v/vt/vn indices, -1 for a missing or out of range vt/vn. Relative indices name
+    // different vertices on different lines, so the face token itself is no key
+    struct VertexKey {
+        int position = -1;
+        int uv = -1;
+        int normal = -1;
+
+        bool operator==(const VertexKey& other) const
+        {
+            return position == other.position && uv == other.uv && normal == other.normal;
+        }
+    };
+
+    struct VertexKeyHash {
+        size_t
+        operator()(const VertexKey& key) const
+        {
+            size_t hash = std::hash<int>()(key.position);
+            hash = hash * 31 + std::hash<int>()(key.uv);
+            return hash * 31 + std::hash<int>()(key.normal);
+        }
+    };
+
+    struct MeshData {
+        std::vector<SceneVertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    bool
+    endsWith(const std::string& value, const std::string& suffix)
+    {
+        return value.size() >= suffix.size() &&
+            value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // OBJ indices are 1-based, negative values are relative to the end of the list
+    int
+    resolveIndex(int index, size_t count)
+    {
+        if (index > 0) return index - 1;
+        if (index < 0) return static_cast<int>(count) + index;
+        return -1;
+    }
+
+    ObjIndex
+    parseFaceVertex(const std::string& token)
+    {
+        ObjIndex result;
+        int* fields[3] = { &result.position, &result.uv, &result.normal };
+
+        size_t start = 0;
+        for (int field = 0; field < 3 && start <= token.size(); field++) {
+            size_t end = token.find('/', start);
+            std::string part = token.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            if (!part.empty()) {
+                *fields[field] = std::stoi(part);
+            }
+            if (end == std::string::npos) break;
+            start = end + 1;
+        }
+        return result;
+    }
+
+    MeshData
+    loadObj(const std::string& filename)
+    {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filename);
+        }
+
+        std::vector<float> positions;
+        std::vector<float> uvs;
+        std::vector<float> normals;
+        bool hasNormals = false;
+
+        MeshData mesh;
+        std::unordered_map<VertexKey, uint32_t, VertexKeyHash> uniqueVertices;
+
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream stream(line);
+            std::string type;
+            stream >> type;
+
+            if (type == "v") {
+                float x = 0, y = 0, z = 0;
+                stream >> x >> y >> z;
+                positions.insert(positions.end(), { x, y, z });
+            }
+            else if (type == "vt") {
+                float u = 0, v = 0;
+                stream >> u >> v;
+                uvs.insert(uvs.end(), { u, 1.0f - v }); // Vulkan has V pointing down
+            }
+            else if (type == "vn") {
+                float x = 0, y = 0, z = 0;
+                stream >> x >> y >> z;
+                normals.insert(normals.end(), { x, y, z });
+            }
+            else if (type == "f") {
+                std::vector<uint32_t> polygon;
+                std::string token;
+                while (stream >> token) {
+                    ObjIndex index = parseFaceVertex(token);
+                    VertexKey key;
+                    key.position = resolveIndex(index.position, positions.size() / 3);
+                    key.uv = resolveIndex(index.uv, uvs.size() / 2);
+                    key.normal = resolveIndex(index.normal, normals.size() / 3);
+                    if (key.position < 0 || static_cast<size_t>(key.position) >= positions.size() / 3) {
+                        throw std::runtime_error("invalid face index in: " + filename);
+                    }
+                    if (key.uv < 0 || static_cast<size_t>(key.uv) >= uvs.size() / 2) key.uv = -1;
+                    if (key.normal < 0 || static_cast<size_t>(key.normal) >= normals.size() / 3) key.normal = -1;
+
+                    auto it = uniqueVertices.find(key);
+                    if (it != uniqueVertices.end()) {
+                        polygon.push_back(it->second);
+                        continue;
+                    }
+
+                    SceneVertex vertex{};
+                    std::memcpy(vertex.position, &positions[key.position * 3], sizeof(vertex.position));
+                    if (key.uv >= 0) {
+                        std::memcpy(vertex.uv, &uvs[key.uv * 2], sizeof(vertex.uv));
+                    }
+                    if (key.normal >= 0) {
+                        std::memcpy(vertex.normal, &normals[key.normal * 3], sizeof(vertex.normal));
+                        hasNormals = true;
+                    }
+
+                    uint32_t newIndex = static_cast<uint32_t>(mesh.vertices.size());
+                    mesh.vertices.push_back(vertex);
+                    uniqueVertices.emplace(key, newIndex);
+                    polygon.push_back(newIndex);
+                }
+
+                for (size_t i = 2; i < polygon.size(); i++) {
+                    mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+                }
+            }
+        }
+
+        if (!hasNormals) {
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                SceneVertex& a = mesh.vertices[mesh.indices[i]];
+                SceneVertex& b = mesh.vertices[mesh.indices[i + 1]];
+                SceneVertex& c = mesh.vertices[mesh.indices[i + 2]];
+                float e1[3], e2[3];
+                for (int k = 0; k < 3; k++) {
+                    e1[k] = b.position[k] - a.position[k];
+                    e2[k] = c.position[k] - a.position[k];
+                }
+                // Not normalized: bigger faces weigh more
+                float n[3] = {
+                    e1[1] * e2[2] - e1[2] * e2[1],
+                    e1[2] * e2[0] - e1[0] * e2[2],
+                    e1[0] * e2[1] - e1[1] * e2[0]
+                };
+                for (SceneVertex* v : { &a, &b, &c }) {
+                    for (int k = 0; k < 3; k++) v->normal[k] += n[k];
+                }
+            }
+            for (SceneVertex& v : mesh.vertices) {
+                float length = std::sqrt(v.normal[0] * v.normal[0] + v.normal[1] * v.normal[1] + v.normal[2] * v.normal[2]);
+                if (length > 0.0f) {
+                    for (int k = 0; k < 3; k++) v.normal[k] /= length;
+                }
+            }
+        }
+
+        return mesh;
+    }
+
+    void
+    writeMesh(const std::string& filename, const MeshData& mesh)
+    {
+        VfMeshHeader header{};
+        header.magic = vf_vulkan::VF_MESH_MAGIC;
+        header.version = vf_vulkan::VF_MESH_VERSION;
+        header.vertexStride = sizeof(SceneVertex);
+        header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        header.lodCount = 1;
+        header.lods[0].firstIndex = 0;
+        header.lods[0].indexCount = header.indexCount;
+
+        header.vertexDataOffset = vf_vulkan::vfMeshAlignOffset(sizeof(VfMeshHeader));
+        header.indexDataOffset = vf_vulkan::vfMeshAlignOffset(header.vertexDataOffset +
+            sizeof(SceneVertex) * mesh.vertices.size());
+
+        // Bounding sphere around the AABB center
+        float minP[3] = { 0, 0, 0 }, maxP[3] = { 0, 0, 0 };
+        if (!mesh.vertices.empty()) {
+            std::memcpy(minP, mesh.vertices[0].position, sizeof(minP));
+            std::memcpy(maxP, mesh.vertices[0].position, sizeof(maxP));
+        }
+        for (const SceneVertex& v : mesh.vertices) {
+            for (int k = 0; k < 3; k++) {
+                minP[k] = std::min(minP[k], v.position[k]);
+                maxP[k] = std::max(maxP[k], v.position[k]);
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            header.boundsCenter[k] = 0.5f * (minP[k] + maxP[k]);
+        }
+        float radiusSq = 0.0f;
+        for (const SceneVertex& v : mesh.vertices) {
+            float d[3] = { v.position[0] - header.boundsCenter[0], v.position[1] - header.boundsCenter[1], v.position[2] - header.boundsCenter[2] };
+            radiusSq = std::max(radiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        }
+        header.boundsRadius = std::sqrt(radiusSq);
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to create file: " + filename);
+        }
+
+        auto padTo = [&file](uint64_t offset) {
+            static const char zeros[vf_vulkan::VF_MESH_STREAM_ALIGNMENT] = {};
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(offset - position));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        padTo(header.vertexDataOffset);
+        file.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+            static_cast<std::streamsize>(sizeof(SceneVertex) * mesh.vertices.size()));
+        padTo(header.indexDataOffset);
+        file.write(reinterpret_cast<const char*>(mesh.indices.data()),
+            static_cast<std::streamsize>(sizeof(uint32_t) * mesh.indices.size()));
+
+        if (!file) {
+            throw std::runtime_error("failed to write file: " + filename);
+        }
+    }
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cerr << "usage: vfmesh_cook <input.obj> <output.vfmesh>" << std::endl;
+        return 1;
+    }
+
+    const std::string input = argv[1];
+    const std::string output = argv[2];
+
+    try {
+        if (endsWith(input, ".gltf") || endsWith(input, ".glb")) {
+            throw std::runtime_error("glTF input is not supported yet, export the mesh to OBJ");
+        }
+
+        MeshData mesh = loadObj(input);
+        writeMesh(output, mesh);
+        std::cout << output << ": " << mesh.vertices.size() << " vertices, "
+            << mesh.indices.size() / 3 << " triangles" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "vfmesh_cook: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+﻿// vfpak - packs a directory into a .vfpak asset archive
+//
+// Usage: vfpak [--none | --lz4 | --zstd] [--store <ext>]... <input dir> <output.vfpak>
+//
+// Paths inside the archive are relative to the input directory with '/' separators,
+// so "shaders/vert.spv" is found by VulkanContext exactly as the loose file was.
+// Each entry is compressed with the selected codec (zstd, else LZ4, by default when available)
+// and stored as is when that does not make it smaller. Extensions given with --store
+// (default: .ktx2) are always stored as is: textures are streamed from the mapping mip by mip.
+
+#include <vFrame/vf_pak_format.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef VFRAME_HAS_LZ4
+#include <lz4hc.h>
+#endif
+#ifdef VFRAME_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace fs = std::filesystem;
+using vf_vulkan::VfPakEntry;
+using vf_vulkan::VfPakHeader;
+
+namespace {
+
+    struct InputFile {
+        std::string path;
+        std::vector<uint8_t> stored;
+        uint64_t size = 0;
+        uint32_t compression = vf_vulkan::VF_PAK_COMPRESSION_NONE;
+    };
+
+    std::vector<uint8_t>
+    readBinary(const fs::path& filename)
+    {
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filename.string());
+        }
+        std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return bytes;
+    }
+
+    // Returns an empty vector when the codec is not available or the data does not shrink
+    std::vector<uint8_t>
+    compress(uint32_t compression, const std::vector<uint8_t>& raw)
+    {
+        std::vector<uint8_t> result;
+        switch (compression) {
+#ifdef VFRAME_HAS_LZ4
+        case vf_vulkan::VF_PAK_COMPRESSION_LZ4: {
+            result.resize(static_cast<size_t>(LZ4_compressBound(static_cast<int>(raw.size()))));
+            int written = LZ4_compress_HC(reinterpret_cast<const char*>(raw.data()), reinterpret_cast<char*>(result.data()),
+                static_cast<int>(raw.size()), static_cast<int>(result.size()), LZ4HC_CLEVEL_MAX);
+            result.resize(written > 0 ? static_cast<size_t>(written) : 0);
+            break;
+        }
+#endif
+#ifdef VFRAME_HAS_ZSTD
+        case vf_vulkan::VF_PAK_COMPRESSION_ZSTD: {
+            result.resize(ZSTD_compressBound(raw.size()));
+            size_t written = ZSTD_compress(result.data(), result.size(), raw.data(), raw.size(), 19);
+            result.resize(ZSTD_isError(written) ? 0 : written);
+            break;
+        }
+#endif
+        default:
+            break;
+        }
+
+        if (result.size() >= raw.size()) {
+            result.clear();
+        }
+        return result;
+    }
+
+    uint32_t
+    defaultCompression()
+    {
+#if defined(VFRAME_HAS_ZSTD)
+        return vf_vulkan::VF_PAK_COMPRESSION_ZSTD;
+#elif defined(VFRAME_HAS_LZ4)
+        return vf_vulkan::VF_PAK_COMPRESSION_LZ4;
+#else
+        return vf_vulkan::VF_PAK_COMPRESSION_NONE;
+#endif
+    }
+
+    void
+    writeArchive(const std::string& filename, std::vector<InputFile>& files)
+    {
+        std::sort(files.begin(), files.end(), [](const InputFile& a, const InputFile& b) {
+            uint64_t ha = vf_vulkan::vfPakHashPath(a.path.data(), a.path.size());
+            uint64_t hb = vf_vulkan::vfPakHashPath(b.path.data(), b.path.size());
+            return ha != hb ? ha < hb : a.path < b.path;
+        });
+
+        VfPakHeader header{};
+        header.magic = vf_vulkan::VF_PAK_MAGIC;
+        header.version = vf_vulkan::VF_PAK_VERSION;
+        header.entryCount = static_cast<uint32_t>(files.size());
+        header.entriesOffset = sizeof(VfPakHeader);
+        header.stringsOffset = header.entriesOffset + sizeof(VfPakEntry) * files.size();
+
+        std::string strings;
+        std::vector<VfPakEntry> entries(files.size());
+        for (size_t i = 0; i < files.size(); i++) {
+            entries[i].pathHash = vf_vulkan::vfPakHashPath(files[i].path.data(), files[i].path.size());
+            entries[i].pathOffset = static_cast<uint32_t>(strings.size());
+            entries[i].pathLength = static_cast<uint32_t>(files[i].path.size());
+            strings += files[i].path;
+        }
+        header.stringsSize = strings.size();
+
+        uint64_t offset = vf_vulkan::vfPakAlignOffset(header.stringsOffset + header.stringsSize);
+        for (size_t i = 0; i < files.size(); i++) {
+            entries[i].dataOffset = offset;
+            entries[i].storedSize = files[i].stored.size();
+            entries[i].size = files[i].size;
+            entries[i].compression = files[i].compression;
+            offset = vf_vulkan::vfPakAlignOffset(offset + entries[i].storedSize);
+        }
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to create file: " + filename);
+        }
+
+        auto padTo = [&file](uint64_t target) {
+            static const char zeros[vf_vulkan::VF_PAK_DATA_ALIGNMENT] = {};
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(target - position));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(VfPakEntry) * entries.size()));
+        file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        for (size_t i = 0; i < files.size(); i++) {
+            padTo(entries[i].dataOffset);
+            file.write(reinterpret_cast<const char*>(files[i].stored.data()), static_cast<std::streamsize>(files[i].stored.size()));
+        }
+
+        if (!file) {
+            throw std::runtime_error("failed to write file: " + filename);
+        }
+    }
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+    uint32_t compression = defaultCompression();
+    std::vector<std::string> storeExtensions;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--none") compression = vf_vulkan::VF_PAK_COMPRESSION_NONE;
+        else if (arg == "--lz4") compression = vf_vulkan::VF_PAK_COMPRESSION_LZ4;
+        else if (arg == "--zstd") compression = vf_vulkan::VF_PAK_COMPRESSION_ZSTD;
+        else if (arg == "--store" && i + 1 < argc) storeExtensions.push_back(argv[++i]);
+        else positional.push_back(arg);
+    }
+    if (storeExtensions.empty()) {
+        storeExtensions.push_back(".ktx2");
+    }
+
+    if (positional.size() != 2) {
+        std::cerr << "usage: vfpak [--none | --lz4 | --zstd] [--store <ext>]... <input dir> <output.vfpak>" << std::endl;
+        return 1;
+    }
+
+    try {
+#ifndef VFRAME_HAS_LZ4
+        if (compression == vf_vulkan::VF_PAK_COMPRESSION_LZ4) throw std::runtime_error("built without LZ4");
+#endif
+#ifndef VFRAME_HAS_ZSTD
+        if (compression == vf_vulkan::VF_PAK_COMPRESSION_ZSTD) throw std::runtime_error("built without zstd");
+#endif
+
+        const fs::path root = positional[0];
+        std::vector<InputFile> files;
+        uint64_t rawBytes = 0;
+        uint64_t storedBytes = 0;
+
+        for (const auto& item : fs::recursive_directory_iterator(root)) {
+            if (!item.is_regular_file()) continue;
+
+            InputFile input;
+            input.path = fs::relative(item.path(), root).generic_string();
+            std::vector<uint8_t> raw = readBinary(item.path());
+            input.size = raw.size();
+
+            const std::string extension = item.path().extension().string();
+            const bool store = std::find(storeExtensions.begin(), storeExtensions.end(), extension) != storeExtensions.end();
+
+            std::vector<uint8_t> packed = store ? std::vector<uint8_t>() : compress(compression, raw);
+            if (!packed.empty()) {
+                input.stored = std::move(packed);
+                input.compression = compression;
+            }
+            else {
+                input.stored = std::move(raw);
+            }
+
+            rawBytes += input.size;
+            storedBytes += input.stored.size();
+            files.push_back(std::move(input));
+        }
+
+        writeArchive(positional[1], files);
+        std::cout << positional[1] << ": " << files.size() << " files, " << rawBytes << " -> "
+            << storedBytes << " bytes" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "vfpak: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}